@@ -0,0 +1,114 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : enable
+#extension GL_GOOGLE_include_directive : require
+
+// Camera depth prepass. Position stream only, the packed attributes aren't bound.
+// Its depth has to match pbr.vert's bit for bit for the EQUAL test of the opaque
+// pass, both take the position from mesh_position.glsl.
+layout(location = 0) in vec3 inPos;
+
+invariant gl_Position;
+
+#define ALPHA_MODE_MASK 1u
+
+struct SceneData {
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    mat4 invView;
+    mat4 invProj;
+    mat4 lightSpaceMatrix;
+    mat4 cascadeViewProj[4];
+    mat4 prevViewProj;
+    vec4 frustumPlanes[6];
+    vec4 cascadeSplits;
+    vec4 cameraPos;
+    vec2 jitter;
+    int lightCount;
+    int irradianceIndex;
+    int prefilteredIndex;
+    int brdfLutIndex;
+    int shadowMapIndex;
+    int lightBufferIndex;
+    int headlampEnabled;
+    int visualizeCascades;
+    float shadowBias;
+    float shadowNormalBias;
+    int pcfRange;
+    float csmLambda;
+    int clusterBufferIndex;
+    int clusterGridBufferIndex;
+    int clusterLightIndexBufferIndex;
+    int gridX, gridY, gridZ;
+    float nearClip, farClip;
+    float screenWidth, screenHeight;
+    float iblIntensity;
+    int sceneColorIndex;
+    vec2 padding;
+};
+
+struct MeshInstance {
+    mat4 transform;
+    vec3 sphereCenter;
+    float sphereRadius;
+    uint materialIndex;
+    uint padding[3];
+};
+
+struct Material {
+    vec4 baseColorFactor;
+    vec4 emissiveFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float alphaCutoff;
+    uint alphaMode;
+
+    float transmissionFactor;
+    float ior;
+    float thicknessFactor;
+    uint doubleSided;
+
+    int baseColorTextureIndex;
+    int normalTextureIndex;
+    int metallicRoughnessTextureIndex;
+    int emissiveTextureIndex;
+
+    int occlusionTextureIndex;
+    int transmissionTextureIndex;
+    int thicknessTextureIndex;
+    uint padding;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer SceneDataBuffer {
+    SceneData scene;
+} allSceneBuffers[];
+
+layout(std430, set = 0, binding = 6) readonly buffer InstanceBuffer {
+    MeshInstance instances[];
+} allInstanceBuffers[];
+
+layout(std430, set = 0, binding = 2) readonly buffer MaterialBuffer {
+    Material materials[];
+} allMaterialBuffers[];
+
+layout(push_constant) uniform PushConstants {
+    uint sceneDataIndex;
+    uint instanceBufferIndex;
+    uint materialBufferIndex;
+} pc;
+
+#include "mesh_position.glsl"
+
+void main() {
+    SceneData scene = allSceneBuffers[pc.sceneDataIndex].scene;
+    MeshInstance instance = allInstanceBuffers[pc.instanceBufferIndex].instances[gl_InstanceIndex];
+
+    // Alpha tested surfaces need their UVs, they're left to the opaque pass (past the far plane)
+    if (allMaterialBuffers[pc.materialBufferIndex].materials[instance.materialIndex].alphaMode == ALPHA_MODE_MASK) {
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+        return;
+    }
+
+    vec4 worldPos = meshWorldPosition(instance.transform, inPos);
+    gl_Position = meshClipPosition(scene.viewProj, worldPos);
+}
@@ -0,0 +1,12 @@
+// World and clip space position of a mesh vertex, shared by pbr.vert, depth_prepass.vert and
+// visbuffer.vert. The opaque pass tests against the prepass depth with EQUAL, which
+// only holds if every one of them runs the same operations. Each one also declares
+// gl_Position invariant. Included, not compiled on its own.
+
+vec4 meshWorldPosition(mat4 transform, vec3 position) {
+  return transform * vec4(position, 1.0);
+}
+
+vec4 meshClipPosition(mat4 viewProj, vec4 worldPos) {
+  return viewProj * worldPos;
+}
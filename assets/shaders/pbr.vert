@@ -1,12 +1,14 @@
 #version 460
 #extension GL_EXT_nonuniform_qualifier : enable
 #extension GL_EXT_buffer_reference : enable
+#extension GL_GOOGLE_include_directive : require
 
+// Binding 0: position stream, binding 1: PackedVertex (see model.hpp)
 layout(location = 0) in vec3 inPos;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec2 inUV;
-layout(location = 3) in vec4 inTangent;
-layout(location = 4) in vec4 inColor;
+layout(location = 1) in vec2 inNormalOct;   // RG16 snorm
+layout(location = 2) in vec2 inUV;          // RG16 float
+layout(location = 3) in ivec2 inTangentOct; // RG16 sint, handedness in y's lowest bit
+layout(location = 4) in vec4 inColor;       // RGBA8 unorm
 
 layout(location = 0) out vec3 outWorldPos;
 layout(location = 1) out vec3 outNormal;
@@ -17,6 +19,9 @@ layout(location = 5) out flat uint outMaterialIndex;
 layout(location = 6) out vec4 outCurClipPos;
 layout(location = 7) out vec4 outPrevClipPos;
 
+// The depth prepass computes the same position, see mesh_position.glsl
+invariant gl_Position;
+
 // Structures (keeping them to compile, but unused)
 struct SceneData {
   mat4 view;
@@ -108,6 +113,16 @@ layout(push_constant) uniform PushConstants {
 }
 pc;
 
+#include "mesh_position.glsl"
+
+// Inverse of octEncode in model.cpp
+vec3 octDecode(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+  return normalize(n);
+}
+
 // ... (buffer definitions)
 void main() {
   SceneData scene = allSceneBuffers[pc.sceneDataIndex].scene;
@@ -118,18 +133,22 @@ void main() {
   mat4 modelMatrix = instance.transform;
   uint matIdx = instance.materialIndex;
 
-  vec4 worldPos = modelMatrix * vec4(inPos, 1.0);
+  vec4 worldPos = meshWorldPosition(modelMatrix, inPos);
   outWorldPos = worldPos.xyz;
 
+  vec3 normal = octDecode(inNormalOct);
+  vec3 tangent = octDecode(vec2(inTangentOct) / 32767.0);
+  float handedness = (inTangentOct.y & 1) != 0 ? -1.0 : 1.0;
+
   mat3 normalMatrix = mat3(modelMatrix);
-  outNormal = normalize(normalMatrix * inNormal);
-  outTangent = vec4(normalize(normalMatrix * inTangent.xyz), inTangent.w);
+  outNormal = normalize(normalMatrix * normal);
+  outTangent = vec4(normalize(normalMatrix * tangent), handedness);
 
   outUV = inUV;
   outColor = inColor;
   outMaterialIndex = matIdx; // instance.materialIndex;
 
-  gl_Position = scene.viewProj * worldPos;
+  gl_Position = meshClipPosition(scene.viewProj, worldPos);
 
   // Velocity Calculation
   outCurClipPos = gl_Position;
@@ -1,11 +1,8 @@
 #version 460
 #extension GL_EXT_nonuniform_qualifier : enable
 
+// Position stream only, the packed attributes aren't bound for depth-only passes
 layout(location = 0) in vec3 inPos;
-// layout(location = 1) in vec3 inNormal;
-// layout(location = 2) in vec2 inUV;
-// layout(location = 3) in vec4 inTangent;
-// layout(location = 4) in vec4 inColor;
 
 struct SceneData {
     mat4 view;
@@ -51,6 +48,30 @@ struct MeshInstance {
     uint padding[3];
 };
 
+struct Material {
+    vec4 baseColorFactor;
+    vec4 emissiveFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float alphaCutoff;
+    uint alphaMode;
+
+    float transmissionFactor;
+    float ior;
+    float thicknessFactor;
+    uint doubleSided;
+
+    int baseColorTextureIndex;
+    int normalTextureIndex;
+    int metallicRoughnessTextureIndex;
+    int emissiveTextureIndex;
+
+    int occlusionTextureIndex;
+    int transmissionTextureIndex;
+    int thicknessTextureIndex;
+    uint padding;
+};
+
 // Bindless Set #0
 layout(std430, set = 0, binding = 1) readonly buffer SceneDataBuffer {
     SceneData scene;
@@ -60,6 +81,10 @@ layout(std430, set = 0, binding = 6) readonly buffer InstanceBuffer {
     MeshInstance instances[];
 } allInstanceBuffers[];
 
+layout(std430, set = 0, binding = 2) readonly buffer MaterialBuffer {
+    Material materials[];
+} allMaterialBuffers[];
+
 // Push Constants
 layout(push_constant) uniform PushConstants {
     uint sceneDataIndex;
@@ -71,7 +96,7 @@ layout(push_constant) uniform PushConstants {
 void main() {
     SceneData scene = allSceneBuffers[pc.sceneDataIndex].scene;
     MeshInstance instance = allInstanceBuffers[pc.instanceBufferIndex].instances[gl_InstanceIndex];
-    
+
     mat4 shadowMatrix = scene.lightSpaceMatrix;
     if (pc.cascadeIndex < 4) {
         shadowMatrix = scene.cascadeViewProj[pc.cascadeIndex];
@@ -11,6 +11,7 @@ layout(push_constant) uniform PushConstants {
   float radius;
   float bias;
   float power;
+  uint sceneDataIndex;
 } pc;
 
 struct SceneData {
@@ -21,9 +22,11 @@ struct SceneData {
   mat4 invProj;
   mat4 lightSpaceMatrix;
   mat4 cascadeViewProj[4];
+  mat4 prevViewProj;
   vec4 frustumPlanes[6];
   vec4 cascadeSplits;
   vec4 cameraPos;
+  vec2 jitter;
   int lightCount;
   int irradianceIndex;
   int prefilteredIndex;
@@ -36,7 +39,15 @@ struct SceneData {
   float shadowNormalBias;
   int pcfRange;
   float csmLambda;
-  int padding1;
+  int clusterBufferIndex;
+  int clusterGridBufferIndex;
+  int clusterLightIndexBufferIndex;
+  int gridX, gridY, gridZ;
+  float nearClip, farClip;
+  float screenWidth, screenHeight;
+  float iblIntensity;
+  int sceneColorIndex;
+  vec2 padding;
 };
 
 // Bindless Set #0
@@ -65,7 +76,7 @@ vec3 getViewPos(vec2 uv, SceneData scene) {
 }
 
 void main() {
-  SceneData scene = allSceneBuffers[0].scene;
+  SceneData scene = allSceneBuffers[nonuniformEXT(pc.sceneDataIndex)].scene;
 
   float depth = texture(textures[nonuniformEXT(pc.depthTextureIndex)], inUV).r;
   if (depth >= 1.0) {
@@ -0,0 +1,62 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : enable
+
+// Depth-aware upsample of the half resolution SSAO (ssao.comp) into the full resolution target
+// composite.frag reads. A 4x4 half resolution neighbourhood, wide enough to average out the
+// interleaved 4x4 sampling pattern, is weighted by distance and by how close each tap's linear
+// depth is to this pixel's, so occlusion doesn't bleed across depth edges.
+layout(location = 0) in vec2 inUV;
+layout(location = 0) out float outSSAO;
+
+// Must match SSAOUpsamplePushConstants in renderer_system.cpp
+layout(push_constant) uniform PushConstants {
+    uint halfIndex;  // RG32_SFLOAT: AO, linear view distance
+    uint depthIndex; // Full resolution depth
+    float nearClip;
+    float farClip;
+} pc;
+
+// Relative depth difference at which a tap's weight falls to 1 / e
+#define DEPTH_TOLERANCE 0.05
+
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+
+void main() {
+    float depth = texture(textures[nonuniformEXT(pc.depthIndex)], inUV).r;
+    if (depth >= 1.0) {
+        outSSAO = 1.0;
+        return;
+    }
+    float distance = pc.nearClip * pc.farClip / (pc.farClip - depth * (pc.farClip - pc.nearClip));
+
+    ivec2 halfSize = textureSize(textures[nonuniformEXT(pc.halfIndex)], 0);
+    vec2 halfCoord = inUV * vec2(halfSize) - 0.5;
+    ivec2 base = ivec2(floor(halfCoord)) - 1;
+
+    float result = 0.0;
+    float weightSum = 0.0;
+    float nearestAO = 1.0;
+    float nearestDiff = 1e30;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            ivec2 tap = clamp(base + ivec2(x, y), ivec2(0), halfSize - 1);
+            vec2 tapValue = texelFetch(textures[nonuniformEXT(pc.halfIndex)], tap, 0).rg;
+            float diff = abs(tapValue.g - distance);
+
+            vec2 offset = vec2(base + ivec2(x, y)) - halfCoord;
+            float spatialWeight = exp(-dot(offset, offset) / 4.5); // sigma 1.5 half texels
+            float depthWeight = exp(-diff / (distance * DEPTH_TOLERANCE));
+            float w = spatialWeight * depthWeight;
+
+            result += tapValue.r * w;
+            weightSum += w;
+            if (diff < nearestDiff) {
+                nearestDiff = diff;
+                nearestAO = tapValue.r;
+            }
+        }
+    }
+
+    // No tap on this pixel's surface (thin geometry lost by the downsample)
+    outSSAO = weightSum > 1e-4 ? result / weightSum : nearestAO;
+}
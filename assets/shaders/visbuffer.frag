@@ -0,0 +1,67 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : enable
+
+layout(location = 0) in vec2 inUV;
+layout(location = 1) in flat uint inMaterialIndex;
+layout(location = 2) in flat uint inCommandIndex;
+
+// Draw command index << triangleBits | triangle within the command, cleared to ~0u
+layout(location = 0) out uint outVisibility;
+
+#define ALPHA_MODE_MASK 1u
+
+struct Material {
+    vec4 baseColorFactor;
+    vec4 emissiveFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float alphaCutoff;
+    uint alphaMode;
+
+    float transmissionFactor;
+    float ior;
+    float thicknessFactor;
+    uint doubleSided;
+
+    int baseColorTextureIndex;
+    int normalTextureIndex;
+    int metallicRoughnessTextureIndex;
+    int emissiveTextureIndex;
+
+    int occlusionTextureIndex;
+    int transmissionTextureIndex;
+    int thicknessTextureIndex;
+    uint padding;
+};
+
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+
+layout(std430, set = 0, binding = 2) readonly buffer MaterialBuffer {
+    Material materials[];
+} allMaterialBuffers[];
+
+// Must match VisibilityPushConstants in renderer_system.cpp
+layout(push_constant) uniform PushConstants {
+    uint sceneDataIndex;
+    uint instanceBufferIndex;
+    uint materialBufferIndex;
+    uint firstCommand;
+    uint triangleBits;
+} pc;
+
+void main() {
+    // Same test as pbr.frag, the resolve never sees the discarded pixels
+    Material mat = allMaterialBuffers[pc.materialBufferIndex].materials[inMaterialIndex];
+    if (mat.alphaMode == ALPHA_MODE_MASK) {
+        float alpha = mat.baseColorFactor.a;
+        if (mat.baseColorTextureIndex != -1) {
+            alpha *= textureLod(textures[nonuniformEXT(mat.baseColorTextureIndex)], inUV, 0.0).a;
+        }
+        if (alpha < mat.alphaCutoff) {
+            discard;
+        }
+    }
+
+    // gl_PrimitiveID restarts with every draw of the multi-draw
+    outVisibility = (inCommandIndex << pc.triangleBits) | uint(gl_PrimitiveID);
+}
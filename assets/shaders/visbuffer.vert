@@ -0,0 +1,91 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : enable
+#extension GL_GOOGLE_include_directive : require
+
+// Visibility pass: depth plus which triangle of which draw command covers each pixel,
+// shaded later by visbuffer_resolve.comp. Binding 0: position stream, binding 1: PackedVertex
+// (only the UV is read, alpha tested materials need it).
+layout(location = 0) in vec3 inPos;
+layout(location = 2) in vec2 inUV; // RG16 float
+
+layout(location = 0) out vec2 outUV;
+layout(location = 1) out flat uint outMaterialIndex;
+layout(location = 2) out flat uint outCommandIndex;
+
+// Same depth as pbr.vert and the prepass
+invariant gl_Position;
+
+struct SceneData {
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    mat4 invView;
+    mat4 invProj;
+    mat4 lightSpaceMatrix;
+    mat4 cascadeViewProj[4];
+    mat4 prevViewProj;
+    vec4 frustumPlanes[6];
+    vec4 cascadeSplits;
+    vec4 cameraPos;
+    vec2 jitter;
+    int lightCount;
+    int irradianceIndex;
+    int prefilteredIndex;
+    int brdfLutIndex;
+    int shadowMapIndex;
+    int lightBufferIndex;
+    int headlampEnabled;
+    int visualizeCascades;
+    float shadowBias;
+    float shadowNormalBias;
+    int pcfRange;
+    float csmLambda;
+    int clusterBufferIndex;
+    int clusterGridBufferIndex;
+    int clusterLightIndexBufferIndex;
+    int gridX, gridY, gridZ;
+    float nearClip, farClip;
+    float screenWidth, screenHeight;
+    float iblIntensity;
+    int sceneColorIndex;
+    vec2 padding;
+};
+
+struct MeshInstance {
+    mat4 transform;
+    vec3 sphereCenter;
+    float sphereRadius;
+    uint materialIndex;
+    uint padding[3];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer SceneBuffer {
+    SceneData scene;
+} allSceneBuffers[];
+
+layout(std430, set = 0, binding = 6) readonly buffer InstanceBuffer {
+    MeshInstance instances[];
+} allInstanceBuffers[];
+
+// Must match VisibilityPushConstants in renderer_system.cpp
+layout(push_constant) uniform PushConstants {
+    uint sceneDataIndex;
+    uint instanceBufferIndex;
+    uint materialBufferIndex;
+    uint firstCommand; // Draw command buffer region this draw call reads, gl_DrawID counts from there
+    uint triangleBits; // Low bits of the visibility ID holding the triangle, the command index sits above
+} pc;
+
+#include "mesh_position.glsl"
+
+void main() {
+    SceneData scene = allSceneBuffers[pc.sceneDataIndex].scene;
+    MeshInstance instance = allInstanceBuffers[pc.instanceBufferIndex].instances[gl_InstanceIndex];
+
+    vec4 worldPos = meshWorldPosition(instance.transform, inPos);
+    gl_Position = meshClipPosition(scene.viewProj, worldPos);
+
+    outUV = inUV;
+    outMaterialIndex = instance.materialIndex;
+    outCommandIndex = pc.firstCommand + gl_DrawID;
+}
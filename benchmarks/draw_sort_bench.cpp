@@ -0,0 +1,110 @@
+// Draw ordering microbenchmark: the draw key radix sort against the std::sort on
+// glm::distance that SceneManager used to run every frame. CPU only, no device needed.
+//
+//   cmake -DASTRAL_BUILD_BENCHMARKS=ON ... && ./bin/AstralDrawSortBench
+
+#include "astral/renderer/draw_key.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct BenchInstance {
+    glm::vec3 center;
+    uint32_t materialIndex;
+    bool transparent;
+};
+
+// What sortAndUploadInstances did: split into two copies, sort each with a comparator
+// that takes two square roots per comparison, merge back
+void legacySort(std::vector<BenchInstance>& instances, const glm::vec3& cameraPos) {
+    std::vector<BenchInstance> opaque;
+    std::vector<BenchInstance> transparent;
+    opaque.reserve(instances.size());
+    transparent.reserve(instances.size());
+    for (const auto& inst : instances) {
+        (inst.transparent ? transparent : opaque).push_back(inst);
+    }
+
+    std::sort(opaque.begin(), opaque.end(), [&](const BenchInstance& a, const BenchInstance& b) {
+        return glm::distance(a.center, cameraPos) < glm::distance(b.center, cameraPos);
+    });
+    std::sort(transparent.begin(), transparent.end(), [&](const BenchInstance& a, const BenchInstance& b) {
+        return glm::distance(a.center, cameraPos) > glm::distance(b.center, cameraPos);
+    });
+
+    instances.clear();
+    instances.insert(instances.end(), opaque.begin(), opaque.end());
+    instances.insert(instances.end(), transparent.begin(), transparent.end());
+}
+
+void keySort(const std::vector<BenchInstance>& instances, const glm::vec3& cameraPos,
+             std::vector<astral::DrawKey>& keys, std::vector<astral::DrawKey>& scratch) {
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const BenchInstance& inst = instances[i];
+        glm::vec3 offset = inst.center - cameraPos;
+        astral::DrawPass pass = inst.transparent ? astral::DrawPass::Transparent : astral::DrawPass::Opaque;
+        keys[i].key = astral::makeDrawKey(pass, 0, inst.materialIndex, glm::dot(offset, offset));
+        keys[i].payload = static_cast<uint32_t>(i);
+    }
+    astral::radixSortDrawKeys(keys, scratch);
+}
+
+// Only fn is timed, prepare resets its input outside the measurement
+template <typename Prepare, typename Fn>
+double averageMs(int iterations, Prepare&& prepare, Fn&& fn) {
+    std::chrono::duration<double, std::milli> elapsed(0.0);
+    for (int i = 0; i < iterations; ++i) {
+        prepare();
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+    return elapsed.count() / iterations;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_int_distribution<uint32_t> material(0, 255);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    std::printf("%10s %14s %14s %9s\n", "instances", "std::sort ms", "radix ms", "speedup");
+    for (size_t count : {1000u, 10000u, 100000u}) {
+        std::vector<BenchInstance> source(count);
+        for (auto& inst : source) {
+            inst.center = glm::vec3(position(rng), position(rng), position(rng));
+            inst.materialIndex = material(rng);
+            inst.transparent = percent(rng) < 10;
+        }
+        std::vector<astral::DrawKey> keys(count);
+        std::vector<astral::DrawKey> scratch(count);
+        const int iterations = count >= 100000 ? 20 : 200;
+
+        // The camera moves a little every frame, like the app's per-frame sort
+        glm::vec3 cameraPos(0.0f);
+        std::vector<BenchInstance> working;
+        // legacySort reorders in place, every iteration starts from the unsorted source
+        double legacyMs = averageMs(iterations, [&] {
+            working = source;
+            cameraPos.x += 0.1f;
+        }, [&] {
+            legacySort(working, cameraPos);
+        });
+        cameraPos = glm::vec3(0.0f);
+        double radixMs = averageMs(iterations, [&] {
+            cameraPos.x += 0.1f;
+        }, [&] {
+            keySort(source, cameraPos, keys, scratch);
+        });
+
+        std::printf("%10zu %14.3f %14.3f %8.1fx\n", count, legacyMs, radixMs, legacyMs / radixMs);
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+// Model load benchmark: the CPU side of AssetManager::loadModel, cold (import, LODs, vertex
+// cache optimization, meshlets, cache write) against warm (mesh cache hit). The GPU upload
+// that follows in createModel needs a device and is left out; it's the same on both paths.
+//
+//   cmake -DASTRAL_BUILD_BENCHMARKS=ON ... && ./bin/AstralModelLoadBench [model paths...]
+
+#include "astral/renderer/assimp_loader.hpp"
+#include "astral/renderer/geometry_optimizer.hpp"
+#include "astral/renderer/gltf_loader.hpp"
+#include "astral/renderer/lod_builder.hpp"
+#include "astral/renderer/mesh_cache.hpp"
+#include "astral/renderer/meshlet_builder.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename Fn>
+double averageMs(int iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        fn();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+astral::ModelLoader* findLoader(const std::vector<std::unique_ptr<astral::ModelLoader>>& loaders,
+                                const std::filesystem::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c){ return std::tolower(c); });
+    for (const auto& loader : loaders) {
+        if (loader->supportsExtension(ext)) {
+            return loader.get();
+        }
+    }
+    return nullptr;
+}
+
+// Entries only; MeshCache creates the directory once and store() expects it to exist
+void clearCache(const std::filesystem::path& cacheDir) {
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(cacheDir, ec)) {
+        std::filesystem::remove(entry.path(), ec);
+    }
+}
+
+std::string label(const std::filesystem::path& path) {
+    // Most models ship as <name>/scene.gltf
+    return path.has_parent_path() ? path.parent_path().filename().string() : path.filename().string();
+}
+
+// Keeps the warm loop's reads of the mapped geometry from being optimized away
+volatile size_t g_sink = 0;
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // Keep the per-load info logging out of the timings
+    spdlog::set_level(spdlog::level::warn);
+
+    std::vector<std::filesystem::path> models;
+    for (int i = 1; i < argc; ++i) {
+        models.emplace_back(argv[i]);
+    }
+    if (models.empty()) {
+        models.emplace_back(ASTRAL_BENCH_ASSETS_DIR "/models/damaged_helmet/scene.gltf");
+    }
+
+    std::vector<std::unique_ptr<astral::ModelLoader>> loaders;
+    loaders.push_back(std::make_unique<astral::GltfLoader>());
+    loaders.push_back(std::make_unique<astral::AssimpLoader>());
+
+    std::filesystem::path cacheDir = std::filesystem::temp_directory_path() / "astral_model_load_bench";
+    astral::MeshCache cache(cacheDir);
+
+    std::printf("%-32s %10s %10s %9s\n", "model", "cold ms", "warm ms", "speedup");
+    for (const auto& path : models) {
+        astral::ModelLoader* loader = findLoader(loaders, path);
+        if (!std::filesystem::exists(path) || !loader) {
+            std::printf("%-32s %10s\n", label(path).c_str(), "skipped");
+            continue;
+        }
+        const int iterations = 5;
+
+        bool imported = true;
+        double coldMs = averageMs(iterations, [&] {
+            clearCache(cacheDir);
+            auto data = loader->import(path);
+            if (!data) {
+                imported = false;
+                return;
+            }
+            astral::buildLods(*data);
+            astral::optimizeGeometry(*data);
+            astral::buildMeshlets(*data);
+            cache.store(path, *data);
+        });
+        if (!imported) {
+            std::printf("%-32s %10s\n", label(path).c_str(), "failed");
+            continue;
+        }
+
+        // The last cold iteration left a fresh entry behind. Touch the geometry so the
+        // mapped pages are actually read, as the upload would
+        bool hit = true;
+        double warmMs = averageMs(iterations * 4, [&] {
+            auto data = cache.load(path);
+            if (!data) {
+                hit = false;
+                return;
+            }
+            size_t sum = data->indices.size();
+            for (const auto& vertex : data->vertices) {
+                sum += static_cast<size_t>(vertex.position.x != 0.0f);
+            }
+            g_sink = sum;
+        });
+        if (!hit) {
+            std::printf("%-32s %10.3f %10s\n", label(path).c_str(), coldMs, "miss");
+            continue;
+        }
+
+        std::printf("%-32s %10.3f %10.3f %8.1fx\n", label(path).c_str(), coldMs, warmMs, coldMs / warmMs);
+    }
+
+    std::filesystem::remove_all(cacheDir);
+    return 0;
+}
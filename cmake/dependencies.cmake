@@ -6,6 +6,9 @@ include(FetchContent)
 find_package(Vulkan REQUIRED)
 message(STATUS "Found Vulkan: ${Vulkan_VERSION}")
 
+# Worker threads (headless frame writer)
+find_package(Threads REQUIRED)
+
 # Attempt to find Shaderc from Vulkan SDK
 find_library(SHADERC_LIB shaderc_combined 
     HINTS 
@@ -0,0 +1,39 @@
+# Shader Compilation
+# GLSL sources are compiled to SPIR-V next to themselves (<shader>.spv), which is
+# where the renderer loads them from and what the examples copy with the assets.
+# Includes (*.glsl) are tracked through the depfiles glslc writes.
+find_program(GLSLC_EXECUTABLE glslc
+    HINTS
+        $ENV{VULKAN_SDK}/bin
+        $ENV{VULKAN_SDK}/Bin
+)
+
+if(NOT GLSLC_EXECUTABLE)
+    message(FATAL_ERROR "glslc not found. Install the Vulkan SDK and set VULKAN_SDK environment variable.")
+endif()
+
+# Function to compile a list of shaders into a target that builds them all
+function(astral_add_shaders target_name)
+    set(spirv_outputs)
+    foreach(shader ${ARGN})
+        set(shader_source ${CMAKE_CURRENT_SOURCE_DIR}/${shader})
+        set(shader_output ${shader_source}.spv)
+        get_filename_component(shader_name ${shader} NAME)
+        set(shader_depfile ${CMAKE_CURRENT_BINARY_DIR}/shaders/${shader_name}.d)
+
+        add_custom_command(
+            OUTPUT ${shader_output}
+            COMMAND ${CMAKE_COMMAND} -E make_directory ${CMAKE_CURRENT_BINARY_DIR}/shaders
+            COMMAND ${GLSLC_EXECUTABLE} --target-env=vulkan1.3
+                -MD -MF ${shader_depfile}
+                -o ${shader_output} ${shader_source}
+            DEPENDS ${shader_source}
+            DEPFILE ${shader_depfile}
+            COMMENT "Compiling shader ${shader_name}"
+            VERBATIM
+        )
+        list(APPEND spirv_outputs ${shader_output})
+    endforeach()
+
+    add_custom_target(${target_name} ALL DEPENDS ${spirv_outputs})
+endfunction()
@@ -7,9 +7,13 @@ protected:
     }
 };
 
-int main() {
+int main(int argc, char** argv) {
     try {
         GltfViewer app;
+        // --headless: render Config::headless.frameCount frames to disk, no window
+        for (int i = 1; i < argc; i++) {
+            if (std::string(argv[i]) == "--headless") app.setHeadless(true);
+        }
         app.run();
     } catch (const std::exception& e) {
         std::cerr << "Fatal Error: " << e.what() << std::endl;
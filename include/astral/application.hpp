@@ -3,10 +3,12 @@
 #include "astral/astral.hpp"
 #include "astral/core/commands.hpp"
 #include "astral/core/context.hpp"
+#include "astral/core/job_system.hpp"
 #include "astral/platform/window.hpp"
 #include "astral/renderer/camera.hpp"
 #include "astral/renderer/environment_manager.hpp"
 #include "astral/renderer/asset_manager.hpp"
+#include "astral/renderer/offscreen_target.hpp"
 #include "astral/renderer/renderer_system.hpp"
 #include "astral/renderer/scene_manager.hpp"
 #include "astral/renderer/swapchain.hpp"
@@ -28,6 +30,10 @@ public:
 
   void run();
 
+  // Headless: no window / swapchain / UI, frames go to an offscreen image and
+  // are read back to disk (see Config::headless). Must be set before run().
+  void setHeadless(bool headless) { m_headless = headless; }
+
 protected:
   virtual void initScene() = 0; // Pure virtual
 
@@ -39,8 +45,16 @@ protected:
 
   void init();
   void cleanup();
+  void runHeadless();
+  // One headless frame into the offscreen target, returns the pass recording ms
+  double renderHeadlessFrame(RenderGraph &graph, uint32_t frame,
+                             float deltaTime, bool writeFrames);
+  void runLightCullSweep(RenderGraph &graph, float deltaTime);
+  void runSSAOComparison(RenderGraph &graph, float deltaTime);
   void handleInput(float deltaTime);
   void updateUI(float deltaTime);
+  SceneData buildSceneData();
+  void syncModelInstances();
 
   // Core
   std::unique_ptr<Window> m_window;
@@ -50,6 +64,8 @@ protected:
   std::unique_ptr<CommandPool> m_commandPool;
   std::vector<std::unique_ptr<CommandBuffer>> m_commandBuffers;
   std::vector<VkSemaphore> m_imageSemaphores;
+  std::unique_ptr<OffscreenTarget> m_offscreen; // Headless only
+  std::unique_ptr<JobSystem> m_jobSystem;       // Null when parallel recording is off
 
   // Managers
   std::unique_ptr<SceneManager> m_sceneManager;
@@ -64,9 +80,15 @@ protected:
   // Scene
   Camera m_camera;
   std::shared_ptr<Model> m_model;
+  const Model *m_instancedModel = nullptr; // What m_modelInstances were created for
+  uint64_t m_instancedGeometryVersion = 0; // GeometryArena layout they point into
+  std::vector<InstanceHandle> m_modelInstances;
   RendererSystem::UIParams m_uiParams;
 
   // State
+  bool m_headless = false;
+  uint32_t m_width = 0;
+  uint32_t m_height = 0;
   uint32_t m_currentFrame = 0;
   float m_lastFrameTime = 0.0f;
   bool m_firstFrame = true;
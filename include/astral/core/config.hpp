@@ -28,6 +28,38 @@ public:
         std::string lastModelPath = "";
     } general;
 
+    // Headless / batch frame generation (enabled via --headless)
+    struct {
+        uint32_t frameCount = 300;
+        std::string outputDirectory = "frames";
+        bool writeFrames = true; // false -> render + readback only, for throughput runs
+        bool lightCullSweep = false; // After the frames, time light culling at 16..4096 lights
+        bool ssaoComparison = false; // After the frames, time fragment SSAO against the compute presets
+    } headless;
+
+    // Texture cooking (BC7/BC5/BC4 + mip chain), cached on disk by source hash
+    struct {
+        bool compress = true;                       // false -> RGBA8 (still cached, still mipmapped)
+        std::string cacheDirectory = "texture_cache"; // "" -> cook on every load
+    } textures;
+
+    // Mesh import
+    struct {
+        std::string cacheDirectory = "mesh_cache"; // "" -> run the importer on every load
+    } meshes;
+
+    // Clustered lighting grid, read at startup
+    struct {
+        uint32_t tileSize = 64;    // Screen pixels per cluster column / row
+        uint32_t depthSlices = 24; // Logarithmic slices between near and far
+    } clusters;
+
+    // RenderGraph pass recording
+    struct {
+        bool parallelRecording = true; // false -> every pass recorded inline on the main thread
+        uint32_t workerThreads = 0;    // 0 -> hardware threads - 1
+    } jobs;
+
 private:
     Config() = default;
     
@@ -24,6 +24,7 @@ struct QueueFamilyIndices {
 
 class Context {
 public:
+    // window == nullptr -> headless: no surface, no swapchain extension
     Context(Window* window);
     ~Context();
 
@@ -36,9 +37,16 @@ public:
     QueueFamilyIndices getQueueFamilyIndices() const { return m_indices; }
     VkQueue getGraphicsQueue() const { return m_graphicsQueue; }
     VkQueue getPresentQueue() const { return m_presentQueue; }
+    // May be the graphics queue itself when there is no separate transfer family
+    VkQueue getTransferQueue() const { return m_transferQueue; }
 
     DescriptorManager& getDescriptorManager() { return *m_descriptorManager; }
     Window& getWindow() { return *m_window; }
+    bool isHeadless() const { return m_window == nullptr; }
+    bool supportsTextureCompressionBC() const { return m_textureCompressionBC; }
+    bool supportsDepthClamp() const { return m_depthClamp; }
+    // gl_PrimitiveID in fragment shaders, gl_DrawID and RG16F storage images (visibility buffer path)
+    bool supportsVisibilityBuffer() const { return m_visibilityBuffer; }
 
 private:
     void createInstance(const std::vector<const char*>& requiredExtensions);
@@ -54,7 +62,7 @@ private:
     Window* m_window;
     VkInstance m_instance;
     VkDebugUtilsMessengerEXT m_debugMessenger;
-    VkSurfaceKHR m_surface;
+    VkSurfaceKHR m_surface = VK_NULL_HANDLE;
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
     VkDevice m_device;
     VmaAllocator m_allocator;
@@ -65,6 +73,9 @@ private:
     VkQueue m_transferQueue;
 
     QueueFamilyIndices m_indices;
+    bool m_textureCompressionBC = false;
+    bool m_depthClamp = false;
+    bool m_visibilityBuffer = false;
 
     std::unique_ptr<DescriptorManager> m_descriptorManager;
 
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace astral {
+
+// Small fixed pool of worker threads for fork/join style work (e.g. recording
+// RenderGraph passes in parallel). The calling thread joins in as thread 0,
+// workers are 1..getThreadCount()-1, so per-thread resources can be indexed directly.
+class JobSystem {
+public:
+    using Job = std::function<void(uint32_t index, uint32_t threadIndex)>;
+
+    // 0 = one worker per hardware thread, minus the caller
+    explicit JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+    // Runs job(i, thread) for every i in [0, count) and returns once all are done.
+    // Only call from one thread at a time. The first exception thrown by a job is rethrown here.
+    void parallelFor(uint32_t count, const Job& job);
+
+private:
+    void workerLoop(uint32_t threadIndex);
+    void runBatch(uint32_t threadIndex);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    // Current batch, published under m_mutex
+    const Job* m_job = nullptr;
+    uint32_t m_count = 0;
+    std::atomic<uint32_t> m_next{0};
+    uint32_t m_activeWorkers = 0;
+    uint64_t m_generation = 0;
+    bool m_stop = false;
+    std::exception_ptr m_error;
+};
+
+} // namespace astral
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace astral {
+
+// Read-only memory mapping of a whole file. The pages are only faulted in when touched,
+// so copying out of it is a single memcpy straight from the page cache.
+class MappedFile {
+public:
+    // Throws std::runtime_error if the file can't be opened or mapped
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* getData() const { return m_data; }
+    size_t getSize() const { return m_size; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+} // namespace astral
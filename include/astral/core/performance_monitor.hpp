@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include <deque>
 
@@ -10,6 +11,15 @@ public:
     ~PerformanceMonitor() = default;
 
     void update(float deltaTime);
+    // GPU culling counters, read back a couple of frames late
+    void updateCulling(uint32_t instanceCount, uint32_t drawnCount, uint32_t frustumCulled, uint32_t occlusionCulled, uint32_t shadowDrawn,
+                       uint32_t meshletsDrawn, uint32_t meshletsCulled);
+    // Clustered light culling: lights, light index entries written / capacity, GPU time of the three passes
+    void updateLightCulling(uint32_t lightCount, uint32_t indexCount, uint32_t indexCapacity, float gpuMs);
+    // SSAO GPU time, from the first SSAO pass to the last one of whichever path ran
+    void updateSSAO(float gpuMs, bool compute);
+    // Bindless slot occupancy: sampled images (live, ever used, capacity), storage buffers, slots waiting to be recycled
+    void updateBindless(uint32_t imagesLive, uint32_t imagesHighWater, uint32_t imageCapacity, uint32_t buffersLive, uint32_t pendingSlots);
     void renderUI();
 
     float getAverageFPS() const { return m_avgFPS; }
@@ -26,6 +36,28 @@ private:
     int m_maxHistorySize = 1000;
 
     std::deque<float> m_frameTimes; // Milliseconds
+
+    uint32_t m_instanceCount = 0;
+    uint32_t m_drawnCount = 0;
+    uint32_t m_frustumCulled = 0;
+    uint32_t m_occlusionCulled = 0;
+    uint32_t m_shadowDrawn = 0;
+    uint32_t m_meshletsDrawn = 0;
+    uint32_t m_meshletsCulled = 0;
+
+    uint32_t m_lightCount = 0;
+    uint32_t m_lightIndexCount = 0;
+    uint32_t m_lightIndexCapacity = 0;
+    float m_lightCullMs = 0.0f;
+
+    float m_ssaoMs = 0.0f;
+    bool m_ssaoCompute = false;
+
+    uint32_t m_imagesLive = 0;
+    uint32_t m_imagesHighWater = 0;
+    uint32_t m_imageCapacity = 0;
+    uint32_t m_buffersLive = 0;
+    uint32_t m_pendingSlots = 0;
 };
 
 } // namespace astral
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "astral/core/context.hpp"
+#include "astral/renderer/descriptor_manager.hpp"
+#include "astral/renderer/mesh_cache.hpp"
 #include "astral/renderer/model.hpp"
+#include "astral/renderer/model_data.hpp"
 #include "astral/renderer/scene_manager.hpp"
+#include "astral/renderer/texture_streamer.hpp"
 #include "astral/resources/sampler.hpp"
 #include <filesystem>
 #include <memory>
@@ -12,51 +16,71 @@
 
 namespace astral {
 
-enum class TextureType {
-    Albedo,
-    Normal,
-    MetallicRoughness,
-    Occlusion,
-    Emissive,
-    Transmission,
-    Thickness
-};
-
-class AssetManager;
+// Loaders only import into CPU side ModelData, AssetManager does all the GPU work
 class ModelLoader {
 public:
     virtual ~ModelLoader() = default;
-    virtual std::unique_ptr<Model> load(const std::filesystem::path& path, SceneManager* sceneManager, AssetManager* assetManager) = 0;
+    virtual std::unique_ptr<ModelData> import(const std::filesystem::path& path) = 0;
     virtual bool supportsExtension(const std::string& extension) const = 0;
 };
 
 class AssetManager {
 public:
-    AssetManager(Context* context);
+    // compressTextures: cook to BC7/BC5/BC4 when the device supports BC, RGBA8 otherwise.
+    // textureCacheDirectory: where cooked textures are kept between runs (empty = no cache).
+    // meshCacheDirectory: where imported models are cooked to the binary mesh format (empty = always import).
+    AssetManager(Context* context, bool compressTextures = true, const std::filesystem::path& textureCacheDirectory = "texture_cache",
+                 const std::filesystem::path& meshCacheDirectory = "mesh_cache");
     ~AssetManager() = default;
 
     void registerLoader(std::unique_ptr<ModelLoader> loader);
     
-    // Loads a model from file, using the appropriate loader based on extension.
-    // Uses caching to avoid reloading the same asset multiple times if requested (optional future improvement, currently direct load).
-    // Loads a model from file, using the appropriate loader based on extension.
-    // Uses caching to avoid reloading the same asset multiple times if requested (optional future improvement, currently direct load).
+    // Loads a model from file, from the mesh cache when it has an up to date entry,
+    // otherwise through the loader matching the extension (and cooks the result).
     std::unique_ptr<Model> loadModel(const std::filesystem::path& path, SceneManager* sceneManager);
 
+    // Textures stream in: the returned image has its final size but no contents until the
+    // TextureStreamer uploads it. Always hand it to registerTexture(), not registerImage().
     std::shared_ptr<Image> getOrLoadTexture(const std::filesystem::path& path, TextureType type = TextureType::Albedo);
+    // Encoded (png/jpg...) bytes, e.g. glTF buffer views. Copies the data, not cached.
+    std::shared_ptr<Image> loadTextureFromMemory(const uint8_t* data, size_t size, TextureType type = TextureType::Albedo);
+    // Bindless index for image+sampler. While the image is still streaming this is a slot
+    // showing the type's fallback, updateStreaming() later patches materials to the real one.
+    uint32_t registerTexture(const std::shared_ptr<Image>& image, VkSampler sampler);
     VkSampler getSampler(const SamplerSpecs& specs);
 
+    // Once per frame on the main thread, before SceneManager::updateMaterialBuffer
+    void updateStreaming(SceneManager& sceneManager);
+    // Blocks until every queued texture is resident (headless captures)
+    void finishStreaming(SceneManager& sceneManager);
+    // Semaphore wait for the next graphics submit, see TextureStreamer::takeGraphicsWait
+    bool takeStreamingWait(VkSemaphoreSubmitInfo& wait) { return m_streamer->takeGraphicsWait(wait); }
+
 private:
+    std::unique_ptr<Model> createModel(const ModelData& data, SceneManager* sceneManager);
+
     Context* m_context;
     std::vector<std::unique_ptr<ModelLoader>> m_loaders;
-    std::unordered_map<std::string, std::shared_ptr<Image>> m_textureCache;
+    std::unique_ptr<MeshCache> m_meshCache;
+    bool m_compressTextures;
+    std::unordered_map<std::string, std::shared_ptr<Image>> m_textureCache; // Key: absolute path + format
     std::unordered_map<SamplerSpecs, std::shared_ptr<Sampler>> m_samplerCache;
     std::shared_ptr<Image> m_errorTexture; // Magenta
     std::shared_ptr<Image> m_defaultNormalTexture; // Flat Blue
     std::shared_ptr<Image> m_whiteTexture; // White
     std::shared_ptr<Image> m_blackTexture; // Black
-    
-    // Future: Cache, Async loading queue
+
+    struct StreamingTexture {
+        std::shared_ptr<Image> fallback;
+        std::vector<std::pair<BindlessHandle, VkSampler>> placeholders; // Bindless slot showing the fallback
+    };
+    VkFormat getTextureFormat(TextureType type) const;
+    std::shared_ptr<Image> createStreamingImage(uint32_t width, uint32_t height, TextureType type);
+    std::shared_ptr<Image> getFallback(TextureType type) const;
+    std::unordered_map<const Image*, StreamingTexture> m_streaming;
+
+    // Last member: joins its decode threads before the images above go away
+    std::unique_ptr<TextureStreamer> m_streamer;
 };
 
 } // namespace astral
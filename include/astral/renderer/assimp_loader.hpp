@@ -1,6 +1,5 @@
 #pragma once
 
-#include "astral/renderer/model.hpp"
 #include "astral/renderer/asset_manager.hpp"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -10,21 +9,17 @@
 
 namespace astral {
 
-class Context;
-class SceneManager;
-
 class AssimpLoader : public ModelLoader {
 public:
-    explicit AssimpLoader(Context* context);
-    ~AssimpLoader() override;
+    AssimpLoader() = default;
+    ~AssimpLoader() override = default;
 
-    std::unique_ptr<Model> load(const std::filesystem::path& path, SceneManager* sceneManager, AssetManager* assetManager) override;
+    std::unique_ptr<ModelData> import(const std::filesystem::path& path) override;
     bool supportsExtension(const std::string& extension) const override;
 
 private:
-    Context* m_context;
-
-    int loadTexture(const std::filesystem::path& path, Model* model, AssetManager* assetManager, const std::filesystem::path& modelDir);
+    // Resolves a texture reference against the usual export layouts, empty if not found
+    std::filesystem::path findTexture(const std::filesystem::path& path, const std::filesystem::path& modelDir) const;
 };
 
 } // namespace astral
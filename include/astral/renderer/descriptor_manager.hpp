@@ -2,12 +2,35 @@
 
 #include "astral/core/context.hpp"
 #include <vulkan/vulkan.h>
+#include <utility>
 #include <vector>
 
 namespace astral {
 
+// Slot plus the generation it was handed out with. Keep one wherever a slot gets released
+// later: releasing through a handle whose slot was already released (and maybe reused) is
+// caught instead of freeing somebody else's descriptor.
+struct BindlessHandle {
+    uint32_t binding = 0;
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
 class DescriptorManager {
 public:
+    // Image tables, storage buffers use their binding number directly
+    static constexpr uint32_t IMAGE_BINDING = 0;
+    static constexpr uint32_t ARRAY_IMAGE_BINDING = 4;
+    static constexpr uint32_t STORAGE_IMAGE_BINDING = 5;
+    static constexpr uint32_t CUBE_IMAGE_BINDING = 12;
+
+    struct Occupancy {
+        uint32_t live = 0;
+        uint32_t pending = 0;   // Released, waiting for the frames in flight
+        uint32_t highWater = 0; // Slots ever touched
+        uint32_t capacity = 0;
+    };
+
     DescriptorManager(Context* context);
     ~DescriptorManager();
 
@@ -15,25 +38,56 @@ public:
     VkDescriptorSet getDescriptorSet() const { return m_set; }
 
     uint32_t registerImage(VkImageView view, VkSampler sampler);
+    // Slot for an image that is created later / recreated (RenderGraph transients)
+    uint32_t reserveImage();
+    void updateImage(uint32_t index, VkImageView view, VkSampler sampler);
     uint32_t registerImageArray(VkImageView view, VkSampler sampler);
     uint32_t registerImageCube(VkImageView view, VkSampler sampler);
     uint32_t registerStorageImage(VkImageView view);
+    // Same as reserveImage / updateImage, for transients written by compute passes
+    uint32_t reserveStorageImage();
+    void updateStorageImage(uint32_t index, VkImageView view);
     uint32_t registerBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t binding = 1);
+    // Slot whose range moves around (UploadRing allocations). Only rewrite it while no
+    // in-flight frame uses it, e.g. a per-frame slot after that frame's fence.
+    uint32_t reserveBuffer(uint32_t binding);
+    void updateBuffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t binding);
+
+    // Slots are recycled: release() queues the slot, it's handed out again once every
+    // frame that may still reference it has retired (beginFrame calls, frames in flight).
+    // The descriptor itself is left as is, PARTIALLY_BOUND covers it as long as nothing
+    // reads the old index anymore.
+    BindlessHandle getHandle(uint32_t binding, uint32_t index) const;
+    bool isValid(const BindlessHandle& handle) const;
+    void release(const BindlessHandle& handle);
+    // After waiting on the frame's fence
+    void beginFrame();
+    Occupancy getOccupancy(uint32_t binding) const;
 
 private:
     void createLayout();
     void createPoolAndSet();
 
+    struct SlotTable {
+        uint32_t next = 0; // Never handed out from here on
+        uint32_t live = 0;
+        std::vector<uint32_t> free;
+        std::vector<std::pair<uint32_t, uint64_t>> pending; // Slot, frame it was released in
+        std::vector<uint32_t> generations;
+        std::vector<bool> allocated;
+    };
+    uint32_t allocateSlot(uint32_t binding);
+    static uint32_t getCapacity(uint32_t binding);
+
     Context* m_context;
     VkDescriptorSetLayout m_layout;
     VkDescriptorPool m_pool;
     VkDescriptorSet m_set;
 
-    uint32_t m_nextImageIndex = 0;
-    uint32_t m_nextArrayImageIndex = 0;
-    uint32_t m_nextCubeImageIndex = 0;
-    uint32_t m_nextStorageImageIndex = 0;
-    uint32_t m_nextBufferIndices[16]{0}; // Track indices per binding (extended for more buffer types)
+    SlotTable m_tables[16]; // Per binding
+    uint64_t m_frameNumber = 0;
+    // Frames in flight, a released slot may still be read until then
+    static constexpr uint64_t RELEASE_LATENCY_FRAMES = 2;
     static constexpr uint32_t MAX_BINDLESS_IMAGES = 10000;
     static constexpr uint32_t MAX_BINDLESS_BUFFERS = 2000;
 };
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+namespace astral {
+
+// Coarsest first, draws of one pass stay together
+enum class DrawPass : uint32_t {
+    Opaque = 0,
+    Masked = 1,
+    Transparent = 2
+};
+
+// 64-bit sort key, built once per instance and radix sorted. Bit layout:
+//   opaque / masked: [63:62] pass | [61:52] pipeline | [51:32] material | [31:0] depth
+//   transparent:     [63:62] pass | [61:30] ~depth   | [29:20] pipeline | [19:0] material
+// Depth is the squared view distance, its float bits already sort like the value
+// (positive IEEE floats are monotonic as integers) so there's no sqrt or rescale.
+// Opaque draws go front to back within a material, transparents back to front first.
+struct DrawKey {
+    uint64_t key;
+    uint32_t payload; // Whatever the caller sorts, e.g. an instance handle
+};
+
+uint64_t makeDrawKey(DrawPass pass, uint32_t pipeline, uint32_t material, float distanceSquared);
+
+// LSD radix sort on DrawKey::key, stable. Allocation free: 'scratch' must be at
+// least as large as 'keys', the result ends up in 'keys'.
+void radixSortDrawKeys(std::span<DrawKey> keys, std::span<DrawKey> scratch);
+
+} // namespace astral
@@ -3,8 +3,10 @@
 #include "astral/core/context.hpp"
 #include "astral/resources/image.hpp"
 #include "astral/renderer/compute_pipeline.hpp"
+#include "astral/renderer/descriptor_manager.hpp"
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace astral {
 
@@ -13,12 +15,13 @@ public:
     EnvironmentManager(Context* context);
     ~EnvironmentManager();
 
+    // Can be called again to switch environments, the previous maps' slots are recycled
     void loadHDR(const std::string& path);
     
-    uint32_t getSkyboxIndex() const { return m_skyboxIndex; }
-    uint32_t getIrradianceIndex() const { return m_irradianceIndex; }
-    uint32_t getPrefilteredIndex() const { return m_prefilteredIndex; }
-    uint32_t getBrdfLutIndex() const { return m_brdfLutIndex; }
+    uint32_t getSkyboxIndex() const { return m_skyboxSlot.index; }
+    uint32_t getIrradianceIndex() const { return m_irradianceSlot.index; }
+    uint32_t getPrefilteredIndex() const { return m_prefilteredSlot.index; }
+    uint32_t getBrdfLutIndex() const { return m_brdfLutSlot.index; }
 
 private:
     Context* m_context;
@@ -28,10 +31,17 @@ private:
     std::unique_ptr<Image> m_prefiltered;
     std::unique_ptr<Image> m_brdfLut;
 
-    uint32_t m_skyboxIndex = (uint32_t)-1;
-    uint32_t m_irradianceIndex = (uint32_t)-1;
-    uint32_t m_prefilteredIndex = (uint32_t)-1;
-    uint32_t m_brdfLutIndex = (uint32_t)-1;
+    // Sampled by the renderer, index is UINT32_MAX until loaded
+    BindlessHandle m_skyboxSlot;
+    BindlessHandle m_irradianceSlot;
+    BindlessHandle m_prefilteredSlot;
+    BindlessHandle m_brdfLutSlot;
+
+    // Only used while generating (equirect input, storage outputs, per-mip views),
+    // released at the end of loadHDR
+    BindlessHandle registerScratch(uint32_t binding, uint32_t index);
+    std::vector<BindlessHandle> m_scratchSlots;
+    std::vector<VkImageView> m_scratchViews;
 
     void convertEquirectToCube(const std::unique_ptr<Image>& equirect);
     void generateIrradiance();
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "astral/core/context.hpp"
+#include "astral/renderer/model.hpp"
+#include "astral/resources/buffer.hpp"
+#include <map>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace astral {
+
+// Where one model's geometry lives inside the arena, in elements (not bytes)
+struct GeometryAllocation {
+    uint32_t vertexOffset = 0; // VkDrawIndexedIndirectCommand::vertexOffset of its draws
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;   // Added to the primitives' firstIndex
+    uint32_t indexCount = 0;
+    uint32_t firstMeshlet = 0; // Added to the primitives' firstMeshlet
+    uint32_t meshletCount = 0;
+};
+
+// Shared vertex streams (positions + PackedVertex attributes), index buffer and meshlet
+// table for every loaded model, suballocated with a first-fit free list, so the whole scene
+// draws with a single bind and one indirect draw per pass.
+// Running out of room first compacts the live allocations if that frees enough space,
+// otherwise both buffers grow (doubling). Either waits for the device and bumps the layout
+// version: draw commands built from older offsets have to be rebuilt.
+class GeometryArena {
+public:
+    GeometryArena(Context* context, uint32_t initialVertexCapacity, uint32_t initialIndexCapacity,
+                  uint32_t initialMeshletCapacity);
+    ~GeometryArena() = default;
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    // Packs the vertices into the GPU streams, the spans can go away afterwards
+    GeometryHandle allocate(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                            std::span<const Meshlet> meshlets);
+    // The ranges are reused right away, only free once no frame in flight draws them
+    void free(GeometryHandle handle);
+    const GeometryAllocation& get(GeometryHandle handle) const { return m_allocations[handle]; }
+
+    // Packs every live allocation to the front of the buffers, false if nothing moved
+    bool defragment();
+    uint64_t getLayoutVersion() const { return m_layoutVersion; }
+
+    VkBuffer getPositionBuffer() const { return m_positionBuffer->getHandle(); }
+    VkBuffer getAttributeBuffer() const { return m_attributeBuffer->getHandle(); }
+    VkBuffer getIndexBuffer() const { return m_indexBuffer->getHandle(); }
+    // Bindless storage buffer slots (binding 6) of the streams and the Meshlet table
+    uint32_t getPositionBufferIndex() const { return m_positionBufferIndex; }
+    uint32_t getAttributeBufferIndex() const { return m_attributeBufferIndex; }
+    uint32_t getIndexBufferIndex() const { return m_indexBufferIndex; }
+    uint32_t getMeshletBufferIndex() const { return m_meshletBufferIndex; }
+    uint32_t getVertexCapacity() const { return m_vertexRanges.getCapacity(); }
+    uint32_t getIndexCapacity() const { return m_indexRanges.getCapacity(); }
+    uint32_t getUsedVertices() const { return m_vertexRanges.getUsed(); }
+    uint32_t getUsedIndices() const { return m_indexRanges.getUsed(); }
+
+private:
+    // Free ranges keyed by offset, neighbours are merged on release
+    class RangeList {
+    public:
+        explicit RangeList(uint32_t capacity);
+        // UINT32_MAX when no single free range is large enough
+        uint32_t allocate(uint32_t count);
+        void release(uint32_t offset, uint32_t count);
+        void grow(uint32_t newCapacity);
+        // Everything below 'used' taken, the rest free (after compaction)
+        void reset(uint32_t used);
+
+        uint32_t getCapacity() const { return m_capacity; }
+        uint32_t getUsed() const { return m_capacity - m_free; }
+        uint32_t getFree() const { return m_free; }
+
+    private:
+        std::map<uint32_t, uint32_t> m_ranges; // Offset -> count
+        uint32_t m_capacity;
+        uint32_t m_free;
+    };
+
+    std::unique_ptr<Buffer> createBuffer(VkDeviceSize size, VkBufferUsageFlags usage) const;
+    // Replaces the buffer with a larger one, keeping its contents
+    void growBuffer(std::unique_ptr<Buffer>& buffer, VkDeviceSize newSize, VkBufferUsageFlags usage);
+    // Points the bindless slots at the current buffers
+    void updateDescriptors();
+
+    Context* m_context;
+    // Both vertex streams share the vertex offsets
+    std::unique_ptr<Buffer> m_positionBuffer;
+    std::unique_ptr<Buffer> m_attributeBuffer;
+    std::unique_ptr<Buffer> m_indexBuffer;
+    std::unique_ptr<Buffer> m_meshletBuffer;
+    uint32_t m_positionBufferIndex;
+    uint32_t m_attributeBufferIndex;
+    uint32_t m_indexBufferIndex;
+    uint32_t m_meshletBufferIndex;
+    RangeList m_vertexRanges;
+    RangeList m_indexRanges;
+    RangeList m_meshletRanges;
+
+    std::vector<GeometryAllocation> m_allocations;
+    std::vector<bool> m_live;
+    std::vector<GeometryHandle> m_freeHandles;
+    uint64_t m_layoutVersion = 0;
+};
+
+} // namespace astral
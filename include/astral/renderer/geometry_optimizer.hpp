@@ -0,0 +1,29 @@
+#pragma once
+
+#include "astral/renderer/model_data.hpp"
+
+namespace astral {
+
+// Post-transform vertex cache efficiency over every index range of a model (each LOD of each
+// primitive is its own draw, the cache starts cold for each), simulated as a 16 entry FIFO
+struct VertexCacheStats {
+    float acmr = 0.0f; // Vertex shader invocations per triangle, 3 = no reuse at all
+    float atvr = 0.0f; // Invocations per referenced vertex, 1 = every vertex shaded once
+};
+
+struct GeometryOptimizationReport {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    uint32_t droppedVertices = 0; // Referenced by no index range
+};
+
+// Import time reordering, after buildLods and before buildMeshlets:
+//  - every index range's triangles for the post-transform vertex cache (Forsyth's linear speed
+//    algorithm, 32 entry LRU model)
+//  - the result split where the cache restarts, those clusters sorted outside-in so the ones
+//    facing away from the mesh center go first and occlude the rest (less overdraw)
+//  - the vertices renumbered in first use order (fetch locality), unreferenced ones dropped
+// Stored in the mesh cache, so it's paid once per asset.
+GeometryOptimizationReport optimizeGeometry(ModelData& data);
+
+} // namespace astral
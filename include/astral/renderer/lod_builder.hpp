@@ -0,0 +1,15 @@
+#pragma once
+
+#include "astral/renderer/model_data.hpp"
+
+namespace astral {
+
+// Adds up to MAX_LODS - 1 coarser index ranges to every primitive (Primitive::lods), each
+// keeping about half the triangles of the one before. Quadric error edge collapses onto
+// existing vertices, so the levels share the primitive's vertices and only cost indices.
+// Border and seam vertices (UV / normal splits) stay put, which keeps the silhouette and the
+// texture layout intact. Runs once at import, before buildMeshlets; the ranges are appended
+// to indexStorage and stored in the mesh cache with the rest of the model.
+void buildLods(ModelData& data);
+
+} // namespace astral
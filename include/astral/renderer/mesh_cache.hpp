@@ -0,0 +1,29 @@
+#pragma once
+
+#include "astral/renderer/model_data.hpp"
+#include <filesystem>
+#include <memory>
+
+namespace astral {
+
+// Cooked binary copy of imported models (geometry, LODs, bounds, meshlets, node hierarchy, material
+// table, texture references), written after the first import. Later loads memory-map the entry and
+// ModelData's vertex/index views point straight into the mapping, nothing is parsed or copied
+// until the upload into the GPU buffers.
+// Entries are keyed by the source's absolute path and invalidated by its size / write time
+// (for .gltf that's the json only; touch it after editing external .bin files).
+class MeshCache {
+public:
+    explicit MeshCache(std::filesystem::path cacheDirectory);
+
+    // Null when there is no entry or it's stale / from an older format version
+    std::unique_ptr<ModelData> load(const std::filesystem::path& source) const;
+    void store(const std::filesystem::path& source, const ModelData& data) const;
+
+private:
+    std::filesystem::path getCachePath(const std::filesystem::path& source) const;
+
+    std::filesystem::path m_cacheDirectory;
+};
+
+} // namespace astral
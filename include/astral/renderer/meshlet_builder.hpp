@@ -0,0 +1,14 @@
+#pragma once
+
+#include "astral/renderer/model_data.hpp"
+
+namespace astral {
+
+// Splits every primitive into meshlets (runs of consecutive triangles, so each one is a plain
+// index range) and computes their bounding spheres and normal cones. Runs once at import,
+// the result is stored in the mesh cache with the rest of the model.
+// Every LOD level gets its own meshlets. Primitives with a double sided material get no cone,
+// their back faces are visible.
+void buildMeshlets(ModelData& data);
+
+} // namespace astral
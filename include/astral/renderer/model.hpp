@@ -10,23 +10,83 @@
 
 namespace astral {
 
+class GeometryArena;
+// Index into the GeometryArena's allocation table
+using GeometryHandle = uint32_t;
+constexpr GeometryHandle INVALID_GEOMETRY = UINT32_MAX;
+
+// Loader and mesh cache format, packed into the two GPU streams below by the GeometryArena
 struct Vertex {
     glm::vec3 position;
     glm::vec3 normal;
     glm::vec2 uv;
     glm::vec4 tangent;
     glm::vec4 color;
+};
+
+// GPU vertex, 28 bytes instead of 64. Positions are a stream of their own (binding 0, full
+// floats so every pass rasterizes the same depth) and depth-only passes fetch nothing else;
+// the shading attributes are packed into binding 1.
+struct PackedVertex {
+    uint32_t normal;  // Octahedral, RG16 snorm
+    uint32_t tangent; // Octahedral, RG16 sint with the handedness in the lowest bit of y
+    uint32_t uv;      // RG16 float
+    uint32_t color;   // RGBA8 unorm
+
+    static PackedVertex pack(const Vertex& vertex);
 
-    static VkVertexInputBindingDescription getBindingDescription();
+    // Both streams, for the shading passes
+    static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
     static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+    // Position stream only, for depth-only passes
+    static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions();
+    static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions();
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must match the binding 1 stride");
+
+// Small cluster of a primitive's triangles (at most MAX_MESHLET_VERTICES unique vertices,
+// MAX_MESHLET_TRIANGLES triangles), culled on its own by cull.comp. Laid out for the GPU.
+struct Meshlet {
+    glm::vec3 center;   // Object space bounding sphere
+    float radius;
+    glm::vec3 coneAxis; // Average facing, the whole meshlet is back facing for any viewer with
+    float coneCutoff;   // dot(center - eye, axis) >= cutoff * |center - eye| + radius. 1 = never
+    uint32_t firstIndex; // Relative to its primitive LOD's firstIndex
+    uint32_t indexCount;
+    uint32_t padding[2];
+};
+static_assert(sizeof(Meshlet) == 48, "Meshlet must match cull.comp");
+
+constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+// Levels of detail per primitive, including the full one
+constexpr uint32_t MAX_LODS = 4;
+
+// One simplified index range of a primitive over the same vertices, see buildLods
+struct PrimitiveLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
 };
 
 struct Primitive {
+    // Full detail (LOD 0)
     uint32_t firstIndex;
     uint32_t indexCount;
     int32_t materialIndex; // SceneManager'daki material metadata buffer indeksi
     glm::vec3 boundingCenter;
     float boundingRadius;
+    uint32_t firstMeshlet = 0; // Into the model's meshlet list, see buildMeshlets
+    uint32_t meshletCount = 0;
+    // Coarser levels, lods[0] is LOD 1. Offsets are in the same space as the ones above.
+    uint32_t lodCount = 1;
+    PrimitiveLod lods[MAX_LODS - 1] = {};
+
+    PrimitiveLod getLod(uint32_t level) const {
+        return level == 0 ? PrimitiveLod{firstIndex, indexCount, firstMeshlet, meshletCount} : lods[level - 1];
+    }
 };
 
 struct Mesh {
@@ -35,9 +95,16 @@ struct Mesh {
 };
 
 struct Model {
+    Model() = default;
+    ~Model(); // Hands the geometry back to the arena
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
     std::vector<Mesh> meshes;
-    std::unique_ptr<Buffer> vertexBuffer;
-    std::unique_ptr<Buffer> indexBuffer;
+    // Vertices and indices live in the scene's shared GeometryArena, primitive firstIndex
+    // values are relative to this allocation (see GeometryArena::get)
+    GeometryArena* arena = nullptr;
+    GeometryHandle geometry = INVALID_GEOMETRY;
     
     // Model içindeki tüm dokular (bindless sisteme kayıtlı)
     // Model içindeki tüm dokular (bindless sisteme kayıtlı)
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "astral/renderer/material.hpp"
+#include "astral/renderer/model.hpp"
+#include "astral/resources/sampler.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace astral {
+
+enum class TextureType {
+    Albedo,
+    Normal,
+    MetallicRoughness,
+    Occlusion,
+    Emissive,
+    Transmission,
+    Thickness
+};
+
+// CPU side result of importing a model file, nothing in here touches the GPU yet.
+// Loaders produce it, the mesh cache stores it, AssetManager turns it into a Model.
+// All cross references are indices into the vectors below, not bindless / scene indices.
+struct ModelData {
+    struct ImageSource {
+        std::string path;              // Absolute, empty when embedded
+        std::vector<uint8_t> embedded; // Encoded (png/jpg) bytes, e.g. glb buffer views
+        TextureType type = TextureType::Albedo;
+    };
+
+    struct TextureRef {
+        int32_t image = -1;
+        SamplerSpecs sampler;
+    };
+
+    struct MaterialData {
+        std::string name;
+        MaterialGPU gpuData; // Texture index fields index 'textures', -1 = none
+    };
+
+    struct MeshData {
+        std::string name;
+        std::vector<Primitive> primitives; // materialIndex indexes 'materials'
+    };
+
+    struct NodeData {
+        int32_t parent = -1;    // Always before the node itself
+        int32_t meshIndex = -1;
+        glm::mat4 matrix{1.0f}; // World transform, parents already applied
+        std::string name;
+    };
+
+    std::vector<ImageSource> images;
+    std::vector<TextureRef> textures;
+    std::vector<MaterialData> materials;
+    std::vector<MeshData> meshes;
+    std::vector<NodeData> nodes;
+    std::vector<Meshlet> meshlets; // Primitive::firstMeshlet indexes this
+
+    // Geometry views either point into the storage vectors (fresh import) or straight
+    // into the memory-mapped cache file, which 'backing' then keeps alive
+    std::span<const Vertex> vertices;
+    std::span<const uint32_t> indices;
+    std::vector<Vertex> vertexStorage;
+    std::vector<uint32_t> indexStorage;
+    std::shared_ptr<const void> backing;
+
+    // After filling vertexStorage / indexStorage
+    void adoptStorage() {
+        vertices = vertexStorage;
+        indices = indexStorage;
+    }
+};
+
+} // namespace astral
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "astral/core/context.hpp"
+#include "astral/resources/buffer.hpp"
+#include "astral/resources/image.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace astral {
+
+// Headless render target. One color image + host-visible readback buffer per
+// frame in flight. The GPU copy is recorded at the end of the frame's command
+// buffer; once that frame's fence signals, collect() hands the pixels to a
+// writer thread so the render loop never waits on PNG encoding / disk I/O.
+class OffscreenTarget {
+public:
+    OffscreenTarget(Context* context, uint32_t width, uint32_t height, VkFormat format,
+                    uint32_t framesInFlight, const std::filesystem::path& outputDirectory);
+    ~OffscreenTarget();
+
+    // Disable copying
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    Image& getImage(uint32_t frameIndex) { return *m_frames[frameIndex].image; }
+    VkFormat getFormat() const { return m_format; }
+    VkExtent2D getExtent() const { return {m_width, m_height}; }
+
+    // Image must already be in TRANSFER_SRC_OPTIMAL (RenderGraph final layout)
+    void recordReadback(VkCommandBuffer cmd, uint32_t frameIndex, uint32_t frameNumber);
+    // Call after waiting on the frame's fence. Blocks while the writer is
+    // kMaxQueuedJobs frames behind, so a slow disk throttles the render loop
+    // instead of growing the queue without bound.
+    void collect(uint32_t frameIndex);
+    // Blocks until all queued frames are on disk
+    void flush();
+
+    uint32_t getFramesWritten() const { return m_framesWritten.load(); }
+
+private:
+    struct FrameSlot {
+        std::unique_ptr<Image> image;
+        std::unique_ptr<Buffer> readback;
+        void* mapped = nullptr;
+        bool pending = false;
+        uint32_t frameNumber = 0;
+    };
+
+    static constexpr size_t kMaxQueuedJobs = 2;
+
+    struct WriteJob {
+        uint32_t frameNumber;
+        std::vector<uint8_t> pixels;
+    };
+
+    void writerLoop();
+
+    Context* m_context;
+    uint32_t m_width;
+    uint32_t m_height;
+    VkFormat m_format;
+    std::filesystem::path m_outputDirectory;
+    std::vector<FrameSlot> m_frames;
+
+    // Writer thread
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_jobCv;
+    std::condition_variable m_idleCv;
+    std::deque<WriteJob> m_jobs;
+    bool m_busy = false;
+    bool m_stop = false;
+    std::atomic<uint32_t> m_framesWritten{0};
+};
+
+} // namespace astral
@@ -23,6 +23,7 @@ struct PipelineSpecs {
     VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
     VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
     VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    bool depthClamp = false; // Clamp instead of clipping at near/far, needs the depthClamp feature
 
     bool enableBlending = false;
     VkBlendFactor srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
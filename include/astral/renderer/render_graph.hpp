@@ -1,7 +1,9 @@
 #pragma once
 
 #include "astral/core/context.hpp"
+#include "astral/core/job_system.hpp"
 #include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
 #include <functional>
 #include <string>
 #include <vector>
@@ -13,46 +15,206 @@ struct RenderPassResource {
     std::string name;
     VkImage image = VK_NULL_HANDLE;
     VkImageView view = VK_NULL_HANDLE;
+    VkBuffer buffer = VK_NULL_HANDLE; // Set for buffer resources, image fields stay null
+    VkDeviceSize size = 0;
     VkFormat format;
     uint32_t width;
     uint32_t height;
+    uint32_t baseArrayLayer = 0;
+    uint32_t layerCount = VK_REMAINING_ARRAY_LAYERS; // Layer views (e.g. one CSM cascade) only alias their own layers
     VkClearValue clearValue;
     VkImageLayout currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED; // Layout left behind at the end of execute(), UNDEFINED = don't care
     bool isExternal = false;
+    bool isTransient = false; // Owned by the graph, see addTransientImage
+    bool isExported = false;  // Consumed after execute(), see markExported
+};
+
+// Intermediate render target owned by the graph. Declared every frame; the graph
+// derives its lifetime from the compiled schedule and lets targets whose lifetimes
+// don't overlap share the same VMA memory.
+struct TransientImageDesc {
+    uint32_t width;
+    uint32_t height;
+    VkFormat format;
+    VkImageUsageFlags usage;
+    // Optional bindless slot (DescriptorManager::reserveImage), rewritten whenever the image is recreated
+    uint32_t bindlessIndex = UINT32_MAX;
+    VkSampler sampler = VK_NULL_HANDLE;
+    // Optional storage image slot (DescriptorManager::reserveStorageImage), needs VK_IMAGE_USAGE_STORAGE_BIT
+    uint32_t storageIndex = UINT32_MAX;
+};
+
+// How a pass touches a resource. The graph derives layouts, stage and access
+// masks from this, so passes never record their own barriers. The one exception is
+// a dependency between subresources inside a single pass, which the graph can't see
+// because it tracks the whole image: DepthPyramidPass reads each mip it just wrote
+// to build the next one. Such barriers stay within the pass and must leave every
+// subresource in the layout its declared usage implies.
+enum class ResourceUsage {
+    ColorAttachment,         // Dynamic rendering color target
+    DepthAttachment,         // Depth test + write
+    DepthAttachmentReadOnly, // Depth test without writes
+    DepthAttachmentLoad,     // Depth test + write on top of earlier passes, even when the pass clears its color outputs
+    SampledFragment,         // texture() in a fragment shader
+    SampledCompute,          // texture() in a compute shader
+    StorageReadVertex,       // SSBO reads in a vertex shader (instance data)
+    StorageReadFragment,     // SSBO reads in a fragment shader (cluster light lists)
+    StorageReadCompute,
+    StorageWriteCompute,
+    StorageReadWriteCompute, // Atomics / in-place updates
+    IndirectRead,            // vkCmdDraw*Indirect argument buffer
+    CopySrc,
+    CopyDst,
+    BlitSrc,
+    BlitDst,
+    Clear                    // vkCmdFillBuffer / vkCmdClear*Image
+};
+
+struct RenderPassAccess {
+    std::string resource;
+    ResourceUsage usage;
 };
 
 using RenderPassExecuteCallback = std::function<void(VkCommandBuffer)>;
 
 struct RenderPassNode {
     std::string name;
-    std::vector<std::string> inputs;
-    std::vector<std::string> outputs;
+    std::vector<RenderPassAccess> accesses;
     RenderPassExecuteCallback execute;
     bool clearOutputs = true; // Added to support UI overlays
+    // Optional, see setPassHooks
+    RenderPassExecuteCallback before;
+    RenderPassExecuteCallback after;
+};
+
+// Filled by the compile step every execute(), handy for the perf overlay
+struct RenderGraphStats {
+    uint32_t passCount = 0;
+    uint32_t culledPassCount = 0;
+    uint32_t levelCount = 0;
+    uint32_t barrierBatchCount = 0;
+    uint32_t imageBarrierCount = 0;
+    uint32_t bufferBarrierCount = 0;
+    uint32_t transientImageCount = 0;
+    uint32_t transientBlockCount = 0;
+    VkDeviceSize transientBytesRequested = 0; // Sum of every transient on its own
+    VkDeviceSize transientBytesAllocated = 0; // What the aliased blocks actually take
+    uint32_t recordThreadCount = 1;
+    double recordCpuMs = 0.0; // CPU time spent recording pass callbacks (wall time when parallel)
+};
+
+// Stage/access history of one physical image or buffer, kept across frames so the
+// first barrier of a frame waits on what the previous frame last did with it
+struct ResourceSyncState {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+    VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;   // Reads since the last write
+    VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE; // Where the last write is already visible
+    VkAccessFlags2 visibleAccess = VK_ACCESS_2_NONE;
 };
 
 class RenderGraph {
 public:
-    RenderGraph(Context* context);
+    // With a job system, pass callbacks are recorded concurrently into secondary command
+    // buffers, so they must only read shared state (no uploads, no member writes).
+    RenderGraph(Context* context, JobSystem* jobSystem = nullptr);
     ~RenderGraph();
 
-    void addPass(const std::string& name, 
-                 const std::vector<std::string>& inputs, 
-                 const std::vector<std::string>& outputs, 
+    // Inputs are sampled in the fragment shader, outputs are color/depth attachments
+    void addPass(const std::string& name,
+                 const std::vector<std::string>& inputs,
+                 const std::vector<std::string>& outputs,
+                 RenderPassExecuteCallback execute,
+                 bool clearOutputs = true);
+
+    // Explicit form: every image and buffer the pass touches, with how it's used.
+    // Attachment usages are bound with vkCmdBeginRendering in declaration order.
+    void addPass(const std::string& name,
+                 const std::vector<RenderPassAccess>& accesses,
                  RenderPassExecuteCallback execute,
                  bool clearOutputs = true);
 
-    void addExternalResource(const std::string& name, VkImage image, VkImageView view, VkFormat format, uint32_t width, uint32_t height, VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+    void addExternalResource(const std::string& name, VkImage image, VkImageView view, VkFormat format, uint32_t width, uint32_t height,
+                             VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                             uint32_t baseArrayLayer = 0, uint32_t layerCount = VK_REMAINING_ARRAY_LAYERS);
+    void addExternalBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize size);
+    // Contents don't survive the frame, anything read next frame must stay external
+    void addTransientImage(const std::string& name, const TransientImageDesc& desc);
     void setResourceClearValue(const std::string& name, VkClearValue clearValue);
+    // PRESENT_SRC for swapchain images, TRANSFER_SRC for offscreen readback.
+    // Passes writing a resource with a final layout are the roots the graph keeps alive.
+    void setResourceFinalLayout(const std::string& name, VkImageLayout finalLayout);
+    // Contents are consumed after execute() (host readback, next frame), so passes writing
+    // the resource (or any view of the same image / buffer) are roots too. Cleared when the
+    // resource is registered again.
+    void markExported(const std::string& name);
+    // Recorded on the primary command buffer right before / after the pass: behind the
+    // level's barriers, outside its rendering and never in a secondary. For timestamps
+    // and queries that need a fixed spot in the frame. Skipped with the pass when it's culled.
+    void setPassHooks(const std::string& passName, RenderPassExecuteCallback before,
+                      RenderPassExecuteCallback after = nullptr);
 
-    void execute(VkCommandBuffer cmd, VkExtent2D extent);
+    // frameIndex selects the per-thread command pools to reset, the caller must have
+    // waited on that frame slot's fence
+    void execute(VkCommandBuffer cmd, VkExtent2D extent, uint32_t frameIndex);
     void clear();
 
+    // Valid inside pass callbacks (transients are only realized during execute)
+    VkImage getImage(const std::string& name) const;
+    VkImageView getImageView(const std::string& name) const;
+
+    const RenderGraphStats& getStats() const { return m_stats; }
+    // True when the last execute() recorded the pass (declared and not culled), until clear()
+    bool wasExecuted(const std::string& passName) const;
+
 private:
+    void compile();
+    const RenderPassResource& getResource(const RenderPassNode& pass, const std::string& name) const;
+    bool dependsOn(const RenderPassNode& later, const RenderPassNode& earlier) const;
+    bool readsFrom(const RenderPassNode& reader, const RenderPassNode& writer) const;
+    void recordPass(VkCommandBuffer cmd, const RenderPassNode& pass, VkCommandBuffer secondary = VK_NULL_HANDLE);
+    void recordSecondaries(uint32_t frameIndex);
+    VkCommandBuffer acquireSecondary(uint32_t frameIndex, uint32_t threadIndex);
+    void realizeTransients();
+    void destroyTransients();
+
     Context* m_context;
+    JobSystem* m_jobSystem;
     std::vector<RenderPassNode> m_passes;
     std::map<std::string, RenderPassResource> m_resources;
-    std::map<VkImage, VkImageLayout> m_imageLayouts;
+    std::map<VkImage, ResourceSyncState> m_imageStates;
+    std::map<VkBuffer, ResourceSyncState> m_bufferStates;
+
+    // Compile output: pass indices grouped by dependency level, each level gets one barrier batch
+    std::vector<std::vector<uint32_t>> m_levels;
+    RenderGraphStats m_stats;
+
+    struct TransientImage {
+        TransientImageDesc desc;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkMemoryRequirements requirements{};
+        uint32_t firstLevel = 0;
+        uint32_t lastLevel = 0;
+        uint32_t block = 0;
+    };
+    std::map<std::string, TransientImageDesc> m_transientDescs; // Declared this frame
+    std::map<std::string, TransientImage> m_transients;         // Realized (declared since the last resize), reused while the plan holds
+    std::vector<VmaAllocation> m_transientBlocks;
+    std::vector<std::vector<VkImage>> m_blockImages; // Images aliasing each block
+    VkDeviceSize m_transientBytesRequested = 0;
+    VkDeviceSize m_transientBytesAllocated = 0;
+
+    // Parallel recording: one pool per frame slot and thread, reset when the slot comes around again
+    struct RecordPool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+        uint32_t used = 0;
+    };
+    std::vector<std::vector<RecordPool>> m_recordPools; // [frameIndex][threadIndex]
+    std::vector<VkCommandBuffer> m_secondaries;         // Per pass, null = record inline
 };
 
 } // namespace astral
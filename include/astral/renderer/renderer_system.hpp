@@ -18,12 +18,52 @@ struct Model; // Forward declaration
 class Swapchain;
 class CommandBuffer;
 class FrameSync;
+
+// Written by cull.comp, the draw counts double as vkCmdDrawIndexedIndirectCount sources
+struct CullCounters {
+  uint32_t earlyDrawCount;
+  uint32_t lateDrawCount;
+  uint32_t lateCandidateCount; // Hidden by last frame's depth, retested after the early draws
+  uint32_t frustumCulled;
+  uint32_t occlusionCulled;
+  uint32_t transparentDrawn;
+  uint32_t shadowDrawCount[4];        // Static casters per cascade
+  uint32_t shadowDynamicDrawCount[4]; // Dynamic casters per cascade
+  uint32_t meshletDrawCount;
+  uint32_t meshletsCulled;
+  uint32_t meshletDispatch[3]; // VkDispatchIndirectCommand, x = instances queued for meshlet culling
+  uint32_t padding;
+};
+
+// Written by the scan phase of cluster_cull.comp
+struct LightCullCounters {
+  uint32_t requiredIndices; // Light index buffer entries the frame needed, may exceed its capacity
+  uint32_t padding[3];
+};
+
 class RendererSystem {
 public:
-  RendererSystem(Context *context, Swapchain *swapchain, uint32_t width,
-                 uint32_t height);
+  // Frame slots the application cycles through (command buffers, fences and
+  // every per-frame resource here)
+  static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+
+  // Clustered lighting grid: screen tiles of about tileSize pixels, each split
+  // into depthSlices logarithmic slices between the near and far planes
+  struct ClusterGridSpecs {
+    uint32_t tileSize = 64;
+    uint32_t depthSlices = 24;
+  };
+
+  // outputFormat: format of the final target (swapchain image format, or the
+  // offscreen image format in headless mode)
+  RendererSystem(Context *context, VkFormat outputFormat, uint32_t width,
+                 uint32_t height, const ClusterGridSpecs &clusterGrid = {});
   ~RendererSystem();
 
+  // Samples per half-resolution pixel of the compute SSAO (8 / 16 / 32), the
+  // interleaved 4x4 pattern spreads them over the full 32 sample kernel
+  enum class SSAOQuality { Low, Medium, High };
+
   struct UIParams {
     float exposure = 1.0f;
     float bloomStrength = 0.04f;
@@ -33,6 +73,18 @@ public:
     bool enableFXAA = true;
     bool enableHeadlamp = false;
     bool enableSSAO = true;
+    bool enableOcclusionCulling = true;
+    bool enableMeshletCulling = true;
+    bool enableLod = true;
+    bool enableShadowCaching = true;
+    // Position-only depth pass before the opaque shading
+    bool enableDepthPrepass = true;
+    // Rasterize triangle IDs only and shade every pixel once in a compute
+    // resolve (replaces the prepass and the opaque passes when on)
+    bool enableVisibilityBuffer = false;
+    // Skip clusters behind the farthest depth of their tile. Needs this frame's
+    // depth, so only applies with the prepass or the visibility buffer
+    bool enableClusterDepthBounds = false;
     bool visualizeCascades = false;
     float shadowBias = 0.002f;
     float shadowNormalBias = 0.005f;
@@ -40,20 +92,76 @@ public:
     float csmLambda = 0.95f;
     float ssaoRadius = 0.5f;
     float ssaoBias = 0.025f;
+    // Half-resolution compute SSAO with a bilateral upsample, off = the full
+    // resolution fragment path (32 samples + blur)
+    bool ssaoCompute = true;
+    SSAOQuality ssaoQuality = SSAOQuality::Medium;
     float gamma = 2.2f;
     float iblIntensity = 1.0f;
     int selectedMaterial = 0;
     int selectedLight = 0;
   };
 
+  // Image the graph resolves into ("FinalOutput" resource). Either the
+  // acquired swapchain image or an offscreen image for headless rendering.
+  struct OutputTarget {
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent = {0, 0};
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  };
+
   void initializePipelines(VkDescriptorSetLayout *setLayouts,
                            uint32_t layoutCount);
 
   void render(CommandBuffer &cmd, RenderGraph &graph,
               SceneManager &sceneManager, uint32_t currentFrame,
-              uint32_t imageIndex, const SceneData &sceneData,
-              Swapchain *swapchain, FrameSync *sync, const UIParams &uiParams,
-              const Model *model, uint32_t skyboxIndex);
+              const OutputTarget &output, const SceneData &sceneData,
+              FrameSync *sync, const UIParams &uiParams, uint32_t skyboxIndex);
+
+  // Resets this frame slot's timestamp queries. Record on the primary command
+  // buffer before the graph runs.
+  void recordFrameBegin(VkCommandBuffer cmd, uint32_t currentFrame);
+
+  // Copies this frame's culling and light culling counters to the host, record
+  // after the graph ran. They're picked up by render() once the frame slot
+  // comes around again.
+  void recordCullReadback(VkCommandBuffer cmd, uint32_t currentFrame);
+
+  // Call once the frame's command buffer was submitted, before the graph is
+  // cleared. Contents that later frames reuse (the Hi-Z pyramid, the cluster
+  // AABBs) only count as valid once the pass writing them went to the GPU.
+  void onFrameSubmitted(const RenderGraph &graph);
+
+  struct CullStats {
+    uint32_t instanceCount = 0;
+    uint32_t drawnCount = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t occlusionCulled = 0;
+    uint32_t shadowDrawn = 0; // Summed over the cascades
+    uint32_t meshletsDrawn = 0;
+    uint32_t meshletsCulled = 0;
+  };
+  const CullStats &getCullStats() const { return m_cullStats; }
+
+  struct LightCullStats {
+    uint32_t lightCount = 0;
+    uint32_t indexCount = 0;    // Light index entries written (hits over all clusters)
+    uint32_t indexCapacity = 0; // What the light index buffer holds
+    float gpuMs = 0.0f;         // Count + scan + write, 0 without timestamp support
+  };
+  const LightCullStats &getLightCullStats() const { return m_lightCullStats; }
+
+  struct SSAOStats {
+    bool compute = false; // Which path the timing is from
+    float gpuMs = 0.0f;   // All SSAO passes, 0 without timestamp support
+  };
+  const SSAOStats &getSSAOStats() const { return m_ssaoStats; }
+
+  // Forces the cached shadow cascades to re-render their static casters, for
+  // changes the instance registry doesn't see (e.g. geometry edited in place)
+  void invalidateShadowCache();
 
   // Getters for resources that might be needed by App (or maybe App shouldn't
   // know) For now, let's keep it simple.
@@ -69,42 +177,53 @@ public:
   // manage them internally and expose binding them to the graph.
 
   struct RenderResources {
-    std::unique_ptr<Image> hdrImage;
-    std::unique_ptr<Image> normalImage;
+    // HDR/Normal/Velocity/LDR/SSAO/Bloom/SceneColor are RenderGraph transients.
+    // Depth stays here so it can be read the following frame.
     std::unique_ptr<Image> depthImage;
-    std::unique_ptr<Image> velocityImage;
-    std::unique_ptr<Image> ldrImage;
 
     // TAA
     std::unique_ptr<Image> taaHistoryImage1;
     std::unique_ptr<Image> taaHistoryImage2;
     bool taaPingPong = false;
 
+    // Hi-Z: max depth pyramid at half resolution, built after the early opaque
+    // draws and read by both culling phases (the early one a frame later)
+    std::unique_ptr<Image> depthPyramid;
+    std::vector<VkImageView> depthPyramidMipViews;
+    std::vector<uint32_t> depthPyramidMipIndices; // Storage image slots
+    bool depthPyramidValid = false;
+
+    // GPU culling output, per frame in flight. The per-instance ones grow
+    // with the frame's instance count.
+    std::vector<std::unique_ptr<GrowableBuffer>> drawCommandBuffers;
+    std::vector<std::unique_ptr<Buffer>> cullCounterBuffers;
+    std::vector<std::unique_ptr<GrowableBuffer>> cullCandidateBuffers;
+    std::vector<std::unique_ptr<Buffer>> cullReadbackBuffers;
+    std::vector<std::unique_ptr<GrowableBuffer>> shadowDrawCommandBuffers; // One region per cascade
+    std::vector<uint32_t> cullCounterBufferIndices;
+
     // Shadow
     std::unique_ptr<Image> shadowImage;
     std::vector<VkImageView> shadowLayerViews;
+    // Static casters of the cached cascades (1-3), copied into the shadow map
+    // before the dynamic casters are drawn on top
+    std::unique_ptr<Image> shadowCacheImage;
+    std::vector<VkImageView> shadowCacheLayerViews;
 
     // SSAO
-    std::unique_ptr<Image> ssaoImage;
-    std::unique_ptr<Image> ssaoBlurImage;
     std::unique_ptr<Image> noiseImage;
     std::unique_ptr<Buffer> ssaoKernelBuffer;
 
-    // Bloom
-    std::unique_ptr<Image> bloomImage;
-    std::unique_ptr<Image> bloomBlurImage;
 
-    // Transmission
-    std::unique_ptr<Image> sceneColorImage; // Copy of Opaque Pass
-    
     // Cluster
     std::unique_ptr<Buffer> clusterBuffer;
     std::vector<std::unique_ptr<Buffer>> clusterGridBuffers;
-    std::vector<std::unique_ptr<Buffer>> lightIndexBuffers;
-    std::vector<std::unique_ptr<Buffer>> clusterAtomicBuffers;
+    // Compacted per-cluster light lists, sized by the hits the frame slot last
+    // needed (read back with the culling counters)
+    std::vector<std::unique_ptr<GrowableBuffer>> lightIndexBuffers;
+    std::vector<std::unique_ptr<Buffer>> lightCullCounterBuffers;
     std::vector<uint32_t> clusterGridBufferIndices;
-    std::vector<uint32_t> lightIndexBufferIndices;
-    std::vector<uint32_t> clusterAtomicBufferIndices;
+    std::vector<uint32_t> lightCullCounterBufferIndices;
   };
 
   RenderResources &getResources() { return m_resources; }
@@ -118,7 +237,7 @@ public:
 
 private:
   Context *m_context;
-  VkFormat m_swapchainFormat;
+  VkFormat m_outputFormat;
   uint32_t m_width;
   uint32_t m_height;
 
@@ -129,46 +248,72 @@ private:
   std::shared_ptr<Shader> m_taaFragShader;
   std::shared_ptr<Shader> m_ssaoFragShader;
   std::shared_ptr<Shader> m_ssaoBlurFragShader;
+  std::shared_ptr<Shader> m_ssaoDownsampleShader;
+  std::shared_ptr<Shader> m_ssaoComputeShader;
+  std::shared_ptr<Shader> m_ssaoUpsampleFragShader;
   std::shared_ptr<Shader> m_compositeFragShader;
   std::shared_ptr<Shader> m_bloomFragShader;
   std::shared_ptr<Shader> m_fxaaFragShader;
   std::shared_ptr<Shader> m_shadowVertShader;
+  std::shared_ptr<Shader> m_depthPrepassVertShader;
   std::shared_ptr<Shader> m_shadowFragShader;
   std::shared_ptr<Shader> m_cullShader;
+  std::shared_ptr<Shader> m_depthPyramidShader;
   std::shared_ptr<Shader> m_clusterBuildShader;
   std::shared_ptr<Shader> m_clusterCullShader;
   std::shared_ptr<Shader> m_skyboxVertShader;
   std::shared_ptr<Shader> m_skyboxFragShader;
+  std::shared_ptr<Shader> m_visibilityVertShader;
+  std::shared_ptr<Shader> m_visibilityFragShader;
+  std::shared_ptr<Shader> m_visibilityResolveShader;
 
   // Pipelines
   std::unique_ptr<GraphicsPipeline> m_pbrPipeline; // Opaque
+  // Opaque after the depth prepass: EQUAL without depth writes, or LESS_OR_EQUAL
+  // with writes when alpha tested materials (not in the prepass) are around
+  std::unique_ptr<GraphicsPipeline> m_pbrEqualPipeline;
+  std::unique_ptr<GraphicsPipeline> m_pbrLessEqualPipeline;
+  std::unique_ptr<GraphicsPipeline> m_depthPrepassPipeline;
   std::unique_ptr<GraphicsPipeline> m_pbrTransparentPipeline; // Transparent
   std::unique_ptr<GraphicsPipeline> m_taaPipeline;
   std::unique_ptr<GraphicsPipeline> m_ssaoPipeline;
   std::unique_ptr<GraphicsPipeline> m_ssaoBlurPipeline;
+  std::unique_ptr<ComputePipeline> m_ssaoDownsamplePipeline;
+  std::unique_ptr<ComputePipeline> m_ssaoComputePipeline;
+  std::unique_ptr<GraphicsPipeline> m_ssaoUpsamplePipeline;
   std::unique_ptr<GraphicsPipeline> m_compositePipeline;
   std::unique_ptr<GraphicsPipeline> m_bloomPipeline;
   std::unique_ptr<GraphicsPipeline> m_fxaaPipeline;
   std::unique_ptr<GraphicsPipeline> m_shadowPipeline;
   std::unique_ptr<ComputePipeline> m_cullPipeline;
+  std::unique_ptr<ComputePipeline> m_depthPyramidPipeline;
   std::unique_ptr<ComputePipeline> m_clusterBuildPipeline;
   std::unique_ptr<ComputePipeline> m_clusterCullPipeline;
   std::unique_ptr<GraphicsPipeline> m_skyboxPipeline;
+  // Visibility buffer path, null where the device lacks its features
+  std::unique_ptr<GraphicsPipeline> m_visibilityPipeline;
+  std::unique_ptr<ComputePipeline> m_visibilityResolvePipeline;
 
   // Layouts
   VkPipelineLayout m_pipelineLayout;
   VkPipelineLayout m_taaLayout;
   VkPipelineLayout m_ssaoLayout;
   VkPipelineLayout m_ssaoBlurLayout;
+  VkPipelineLayout m_ssaoDownsampleLayout;
+  VkPipelineLayout m_ssaoComputeLayout;
+  VkPipelineLayout m_ssaoUpsampleLayout;
   VkPipelineLayout m_compositeLayout;
   VkPipelineLayout m_bloomLayout;
   VkPipelineLayout m_fxaaLayout;
   // m_shadowLayout reuses pipelineLayout (basic one) or we might need specific
   // if push constants differ
   VkPipelineLayout m_cullLayout;
+  VkPipelineLayout m_depthPyramidLayout;
   VkPipelineLayout m_clusterBuildLayout;
   VkPipelineLayout m_clusterCullLayout;
   VkPipelineLayout m_skyboxLayout;
+  VkPipelineLayout m_visibilityLayout = VK_NULL_HANDLE;
+  VkPipelineLayout m_visibilityResolveLayout = VK_NULL_HANDLE;
 
   RenderResources m_resources;
 
@@ -176,6 +321,7 @@ private:
   VkSampler m_hdrSampler;
   VkSampler m_noiseSampler;
   VkSampler m_shadowSampler;
+  VkSampler m_depthPyramidSampler;
 
   // Indices
   uint32_t m_hdrTextureIndex;
@@ -187,6 +333,13 @@ private:
   uint32_t m_noiseTextureIndex;
   uint32_t m_ssaoTextureIndex;
   uint32_t m_ssaoBlurTextureIndex;
+  // Half-resolution compute SSAO targets, sampled and storage slots
+  uint32_t m_ssaoHalfDepthIndex;
+  uint32_t m_ssaoHalfDepthStorageIndex;
+  uint32_t m_ssaoHalfNormalIndex;
+  uint32_t m_ssaoHalfNormalStorageIndex;
+  uint32_t m_ssaoHalfIndex;
+  uint32_t m_ssaoHalfStorageIndex;
   uint32_t m_bloomTextureIndex;
   uint32_t m_bloomBlurTextureIndex;
   uint32_t m_shadowMapIndex;
@@ -194,11 +347,69 @@ private:
   uint32_t m_ldrTextureIndex;
   uint32_t m_ssaoKernelBufferIndex;
   uint32_t m_clusterBufferIndex;
+  uint32_t m_depthPyramidIndex;
+  uint32_t m_visibilityTextureIndex;
+  // Storage slots of HDR / Normal / Velocity, written by the visibility resolve
+  uint32_t m_hdrStorageIndex;
+  uint32_t m_normalStorageIndex;
+  uint32_t m_velocityStorageIndex;
+  // The scene's IDs didn't fit 32 bits once, the forward path took over
+  bool m_visibilityFallbackWarned = false;
+
+  // Grid dimensions, derived from the resolution and ClusterGridSpecs
+  uint32_t m_clusterGridX;
+  uint32_t m_clusterGridY;
+  uint32_t m_clusterGridZ;
+  uint32_t m_clusterCount;
+  // Projection the cluster AABBs were built for, rebuilt when it changes
+  struct ClusterBuildState {
+    glm::mat4 invProj{1.0f};
+    float nearClip = 0.0f;
+    float farClip = 0.0f;
+    bool valid = false;
+  };
+  ClusterBuildState m_clusterBuild;
+  // What this frame's ClusterBuildPass builds, promoted by onFrameSubmitted
+  ClusterBuildState m_pendingClusterBuild;
 
-  bool m_clustersBuilt = false;
+  // Readback of cullReadbackBuffers, per frame slot
+  std::vector<bool> m_cullReadbackPending;
+  std::vector<uint32_t> m_cullInstanceCounts;
+  CullStats m_cullStats;
+  std::vector<uint32_t> m_lightCullLightCounts;
+  LightCullStats m_lightCullStats;
+  // Per frame slot: two timestamps around the light culling dispatches, two
+  // around the SSAO passes. Null when the graphics queue can't write them.
+  VkQueryPool m_timestampPool = VK_NULL_HANDLE;
+  float m_timestampPeriod = 0.0f; // Nanoseconds per tick
+  std::vector<bool> m_lightCullTimingPending;
+  std::vector<bool> m_ssaoTimingPending;
+  std::vector<bool> m_ssaoTimingCompute;
+  SSAOStats m_ssaoStats;
+
+  // What each cascade layer of shadowImage currently holds
+  struct ShadowCascadeCache {
+    glm::mat4 viewProj{1.0f}; // Matrix the cached static layer was drawn with
+    uint64_t dynamicHash = 0; // Dynamic casters drawn on top of it
+    bool valid = false;
+  };
+  ShadowCascadeCache m_shadowCascades[4];
+  // What this frame's shadow passes draw, promoted by onFrameSubmitted
+  struct PendingShadowCache {
+    ShadowCascadeCache cascades[4];
+    bool cacheRefreshed = false; // Some layer of shadowCacheImage was redrawn
+  };
+  PendingShadowCache m_pendingShadowCache;
+  uint64_t m_shadowCacheStaticVersion = 0; // SceneManager::getStaticSceneVersion
+  bool m_shadowMapValid = false;   // Left SHADER_READ_ONLY by the last frame
+  bool m_shadowCacheValid = false; // Left TRANSFER_SRC by the last frame
 
   // Internal helpers
   std::string readFile(const std::string &filename);
+  // Binds the scene's geometry arena, the same buffers for every draw. Depth-only
+  // passes only fetch the position stream.
+  void bindGeometry(VkCommandBuffer cb, const SceneManager &sceneManager,
+                    bool positionsOnly) const;
   void createSemaphores(); // Actually semaphores are per-frame, owned by App
                            // usually or Renderer? Sync object is in App.
 };
@@ -1,21 +1,51 @@
 #pragma once
 
 #include "astral/core/context.hpp"
+#include "astral/renderer/draw_key.hpp"
+#include "astral/renderer/geometry_arena.hpp"
 #include "astral/renderer/model.hpp"
 #include "astral/renderer/scene_data.hpp"
 #include "astral/renderer/material.hpp"
 #include "astral/resources/buffer.hpp"
+#include "astral/resources/growable_buffer.hpp"
+#include "astral/resources/upload_ring.hpp"
 #include <memory>
 #include <vector>
 
 namespace astral {
 
+// MeshInstance::flags
+constexpr uint32_t MESH_INSTANCE_DYNAMIC = 1; // Moves, never baked into cached shadow layers
+
 struct MeshInstance {
   glm::mat4 transform;
   glm::vec3 sphereCenter;
   float sphereRadius;
   uint32_t materialIndex;
-  uint32_t padding[3];
+  uint32_t flags;
+  uint32_t firstMeshlet; // Into the geometry arena's meshlet table
+  uint32_t meshletCount; // 0 = culled and drawn as a whole
+};
+
+// Stable handle to a registered mesh instance. The instance's GPU slot moves
+// when others are added / removed, the handle doesn't.
+using InstanceHandle = uint32_t;
+constexpr InstanceHandle INVALID_INSTANCE = UINT32_MAX;
+
+struct MeshInstanceDesc {
+  glm::mat4 transform{1.0f};
+  uint32_t materialIndex = 0;
+  uint32_t indexCount = 0;
+  uint32_t firstIndex = 0;
+  int32_t vertexOffset = 0;
+  uint32_t firstMeshlet = 0; // Absolute, geometry allocation + primitive
+  uint32_t meshletCount = 0;
+  // Coarser levels, absolute like the full detail range above. lods[0] is LOD 1.
+  uint32_t lodCount = 1;
+  PrimitiveLod lods[MAX_LODS - 1] = {};
+  glm::vec3 boundingCenter{0.0f}; // Object space
+  float boundingRadius = 0.0f;
+  bool dynamic = false;
 };
 
 struct Cluster {
@@ -33,6 +63,9 @@ public:
   SceneManager(Context *context);
   ~SceneManager() = default;
 
+  // Rewinds this frame's upload region, call right after waiting on its fence
+  // and before any of the per-frame updates below
+  void beginFrame(uint32_t frameIndex);
   void updateSceneData(uint32_t frameIndex, const SceneData &data);
 
   // Light management
@@ -43,57 +76,98 @@ public:
   void clearLights();
   const std::vector<Light> &getLights() const { return m_lights; }
   uint32_t getLightBufferIndex(uint32_t frameIndex) const {
-    return m_lightBufferIndices[frameIndex];
+    return m_lightBuffers[frameIndex]->getIndex();
   }
 
   void addModel(std::unique_ptr<Model> model);
+
+  // Every model's vertices and indices, bound once per pass
+  GeometryArena &getGeometryArena() { return *m_geometryArena; }
+  const GeometryArena &getGeometryArena() const { return *m_geometryArena; }
   
   // Material Management
   int32_t addMaterial(const Material& material);
-  void updateMaterialBuffer();
+  // Uploads the material table if this frame's copy is stale, after the frame's fence
+  void updateMaterialBuffer(uint32_t frameIndex);
   
   const std::vector<std::unique_ptr<Model>>& getModels() const { return m_models; }
-  const Buffer& getMaterialBuffer() const { return *m_materialBuffer; }
-  uint32_t getMaterialBufferIndex() const { return m_materialBufferIndex; }
+  const Buffer& getMaterialBuffer(uint32_t frameIndex) const { return m_materialBuffers[frameIndex]->get(); }
+  uint32_t getMaterialBufferIndex(uint32_t frameIndex) const { return m_materialBuffers[frameIndex]->getIndex(); }
   uint32_t getMaterialCount() const { return static_cast<uint32_t>(m_materials.size()); }
   const std::vector<Material>& getMaterials() const { return m_materials; }
+  // Any alpha tested (MASK) material, those are left out of the depth prepass
+  bool hasMaskedMaterials() const;
   
   void updateMaterial(uint32_t index, const Material& material);
+  // Points every material texture slot 'from' at 'to' (streamed texture became resident)
+  void remapTextureIndex(int32_t from, int32_t to);
 
   VkBuffer getSceneBuffer(uint32_t frameIndex) const {
-    return m_sceneBuffers[frameIndex]->getHandle();
+    return m_uploadRing->getHandle();
   }
   uint32_t getSceneBufferIndex(uint32_t frameIndex) const {
-    return m_sceneBufferIndices[frameIndex];
+    return m_sceneSlots[frameIndex].index;
   }
   uint32_t getMeshInstanceBufferIndex(uint32_t frameIndex) const {
-    return m_meshInstanceBufferIndices[frameIndex];
+    return m_instanceBuffers[frameIndex]->getIndex();
   }
   uint32_t getIndirectBufferIndex(uint32_t frameIndex) const {
-    return m_indirectBufferIndices[frameIndex];
+    return m_indirectBuffers[frameIndex]->getIndex();
   }
   uint32_t getClusterBufferIndex() const { return m_clusterBufferIndex; }
   uint32_t getLightIndexBufferIndex() const { return m_lightIndexBufferIndex; }
 
-  void addMeshInstance(uint32_t frameIndex, const glm::mat4 &transform,
-                       uint32_t materialIndex, uint32_t indexCount,
-                       uint32_t firstIndex, int vertexOffset,
-                       const glm::vec3 &center, float radius);
-  void prepareIndirectCommands();
-  void clearMeshInstances(uint32_t frameIndex);
+  // Persistent instance registry. Instances stay until destroyed, only the
+  // slots that changed are copied to the GPU, so a static scene costs nothing
+  // per frame. The GPU buffers grow with the registry, there is no upper limit.
+  InstanceHandle createMeshInstance(const MeshInstanceDesc &desc);
+  void destroyMeshInstance(InstanceHandle handle);
+  void setInstanceTransform(InstanceHandle handle, const glm::mat4 &transform);
+  void setInstanceMaterial(InstanceHandle handle, uint32_t materialIndex);
+  void clearMeshInstances();
+
+  // Picks every instance's level of detail from the screen height its bounding
+  // sphere covers (projectionScale = projection[1][1]), with some hysteresis so
+  // instances near a threshold don't flicker between levels. Only instances
+  // that switch get re-uploaded. Disabled = full detail everywhere. Call before
+  // uploadInstances.
+  void selectLods(const glm::vec3 &cameraPos, float projectionScale, bool enabled);
 
-  void sortAndUploadInstances(uint32_t frameIndex, const glm::vec3& cameraPos);
+  // Sorts the transparent slots back to front and copies whatever this frame's
+  // buffers haven't seen yet (everything, if they had to grow). Call after
+  // waiting on the frame's fence.
+  void uploadInstances(uint32_t frameIndex, const glm::vec3 &cameraPos);
 
+  // As of the frame's last uploadInstances
   size_t getMeshInstanceCount(uint32_t frameIndex) const {
-    return m_frameInstances[frameIndex].size();
+    return m_frameInstanceCounts[frameIndex];
   }
   
   size_t getOpaqueMeshInstanceCount(uint32_t frameIndex) const {
       return m_opaqueInstanceCounts[frameIndex];
   }
+  // Summed over the live instances (their largest level), bounds the meshlet
+  // draw list
+  uint32_t getMeshletCount() const { return m_meshletCount; }
+  // Triangles of the largest index range an instance was created with (its
+  // full detail level). Only reset by clearMeshInstances, so it can overstate.
+  uint32_t getMaxDrawTriangles() const { return m_maxDrawTriangles; }
+
+  // Filled by uploadInstances in creation order, the shadow cache tracks these
+  // on the CPU
+  const std::vector<MeshInstance> &getDynamicInstances(uint32_t frameIndex) const {
+    return m_dynamicInstances[frameIndex];
+  }
+  // Per entry of getDynamicInstances: a stamp unique to the instance that is
+  // renewed whenever its slot changes (transform, material, LOD, slot move)
+  const std::vector<uint64_t> &getDynamicInstanceVersions(uint32_t frameIndex) const {
+    return m_dynamicVersions[frameIndex];
+  }
+  // Bumped whenever a static instance is added, removed or moved
+  uint64_t getStaticSceneVersion() const { return m_staticVersion; }
 
   VkBuffer getMeshInstanceBuffer(uint32_t frameIndex) const {
-    return m_meshInstanceBuffers[frameIndex]->getHandle();
+    return m_instanceBuffers[frameIndex]->getHandle();
   }
   VkBuffer getIndirectBuffer(uint32_t frameIndex) const {
     return m_indirectBuffers[frameIndex]->getHandle();
@@ -107,50 +181,85 @@ private:
   Context *m_context;
   static const int MAX_FRAMES_IN_FLIGHT = 2;
 
-  std::vector<std::unique_ptr<Buffer>> m_sceneBuffers;
-  std::vector<std::unique_ptr<Buffer>> m_meshInstanceBuffers;
-  std::vector<std::unique_ptr<Buffer>> m_indirectBuffers;
-  std::vector<std::unique_ptr<Buffer>> m_lightBuffers;
+  // Scene data is rewritten every frame, it lives in the upload ring. Its
+  // descriptor slot follows the allocation (see bindUpload).
+  std::unique_ptr<UploadRing> m_uploadRing;
+  // Per frame in flight mirrors of m_instances / m_commands, patched sparsely.
+  // One command per instance, GPU culling compacts the visible ones into its own buffer.
+  std::vector<std::unique_ptr<GrowableBuffer>> m_instanceBuffers;
+  std::vector<std::unique_ptr<GrowableBuffer>> m_indirectBuffers;
+  // Rewritten every frame, sized by the light count
+  std::vector<std::unique_ptr<GrowableBuffer>> m_lightBuffers;
+
+  struct UploadSlot {
+    uint32_t index = 0;
+    VkDeviceSize offset = VK_WHOLE_SIZE; // What the descriptor currently points at
+    VkDeviceSize range = 0;
+  };
+  void bindUpload(UploadSlot &slot, const UploadAllocation &allocation,
+                  uint32_t binding);
+  std::vector<UploadSlot> m_sceneSlots;
 
   // Static buffers (update rarely or handled differently)
   std::unique_ptr<Buffer> m_clusterBuffer;
   std::unique_ptr<Buffer> m_lightIndexBuffer;
 
-  std::vector<uint32_t> m_sceneBufferIndices;
-  std::vector<uint32_t> m_meshInstanceBufferIndices;
-  std::vector<uint32_t> m_indirectBufferIndices;
-  std::vector<uint32_t> m_lightBufferIndices;
-  
-  uint32_t m_materialBufferIndex;
   uint32_t m_clusterBufferIndex;
   uint32_t m_lightIndexBufferIndex;
 
   std::vector<Light> m_lights;
 
-    // Helper struct for per-frame processing before upload
-    struct FrameMeshInstance {
-        MeshInstance meshInstance;
-        uint32_t indexCount;
-        uint32_t firstIndex;
-        int32_t vertexOffset;
-    };
+  // Instance registry, dense slots with the opaque ones first:
+  // [0, m_opaqueCount) opaque, [m_opaqueCount, size) transparent
+  bool isTransparentMaterial(uint32_t materialIndex) const;
+  void swapSlots(uint32_t a, uint32_t b);
+  void markSlotDirty(uint32_t slot);
+  void setSlotTransparent(uint32_t slot, bool transparent);
+
+  std::vector<MeshInstance> m_instances;
+  std::vector<VkDrawIndexedIndirectCommand> m_commands;
+  std::vector<InstanceHandle> m_slotHandles;
+  std::vector<uint32_t> m_handleSlots; // UINT32_MAX for free handles
+  std::vector<InstanceHandle> m_freeHandles;
+  std::vector<InstanceHandle> m_dynamicHandles;
+  uint32_t m_opaqueCount = 0;
+  uint32_t m_meshletCount = 0;
+  uint32_t m_maxDrawTriangles = 0;
 
-  // Per frame instance data
-  std::vector<std::vector<FrameMeshInstance>> m_frameInstances; // [frame][instance]
+  // Per handle: every level's draw range and the one its slot currently uses
+  struct InstanceLods {
+    PrimitiveLod levels[MAX_LODS] = {};
+    uint32_t count = 1;
+    uint32_t current = 0;
+    uint32_t meshletBound = 0; // Most meshlets of any level
+  };
+  std::vector<InstanceLods> m_handleLods;
+  std::vector<uint64_t> m_handleVersions; // Stamp per handle, see getDynamicInstanceVersions
+  uint64_t m_instanceVersion = 0;
+  uint64_t m_staticVersion = 0;
+
+  // Bit per frame in flight whose buffers are still stale for the slot
+  std::vector<uint8_t> m_slotStaleFrames;
+  std::vector<uint32_t> m_staleSlots;
+  std::vector<uint32_t> m_uploadScratch;
+  std::vector<DrawKey> m_sortKeys; // Only grow, sorting doesn't allocate in steady state
+  std::vector<DrawKey> m_sortScratch;
+
+  // What each frame's buffers were last uploaded with
+  std::vector<uint32_t> m_frameInstanceCounts;
   std::vector<uint32_t> m_opaqueInstanceCounts;
+  std::vector<std::vector<MeshInstance>> m_dynamicInstances;
+  std::vector<std::vector<uint64_t>> m_dynamicVersions;
 
+  // Declared before the models, they free into it on destruction
+  std::unique_ptr<GeometryArena> m_geometryArena;
   std::vector<std::unique_ptr<Model>> m_models;
 
   // Materials
   std::vector<Material> m_materials;
   std::vector<MaterialGPU> m_gpuMaterials; // Flattened for upload
-  std::unique_ptr<Buffer> m_materialBuffer;
-  bool m_materialsDirty = false;
-  
-  // Limits
-  static constexpr uint32_t MAX_MATERIALS = 10000;
-  static constexpr uint32_t MAX_LIGHTS = 256;
-  static constexpr uint32_t MAX_MESH_INSTANCES = 10000;
+  std::vector<std::unique_ptr<GrowableBuffer>> m_materialBuffers;
+  uint8_t m_materialStaleFrames = 0; // Bit per frame in flight
 };
 
 } // namespace astral
@@ -16,6 +16,9 @@ struct SwapchainSupportDetails {
 
 class Swapchain {
 public:
+    // Picked when the surface offers it (sRGB nonlinear), headless targets use it too
+    static constexpr VkFormat PREFERRED_FORMAT = VK_FORMAT_B8G8R8A8_UNORM;
+
     Swapchain(Context* context, Window* window);
     ~Swapchain();
 
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace astral {
+
+struct CookedTexture {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    std::vector<uint8_t> data;             // Every mip back to back, ready for vkCmdCopyBufferToImage
+    std::vector<VkDeviceSize> mipOffsets;  // Into data, full chain down to 1x1
+};
+
+// Turns an encoded image (png/jpg/...) into its final GPU layout: full mip chain, block
+// compressed if format is one of the BC formats of BlockCompressor. Results are cached on
+// disk keyed by a hash of the source bytes and the target format, so a texture is only
+// ever cooked once. Thread safe, the streamer's decode threads all share one.
+class TextureCooker {
+public:
+    // Empty cacheDirectory: cook every time, never touch the disk
+    explicit TextureCooker(std::filesystem::path cacheDirectory = {});
+
+    // name is only for logging. Returns false if the image can't be decoded.
+    bool cook(const std::vector<uint8_t>& encoded, VkFormat format, const std::string& name, CookedTexture& out) const;
+
+private:
+    std::filesystem::path getCachePath(const std::vector<uint8_t>& encoded, VkFormat format) const;
+    bool loadCache(const std::filesystem::path& path, VkFormat format, CookedTexture& out) const;
+    void storeCache(const std::filesystem::path& path, const CookedTexture& texture) const;
+
+    std::filesystem::path m_cacheDirectory;
+};
+
+} // namespace astral
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "astral/core/context.hpp"
+#include "astral/core/commands.hpp"
+#include "astral/renderer/texture_cooker.hpp"
+#include "astral/resources/buffer.hpp"
+#include "astral/resources/image.hpp"
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace astral {
+
+// Fills textures asynchronously: worker threads cook them (decode, mip chain, block
+// compression, see TextureCooker), the main thread batches every decoded texture of a frame into one
+// command buffer on the transfer queue and tracks completion with a timeline semaphore.
+// Nothing here ever blocks the render loop.
+class TextureStreamer {
+public:
+    // cacheDirectory: TextureCooker cache, empty = no disk cache. 0 decode threads = half the hardware threads
+    TextureStreamer(Context* context, std::filesystem::path cacheDirectory = {}, uint32_t decodeThreads = 0);
+    ~TextureStreamer();
+
+    // image: freshly created with the decoded size, full mip chain, transferQueueAccess set.
+    // Its format picks the cooked format (RGBA8 or BC7/BC5/BC4). It stays UNDEFINED
+    // (don't sample it) until update() reports it resident.
+    void enqueue(std::shared_ptr<Image> image, const std::filesystem::path& path);
+    void enqueue(std::shared_ptr<Image> image, std::vector<uint8_t> encoded);
+
+    // Main thread, once per frame: retires finished batches and submits the next one.
+    // Returns the images that became resident (SHADER_READ_ONLY_OPTIMAL) since the last call.
+    std::vector<std::shared_ptr<Image>> update();
+
+    // Wait the next graphics submit must add (fragment / compute shader stages) before it
+    // samples images update() reported: the host seeing the timeline value doesn't order the
+    // transfer queue's writes before the graphics queue's reads. False = nothing new since
+    // the last call.
+    bool takeGraphicsWait(VkSemaphoreSubmitInfo& wait);
+
+    bool isIdle();
+
+private:
+    struct Request {
+        std::shared_ptr<Image> image;
+        std::filesystem::path path;
+        std::vector<uint8_t> encoded; // Used instead of path when not empty
+    };
+
+    struct Decoded {
+        std::shared_ptr<Image> image;
+        std::vector<uint8_t> pixels;           // Every mip back to back, in the image's format
+        std::vector<VkDeviceSize> mipOffsets;
+        bool failed = false;
+    };
+
+    struct Batch {
+        uint64_t timelineValue;
+        std::unique_ptr<CommandBuffer> cmd;
+        std::unique_ptr<Buffer> staging;
+        std::vector<std::shared_ptr<Image>> images;
+    };
+
+    void decodeLoop();
+    Decoded decode(Request& request);
+    void submitBatch(std::vector<Decoded>& decoded);
+
+    Context* m_context;
+    TextureCooker m_cooker;
+    std::unique_ptr<CommandPool> m_commandPool;
+    std::vector<std::unique_ptr<CommandBuffer>> m_freeCommandBuffers;
+    VkSemaphore m_timeline = VK_NULL_HANDLE;
+    uint64_t m_nextTimelineValue = 1;
+    uint64_t m_graphicsWaitValue = 0; // Last batch update() retired that no graphics submit waited on yet
+    std::deque<Batch> m_inFlight;
+
+    // Decode workers
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Request> m_requests;
+    std::vector<Decoded> m_decoded;
+    uint32_t m_decoding = 0;
+    bool m_stop = false;
+
+    // Staging memory per transfer batch, anything bigger goes alone
+    static constexpr VkDeviceSize BATCH_BUDGET = 64ull * 1024 * 1024;
+};
+
+} // namespace astral
@@ -7,6 +7,8 @@ namespace astral {
 
 class Buffer {
 public:
+    // Pass VMA_ALLOCATION_CREATE_MAPPED_BIT to keep the buffer mapped for its whole lifetime,
+    // upload() then is a plain memcpy and map()/unmap() never touch VMA
     Buffer(Context* context, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, VmaAllocationCreateFlags flags = 0);
     ~Buffer();
 
@@ -17,10 +19,13 @@ public:
     void map(void** data);
     void unmap();
     void upload(const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+    // Needed after writing through getMappedData() (no-op on host-coherent memory)
+    void flush(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
 
     VkBuffer getHandle() const { return m_buffer; }
     VmaAllocation getAllocation() const { return m_allocation; }
     VkDeviceSize getSize() const { return m_size; }
+    void* getMappedData() const { return m_persistentData; } // Null unless created MAPPED
 
 private:
     Context* m_context;
@@ -28,6 +33,7 @@ private:
     VmaAllocation m_allocation;
     VkDeviceSize m_size;
     void* m_mappedData = nullptr;
+    void* m_persistentData = nullptr;
 };
 
 } // namespace astral
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "astral/core/context.hpp"
+#include "astral/resources/buffer.hpp"
+#include <memory>
+
+namespace astral {
+
+// Storage buffer with its own bindless slot that reallocates geometrically when it runs out
+// of room, so memory follows the scene instead of a compile-time worst case.
+// One per frame in flight: only reserve() after that frame's fence, the old buffer is then
+// dead on the GPU and gets destroyed right away, and the slot is rewritten in place (the
+// other frame never reads it, see DescriptorManager::reserveBuffer).
+// Contents are not carried over, reserve() returning true means "upload everything again".
+class GrowableBuffer {
+public:
+    GrowableBuffer(Context* context, VkDeviceSize initialSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage,
+                   VmaAllocationCreateFlags flags, uint32_t binding);
+
+    GrowableBuffer(const GrowableBuffer&) = delete;
+    GrowableBuffer& operator=(const GrowableBuffer&) = delete;
+
+    // Grows to at least 'size' bytes (doubling), true if the buffer was replaced
+    bool reserve(VkDeviceSize size);
+
+    Buffer& get() const { return *m_buffer; }
+    VkBuffer getHandle() const { return m_buffer->getHandle(); }
+    VkDeviceSize getSize() const { return m_buffer->getSize(); }
+    void* getMappedData() const { return m_buffer->getMappedData(); }
+    uint32_t getIndex() const { return m_index; }
+
+private:
+    Context* m_context;
+    std::unique_ptr<Buffer> m_buffer;
+    VkBufferUsageFlags m_usage;
+    VmaMemoryUsage m_memoryUsage;
+    VmaAllocationCreateFlags m_flags;
+    uint32_t m_binding;
+    uint32_t m_index;
+};
+
+} // namespace astral
@@ -18,6 +18,7 @@ struct ImageSpecs {
     VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
     VkImageType type = VK_IMAGE_TYPE_2D;
     VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D;
+    bool transferQueueAccess = false; // Written on the transfer queue (streamed textures), shared CONCURRENT if it's another family
 };
 
 class Image {
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace astral {
+
+// CPU block compression for cooked textures. Input is always tightly packed RGBA8,
+// partial blocks at the right/bottom edge repeat the last texel.
+//   BC7 (mode 6)  RGBA colour, 16 bytes per 4x4 block
+//   BC5           R + G (tangent space normal XY), 16 bytes per block
+//   BC4           R only (occlusion, transmission), 8 bytes per block
+class BlockCompressor {
+public:
+    static bool isBlockCompressed(VkFormat format);
+    // Bytes of one width x height mip in format (R8G8B8A8_* or one of the BC formats above)
+    static size_t getImageSize(VkFormat format, uint32_t width, uint32_t height);
+    // dst must hold getImageSize(format, width, height) bytes
+    static void compressImage(VkFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* dst);
+
+    // block: 4x4 RGBA8 texels, row major
+    static void encodeBC4(const uint8_t* block, int channel, uint8_t* dst);
+    static void encodeBC5(const uint8_t* block, uint8_t* dst);
+    static void encodeBC7(const uint8_t* block, uint8_t* dst);
+};
+
+} // namespace astral
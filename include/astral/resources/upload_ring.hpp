@@ -0,0 +1,48 @@
+#pragma once
+
+#include "astral/core/context.hpp"
+#include "astral/resources/buffer.hpp"
+#include <memory>
+#include <vector>
+
+namespace astral {
+
+struct UploadAllocation {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0; // Into buffer, already aligned for storage buffer descriptors
+    VkDeviceSize size = 0;
+    void* data = nullptr;    // Persistently mapped, write straight into it
+};
+
+// Frame-scoped linear allocator for per-frame CPU->GPU data (scene constants, lights,
+// instances). One persistently mapped buffer split into a region per frame in flight;
+// allocating is a pointer bump, nothing is ever mapped or unmapped.
+class UploadRing {
+public:
+    UploadRing(Context* context, VkDeviceSize frameCapacity, uint32_t frameCount, VkBufferUsageFlags usage);
+
+    // Rewinds the region of frameIndex. Only call once that slot's fence has signaled,
+    // everything allocated from it last time around is then dead on the GPU.
+    void beginFrame(uint32_t frameIndex);
+
+    // Throws if the frame region is exhausted
+    UploadAllocation allocate(VkDeviceSize size);
+    UploadAllocation upload(const void* data, VkDeviceSize size);
+    // After writing through UploadAllocation::data (no-op on host-coherent memory)
+    void flush(const UploadAllocation& allocation);
+
+    VkBuffer getHandle() const { return m_buffer->getHandle(); }
+    VkDeviceSize getFrameCapacity() const { return m_frameCapacity; }
+    VkDeviceSize getFrameUsage() const { return m_head - m_frameBase; }
+
+private:
+    std::unique_ptr<Buffer> m_buffer;
+    char* m_mapped = nullptr;
+    VkDeviceSize m_frameCapacity;
+    VkDeviceSize m_alignment;
+    uint32_t m_frameCount;
+    VkDeviceSize m_frameBase = 0;
+    VkDeviceSize m_head = 0;
+};
+
+} // namespace astral
@@ -2,7 +2,11 @@
 #include <GLFW/glfw3.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <imgui.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdio>
+#include <random>
 #include <spdlog/spdlog.h>
 #include "astral/renderer/gltf_loader.hpp"
 #include "astral/renderer/assimp_loader.hpp"
@@ -27,59 +31,92 @@ void AstralApp::init() {
   specs.title = "Astral Renderer";
   specs.width = Config::get().general.windowWidth;
   specs.height = Config::get().general.windowHeight;
+  m_width = specs.width;
+  m_height = specs.height;
 
-  m_window = std::make_unique<Window>(specs);
+  if (!m_headless) {
+    m_window = std::make_unique<Window>(specs);
+  }
   m_context = std::make_unique<Context>(m_window.get());
-  m_swapchain = std::make_unique<Swapchain>(m_context.get(), m_window.get());
-  m_sync = std::make_unique<FrameSync>(m_context.get(), 2);
+  if (!m_headless) {
+    m_swapchain = std::make_unique<Swapchain>(m_context.get(), m_window.get());
+  } else {
+    m_offscreen = std::make_unique<OffscreenTarget>(
+        m_context.get(), m_width, m_height, Swapchain::PREFERRED_FORMAT,
+        RendererSystem::MAX_FRAMES_IN_FLIGHT,
+        Config::get().headless.outputDirectory);
+  }
+  m_sync = std::make_unique<FrameSync>(m_context.get(),
+                                       RendererSystem::MAX_FRAMES_IN_FLIGHT);
 
   // Command Pool
   m_commandPool = std::make_unique<CommandPool>(
       m_context.get(),
       m_context->getQueueFamilyIndices().graphicsFamily.value());
 
-  for (int i = 0; i < 2; i++) { // Max frames in flight
+  for (uint32_t i = 0; i < RendererSystem::MAX_FRAMES_IN_FLIGHT; i++) {
     m_commandBuffers.push_back(m_commandPool->allocateBuffer());
   }
 
   // Per-Image Semaphores
-  m_imageSemaphores.resize(m_swapchain->getImages().size());
-  VkSemaphoreCreateInfo semaphoreInfo = {};
-  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-  for (size_t i = 0; i < m_imageSemaphores.size(); i++) {
-    if (vkCreateSemaphore(m_context->getDevice(), &semaphoreInfo, nullptr,
-                          &m_imageSemaphores[i]) != VK_SUCCESS) {
-      throw std::runtime_error("Failed to create image semaphore!");
+  if (!m_headless) {
+    m_imageSemaphores.resize(m_swapchain->getImages().size());
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    for (size_t i = 0; i < m_imageSemaphores.size(); i++) {
+      if (vkCreateSemaphore(m_context->getDevice(), &semaphoreInfo, nullptr,
+                            &m_imageSemaphores[i]) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create image semaphore!");
+      }
     }
   }
 
   m_sceneManager = std::make_unique<SceneManager>(m_context.get());
   m_envManager = std::make_unique<EnvironmentManager>(m_context.get());
-  m_uiManager = std::make_unique<UIManager>(m_context.get(), m_swapchain->getImageFormat());
+  if (!m_headless) {
+    m_uiManager = std::make_unique<UIManager>(m_context.get(), m_swapchain->getImageFormat());
+  }
   
-  m_assetManager = std::make_unique<AssetManager>(m_context.get());
-  m_assetManager->registerLoader(std::make_unique<GltfLoader>(m_context.get()));
-  m_assetManager->registerLoader(std::make_unique<AssimpLoader>(m_context.get()));
+  m_assetManager = std::make_unique<AssetManager>(
+      m_context.get(), Config::get().textures.compress,
+      Config::get().textures.cacheDirectory, Config::get().meshes.cacheDirectory);
+  m_assetManager->registerLoader(std::make_unique<GltfLoader>());
+  m_assetManager->registerLoader(std::make_unique<AssimpLoader>());
 
   m_perfMonitor = std::make_unique<PerformanceMonitor>();
 
+  if (Config::get().jobs.parallelRecording) {
+    m_jobSystem = std::make_unique<JobSystem>(Config::get().jobs.workerThreads);
+  }
+
   // Renderer System Init
+  VkFormat outputFormat = m_headless ? m_offscreen->getFormat()
+                                     : m_swapchain->getImageFormat();
+  RendererSystem::ClusterGridSpecs clusterGrid;
+  clusterGrid.tileSize = Config::get().clusters.tileSize;
+  clusterGrid.depthSlices = Config::get().clusters.depthSlices;
   m_renderer = std::make_unique<RendererSystem>(
-      m_context.get(), m_swapchain.get(), specs.width, specs.height);
+      m_context.get(), outputFormat, m_width, m_height, clusterGrid);
 
   VkDescriptorSetLayout setLayouts[] = {
       m_context->getDescriptorManager().getLayout()};
   m_renderer->initializePipelines(setLayouts, 1);
 
    // Camera Defaults
-  m_camera.setPerspective(
-      45.0f, (float)m_window->getWidth() / (float)m_window->getHeight(), 0.1f,
-      1000.0f);
+  m_camera.setPerspective(45.0f, (float)m_width / (float)m_height, 0.1f,
+                          1000.0f);
   m_camera.setPosition(glm::vec3(0.0f, 0.0f, 5.0f));
 
   initScene(); // Virtual call
   Config::get().applyTo(m_uiParams); // Apply loaded renderer settings
 
+  if (m_headless) {
+    // Captures must not depend on how fast textures stream in
+    m_assetManager->finishStreaming(*m_sceneManager);
+    spdlog::info("Application Initialized (headless).");
+    return;
+  }
+
   // Input Callbacks
   static AstralApp* s_app = this;
   s_app = this; // Ensure it's set
@@ -114,7 +151,12 @@ void AstralApp::init() {
 
 void AstralApp::run() {
   init(); // Call init here
-  RenderGraph graph(m_context.get());
+  if (m_headless) {
+    runHeadless();
+    return;
+  }
+
+  RenderGraph graph(m_context.get(), m_jobSystem.get());
   m_lastFrameTime = (float)glfwGetTime();
 
   spdlog::info("Entering Main Loop...");
@@ -136,212 +178,16 @@ void AstralApp::run() {
 
     updateUI(deltaTime);
 
-    // Update Scene Data
-    SceneData sd;
-    sd.view = m_camera.getViewMatrix();
-    sd.proj = m_camera.getProjectionMatrix();
-    sd.viewProj = sd.proj * sd.view;
-    sd.invView = glm::inverse(sd.view);
-    sd.invProj = glm::inverse(sd.proj);
-    sd.cameraPos = glm::vec4(m_camera.getPosition(), 1.0f);
-
-    // TAA Jitter (Simple Halton)
-    // TAA Jitter (Simple Halton) - DISABLED for now as full TAA resolve is not active
-    /*
-    auto halton = [](int index, int base) {
-      float f = 1.0f, r = 0.0f;
-      while (index > 0) {
-        f = f / base;
-        r = r + f * (index % base);
-        index = index / base;
-      }
-      return r;
-    };
-    glm::vec2 jitter = glm::vec2((halton((m_frameIndex % 16) + 1, 2) - 0.5f) /
-                                     (float)m_window->getWidth(),
-                                 (halton((m_frameIndex % 16) + 1, 3) - 0.5f) /
-                                     (float)m_window->getHeight());
-    sd.jitter = jitter;
-    sd.proj[2][0] += jitter.x;
-    sd.proj[2][1] += jitter.y;
-    */
-    sd.jitter = glm::vec2(0.0f);
-    sd.viewProj = sd.proj * sd.view;
-
-    if (m_firstFrame) {
-      sd.prevViewProj = sd.viewProj;
-      m_firstFrame = false;
-    } else {
-      sd.prevViewProj = m_prevSceneData.viewProj;
-    }
-    m_prevSceneData = sd;
-    m_frameIndex++;
-
-    // Frustum Planes logic... (Simplified for now, assume Renderer handles
-    // culling or we just copy it)
-    // ... Copying logic
-    glm::mat4 vp = sd.viewProj;
-    for (int i = 0; i < 4; i++)
-      sd.frustumPlanes[0][i] = vp[i][3] + vp[i][0];
-    for (int i = 0; i < 4; i++)
-      sd.frustumPlanes[1][i] = vp[i][3] - vp[i][0];
-    for (int i = 0; i < 4; i++)
-      sd.frustumPlanes[2][i] = vp[i][3] + vp[i][1];
-    for (int i = 0; i < 4; i++)
-      sd.frustumPlanes[3][i] = vp[i][3] - vp[i][1];
-    for (int i = 0; i < 4; i++)
-      sd.frustumPlanes[4][i] = vp[i][3] + vp[i][2];
-    for (int i = 0; i < 4; i++)
-      sd.frustumPlanes[5][i] = vp[i][3] - vp[i][2];
-    for (int i = 0; i < 6; i++) {
-      float length = glm::length(glm::vec3(sd.frustumPlanes[i]));
-      sd.frustumPlanes[i] /= length;
-    }
-
-    // Shadows Logic (Light Space Matrix + CSM)
-    // ... (Omitting full CSM math here for brevity, assume we need to implement
-    // it to match main.cpp exact logic) Ideally this should be in SceneManager
-    // or Renderer. For refactor 1:1, I will put it in
-    // RendererSystem::setupRenderGraph or keep it here and pass fully formed
-    // SceneData. It modifies SceneData heavily. Let's keep it here for now as
-    // part of "Update Logic".
-
-    auto &lights = m_sceneManager->getLights();
-    glm::vec3 lightPos = glm::vec3(5.0f, 8.0f, 5.0f);
-    glm::vec3 lightDir = glm::normalize(glm::vec3(-1.0f, -1.0f, -1.0f));
-    bool isDirectional = true;
-    if (!lights.empty()) {
-      isDirectional = (lights[0].position.w == 1.0f);
-      if (isDirectional) {
-        lightDir = glm::normalize(glm::vec3(lights[0].direction));
-        lightPos = -lightDir * 10.0f;
-      } else {
-        lightPos = glm::vec3(lights[0].position);
-        lightDir = glm::normalize(glm::vec3(0.0f) - lightPos);
-      }
-    }
-    glm::mat4 lightView =
-        glm::lookAt(lightPos, lightPos + lightDir, glm::vec3(0.0f, 1.0f, 0.0f));
-    float orthoSize = 10.0f;
-    glm::mat4 lightProjection =
-        glm::ortho(-orthoSize, orthoSize, -orthoSize, orthoSize, 0.1f, 100.0f);
-    lightProjection[1][1] *= -1;
-    sd.lightSpaceMatrix = lightProjection * lightView;
-
-    // CSM Logic copy
-    float nearClip = m_camera.getNear();
-    float farClip = m_camera.getFar();
-    float cascadeSplits[4];
-    float lambda = m_uiParams.csmLambda;
-    float ratio = farClip / nearClip;
-
-    for (int i = 0; i < 4; i++) {
-      float p = (i + 1) / 4.0f;
-      float log = nearClip * std::pow(ratio, p);
-      float uniform = nearClip + (farClip - nearClip) * p;
-      float d = lambda * (log - uniform) + uniform;
-      cascadeSplits[i] = d;
-    }
-    sd.cascadeSplits = glm::vec4(cascadeSplits[0], cascadeSplits[1],
-                                 cascadeSplits[2], cascadeSplits[3]);
-
-    // Full CSM loop would be here... (Simplified: copying logic)
-    // ... (Logic to compute sd.cascadeViewProj[i])
-    // To ensure compilation, I will implement a simplified version or the full
-    // version if needed. Let's implement the loop as it is critical for
-    // Shadows.
-    float lastSplitDist = nearClip;
-    for (int i = 0; i < 4; i++) {
-      float splitDist = cascadeSplits[i];
-      glm::vec3 frustumCorners[8] = {
-          {-1.0f, 1.0f, -1.0f},  {1.0f, 1.0f, -1.0f}, {1.0f, -1.0f, -1.0f},
-          {-1.0f, -1.0f, -1.0f}, {-1.0f, 1.0f, 1.0f}, {1.0f, 1.0f, 1.0f},
-          {1.0f, -1.0f, 1.0f},   {-1.0f, -1.0f, 1.0f}};
-
-      glm::mat4 invCam = glm::inverse(m_camera.getProjectionMatrix() *
-                                      m_camera.getViewMatrix());
-      for (int j = 0; j < 8; j++) {
-        glm::vec4 pt = invCam * glm::vec4(frustumCorners[j], 1.0f);
-        frustumCorners[j] = glm::vec3(pt) / pt.w;
-      }
-
-      for (int j = 0; j < 4; j++) {
-        glm::vec3 dist = frustumCorners[j + 4] - frustumCorners[j];
-        frustumCorners[j + 4] =
-            frustumCorners[j] + (dist * (splitDist / farClip));
-        frustumCorners[j] =
-            frustumCorners[j] + (dist * (lastSplitDist / farClip));
-      }
-
-      glm::vec3 center = glm::vec3(0.0f);
-      for (int j = 0; j < 8; j++)
-        center += frustumCorners[j];
-      center /= 8.0f;
-
-      float radius = 0.0f;
-      for (int j = 0; j < 8; j++)
-        radius = std::max(radius, glm::length(frustumCorners[j] - center));
-      radius = std::ceil(radius * 16.0f) / 16.0f;
-
-      glm::vec3 maxExtents = glm::vec3(radius);
-      glm::vec3 minExtents = -maxExtents;
-
-      glm::mat4 lightViewMatrix = glm::lookAt(
-          center - lightDir * radius, center, glm::vec3(0.0f, 1.0f, 0.0f));
-      glm::mat4 lightOrthoMatrix =
-          glm::ortho(minExtents.x, maxExtents.x, minExtents.y, maxExtents.y,
-                     0.0f, 2.0f * radius);
-
-      // Snap to texel
-      glm::mat4 shadowMatrix = lightOrthoMatrix * lightViewMatrix;
-      glm::vec4 shadowOrigin = shadowMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-      shadowOrigin *= 4096.0f / 2.0f; // ShadowMapSize = 4096
-      glm::vec2 roundedOrigin = glm::round(glm::vec2(shadowOrigin));
-      glm::vec2 roundOffset =
-          (roundedOrigin - glm::vec2(shadowOrigin)) * 2.0f / 4096.0f;
-
-      lightOrthoMatrix[3][0] += roundOffset.x;
-      lightOrthoMatrix[3][1] += roundOffset.y;
-      lightOrthoMatrix[1][1] *= -1;
-
-      sd.cascadeViewProj[i] = lightOrthoMatrix * lightViewMatrix;
-      lastSplitDist = splitDist;
-    }
-
-    sd.lightCount = (int)lights.size();
-    sd.lightBufferIndex = m_sceneManager->getLightBufferIndex(m_currentFrame);
-    sd.headlampEnabled = m_uiParams.enableHeadlamp ? 1 : 0;
-    sd.visualizeCascades = m_uiParams.visualizeCascades ? 1 : 0;
-    sd.shadowBias = m_uiParams.shadowBias;
-    sd.shadowNormalBias = m_uiParams.shadowNormalBias;
-    sd.pcfRange = m_uiParams.pcfRange;
-    sd.csmLambda = m_uiParams.csmLambda;
-    sd.irradianceIndex = m_envManager->getIrradianceIndex();
-    sd.prefilteredIndex = m_envManager->getPrefilteredIndex();
-    sd.brdfLutIndex = m_envManager->getBrdfLutIndex();
-    // map index and others are filled by RendererSystem when setting up
-    // resources? Actually sceneData expects binding indices. RendererSystem
-    // should expose the indices it registered. We'll update the remaining
-    // indices inside RendererSystem::render or just use getters. For now let's
-    // set them here assuming we can get them. But Application doesn't know
-    // about `shadowMapIndex`. We will pass `sd` to `renderer->render(...)` and
-    // let it fill the resource indices before uploading.
-
-    // Cluster grid dimensions - MUST match RendererSystem::initializePipelines
-    sd.gridX = 16;
-    sd.gridY = 9;
-    sd.gridZ = 24;
-    
-    sd.nearClip = m_camera.getNear();
-    sd.farClip = m_camera.getFar();
-    sd.screenWidth = (float)m_window->getWidth();
-    sd.screenHeight = (float)m_window->getHeight();
+    SceneData sd = buildSceneData();
 
     m_sync->waitForFrame(m_currentFrame);
+    m_context->getDescriptorManager().beginFrame();
+    m_sceneManager->beginFrame(m_currentFrame);
 
     // Update Buffers
+    m_assetManager->updateStreaming(*m_sceneManager); // Patches materials of textures that just landed
     m_sceneManager->updateLightsBuffer(m_currentFrame);
-    m_sceneManager->updateMaterialBuffer();
+    m_sceneManager->updateMaterialBuffer(m_currentFrame);
     // sceneData update is finalized in renderer? No, we need to upload it.
     // The issue is `shadowMapIndex` etc. are in Renderer.
     // Let's defer `updateSceneData` call to inside `renderer.render`?
@@ -365,79 +211,104 @@ void AstralApp::run() {
     auto &cmd = m_commandBuffers[m_currentFrame];
     cmd->begin();
 
-    // Clear instances
-    m_sceneManager->clearMeshInstances(m_currentFrame);
-    // Re-add instances
-    if (m_model) {
-      if (!m_model->linearNodes.empty()) {
-        for (auto *node : m_model->linearNodes) {
-          if (node->meshIndex != -1) {
-            const auto &mesh = m_model->meshes[node->meshIndex];
-            for (const auto &primitive : mesh.primitives) {
-              m_sceneManager->addMeshInstance(
-                  m_currentFrame, node->matrix, primitive.materialIndex,
-                  primitive.indexCount, primitive.firstIndex, 0,
-                  primitive.boundingCenter, primitive.boundingRadius);
-            }
-          }
-        }
-      } else {
-        // Fallback for models without hierarchy (e.g. pre-transformed Assimp models)
-        for (const auto &mesh : m_model->meshes) {
-          for (const auto &primitive : mesh.primitives) {
-            m_sceneManager->addMeshInstance(
-                m_currentFrame, glm::mat4(1.0f), primitive.materialIndex,
-                primitive.indexCount, primitive.firstIndex, 0,
-                primitive.boundingCenter, primitive.boundingRadius);
-          }
-        }
-      }
-    }
+    syncModelInstances();
+    m_sceneManager->selectLods(m_camera.getPosition(),
+                               std::abs(m_camera.getProjectionMatrix()[1][1]),
+                               m_uiParams.enableLod);
 
-    // Sort and Upload Instances (Transparency Sorting)
-    m_sceneManager->sortAndUploadInstances(m_currentFrame, m_camera.getPosition());
+    // Only changed instances are uploaded, transparents are kept back to front
+    m_sceneManager->uploadInstances(m_currentFrame, m_camera.getPosition());
 
     // DEBUG: Log mesh instance count
     spdlog::debug("Frame {}: Mesh instances: {}", m_currentFrame, 
                   m_sceneManager->getMeshInstanceCount(m_currentFrame));
 
+    RendererSystem::OutputTarget output;
+    output.image = m_swapchain->getImages()[imageIndex];
+    output.view = m_swapchain->getImageViews()[imageIndex];
+    output.format = m_swapchain->getImageFormat();
+    output.extent = m_swapchain->getExtent();
+    output.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
     m_renderer->render(*cmd.get(), graph, *m_sceneManager.get(), m_currentFrame,
-                       imageIndex, sd, m_swapchain.get(), m_sync.get(),
-                       m_uiParams, m_model.get(), m_envManager->getSkyboxIndex());
+                       output, sd, m_sync.get(), m_uiParams,
+                       m_envManager->getSkyboxIndex());
+
+    if (m_perfMonitor) {
+      const auto &cull = m_renderer->getCullStats();
+      m_perfMonitor->updateCulling(cull.instanceCount, cull.drawnCount,
+                                   cull.frustumCulled, cull.occlusionCulled,
+                                   cull.shadowDrawn, cull.meshletsDrawn,
+                                   cull.meshletsCulled);
+      const auto &lightCull = m_renderer->getLightCullStats();
+      m_perfMonitor->updateLightCulling(lightCull.lightCount,
+                                        lightCull.indexCount,
+                                        lightCull.indexCapacity,
+                                        lightCull.gpuMs);
+      const auto &ssao = m_renderer->getSSAOStats();
+      m_perfMonitor->updateSSAO(ssao.gpuMs, ssao.compute);
+
+      const auto &descriptors = m_context->getDescriptorManager();
+      auto images = descriptors.getOccupancy(DescriptorManager::IMAGE_BINDING);
+      uint32_t bufferSlots = 0;
+      uint32_t pendingSlots = images.pending;
+      for (uint32_t binding = 1; binding < 16; binding++) {
+        auto occupancy = descriptors.getOccupancy(binding);
+        if (binding != DescriptorManager::ARRAY_IMAGE_BINDING &&
+            binding != DescriptorManager::STORAGE_IMAGE_BINDING &&
+            binding != DescriptorManager::CUBE_IMAGE_BINDING) {
+          bufferSlots += occupancy.live;
+        }
+        pendingSlots += occupancy.pending;
+      }
+      m_perfMonitor->updateBindless(images.live, images.highWater,
+                                    images.capacity, bufferSlots, pendingSlots);
+    }
     
     // Inject UI Pass (Overlay)
-    // Depends on whatever the last pass wrote to "Swapchain".
+    // Depends on whatever the last pass wrote to "FinalOutput".
     // We don't clear outputs because we draw on top.
     
-    graph.addPass("UIPass", {}, {"Swapchain"}, [this](VkCommandBuffer cb){
+    graph.addPass("UIPass", {}, {"FinalOutput"}, [this](VkCommandBuffer cb){
         m_uiManager->render(cb);
     }, false); // clearOutputs = false
     
 
     VkExtent2D ext = m_swapchain->getExtent();
-    graph.execute(cmd->getHandle(), ext);
+    m_renderer->recordFrameBegin(cmd->getHandle(), m_currentFrame);
+    graph.execute(cmd->getHandle(), ext, m_currentFrame);
+    m_renderer->recordCullReadback(cmd->getHandle(), m_currentFrame);
 
     cmd->end();
 
-    // Submit
-    VkPipelineStageFlags waitStages[] = {
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores =
-        &m_sync->getImageAvailableSemaphore(m_currentFrame);
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    VkCommandBuffer buffer = cmd->getHandle();
-    submitInfo.pCommandBuffers = &buffer;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &m_imageSemaphores[imageIndex];
-
-    if (vkQueueSubmit(m_context->getGraphicsQueue(), 1, &submitInfo,
-                      m_sync->getInFlightFence(m_currentFrame)) != VK_SUCCESS) {
+    // Submit, also waiting on textures that landed since the last one
+    VkSemaphoreSubmitInfo waits[2] = {};
+    waits[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    waits[0].semaphore = m_sync->getImageAvailableSemaphore(m_currentFrame);
+    waits[0].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    uint32_t waitCount = 1;
+    if (m_assetManager->takeStreamingWait(waits[1])) {
+      waitCount++;
+    }
+    VkSemaphoreSubmitInfo signal = {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    signal.semaphore = m_imageSemaphores[imageIndex];
+    signal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    VkCommandBufferSubmitInfo cmdInfo = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
+    cmdInfo.commandBuffer = cmd->getHandle();
+    VkSubmitInfo2 submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+    submitInfo.waitSemaphoreInfoCount = waitCount;
+    submitInfo.pWaitSemaphoreInfos = waits;
+    submitInfo.commandBufferInfoCount = 1;
+    submitInfo.pCommandBufferInfos = &cmdInfo;
+    submitInfo.signalSemaphoreInfoCount = 1;
+    submitInfo.pSignalSemaphoreInfos = &signal;
+
+    if (vkQueueSubmit2(m_context->getGraphicsQueue(), 1, &submitInfo,
+                       m_sync->getInFlightFence(m_currentFrame)) != VK_SUCCESS) {
       throw std::runtime_error("Failed to submit draw command buffer!");
     }
+    m_renderer->onFrameSubmitted(graph);
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -450,10 +321,498 @@ void AstralApp::run() {
 
     vkQueuePresentKHR(m_context->getPresentQueue(), &presentInfo);
 
-    m_currentFrame = (m_currentFrame + 1) % 2;
+    m_currentFrame =
+        (m_currentFrame + 1) % RendererSystem::MAX_FRAMES_IN_FLIGHT;
+  }
+
+  vkDeviceWaitIdle(m_context->getDevice());
+}
+
+SceneData AstralApp::buildSceneData() {
+  // Update Scene Data
+  SceneData sd;
+  sd.view = m_camera.getViewMatrix();
+  sd.proj = m_camera.getProjectionMatrix();
+  sd.viewProj = sd.proj * sd.view;
+  sd.invView = glm::inverse(sd.view);
+  sd.invProj = glm::inverse(sd.proj);
+  sd.cameraPos = glm::vec4(m_camera.getPosition(), 1.0f);
+
+  // TAA Jitter (Simple Halton)
+  // TAA Jitter (Simple Halton) - DISABLED for now as full TAA resolve is not active
+  /*
+  auto halton = [](int index, int base) {
+    float f = 1.0f, r = 0.0f;
+    while (index > 0) {
+      f = f / base;
+      r = r + f * (index % base);
+      index = index / base;
+    }
+    return r;
+  };
+  glm::vec2 jitter = glm::vec2((halton((m_frameIndex % 16) + 1, 2) - 0.5f) /
+                                   (float)m_width,
+                               (halton((m_frameIndex % 16) + 1, 3) - 0.5f) /
+                                   (float)m_height);
+  sd.jitter = jitter;
+  sd.proj[2][0] += jitter.x;
+  sd.proj[2][1] += jitter.y;
+  */
+  sd.jitter = glm::vec2(0.0f);
+  sd.viewProj = sd.proj * sd.view;
+
+  if (m_firstFrame) {
+    sd.prevViewProj = sd.viewProj;
+    m_firstFrame = false;
+  } else {
+    sd.prevViewProj = m_prevSceneData.viewProj;
+  }
+  m_prevSceneData = sd;
+  m_frameIndex++;
+
+  // Frustum Planes logic... (Simplified for now, assume Renderer handles
+  // culling or we just copy it)
+  // ... Copying logic
+  glm::mat4 vp = sd.viewProj;
+  for (int i = 0; i < 4; i++)
+    sd.frustumPlanes[0][i] = vp[i][3] + vp[i][0];
+  for (int i = 0; i < 4; i++)
+    sd.frustumPlanes[1][i] = vp[i][3] - vp[i][0];
+  for (int i = 0; i < 4; i++)
+    sd.frustumPlanes[2][i] = vp[i][3] + vp[i][1];
+  for (int i = 0; i < 4; i++)
+    sd.frustumPlanes[3][i] = vp[i][3] - vp[i][1];
+  for (int i = 0; i < 4; i++)
+    sd.frustumPlanes[4][i] = vp[i][3] + vp[i][2];
+  for (int i = 0; i < 4; i++)
+    sd.frustumPlanes[5][i] = vp[i][3] - vp[i][2];
+  for (int i = 0; i < 6; i++) {
+    float length = glm::length(glm::vec3(sd.frustumPlanes[i]));
+    sd.frustumPlanes[i] /= length;
+  }
+
+  // Shadows Logic (Light Space Matrix + CSM)
+  // ... (Omitting full CSM math here for brevity, assume we need to implement
+  // it to match main.cpp exact logic) Ideally this should be in SceneManager
+  // or Renderer. For refactor 1:1, I will put it in
+  // RendererSystem::setupRenderGraph or keep it here and pass fully formed
+  // SceneData. It modifies SceneData heavily. Let's keep it here for now as
+  // part of "Update Logic".
+
+  auto &lights = m_sceneManager->getLights();
+  glm::vec3 lightPos = glm::vec3(5.0f, 8.0f, 5.0f);
+  glm::vec3 lightDir = glm::normalize(glm::vec3(-1.0f, -1.0f, -1.0f));
+  bool isDirectional = true;
+  if (!lights.empty()) {
+    isDirectional = (lights[0].position.w == 1.0f);
+    if (isDirectional) {
+      lightDir = glm::normalize(glm::vec3(lights[0].direction));
+      lightPos = -lightDir * 10.0f;
+    } else {
+      lightPos = glm::vec3(lights[0].position);
+      lightDir = glm::normalize(glm::vec3(0.0f) - lightPos);
+    }
+  }
+  glm::mat4 lightView =
+      glm::lookAt(lightPos, lightPos + lightDir, glm::vec3(0.0f, 1.0f, 0.0f));
+  float orthoSize = 10.0f;
+  glm::mat4 lightProjection =
+      glm::ortho(-orthoSize, orthoSize, -orthoSize, orthoSize, 0.1f, 100.0f);
+  lightProjection[1][1] *= -1;
+  sd.lightSpaceMatrix = lightProjection * lightView;
+
+  // CSM Logic copy
+  float nearClip = m_camera.getNear();
+  float farClip = m_camera.getFar();
+  float cascadeSplits[4];
+  float lambda = m_uiParams.csmLambda;
+  float ratio = farClip / nearClip;
+
+  for (int i = 0; i < 4; i++) {
+    float p = (i + 1) / 4.0f;
+    float log = nearClip * std::pow(ratio, p);
+    float uniform = nearClip + (farClip - nearClip) * p;
+    float d = lambda * (log - uniform) + uniform;
+    cascadeSplits[i] = d;
+  }
+  sd.cascadeSplits = glm::vec4(cascadeSplits[0], cascadeSplits[1],
+                               cascadeSplits[2], cascadeSplits[3]);
+
+  // Full CSM loop would be here... (Simplified: copying logic)
+  // ... (Logic to compute sd.cascadeViewProj[i])
+  // To ensure compilation, I will implement a simplified version or the full
+  // version if needed. Let's implement the loop as it is critical for
+  // Shadows.
+  float lastSplitDist = nearClip;
+  for (int i = 0; i < 4; i++) {
+    float splitDist = cascadeSplits[i];
+    glm::vec3 frustumCorners[8] = {
+        {-1.0f, 1.0f, -1.0f},  {1.0f, 1.0f, -1.0f}, {1.0f, -1.0f, -1.0f},
+        {-1.0f, -1.0f, -1.0f}, {-1.0f, 1.0f, 1.0f}, {1.0f, 1.0f, 1.0f},
+        {1.0f, -1.0f, 1.0f},   {-1.0f, -1.0f, 1.0f}};
+
+    glm::mat4 invCam = glm::inverse(m_camera.getProjectionMatrix() *
+                                    m_camera.getViewMatrix());
+    for (int j = 0; j < 8; j++) {
+      glm::vec4 pt = invCam * glm::vec4(frustumCorners[j], 1.0f);
+      frustumCorners[j] = glm::vec3(pt) / pt.w;
+    }
+
+    for (int j = 0; j < 4; j++) {
+      glm::vec3 dist = frustumCorners[j + 4] - frustumCorners[j];
+      frustumCorners[j + 4] =
+          frustumCorners[j] + (dist * (splitDist / farClip));
+      frustumCorners[j] =
+          frustumCorners[j] + (dist * (lastSplitDist / farClip));
+    }
+
+    glm::vec3 center = glm::vec3(0.0f);
+    for (int j = 0; j < 8; j++)
+      center += frustumCorners[j];
+    center /= 8.0f;
+
+    float radius = 0.0f;
+    for (int j = 0; j < 8; j++)
+      radius = std::max(radius, glm::length(frustumCorners[j] - center));
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    glm::vec3 maxExtents = glm::vec3(radius);
+    glm::vec3 minExtents = -maxExtents;
+
+    glm::mat4 lightViewMatrix = glm::lookAt(
+        center - lightDir * radius, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 lightOrthoMatrix =
+        glm::ortho(minExtents.x, maxExtents.x, minExtents.y, maxExtents.y,
+                   0.0f, 2.0f * radius);
+
+    // Snap to texel
+    glm::mat4 shadowMatrix = lightOrthoMatrix * lightViewMatrix;
+    glm::vec4 shadowOrigin = shadowMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    shadowOrigin *= 4096.0f / 2.0f; // ShadowMapSize = 4096
+    glm::vec2 roundedOrigin = glm::round(glm::vec2(shadowOrigin));
+    glm::vec2 roundOffset =
+        (roundedOrigin - glm::vec2(shadowOrigin)) * 2.0f / 4096.0f;
+
+    lightOrthoMatrix[3][0] += roundOffset.x;
+    lightOrthoMatrix[3][1] += roundOffset.y;
+    lightOrthoMatrix[1][1] *= -1;
+
+    sd.cascadeViewProj[i] = lightOrthoMatrix * lightViewMatrix;
+    lastSplitDist = splitDist;
+  }
+
+  sd.lightCount = (int)lights.size();
+  sd.lightBufferIndex = m_sceneManager->getLightBufferIndex(m_currentFrame);
+  sd.headlampEnabled = m_uiParams.enableHeadlamp ? 1 : 0;
+  sd.visualizeCascades = m_uiParams.visualizeCascades ? 1 : 0;
+  sd.shadowBias = m_uiParams.shadowBias;
+  sd.shadowNormalBias = m_uiParams.shadowNormalBias;
+  sd.pcfRange = m_uiParams.pcfRange;
+  sd.csmLambda = m_uiParams.csmLambda;
+  sd.irradianceIndex = m_envManager->getIrradianceIndex();
+  sd.prefilteredIndex = m_envManager->getPrefilteredIndex();
+  sd.brdfLutIndex = m_envManager->getBrdfLutIndex();
+  // map index and others are filled by RendererSystem when setting up
+  // resources? Actually sceneData expects binding indices. RendererSystem
+  // should expose the indices it registered. We'll update the remaining
+  // indices inside RendererSystem::render or just use getters. For now let's
+  // set them here assuming we can get them. But Application doesn't know
+  // about `shadowMapIndex`. We will pass `sd` to `renderer->render(...)` and
+  // let it fill the resource indices before uploading.
+
+  // Cluster grid dimensions are filled by RendererSystem::render (Config::clusters)
+  sd.nearClip = m_camera.getNear();
+  sd.farClip = m_camera.getFar();
+  sd.screenWidth = (float)m_width;
+  sd.screenHeight = (float)m_height;
+
+  return sd;
+}
+
+void AstralApp::syncModelInstances() {
+  // Instances persist in the SceneManager, they're only rebuilt when the model
+  // changes or the geometry arena moved it (growth / compaction)
+  const GeometryArena &arena = m_sceneManager->getGeometryArena();
+  if (m_model.get() == m_instancedModel &&
+      arena.getLayoutVersion() == m_instancedGeometryVersion) {
+    return;
+  }
+  for (InstanceHandle handle : m_modelInstances) {
+    m_sceneManager->destroyMeshInstance(handle);
+  }
+  m_modelInstances.clear();
+  m_instancedModel = m_model.get();
+  m_instancedGeometryVersion = arena.getLayoutVersion();
+  if (!m_model) {
+    return;
+  }
+  const GeometryAllocation &geometry = arena.get(m_model->geometry);
+
+  auto addPrimitives = [&](const Mesh &mesh, const glm::mat4 &transform) {
+    for (const auto &primitive : mesh.primitives) {
+      MeshInstanceDesc desc;
+      desc.transform = transform;
+      desc.materialIndex = primitive.materialIndex;
+      desc.indexCount = primitive.indexCount;
+      desc.firstIndex = geometry.firstIndex + primitive.firstIndex;
+      desc.vertexOffset = static_cast<int32_t>(geometry.vertexOffset);
+      desc.firstMeshlet = geometry.firstMeshlet + primitive.firstMeshlet;
+      desc.meshletCount = primitive.meshletCount;
+      desc.lodCount = primitive.lodCount;
+      for (uint32_t level = 1; level < primitive.lodCount; ++level) {
+        PrimitiveLod lod = primitive.getLod(level);
+        lod.firstIndex += geometry.firstIndex;
+        lod.firstMeshlet += geometry.firstMeshlet;
+        desc.lods[level - 1] = lod;
+      }
+      desc.boundingCenter = primitive.boundingCenter;
+      desc.boundingRadius = primitive.boundingRadius;
+      InstanceHandle handle = m_sceneManager->createMeshInstance(desc);
+      if (handle != INVALID_INSTANCE) {
+        m_modelInstances.push_back(handle);
+      }
+    }
+  };
+  if (!m_model->linearNodes.empty()) {
+    for (auto *node : m_model->linearNodes) {
+      if (node->meshIndex != -1) {
+        addPrimitives(m_model->meshes[node->meshIndex], node->matrix);
+      }
+    }
+  } else {
+    // Fallback for models without hierarchy (e.g. pre-transformed Assimp models)
+    for (const auto &mesh : m_model->meshes) {
+      addPrimitives(mesh, glm::mat4(1.0f));
+    }
+  }
+}
+
+double AstralApp::renderHeadlessFrame(RenderGraph &graph, uint32_t frame,
+                                      float deltaTime, bool writeFrames) {
+  graph.clear();
+  m_camera.update(deltaTime);
+
+  SceneData sd = buildSceneData();
+
+  m_sync->waitForFrame(m_currentFrame);
+  m_context->getDescriptorManager().beginFrame();
+  m_sceneManager->beginFrame(m_currentFrame);
+  // The slot's previous frame is finished on the GPU, hand its pixels to the writer
+  if (writeFrames) {
+    m_offscreen->collect(m_currentFrame);
+  }
+
+  m_assetManager->updateStreaming(*m_sceneManager);
+  m_sceneManager->updateLightsBuffer(m_currentFrame);
+  m_sceneManager->updateMaterialBuffer(m_currentFrame);
+
+  m_sync->resetFence(m_currentFrame);
+
+  auto &cmd = m_commandBuffers[m_currentFrame];
+  cmd->begin();
+
+  syncModelInstances();
+  m_sceneManager->selectLods(m_camera.getPosition(),
+                             std::abs(m_camera.getProjectionMatrix()[1][1]),
+                             m_uiParams.enableLod);
+  m_sceneManager->uploadInstances(m_currentFrame, m_camera.getPosition());
+
+  Image &target = m_offscreen->getImage(m_currentFrame);
+  RendererSystem::OutputTarget output;
+  output.image = target.getHandle();
+  output.view = target.getView();
+  output.format = target.getSpecs().format;
+  output.extent = m_offscreen->getExtent();
+  output.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+  m_renderer->render(*cmd.get(), graph, *m_sceneManager.get(), m_currentFrame,
+                     output, sd, m_sync.get(), m_uiParams,
+                     m_envManager->getSkyboxIndex());
+
+  m_renderer->recordFrameBegin(cmd->getHandle(), m_currentFrame);
+  graph.execute(cmd->getHandle(), output.extent, m_currentFrame);
+  m_offscreen->recordReadback(cmd->getHandle(), m_currentFrame, frame);
+  m_renderer->recordCullReadback(cmd->getHandle(), m_currentFrame);
+
+  cmd->end();
+
+  VkSemaphoreSubmitInfo streamingWait = {};
+  VkCommandBufferSubmitInfo cmdInfo = {
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
+  cmdInfo.commandBuffer = cmd->getHandle();
+  VkSubmitInfo2 submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+  if (m_assetManager->takeStreamingWait(streamingWait)) {
+    submitInfo.waitSemaphoreInfoCount = 1;
+    submitInfo.pWaitSemaphoreInfos = &streamingWait;
+  }
+  submitInfo.commandBufferInfoCount = 1;
+  submitInfo.pCommandBufferInfos = &cmdInfo;
+
+  if (vkQueueSubmit2(m_context->getGraphicsQueue(), 1, &submitInfo,
+                     m_sync->getInFlightFence(m_currentFrame)) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to submit headless command buffer!");
+  }
+  m_renderer->onFrameSubmitted(graph);
+
+  m_currentFrame = (m_currentFrame + 1) % RendererSystem::MAX_FRAMES_IN_FLIGHT;
+  return graph.getStats().recordCpuMs;
+}
+
+void AstralApp::runHeadless() {
+  RenderGraph graph(m_context.get(), m_jobSystem.get());
+  const auto &headless = Config::get().headless;
+  // Fixed step so batch runs are reproducible regardless of GPU speed
+  const float deltaTime = 1.0f / 60.0f;
+
+  spdlog::info("Entering Headless Loop ({} frames, {}x{})...",
+               headless.frameCount, m_width, m_height);
+  auto startTime = std::chrono::steady_clock::now();
+  double recordMsTotal = 0.0;
+
+  for (uint32_t frame = 0; frame < headless.frameCount; frame++) {
+    recordMsTotal +=
+        renderHeadlessFrame(graph, frame, deltaTime, headless.writeFrames);
+  }
+
+  vkDeviceWaitIdle(m_context->getDevice());
+  if (headless.writeFrames) {
+    for (uint32_t i = 0; i < RendererSystem::MAX_FRAMES_IN_FLIGHT; i++) {
+      m_offscreen->collect(i);
+    }
+  }
+  auto renderEnd = std::chrono::steady_clock::now();
+  m_offscreen->flush();
+  auto writeEnd = std::chrono::steady_clock::now();
+
+  double renderSeconds =
+      std::chrono::duration<double>(renderEnd - startTime).count();
+  double totalSeconds =
+      std::chrono::duration<double>(writeEnd - startTime).count();
+  spdlog::info("Headless: {} frames rendered in {:.2f}s ({:.1f} fps), {} "
+               "written to '{}' in {:.2f}s total ({:.0f} frames/hour)",
+               headless.frameCount, renderSeconds,
+               headless.frameCount / std::max(renderSeconds, 1e-6),
+               m_offscreen->getFramesWritten(), headless.outputDirectory,
+               totalSeconds,
+               headless.frameCount * 3600.0 / std::max(totalSeconds, 1e-6));
+  spdlog::info("Headless: pass recording {:.3f} ms/frame on {} thread(s)",
+               recordMsTotal / std::max(headless.frameCount, 1u),
+               graph.getStats().recordThreadCount);
+
+  if (headless.lightCullSweep) {
+    runLightCullSweep(graph, deltaTime);
+  }
+  if (headless.ssaoComparison) {
+    runSSAOComparison(graph, deltaTime);
+  }
+}
+
+void AstralApp::runLightCullSweep(RenderGraph &graph, float deltaTime) {
+  // Light culling GPU time (count + scan + write) against the light count,
+  // with synthetic point lights scattered around the camera
+  constexpr uint32_t kWarmupFrames = 8; // Covers the readback latency too
+  constexpr uint32_t kMeasuredFrames = 64;
+  constexpr uint32_t kMaxLights = 4096;
+  constexpr float kScatterRadius = 40.0f;
+  constexpr float kLightRange = 6.0f;
+
+  std::vector<Light> originalLights = m_sceneManager->getLights();
+  std::mt19937 rng(1234); // Same lights every run
+  std::uniform_real_distribution<float> offset(-kScatterRadius, kScatterRadius);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  const glm::vec3 center = m_camera.getPosition();
+
+  spdlog::info("Light culling sweep ({} warmup + {} measured frames per step)",
+               kWarmupFrames, kMeasuredFrames);
+  spdlog::info("  {:>6} {:>10} {:>12}", "lights", "gpu ms", "indices");
+  uint32_t frame = 0;
+  for (uint32_t lightCount = 16; lightCount <= kMaxLights; lightCount *= 2) {
+    m_sceneManager->clearLights();
+    for (uint32_t i = 0; i < lightCount; i++) {
+      Light light = {};
+      light.position = glm::vec4(
+          center + glm::vec3(offset(rng), offset(rng) * 0.25f, offset(rng)),
+          0.0f);
+      light.color = glm::vec4(unit(rng), unit(rng), unit(rng), 1.0f);
+      light.direction = glm::vec4(0.0f, -1.0f, 0.0f, kLightRange);
+      light.params = glm::vec4(0.0f);
+      m_sceneManager->addLight(light);
+    }
+
+    double gpuMsTotal = 0.0;
+    uint64_t indicesTotal = 0;
+    for (uint32_t i = 0; i < kWarmupFrames + kMeasuredFrames; i++) {
+      renderHeadlessFrame(graph, frame++, deltaTime, false);
+      if (i >= kWarmupFrames) {
+        const auto &stats = m_renderer->getLightCullStats();
+        gpuMsTotal += stats.gpuMs;
+        indicesTotal += stats.indexCount;
+      }
+    }
+    spdlog::info("  {:>6} {:>10.4f} {:>12}", lightCount,
+                 gpuMsTotal / kMeasuredFrames, indicesTotal / kMeasuredFrames);
+  }
+  if (m_renderer->getLightCullStats().gpuMs == 0.0f) {
+    spdlog::warn("Light culling sweep: no GPU timestamps on this device, "
+                 "times read 0");
+  }
+
+  vkDeviceWaitIdle(m_context->getDevice());
+  m_sceneManager->clearLights();
+  for (const Light &light : originalLights) {
+    m_sceneManager->addLight(light);
+  }
+}
+
+void AstralApp::runSSAOComparison(RenderGraph &graph, float deltaTime) {
+  // SSAO GPU time (first pass to last) of the full resolution fragment path
+  // against the half resolution compute path at each quality preset
+  constexpr uint32_t kWarmupFrames = 8; // Covers the readback latency too
+  constexpr uint32_t kMeasuredFrames = 64;
+
+  struct Variant {
+    const char *name;
+    bool compute;
+    RendererSystem::SSAOQuality quality;
+  };
+  const Variant variants[] = {
+      {"fragment (32 samples, full res)", false,
+       RendererSystem::SSAOQuality::High},
+      {"compute low (8 samples, half res)", true,
+       RendererSystem::SSAOQuality::Low},
+      {"compute medium (16 samples, half res)", true,
+       RendererSystem::SSAOQuality::Medium},
+      {"compute high (32 samples, half res)", true,
+       RendererSystem::SSAOQuality::High},
+  };
+
+  const RendererSystem::UIParams originalParams = m_uiParams;
+  spdlog::info("SSAO comparison ({} warmup + {} measured frames per path)",
+               kWarmupFrames, kMeasuredFrames);
+  spdlog::info("  {:<40} {:>10}", "path", "gpu ms");
+  uint32_t frame = 0;
+  for (const Variant &variant : variants) {
+    m_uiParams.enableSSAO = true;
+    m_uiParams.ssaoCompute = variant.compute;
+    m_uiParams.ssaoQuality = variant.quality;
+
+    double gpuMsTotal = 0.0;
+    for (uint32_t i = 0; i < kWarmupFrames + kMeasuredFrames; i++) {
+      renderHeadlessFrame(graph, frame++, deltaTime, false);
+      if (i >= kWarmupFrames) {
+        gpuMsTotal += m_renderer->getSSAOStats().gpuMs;
+      }
+    }
+    spdlog::info("  {:<40} {:>10.4f}", variant.name,
+                 gpuMsTotal / kMeasuredFrames);
+  }
+  if (m_renderer->getSSAOStats().gpuMs == 0.0f) {
+    spdlog::warn("SSAO comparison: no GPU timestamps on this device, times "
+                 "read 0");
   }
 
   vkDeviceWaitIdle(m_context->getDevice());
+  m_uiParams = originalParams;
 }
 
 void AstralApp::handleInput(float deltaTime) {
@@ -537,17 +896,44 @@ void AstralApp::updateUI(float deltaTime) {
         ImGui::Checkbox("Enable SSAO", &m_uiParams.enableSSAO);
         ImGui::DragFloat("Radius", &m_uiParams.ssaoRadius, 0.01f, 0.01f, 2.0f);
         ImGui::DragFloat("Bias", &m_uiParams.ssaoBias, 0.001f, 0.0f, 0.1f);
+        ImGui::Checkbox("Compute (Half Res)", &m_uiParams.ssaoCompute);
+        ImGui::BeginDisabled(!m_uiParams.ssaoCompute);
+        const char *qualityNames[] = {"Low (8)", "Medium (16)", "High (32)"};
+        int quality = static_cast<int>(m_uiParams.ssaoQuality);
+        if (ImGui::Combo("Quality", &quality, qualityNames,
+                         IM_ARRAYSIZE(qualityNames))) {
+          m_uiParams.ssaoQuality =
+              static_cast<RendererSystem::SSAOQuality>(quality);
+        }
+        ImGui::EndDisabled();
       }
 
       if (ImGui::CollapsingHeader("Anti-Aliasing", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::Checkbox("Enable FXAA", &m_uiParams.enableFXAA);
       }
 
+      if (ImGui::CollapsingHeader("Culling", ImGuiTreeNodeFlags_DefaultOpen)) {
+        ImGui::Checkbox("Occlusion Culling", &m_uiParams.enableOcclusionCulling);
+        ImGui::Checkbox("Meshlet Culling", &m_uiParams.enableMeshletCulling);
+        ImGui::Checkbox("Mesh LODs", &m_uiParams.enableLod);
+        ImGui::Checkbox("Depth Prepass", &m_uiParams.enableDepthPrepass);
+        // Needs gl_PrimitiveID and typeless storage writes, see Context
+        ImGui::BeginDisabled(!m_context->supportsVisibilityBuffer());
+        ImGui::Checkbox("Visibility Buffer", &m_uiParams.enableVisibilityBuffer);
+        ImGui::EndDisabled();
+        // Needs this frame's depth, ignored without one of the above
+        ImGui::BeginDisabled(!m_uiParams.enableDepthPrepass &&
+                             !m_uiParams.enableVisibilityBuffer);
+        ImGui::Checkbox("Cluster Depth Bounds", &m_uiParams.enableClusterDepthBounds);
+        ImGui::EndDisabled();
+      }
+
       ImGui::EndTabItem();
     }
 
     if (ImGui::BeginTabItem("Shadows")) {
       ImGui::Checkbox("Visualize CSM Cascades", &m_uiParams.visualizeCascades);
+      ImGui::Checkbox("Cache Far Cascades", &m_uiParams.enableShadowCaching);
       ImGui::DragFloat("Shadow Bias", &m_uiParams.shadowBias, 0.0001f, 0.0f, 0.05f, "%.4f");
       ImGui::DragFloat("Normal Bias", &m_uiParams.shadowNormalBias, 0.0001f, 0.0f, 0.05f, "%.4f");
       ImGui::SliderInt("PCF Range", &m_uiParams.pcfRange, 0, 4);
@@ -679,8 +1065,10 @@ void AstralApp::updateUI(float deltaTime) {
 
 void AstralApp::cleanup() {
   // Save current settings to config before exit
-  Config::get().general.windowWidth = m_window->getWidth();
-  Config::get().general.windowHeight = m_window->getHeight();
+  if (m_window) {
+    Config::get().general.windowWidth = m_window->getWidth();
+    Config::get().general.windowHeight = m_window->getHeight();
+  }
   Config::get().updateFrom(m_uiParams);
   Config::get().save();
 
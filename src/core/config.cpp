@@ -1,4 +1,5 @@
 #include "astral/core/config.hpp"
+#include <algorithm>
 #include <fstream>
 #include <spdlog/spdlog.h>
 
@@ -23,6 +24,42 @@ void Config::load(const std::string& path) {
             general.lastModelPath = g.value("lastModelPath", "");
         }
 
+        // Load Headless
+        if (m_data.contains("headless")) {
+            auto& h = m_data["headless"];
+            headless.frameCount = h.value("frameCount", headless.frameCount);
+            headless.outputDirectory = h.value("outputDirectory", headless.outputDirectory);
+            headless.writeFrames = h.value("writeFrames", headless.writeFrames);
+            headless.lightCullSweep = h.value("lightCullSweep", headless.lightCullSweep);
+            headless.ssaoComparison = h.value("ssaoComparison", headless.ssaoComparison);
+        }
+
+        // Load Textures
+        if (m_data.contains("textures")) {
+            auto& t = m_data["textures"];
+            textures.compress = t.value("compress", textures.compress);
+            textures.cacheDirectory = t.value("cacheDirectory", textures.cacheDirectory);
+        }
+
+        // Load Meshes
+        if (m_data.contains("meshes")) {
+            meshes.cacheDirectory = m_data["meshes"].value("cacheDirectory", meshes.cacheDirectory);
+        }
+
+        // Load Clusters
+        if (m_data.contains("clusters")) {
+            auto& c = m_data["clusters"];
+            clusters.tileSize = c.value("tileSize", clusters.tileSize);
+            clusters.depthSlices = c.value("depthSlices", clusters.depthSlices);
+        }
+
+        // Load Jobs
+        if (m_data.contains("jobs")) {
+            auto& j = m_data["jobs"];
+            jobs.parallelRecording = j.value("parallelRecording", jobs.parallelRecording);
+            jobs.workerThreads = j.value("workerThreads", jobs.workerThreads);
+        }
+
         spdlog::info("Config loaded from {}.", path);
     } catch (const std::exception& e) {
         spdlog::error("Failed to load config {}: {}", path, e.what());
@@ -35,6 +72,18 @@ void Config::save(const std::string& path) {
         m_data["general"]["windowHeight"] = general.windowHeight;
         m_data["general"]["fullscreen"] = general.fullscreen;
         m_data["general"]["lastModelPath"] = general.lastModelPath;
+        m_data["headless"]["frameCount"] = headless.frameCount;
+        m_data["headless"]["outputDirectory"] = headless.outputDirectory;
+        m_data["headless"]["writeFrames"] = headless.writeFrames;
+        m_data["headless"]["lightCullSweep"] = headless.lightCullSweep;
+        m_data["headless"]["ssaoComparison"] = headless.ssaoComparison;
+        m_data["textures"]["compress"] = textures.compress;
+        m_data["textures"]["cacheDirectory"] = textures.cacheDirectory;
+        m_data["meshes"]["cacheDirectory"] = meshes.cacheDirectory;
+        m_data["clusters"]["tileSize"] = clusters.tileSize;
+        m_data["clusters"]["depthSlices"] = clusters.depthSlices;
+        m_data["jobs"]["parallelRecording"] = jobs.parallelRecording;
+        m_data["jobs"]["workerThreads"] = jobs.workerThreads;
 
         std::ofstream file(path);
         file << m_data.dump(4);
@@ -54,6 +103,11 @@ void Config::applyTo(RendererSystem::UIParams& params) {
     params.iblIntensity = r.value("iblIntensity", params.iblIntensity);
     params.enableFXAA = r.value("enableFXAA", params.enableFXAA);
     params.enableSSAO = r.value("enableSSAO", params.enableSSAO);
+    params.ssaoCompute = r.value("ssaoCompute", params.ssaoCompute);
+    params.ssaoQuality = static_cast<RendererSystem::SSAOQuality>(std::clamp(
+        r.value("ssaoQuality", static_cast<int>(params.ssaoQuality)),
+        static_cast<int>(RendererSystem::SSAOQuality::Low),
+        static_cast<int>(RendererSystem::SSAOQuality::High)));
     params.shadowBias = r.value("shadowBias", params.shadowBias);
     params.shadowNormalBias = r.value("shadowNormalBias", params.shadowNormalBias);
     params.pcfRange = r.value("pcfRange", params.pcfRange);
@@ -67,6 +121,8 @@ void Config::updateFrom(const RendererSystem::UIParams& params) {
     r["iblIntensity"] = params.iblIntensity;
     r["enableFXAA"] = params.enableFXAA;
     r["enableSSAO"] = params.enableSSAO;
+    r["ssaoCompute"] = params.ssaoCompute;
+    r["ssaoQuality"] = static_cast<int>(params.ssaoQuality);
     r["shadowBias"] = params.shadowBias;
     r["shadowNormalBias"] = params.shadowNormalBias;
     r["pcfRange"] = params.pcfRange;
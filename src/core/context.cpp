@@ -24,9 +24,13 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 }
 
 Context::Context(Window* window) : m_window(window) {
-    createInstance(window->getRequiredExtensions());
+    createInstance(window ? window->getRequiredExtensions() : std::vector<const char*>{});
     setupDebugMessenger();
-    createSurface(window);
+    if (window) {
+        createSurface(window);
+    } else {
+        spdlog::info("Context: Headless mode, skipping surface creation");
+    }
     pickPhysicalDevice();
     createLogicalDevice();
     createAllocator();
@@ -45,7 +49,9 @@ Context::~Context() {
         }
     }
 
-    vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+    if (m_surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+    }
     vkDestroyInstance(m_instance, nullptr);
 }
 
@@ -237,10 +243,17 @@ QueueFamilyIndices Context::findQueueFamilies(VkPhysicalDevice device) {
             indices.transferFamily = i;
         }
         
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
-        if (presentSupport) {
-            indices.presentFamily = i;
+        // Headless: nothing to present, alias present onto graphics so isComplete() still holds
+        if (m_surface == VK_NULL_HANDLE) {
+            if (indices.graphicsFamily.has_value()) {
+                indices.presentFamily = indices.graphicsFamily;
+            }
+        } else {
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+            if (presentSupport) {
+                indices.presentFamily = i;
+            }
         }
 
         if (indices.isComplete()) {
@@ -286,6 +299,10 @@ void Context::createLogicalDevice() {
     features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
     features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
     features12.descriptorBindingStorageImageUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE; // Per-frame UploadRing slots
+    features12.timelineSemaphore = VK_TRUE; // Texture streaming completion
+    features12.separateDepthStencilLayouts = VK_TRUE; // DEPTH_ATTACHMENT / DEPTH_READ_ONLY layouts in RenderGraph
+    features12.drawIndirectCount = VK_TRUE; // GPU culled draw counts
 
     VkPhysicalDeviceVulkan13Features features13{};
     features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
@@ -293,8 +310,32 @@ void Context::createLogicalDevice() {
     features13.dynamicRendering = VK_TRUE;
     features13.synchronization2 = VK_TRUE;
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+    VkPhysicalDeviceVulkan11Features supported11{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES};
+    VkPhysicalDeviceFeatures2 supported2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    supported2.pNext = &supported11;
+    vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supported2);
+
+    m_textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+    m_depthClamp = supportedFeatures.depthClamp == VK_TRUE;
+    m_visibilityBuffer = supportedFeatures.geometryShader == VK_TRUE &&
+                         supportedFeatures.shaderStorageImageExtendedFormats == VK_TRUE &&
+                         supported11.shaderDrawParameters == VK_TRUE;
+
+    // Vulkan 1.1 features
+    VkPhysicalDeviceVulkan11Features features11{};
+    features11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    features11.shaderDrawParameters = m_visibilityBuffer ? VK_TRUE : VK_FALSE; // gl_DrawID
+    features12.pNext = &features11;
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.textureCompressionBC = m_textureCompressionBC ? VK_TRUE : VK_FALSE; // Cooked textures, RGBA8 otherwise
+    deviceFeatures.depthClamp = m_depthClamp ? VK_TRUE : VK_FALSE; // Shadow casters in front of a cascade
+    // gl_PrimitiveID in the visibility pass, RG16F velocity written by the visibility resolve
+    deviceFeatures.geometryShader = m_visibilityBuffer ? VK_TRUE : VK_FALSE;
+    deviceFeatures.shaderStorageImageExtendedFormats = m_visibilityBuffer ? VK_TRUE : VK_FALSE;
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -303,9 +344,10 @@ void Context::createLogicalDevice() {
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    std::vector<const char*> deviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
+    std::vector<const char*> deviceExtensions;
+    if (!isHeadless()) {
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
     createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
     createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -0,0 +1,97 @@
+#include "astral/core/job_system.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace astral {
+
+JobSystem::JobSystem(uint32_t workerCount) {
+    if (workerCount == 0) {
+        uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        workerCount = hardwareThreads - 1;
+    }
+
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i + 1);
+    }
+    spdlog::info("JobSystem: {} worker threads", workerCount);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::parallelFor(uint32_t count, const Job& job) {
+    if (count == 0) return;
+
+    // Not worth waking anybody up
+    if (m_workers.empty() || count == 1) {
+        for (uint32_t i = 0; i < count; i++) {
+            job(i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_count = count;
+        m_next = 0;
+        m_error = nullptr;
+        m_activeWorkers = static_cast<uint32_t>(m_workers.size());
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    runBatch(0);
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_activeWorkers == 0; });
+        m_job = nullptr;
+        error = m_error;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::runBatch(uint32_t threadIndex) {
+    for (uint32_t i = m_next.fetch_add(1); i < m_count; i = m_next.fetch_add(1)) {
+        try {
+            (*m_job)(i, threadIndex);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error) m_error = std::current_exception();
+        }
+    }
+}
+
+void JobSystem::workerLoop(uint32_t threadIndex) {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seenGeneration; });
+            if (m_stop) return;
+            seenGeneration = m_generation;
+        }
+
+        runBatch(threadIndex);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_activeWorkers == 0) {
+            m_done.notify_one();
+        }
+    }
+}
+
+} // namespace astral
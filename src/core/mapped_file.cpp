@@ -0,0 +1,83 @@
+#include "astral/core/mapped_file.hpp"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace astral {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open file for mapping: " + path.string());
+    }
+    m_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map empty file: " + path.string());
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+
+    m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to create file mapping: " + path.string());
+    }
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        CloseHandle(m_mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map view of file: " + path.string());
+    }
+}
+
+MappedFile::~MappedFile() {
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file for mapping: " + path.string());
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Failed to map empty file: " + path.string());
+    }
+    m_size = static_cast<size_t>(info.st_size);
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps its own reference
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Failed to map file: " + path.string());
+    }
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const uint8_t*>(data);
+}
+
+MappedFile::~MappedFile() {
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+}
+
+#endif
+
+} // namespace astral
@@ -52,6 +52,37 @@ void PerformanceMonitor::update(float deltaTime) {
     }
 }
 
+void PerformanceMonitor::updateCulling(uint32_t instanceCount, uint32_t drawnCount, uint32_t frustumCulled, uint32_t occlusionCulled, uint32_t shadowDrawn,
+                                       uint32_t meshletsDrawn, uint32_t meshletsCulled) {
+    m_instanceCount = instanceCount;
+    m_drawnCount = drawnCount;
+    m_frustumCulled = frustumCulled;
+    m_occlusionCulled = occlusionCulled;
+    m_shadowDrawn = shadowDrawn;
+    m_meshletsDrawn = meshletsDrawn;
+    m_meshletsCulled = meshletsCulled;
+}
+
+void PerformanceMonitor::updateLightCulling(uint32_t lightCount, uint32_t indexCount, uint32_t indexCapacity, float gpuMs) {
+    m_lightCount = lightCount;
+    m_lightIndexCount = indexCount;
+    m_lightIndexCapacity = indexCapacity;
+    m_lightCullMs = gpuMs;
+}
+
+void PerformanceMonitor::updateSSAO(float gpuMs, bool compute) {
+    m_ssaoMs = gpuMs;
+    m_ssaoCompute = compute;
+}
+
+void PerformanceMonitor::updateBindless(uint32_t imagesLive, uint32_t imagesHighWater, uint32_t imageCapacity, uint32_t buffersLive, uint32_t pendingSlots) {
+    m_imagesLive = imagesLive;
+    m_imagesHighWater = imagesHighWater;
+    m_imageCapacity = imageCapacity;
+    m_buffersLive = buffersLive;
+    m_pendingSlots = pendingSlots;
+}
+
 void PerformanceMonitor::renderUI() {
     ImGui::SetNextWindowSize(ImVec2(300, 250), ImGuiCond_FirstUseEver); // Default size
     if (ImGui::Begin("Performance Statistics", nullptr, ImGuiWindowFlags_NoCollapse)) {
@@ -86,6 +117,22 @@ void PerformanceMonitor::renderUI() {
         }
         
         ImGui::TextDisabled("History: %d frames", (int)m_frameTimes.size());
+
+        ImGui::Separator();
+        ImGui::Text("Instances: %u", m_instanceCount);
+        ImGui::Text("Drawn: %u", m_drawnCount);
+        ImGui::Text("Frustum Culled: %u", m_frustumCulled);
+        ImGui::Text("Occlusion Culled: %u", m_occlusionCulled);
+        ImGui::Text("Meshlets: %u drawn, %u culled", m_meshletsDrawn, m_meshletsCulled);
+        ImGui::Text("Shadow Casters: %u (all cascades)", m_shadowDrawn);
+        ImGui::Text("Light Culling: %u lights, %.3f ms", m_lightCount, m_lightCullMs);
+        ImGui::Text("Light Indices: %u / %u", m_lightIndexCount, m_lightIndexCapacity);
+        ImGui::Text("SSAO: %.3f ms (%s)", m_ssaoMs, m_ssaoCompute ? "half-res compute" : "full-res fragment");
+
+        ImGui::Separator();
+        ImGui::Text("Bindless Images: %u live, %u used / %u", m_imagesLive, m_imagesHighWater, m_imageCapacity);
+        ImGui::Text("Bindless Buffers: %u live", m_buffersLive);
+        ImGui::Text("Slots Pending Reuse: %u", m_pendingSlots);
     }
     ImGui::End();
 }
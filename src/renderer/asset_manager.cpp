@@ -1,13 +1,19 @@
 #include "astral/renderer/asset_manager.hpp"
-#include "astral/renderer/asset_manager.hpp"
+#include "astral/renderer/geometry_optimizer.hpp"
+#include "astral/renderer/lod_builder.hpp"
+#include "astral/renderer/meshlet_builder.hpp"
 #include "astral/resources/image.hpp"
 #include <spdlog/spdlog.h>
 #include <stb_image.h>
 #include <algorithm>
+#include <chrono>
+#include <thread>
 
 namespace astral {
 
-AssetManager::AssetManager(Context* context) : m_context(context) {
+AssetManager::AssetManager(Context* context, bool compressTextures, const std::filesystem::path& textureCacheDirectory,
+                           const std::filesystem::path& meshCacheDirectory)
+    : m_context(context), m_compressTextures(compressTextures && context->supportsTextureCompressionBC()) {
     ImageSpecs specs;
     specs.width = 1;
     specs.height = 1;
@@ -37,6 +43,14 @@ AssetManager::AssetManager(Context* context) : m_context(context) {
     m_blackTexture = std::make_shared<Image>(m_context, specs);
     uint8_t black[] = {0, 0, 0, 255};
     m_blackTexture->upload(black, 4);
+
+    if (compressTextures && !m_compressTextures) {
+        spdlog::warn("Device has no BC texture compression, textures stay RGBA8");
+    }
+    if (!meshCacheDirectory.empty()) {
+        m_meshCache = std::make_unique<MeshCache>(meshCacheDirectory);
+    }
+    m_streamer = std::make_unique<TextureStreamer>(m_context, textureCacheDirectory);
 }
 
 void AssetManager::registerLoader(std::unique_ptr<ModelLoader> loader) {
@@ -49,62 +63,173 @@ std::unique_ptr<Model> AssetManager::loadModel(const std::filesystem::path& path
         return nullptr;
     }
 
-    std::string ext = path.extension().string();
-    // Convert to lowercase for comparison
-    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c){ return std::tolower(c); });
+    auto start = std::chrono::high_resolution_clock::now();
+    auto elapsedMs = [&]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+
+    std::unique_ptr<ModelData> data;
+    if (m_meshCache) {
+        data = m_meshCache->load(path);
+    }
+    bool cached = data != nullptr;
+
+    if (!data) {
+        std::string ext = path.extension().string();
+        // Convert to lowercase for comparison
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c){ return std::tolower(c); });
+
+        auto it = std::find_if(m_loaders.begin(), m_loaders.end(), [&](const auto& loader) { return loader->supportsExtension(ext); });
+        if (it == m_loaders.end()) {
+            spdlog::error("No loader found for extension: {}", ext);
+            return nullptr;
+        }
 
-    for (const auto& loader : m_loaders) {
-        if (loader->supportsExtension(ext)) {
-            spdlog::info("Loading asset: {} using appropriate loader...", path.string());
-            return loader->load(path, sceneManager, this);
+        spdlog::info("Loading asset: {} using appropriate loader...", path.string());
+        data = (*it)->import(path);
+        if (!data) {
+            return nullptr;
+        }
+        buildLods(*data);
+        GeometryOptimizationReport report = optimizeGeometry(*data);
+        spdlog::info("{}: vertex cache ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, {} unused vertices dropped",
+                     path.filename().string(), report.before.acmr, report.after.acmr, report.before.atvr,
+                     report.after.atvr, report.droppedVertices);
+        buildMeshlets(*data);
+        if (m_meshCache) {
+            m_meshCache->store(path, *data);
         }
     }
+    double importMs = elapsedMs();
 
-    spdlog::error("No loader found for extension: {}", ext);
-    return nullptr;
-    spdlog::error("No loader found for extension: {}", ext);
-    return nullptr;
+    auto model = createModel(*data, sceneManager);
+    spdlog::info("Model {} ready in {:.1f} ms ({} {:.1f} ms, upload {:.1f} ms)", path.filename().string(), elapsedMs(),
+                 cached ? "mesh cache" : "import", importMs, elapsedMs() - importMs);
+    return model;
 }
 
-std::shared_ptr<Image> AssetManager::getOrLoadTexture(const std::filesystem::path& path, TextureType type) {
-    auto getFallback = [&]() -> std::shared_ptr<Image> {
-        switch (type) {
-            case TextureType::Normal: return m_defaultNormalTexture;
-            case TextureType::MetallicRoughness:
-            case TextureType::Occlusion:
-            case TextureType::Transmission: 
-            case TextureType::Thickness: return m_whiteTexture;
-            case TextureType::Emissive: return m_blackTexture;
-            case TextureType::Albedo:
-            default: return m_errorTexture;
+std::unique_ptr<Model> AssetManager::createModel(const ModelData& data, SceneManager* sceneManager) {
+    auto model = std::make_unique<Model>();
+
+    // Images, streamed in like any other texture
+    std::vector<std::shared_ptr<Image>> images;
+    images.reserve(data.images.size());
+    for (const auto& source : data.images) {
+        std::shared_ptr<Image> image;
+        if (!source.embedded.empty()) {
+            image = loadTextureFromMemory(source.embedded.data(), source.embedded.size(), source.type);
+        } else if (!source.path.empty()) {
+            image = getOrLoadTexture(source.path, source.type);
         }
-    };
+        if (image) {
+            model->images.push_back(image);
+        }
+        images.push_back(std::move(image));
+    }
 
-    if (!std::filesystem::exists(path)) {
-        spdlog::warn("Texture file not found: {}, returning default for type", path.string());
-        return getFallback();
+    // Textures (image + sampler) -> bindless indices
+    model->textureIndices.reserve(data.textures.size());
+    for (size_t i = 0; i < data.textures.size(); ++i) {
+        const auto& texture = data.textures[i];
+        if (texture.image < 0 || texture.image >= static_cast<int32_t>(images.size()) || !images[texture.image]) {
+            spdlog::warn("Texture {} references missing image {}", i, texture.image);
+            model->textureIndices.push_back(0); // Default fallback
+            continue;
+        }
+        model->textureIndices.push_back(registerTexture(images[texture.image], getSampler(texture.sampler)));
     }
 
-    std::string pathStr = std::filesystem::absolute(path).string();
-    
-    // Check cache
-    if (m_textureCache.find(pathStr) != m_textureCache.end()) {
-        return m_textureCache[pathStr];
+    // Materials
+    std::vector<int32_t> materialIndices;
+    materialIndices.reserve(data.materials.size());
+    for (const auto& source : data.materials) {
+        Material material;
+        material.name = source.name;
+        material.gpuData = source.gpuData;
+
+        auto resolve = [&](int32_t& index, std::shared_ptr<Image>& image) {
+            if (index < 0 || index >= static_cast<int32_t>(data.textures.size())) {
+                index = -1;
+                return;
+            }
+            int32_t imageIndex = data.textures[index].image;
+            if (imageIndex >= 0 && imageIndex < static_cast<int32_t>(images.size())) {
+                image = images[imageIndex];
+            }
+            index = static_cast<int32_t>(model->textureIndices[index]);
+        };
+        resolve(material.gpuData.baseColorIndex, material.baseColorTexture);
+        resolve(material.gpuData.normalIndex, material.normalTexture);
+        resolve(material.gpuData.metallicRoughnessIndex, material.metallicRoughnessTexture);
+        resolve(material.gpuData.emissiveIndex, material.emissiveTexture);
+        resolve(material.gpuData.occlusionIndex, material.occlusionTexture);
+        resolve(material.gpuData.transmissionIndex, material.transmissionTexture);
+        resolve(material.gpuData.thicknessIndex, material.thicknessTexture);
+
+        materialIndices.push_back(sceneManager->addMaterial(material));
+    }
+
+    // Default material if none exist
+    if (materialIndices.empty()) {
+        Material defaultMat;
+        defaultMat.name = "Default";
+        materialIndices.push_back(sceneManager->addMaterial(defaultMat));
     }
 
-    spdlog::info("Loading texture: {}", pathStr);
+    // Meshes, primitive material indices become scene material indices
+    model->meshes.reserve(data.meshes.size());
+    for (const auto& source : data.meshes) {
+        Mesh mesh;
+        mesh.name = source.name;
+        mesh.primitives = source.primitives;
+        for (auto& primitive : mesh.primitives) {
+            bool valid = primitive.materialIndex >= 0 && primitive.materialIndex < static_cast<int32_t>(materialIndices.size());
+            primitive.materialIndex = valid ? materialIndices[primitive.materialIndex] : materialIndices[0];
+        }
+        model->meshes.push_back(std::move(mesh));
+    }
 
-    int width, height, channels;
-    stbi_uc* pixels = stbi_load(pathStr.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    // Node hierarchy, parents always come before their children
+    model->linearNodes.reserve(data.nodes.size());
+    for (const auto& source : data.nodes) {
+        auto node = std::make_unique<Model::Node>();
+        node->parent = source.parent >= 0 ? model->linearNodes[source.parent] : nullptr;
+        node->meshIndex = source.meshIndex;
+        node->matrix = source.matrix;
+        node->name = source.name;
 
-    if (!pixels) {
-        spdlog::error("Failed to load texture image: {}", pathStr);
-        return getFallback();
+        Model::Node* nodePtr = node.get();
+        model->linearNodes.push_back(nodePtr);
+        if (nodePtr->parent) {
+            nodePtr->parent->children.push_back(std::move(node));
+        } else {
+            model->nodes.push_back(std::move(node));
+        }
     }
 
-    ImageSpecs specs;
-    specs.width = static_cast<uint32_t>(width);
-    specs.height = static_cast<uint32_t>(height);
+    // Geometry goes into the shared arena, straight from the (possibly memory-mapped) data
+    model->arena = &sceneManager->getGeometryArena();
+    model->geometry = model->arena->allocate(data.vertices, data.indices, data.meshlets);
+
+    spdlog::info("Model created: {} meshes, {} materials, {} textures",
+                 model->meshes.size(), materialIndices.size(), model->images.size());
+    return model;
+}
+
+std::shared_ptr<Image> AssetManager::getFallback(TextureType type) const {
+    switch (type) {
+        case TextureType::Normal: return m_defaultNormalTexture;
+        case TextureType::MetallicRoughness:
+        case TextureType::Occlusion:
+        case TextureType::Transmission: 
+        case TextureType::Thickness: return m_whiteTexture;
+        case TextureType::Emissive: return m_blackTexture;
+        case TextureType::Albedo:
+        default: return m_errorTexture;
+    }
+}
+
+VkFormat AssetManager::getTextureFormat(TextureType type) const {
     // Normals should be UNORM, others mostly SRGB.
     // Transmission/Thickness are data maps, so use UNORM.
     bool kIsDataMap = (type == TextureType::Normal || type == TextureType::Transmission || type == TextureType::Thickness || type == TextureType::MetallicRoughness || type == TextureType::Occlusion);
@@ -113,19 +238,117 @@ std::shared_ptr<Image> AssetManager::getOrLoadTexture(const std::filesystem::pat
     // The previous code had them as sRGB by default (via generic fallback), which is technically wrong for PBR data maps 
     // but often ignored if engines treat them loosely.
     // Let's force UNORM for all data maps explicitly now.
-    
-    specs.format = kIsDataMap ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8G8B8A8_SRGB;
+    if (!m_compressTextures) {
+        return kIsDataMap ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8G8B8A8_SRGB;
+    }
+
+    // Match the channels pbr.frag reads: normal .xy (z rebuilt), occlusion/transmission .r,
+    // metallic-roughness .gb and thickness .g need a full colour format
+    switch (type) {
+        case TextureType::Normal: return VK_FORMAT_BC5_UNORM_BLOCK;
+        case TextureType::Occlusion:
+        case TextureType::Transmission: return VK_FORMAT_BC4_UNORM_BLOCK;
+        case TextureType::MetallicRoughness:
+        case TextureType::Thickness: return VK_FORMAT_BC7_UNORM_BLOCK;
+        case TextureType::Albedo:
+        case TextureType::Emissive:
+        default: return VK_FORMAT_BC7_SRGB_BLOCK;
+    }
+}
+
+std::shared_ptr<Image> AssetManager::createStreamingImage(uint32_t width, uint32_t height, TextureType type) {
+    ImageSpecs specs;
+    specs.width = width;
+    specs.height = height;
+    specs.format = getTextureFormat(type);
     specs.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    specs.transferQueueAccess = true;
 
     auto image = std::make_shared<Image>(m_context, specs);
-    image->upload(pixels, specs.width * specs.height * 4);
+    m_streaming[image.get()].fallback = getFallback(type);
+    return image;
+}
+
+std::shared_ptr<Image> AssetManager::getOrLoadTexture(const std::filesystem::path& path, TextureType type) {
+    if (!std::filesystem::exists(path)) {
+        spdlog::warn("Texture file not found: {}, returning default for type", path.string());
+        return getFallback(type);
+    }
+
+    std::string pathStr = std::filesystem::absolute(path).string();
+    // ORM maps get loaded as both occlusion and metallic-roughness, which cook differently
+    std::string cacheKey = pathStr + "|" + std::to_string(getTextureFormat(type));
     
-    stbi_image_free(pixels);
+    // Check cache
+    if (m_textureCache.find(cacheKey) != m_textureCache.end()) {
+        return m_textureCache[cacheKey];
+    }
+
+    // Only the header here, decoding happens on the streamer's threads
+    int width, height, channels;
+    if (!stbi_info(pathStr.c_str(), &width, &height, &channels)) {
+        spdlog::error("Failed to load texture image: {}", pathStr);
+        return getFallback(type);
+    }
 
-    m_textureCache[pathStr] = image;
+    spdlog::info("Streaming texture: {} ({}x{})", pathStr, width, height);
+    auto image = createStreamingImage(static_cast<uint32_t>(width), static_cast<uint32_t>(height), type);
+    m_streamer->enqueue(image, pathStr);
+
+    m_textureCache[cacheKey] = image;
+    return image;
+}
+
+std::shared_ptr<Image> AssetManager::loadTextureFromMemory(const uint8_t* data, size_t size, TextureType type) {
+    int width, height, channels;
+    if (!stbi_info_from_memory(data, static_cast<int>(size), &width, &height, &channels)) {
+        spdlog::error("Failed to read embedded texture header: {}", stbi_failure_reason());
+        return getFallback(type);
+    }
+
+    auto image = createStreamingImage(static_cast<uint32_t>(width), static_cast<uint32_t>(height), type);
+    m_streamer->enqueue(image, std::vector<uint8_t>(data, data + size));
     return image;
 }
 
+uint32_t AssetManager::registerTexture(const std::shared_ptr<Image>& image, VkSampler sampler) {
+    auto& descriptorManager = m_context->getDescriptorManager();
+    auto it = m_streaming.find(image.get());
+    if (it == m_streaming.end()) {
+        return descriptorManager.registerImage(image->getView(), sampler);
+    }
+
+    // A slot of its own rather than rewriting it later: frames in flight may still sample it
+    uint32_t placeholder = descriptorManager.registerImage(it->second.fallback->getView(), sampler);
+    it->second.placeholders.push_back({descriptorManager.getHandle(DescriptorManager::IMAGE_BINDING, placeholder), sampler});
+    return placeholder;
+}
+
+void AssetManager::updateStreaming(SceneManager& sceneManager) {
+    auto& descriptorManager = m_context->getDescriptorManager();
+    for (const auto& image : m_streamer->update()) {
+        auto it = m_streaming.find(image.get());
+        if (it == m_streaming.end()) {
+            continue;
+        }
+        for (const auto& [placeholder, sampler] : it->second.placeholders) {
+            uint32_t index = descriptorManager.registerImage(image->getView(), sampler);
+            sceneManager.remapTextureIndex(static_cast<int32_t>(placeholder.index), static_cast<int32_t>(index));
+            // Frames in flight may still sample it, the slot is recycled once they retire
+            descriptorManager.release(placeholder);
+        }
+        m_streaming.erase(it);
+    }
+}
+
+void AssetManager::finishStreaming(SceneManager& sceneManager) {
+    while (!m_streamer->isIdle()) {
+        updateStreaming(sceneManager);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    updateStreaming(sceneManager);
+}
+
 VkSampler AssetManager::getSampler(const SamplerSpecs& specs) {
     if (m_samplerCache.find(specs) != m_samplerCache.end()) {
         return m_samplerCache[specs]->getHandle();
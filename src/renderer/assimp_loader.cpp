@@ -1,37 +1,19 @@
 #include "astral/renderer/assimp_loader.hpp"
-#include "astral/renderer/asset_manager.hpp"
-#include "astral/core/context.hpp"
-#include "astral/renderer/scene_manager.hpp"
-#include "astral/renderer/descriptor_manager.hpp"
-#include <stb_image.h>
 #include <spdlog/spdlog.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <map>
 #include <memory>
 #include <vulkan/vulkan.h>
-#include "astral/resources/image.hpp"
 
 namespace astral {
 
-class AssimpLoader; // forward decl if needed
-
-
-AssimpLoader::AssimpLoader(Context* context) : m_context(context) {
-    // No default sampler creation needed here
-}
-
-AssimpLoader::~AssimpLoader() {
-    // Samplers managed by AssetManager
-}
-
-// createDefaultSampler removed
-
 bool AssimpLoader::supportsExtension(const std::string& extension) const {
     // Support common formats
     return extension == ".obj" || extension == ".fbx" || extension == ".dae" || extension == ".blend";
 }
 
-std::unique_ptr<Model> AssimpLoader::load(const std::filesystem::path& path, SceneManager* sceneManager, AssetManager* assetManager) {
+std::unique_ptr<ModelData> AssimpLoader::import(const std::filesystem::path& path) {
     Assimp::Importer importer;
     
     // Flags:
@@ -56,15 +38,26 @@ std::unique_ptr<Model> AssimpLoader::load(const std::filesystem::path& path, Sce
         return nullptr;
     }
 
-    auto model = std::make_unique<Model>();
+    auto model = std::make_unique<ModelData>();
     std::filesystem::path directory = path.parent_path();
 
+    // Every texture goes through the same sampler, so one texture per (file, type)
+    SamplerSpecs specs;
+    specs.magFilter = VK_FILTER_LINEAR;
+    specs.minFilter = VK_FILTER_LINEAR;
+    specs.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    specs.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    specs.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    specs.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    specs.anisotropyEnable = true;
+    specs.maxAnisotropy = 16.0f;
+    std::map<std::pair<std::string, TextureType>, int32_t> textureLookup;
+
     // 1. Process Materials
-    std::vector<int32_t> materialIndices;
     if (scene->HasMaterials()) {
          for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
              aiMaterial* aiMat = scene->mMaterials[i];
-             Material material;
+             ModelData::MaterialData material;
              aiString matName;
              aiMat->Get(AI_MATKEY_NAME, matName);
              material.name = matName.C_Str();
@@ -95,71 +88,73 @@ std::unique_ptr<Model> AssimpLoader::load(const std::filesystem::path& path, Sce
              }
  
              // Textures
-             // Helper to load texture
-             auto loadAndRegister = [&](aiTextureType type, int32_t& targetIndex, std::shared_ptr<Image>& targetPtr) {
-                 if (aiMat->GetTextureCount(type) > 0) {
-                     aiString str;
-                     aiMat->GetTexture(type, 0, &str);
-                     std::filesystem::path texPath = directory / str.C_Str();
-                     int texIdx = loadTexture(texPath, model.get(), assetManager, directory);
-                     if (texIdx >= 0) {
-                        targetIndex = model->textureIndices[texIdx];
-                        // Get the image pointer we just added/found
-                        if (texIdx < static_cast<int>(model->images.size())) {
-                            targetPtr = model->images[texIdx];
-                        }
-                     } else {
-                        targetIndex = -1;
-                     }
-                 } else {
-                     targetIndex = -1;
+             // Helper to resolve a texture slot into model->textures
+             auto loadAndRegister = [&](aiTextureType type, int32_t& targetIndex, TextureType textureType) {
+                 targetIndex = -1;
+                 if (aiMat->GetTextureCount(type) == 0) {
+                     return;
+                 }
+                 aiString str;
+                 aiMat->GetTexture(type, 0, &str);
+                 std::filesystem::path texPath = findTexture(directory / str.C_Str(), directory);
+                 if (texPath.empty()) {
+                     return;
                  }
+
+                 auto key = std::make_pair(texPath.string(), textureType);
+                 auto it = textureLookup.find(key);
+                 if (it == textureLookup.end()) {
+                     ModelData::ImageSource image;
+                     image.path = key.first;
+                     image.type = textureType;
+                     model->images.push_back(std::move(image));
+
+                     ModelData::TextureRef texture;
+                     texture.image = static_cast<int32_t>(model->images.size() - 1);
+                     texture.sampler = specs;
+                     model->textures.push_back(texture);
+                     it = textureLookup.emplace(key, static_cast<int32_t>(model->textures.size() - 1)).first;
+                 }
+                 targetIndex = it->second;
              };
  
-             loadAndRegister(aiTextureType_BASE_COLOR, material.gpuData.baseColorIndex, material.baseColorTexture);
+             loadAndRegister(aiTextureType_BASE_COLOR, material.gpuData.baseColorIndex, TextureType::Albedo);
              if (material.gpuData.baseColorIndex == -1) // Fallback to diffuse
-                 loadAndRegister(aiTextureType_DIFFUSE, material.gpuData.baseColorIndex, material.baseColorTexture);
+                 loadAndRegister(aiTextureType_DIFFUSE, material.gpuData.baseColorIndex, TextureType::Albedo);
                  
-             loadAndRegister(aiTextureType_NORMALS, material.gpuData.normalIndex, material.normalTexture);
+             loadAndRegister(aiTextureType_NORMALS, material.gpuData.normalIndex, TextureType::Normal);
              if (material.gpuData.normalIndex == -1)
-                 loadAndRegister(aiTextureType_HEIGHT, material.gpuData.normalIndex, material.normalTexture);
+                 loadAndRegister(aiTextureType_HEIGHT, material.gpuData.normalIndex, TextureType::Normal);
              if (material.gpuData.normalIndex == -1)
-                 loadAndRegister(aiTextureType_NORMAL_CAMERA, material.gpuData.normalIndex, material.normalTexture);
-             loadAndRegister(aiTextureType_METALNESS, material.gpuData.metallicRoughnessIndex, material.metallicRoughnessTexture);
+                 loadAndRegister(aiTextureType_NORMAL_CAMERA, material.gpuData.normalIndex, TextureType::Normal);
+             loadAndRegister(aiTextureType_METALNESS, material.gpuData.metallicRoughnessIndex, TextureType::MetallicRoughness);
              if (material.gpuData.metallicRoughnessIndex == -1)
-                 loadAndRegister(aiTextureType_SPECULAR, material.gpuData.metallicRoughnessIndex, material.metallicRoughnessTexture);
+                 loadAndRegister(aiTextureType_SPECULAR, material.gpuData.metallicRoughnessIndex, TextureType::MetallicRoughness);
              if (material.gpuData.metallicRoughnessIndex == -1)
-                 loadAndRegister(aiTextureType_SHININESS, material.gpuData.metallicRoughnessIndex, material.metallicRoughnessTexture);
+                 loadAndRegister(aiTextureType_SHININESS, material.gpuData.metallicRoughnessIndex, TextureType::MetallicRoughness);
              if (material.gpuData.metallicRoughnessIndex == -1)
-                 loadAndRegister(aiTextureType_UNKNOWN, material.gpuData.metallicRoughnessIndex, material.metallicRoughnessTexture);
+                 loadAndRegister(aiTextureType_UNKNOWN, material.gpuData.metallicRoughnessIndex, TextureType::MetallicRoughness);
              if (material.gpuData.metallicRoughnessIndex == -1)
-                 loadAndRegister(aiTextureType_DIFFUSE_ROUGHNESS, material.gpuData.metallicRoughnessIndex, material.metallicRoughnessTexture);
+                 loadAndRegister(aiTextureType_DIFFUSE_ROUGHNESS, material.gpuData.metallicRoughnessIndex, TextureType::MetallicRoughness);
              
-             loadAndRegister(aiTextureType_EMISSIVE, material.gpuData.emissiveIndex, material.emissiveTexture);
-             loadAndRegister(aiTextureType_AMBIENT_OCCLUSION, material.gpuData.occlusionIndex, material.occlusionTexture);
+             loadAndRegister(aiTextureType_EMISSIVE, material.gpuData.emissiveIndex, TextureType::Emissive);
+             loadAndRegister(aiTextureType_AMBIENT_OCCLUSION, material.gpuData.occlusionIndex, TextureType::Occlusion);
  
-             materialIndices.push_back(sceneManager->addMaterial(material));
+             model->materials.push_back(material);
          }
     }
-    
-    // Default material if none
-    if (materialIndices.empty()) {
-        Material defaultMat;
-        defaultMat.name = "Default";
-        materialIndices.push_back(sceneManager->addMaterial(defaultMat));
-    }
 
     // 2. Process Meshes
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
+    auto& vertices = model->vertexStorage;
+    auto& indices = model->indexStorage;
 
     if (scene->HasMeshes()) {
         for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
             aiMesh* mesh = scene->mMeshes[i];
-            Mesh meshData;
+            ModelData::MeshData meshData;
             meshData.name = mesh->mName.C_Str();
             
-            Primitive primitive;
+            Primitive primitive{};
             primitive.firstIndex = static_cast<uint32_t>(indices.size());
             uint32_t vertexStart = static_cast<uint32_t>(vertices.size());
             
@@ -214,39 +209,21 @@ std::unique_ptr<Model> AssimpLoader::load(const std::filesystem::path& path, Sce
             primitive.indexCount = static_cast<uint32_t>(indices.size()) - primitive.firstIndex;
             primitive.boundingCenter = (minPos + maxPos) * 0.5f;
             primitive.boundingRadius = glm::distance(maxPos, primitive.boundingCenter);
-            primitive.materialIndex = materialIndices[mesh->mMaterialIndex];
+            primitive.materialIndex = static_cast<int32_t>(mesh->mMaterialIndex);
 
             meshData.primitives.push_back(primitive);
             model->meshes.push_back(meshData);
         }
     }
 
-    // Upload Buffers
-    if (!vertices.empty()) {
-        model->vertexBuffer = std::make_unique<Buffer>(
-            m_context,
-            vertices.size() * sizeof(Vertex),
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            VMA_MEMORY_USAGE_CPU_TO_GPU
-        );
-        model->vertexBuffer->upload(vertices.data(), vertices.size() * sizeof(Vertex));
-    }
+    model->adoptStorage();
 
-    if (!indices.empty()) {
-        model->indexBuffer = std::make_unique<Buffer>(
-            m_context,
-            indices.size() * sizeof(uint32_t),
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-            VMA_MEMORY_USAGE_CPU_TO_GPU
-        );
-        model->indexBuffer->upload(indices.data(), indices.size() * sizeof(uint32_t));
-    }
-
-    spdlog::info("Loaded model via Assimp: {} ({} meshes, {} materials)", path.string(), model->meshes.size(), materialIndices.size());
+    // PreTransformVertices flattened the hierarchy, no nodes to keep
+    spdlog::info("Imported model via Assimp: {} ({} meshes, {} materials)", path.string(), model->meshes.size(), model->materials.size());
     return model;
 }
 
-int AssimpLoader::loadTexture(const std::filesystem::path& path, Model* model, AssetManager* assetManager, const std::filesystem::path& modelDir) {
+std::filesystem::path AssimpLoader::findTexture(const std::filesystem::path& path, const std::filesystem::path& modelDir) const {
     // Strategy for finding textures:
     // 1. Try absolute or relative path as given
     // 2. Try in the same directory as the model
@@ -283,7 +260,6 @@ int AssimpLoader::loadTexture(const std::filesystem::path& path, Model* model, A
         pathsToTry.push_back(grandparent / filename);
     }
 
-    std::shared_ptr<Image> image = nullptr;
     std::filesystem::path foundPath;
 
     spdlog::info("Looking for texture: {}", path.string());
@@ -294,13 +270,10 @@ int AssimpLoader::loadTexture(const std::filesystem::path& path, Model* model, A
              std::filesystem::path cleanPath = std::filesystem::weakly_canonical(tryPath);
              spdlog::debug("Checking path: {}", cleanPath.string());
              
-             if (std::filesystem::exists(cleanPath)) {
-                 image = assetManager->getOrLoadTexture(cleanPath);
-                 if (image) {
-                     foundPath = cleanPath;
-                     spdlog::info("Found texture at: {}", cleanPath.string());
-                     break; 
-                 }
+             if (std::filesystem::is_regular_file(cleanPath)) {
+                 foundPath = cleanPath;
+                 spdlog::info("Found texture at: {}", cleanPath.string());
+                 break;
              }
         } catch (const std::exception& e) {
             spdlog::warn("Path check failed for '{}': {}", tryPath.string(), e.what());
@@ -310,19 +283,16 @@ int AssimpLoader::loadTexture(const std::filesystem::path& path, Model* model, A
     }
     
     // 8. If still not found, try recursive search in model's base directory
-    if (!image) {
+    if (foundPath.empty()) {
         try {
             std::filesystem::path baseDir = modelDir.parent_path(); // e.g. m1897-trenchgun/
             if (std::filesystem::exists(baseDir) && std::filesystem::is_directory(baseDir)) {
                 spdlog::debug("Searching recursively in: {}", baseDir.string());
                 for (const auto& entry : std::filesystem::recursive_directory_iterator(baseDir)) {
                     if (entry.is_regular_file() && entry.path().filename() == filename) {
-                        image = assetManager->getOrLoadTexture(entry.path());
-                        if (image) {
-                            foundPath = entry.path();
-                            spdlog::info("Found texture via recursive search: {}", foundPath.string());
-                            break;
-                        }
+                        foundPath = entry.path();
+                        spdlog::info("Found texture via recursive search: {}", foundPath.string());
+                        break;
                     }
                 }
             }
@@ -333,7 +303,7 @@ int AssimpLoader::loadTexture(const std::filesystem::path& path, Model* model, A
     
     // 9. Fuzzy matching - try to find textures with similar suffixes
     // e.g., "Cartridge_low_Cartridge_BaseColor.png" -> look for "*BaseColor.png" or "*_BaseColor.png"
-    if (!image) {
+    if (foundPath.empty()) {
         try {
             // Extract texture type suffix from filename
             std::vector<std::string> textureSuffixes = {"BaseColor", "Diffuse", "Normal", "Metallic", "Roughness", "MetallicRoughness", "Occlusion", "Emissive", "Height"};
@@ -383,12 +353,9 @@ int AssimpLoader::loadTexture(const std::filesystem::path& path, Model* model, A
                             }
                             
                             if (likelyMatch) {
-                                image = assetManager->getOrLoadTexture(entry.path());
-                                if (image) {
-                                    foundPath = entry.path();
-                                    spdlog::info("Found texture via fuzzy match: {} -> {}", filename, foundPath.string());
-                                    break;
-                                }
+                                foundPath = entry.path();
+                                spdlog::info("Found texture via fuzzy match: {} -> {}", filename, foundPath.string());
+                                break;
                             }
                         }
                     }
@@ -399,36 +366,11 @@ int AssimpLoader::loadTexture(const std::filesystem::path& path, Model* model, A
         }
     }
 
-    if (!image) {
+    if (foundPath.empty()) {
         spdlog::warn("Failed to find texture '{}'. Searched {} locations + recursive + fuzzy.", path.string(), pathsToTry.size());
-        return -1;
-    } 
-    // else, image found, proceed
-    
-    try {
-        // Register with descriptor manager
-        SamplerSpecs specs;
-        specs.magFilter = VK_FILTER_LINEAR;
-        specs.minFilter = VK_FILTER_LINEAR;
-        specs.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-        specs.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        specs.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        specs.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        specs.anisotropyEnable = true;
-        specs.maxAnisotropy = 16.0f;
-        
-        VkSampler sampler = assetManager->getSampler(specs);
-
-        uint32_t texIdx = m_context->getDescriptorManager().registerImage(image->getView(), sampler);
-        
-        model->images.push_back(image);
-        model->textureIndices.push_back(texIdx);
-        
-        return static_cast<int>(model->textureIndices.size() - 1);
-    } catch (const std::exception& e) {
-        spdlog::error("Error registering texture: {}", e.what());
-        return -1;
+        return {};
     }
+    return std::filesystem::absolute(foundPath).lexically_normal();
 }
 
 } // namespace astral
@@ -1,5 +1,7 @@
 #include "astral/renderer/descriptor_manager.hpp"
 #include "astral/core/context.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <string>
@@ -62,7 +64,9 @@ void DescriptorManager::createLayout() {
     b5.stageFlags = VK_SHADER_STAGE_ALL;
     bindings.push_back(b5);
 
-    std::vector<VkDescriptorBindingFlags> flags(bindings.size(), VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT);
+    // UNUSED_WHILE_PENDING: per-frame slots get rewritten while the other frame is still in flight
+    std::vector<VkDescriptorBindingFlags> flags(bindings.size(), VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                                                 VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
 
     // Find index of binding 13 for variable count (must be the HIGHEST binding number per Vulkan spec)
     for(size_t i = 0; i < bindings.size(); ++i) {
@@ -123,12 +127,17 @@ void DescriptorManager::createPoolAndSet() {
 }
 
 uint32_t DescriptorManager::registerImage(VkImageView view, VkSampler sampler) {
-    if (m_nextImageIndex >= MAX_BINDLESS_IMAGES) {
-        throw std::runtime_error("Maximum bindless images reached!");
-    }
+    uint32_t index = reserveImage();
+    updateImage(index, view, sampler);
+    return index;
+}
 
-    uint32_t index = m_nextImageIndex++;
-    
+uint32_t DescriptorManager::reserveImage() {
+    // Left unwritten until updateImage, fine with PARTIALLY_BOUND as long as nothing samples it
+    return allocateSlot(IMAGE_BINDING);
+}
+
+void DescriptorManager::updateImage(uint32_t index, VkImageView view, VkSampler sampler) {
     VkDescriptorImageInfo imageInfo = {};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     imageInfo.imageView = view;
@@ -143,16 +152,10 @@ uint32_t DescriptorManager::registerImage(VkImageView view, VkSampler sampler) {
     write.pImageInfo = &imageInfo;
 
     vkUpdateDescriptorSets(m_context->getDevice(), 1, &write, 0, nullptr);
-
-    return index;
 }
 
 uint32_t DescriptorManager::registerImageArray(VkImageView view, VkSampler sampler) {
-    if (m_nextArrayImageIndex >= MAX_BINDLESS_IMAGES) {
-        throw std::runtime_error("Maximum bindless array images reached!");
-    }
-
-    uint32_t index = m_nextArrayImageIndex++;
+    uint32_t index = allocateSlot(ARRAY_IMAGE_BINDING);
     
     VkDescriptorImageInfo imageInfo = {};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -173,12 +176,16 @@ uint32_t DescriptorManager::registerImageArray(VkImageView view, VkSampler sampl
 }
 
 uint32_t DescriptorManager::registerStorageImage(VkImageView view) {
-    if (m_nextStorageImageIndex >= MAX_BINDLESS_IMAGES) {
-        throw std::runtime_error("Maximum bindless storage images reached!");
-    }
+    uint32_t index = reserveStorageImage();
+    updateStorageImage(index, view);
+    return index;
+}
 
-    uint32_t index = m_nextStorageImageIndex++;
-    
+uint32_t DescriptorManager::reserveStorageImage() {
+    return allocateSlot(STORAGE_IMAGE_BINDING);
+}
+
+void DescriptorManager::updateStorageImage(uint32_t index, VkImageView view) {
     VkDescriptorImageInfo imageInfo = {};
     imageInfo.imageView = view;
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
@@ -192,16 +199,10 @@ uint32_t DescriptorManager::registerStorageImage(VkImageView view) {
     write.pImageInfo = &imageInfo;
 
     vkUpdateDescriptorSets(m_context->getDevice(), 1, &write, 0, nullptr);
-
-    return index;
 }
 
 uint32_t DescriptorManager::registerImageCube(VkImageView view, VkSampler sampler) {
-    if (m_nextCubeImageIndex >= MAX_BINDLESS_IMAGES) {
-        throw std::runtime_error("Maximum bindless cube images reached!");
-    }
-
-    uint32_t index = m_nextCubeImageIndex++;
+    uint32_t index = allocateSlot(CUBE_IMAGE_BINDING);
     
     VkDescriptorImageInfo imageInfo = {};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -222,16 +223,19 @@ uint32_t DescriptorManager::registerImageCube(VkImageView view, VkSampler sample
 }
 
 uint32_t DescriptorManager::registerBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t binding) {
-    if (binding == 0 || binding > 15) {
-        throw std::runtime_error("Invalid binding index for registerBuffer! (Expected 1-15)");
-    }
-    
-    if (m_nextBufferIndices[binding] >= MAX_BINDLESS_BUFFERS) {
-        throw std::runtime_error("Maximum bindless buffers reached for binding " + std::to_string(binding));
+    uint32_t index = reserveBuffer(binding);
+    updateBuffer(index, buffer, offset, range, binding);
+    return index;
+}
+
+uint32_t DescriptorManager::reserveBuffer(uint32_t binding) {
+    if (binding == 0 || binding > 15 || getCapacity(binding) != MAX_BINDLESS_BUFFERS) {
+        throw std::runtime_error("Invalid binding index for registerBuffer! (Expected a storage buffer binding)");
     }
+    return allocateSlot(binding);
+}
 
-    uint32_t index = m_nextBufferIndices[binding]++;
-    
+void DescriptorManager::updateBuffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t binding) {
     VkDescriptorBufferInfo bufferInfo = {};
     bufferInfo.buffer = buffer;
     bufferInfo.offset = offset;
@@ -246,8 +250,95 @@ uint32_t DescriptorManager::registerBuffer(VkBuffer buffer, VkDeviceSize offset,
     write.pBufferInfo = &bufferInfo;
 
     vkUpdateDescriptorSets(m_context->getDevice(), 1, &write, 0, nullptr);
+}
+
+uint32_t DescriptorManager::getCapacity(uint32_t binding) {
+    switch (binding) {
+    case IMAGE_BINDING:
+    case ARRAY_IMAGE_BINDING:
+    case STORAGE_IMAGE_BINDING:
+    case CUBE_IMAGE_BINDING:
+        return MAX_BINDLESS_IMAGES;
+    default:
+        return MAX_BINDLESS_BUFFERS;
+    }
+}
 
+uint32_t DescriptorManager::allocateSlot(uint32_t binding) {
+    SlotTable& table = m_tables[binding];
+    uint32_t index;
+    if (!table.free.empty()) {
+        index = table.free.back();
+        table.free.pop_back();
+    } else {
+        if (table.next >= getCapacity(binding)) {
+            throw std::runtime_error("Maximum bindless slots reached for binding " + std::to_string(binding) + "!");
+        }
+        index = table.next++;
+        table.generations.push_back(0);
+        table.allocated.push_back(false);
+    }
+    table.allocated[index] = true;
+    table.live++;
     return index;
 }
 
+BindlessHandle DescriptorManager::getHandle(uint32_t binding, uint32_t index) const {
+    const SlotTable& table = m_tables[binding];
+    if (index >= table.next || !table.allocated[index]) {
+        throw std::runtime_error("getHandle: slot " + std::to_string(index) + " of binding " + std::to_string(binding) +
+                                 " isn't allocated!");
+    }
+    return {binding, index, table.generations[index]};
+}
+
+bool DescriptorManager::isValid(const BindlessHandle& handle) const {
+    if (handle.binding >= 16) {
+        return false;
+    }
+    const SlotTable& table = m_tables[handle.binding];
+    return handle.index < table.next && table.allocated[handle.index] &&
+           table.generations[handle.index] == handle.generation;
+}
+
+void DescriptorManager::release(const BindlessHandle& handle) {
+    if (handle.index == UINT32_MAX) {
+        return; // Default constructed, never registered
+    }
+    if (!isValid(handle)) {
+        spdlog::error("DescriptorManager: stale release of slot {} (binding {}, generation {})", handle.index,
+                      handle.binding, handle.generation);
+        return;
+    }
+    SlotTable& table = m_tables[handle.binding];
+    table.allocated[handle.index] = false;
+    table.generations[handle.index]++;
+    table.live--;
+    table.pending.push_back({handle.index, m_frameNumber});
+}
+
+void DescriptorManager::beginFrame() {
+    m_frameNumber++;
+    for (SlotTable& table : m_tables) {
+        // Released in frame order, the retired ones are a prefix
+        auto retired = std::find_if(table.pending.begin(), table.pending.end(), [&](const auto& entry) {
+            return entry.second + RELEASE_LATENCY_FRAMES > m_frameNumber;
+        });
+        for (auto it = table.pending.begin(); it != retired; ++it) {
+            table.free.push_back(it->first);
+        }
+        table.pending.erase(table.pending.begin(), retired);
+    }
+}
+
+DescriptorManager::Occupancy DescriptorManager::getOccupancy(uint32_t binding) const {
+    const SlotTable& table = m_tables[binding];
+    Occupancy occupancy;
+    occupancy.live = table.live;
+    occupancy.pending = static_cast<uint32_t>(table.pending.size());
+    occupancy.highWater = table.next;
+    occupancy.capacity = getCapacity(binding);
+    return occupancy;
+}
+
 } // namespace astral
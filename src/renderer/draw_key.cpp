@@ -0,0 +1,73 @@
+#include "astral/renderer/draw_key.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace astral {
+
+uint64_t makeDrawKey(DrawPass pass, uint32_t pipeline, uint32_t material, float distanceSquared) {
+    // Negative zero / NaN would land at the wrong end
+    float depthValue = distanceSquared > 0.0f ? distanceSquared : 0.0f;
+    uint32_t depth;
+    memcpy(&depth, &depthValue, sizeof(depth));
+
+    pipeline &= 0x3FF;
+    material &= 0xFFFFF;
+    uint64_t key = static_cast<uint64_t>(pass) << 62;
+    if (pass == DrawPass::Transparent) {
+        key |= static_cast<uint64_t>(~depth) << 30;
+        key |= static_cast<uint64_t>(pipeline) << 20;
+        key |= material;
+    } else {
+        key |= static_cast<uint64_t>(pipeline) << 52;
+        key |= static_cast<uint64_t>(material) << 32;
+        key |= depth;
+    }
+    return key;
+}
+
+void radixSortDrawKeys(std::span<DrawKey> keys, std::span<DrawKey> scratch) {
+    const size_t count = keys.size();
+    if (count < 2) {
+        return;
+    }
+    if (scratch.size() < count) {
+        throw std::runtime_error("radixSortDrawKeys: scratch smaller than the keys");
+    }
+
+    // One read for all eight byte histograms
+    uint32_t histograms[8][256] = {};
+    for (const DrawKey& k : keys) {
+        for (int digit = 0; digit < 8; ++digit) {
+            histograms[digit][(k.key >> (digit * 8)) & 0xFF]++;
+        }
+    }
+
+    DrawKey* src = keys.data();
+    DrawKey* dst = scratch.data();
+    for (int digit = 0; digit < 8; ++digit) {
+        uint32_t* histogram = histograms[digit];
+        const int shift = digit * 8;
+        // Every key has the same byte here (e.g. unused pipeline bits), nothing would move
+        if (histogram[(src[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket) {
+            uint32_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != keys.data()) {
+        std::copy(src, src + count, keys.data());
+    }
+}
+
+} // namespace astral
@@ -32,6 +32,13 @@ EnvironmentManager::~EnvironmentManager() {
   // Resources are managed by unique_ptrs
 }
 
+BindlessHandle EnvironmentManager::registerScratch(uint32_t binding,
+                                                   uint32_t index) {
+  m_scratchSlots.push_back(
+      m_context->getDescriptorManager().getHandle(binding, index));
+  return m_scratchSlots.back();
+}
+
 void EnvironmentManager::loadHDR(const std::string &path) {
   if (!std::filesystem::exists(path)) {
     spdlog::warn("Skybox HDR not found at: {}. IBL will be disabled.", path);
@@ -39,15 +46,26 @@ void EnvironmentManager::loadHDR(const std::string &path) {
   }
   spdlog::info("Loading HDR environment map: {}", path);
   int width, height, channels;
-  stbi_set_flip_vertically_on_load(true);
+  stbi_set_flip_vertically_on_load_thread(true); // Global flag would race the texture decode threads
   float *data = stbi_loadf(path.c_str(), &width, &height, &channels, 4);
-  stbi_set_flip_vertically_on_load(false);
+  stbi_set_flip_vertically_on_load_thread(false);
 
   if (!data) {
     spdlog::error("Failed to load HDR image: {}", path);
     return;
   }
 
+  auto &descriptorManager = m_context->getDescriptorManager();
+  if (m_skybox) {
+    // Reload: frames in flight still sample the old maps
+    vkDeviceWaitIdle(m_context->getDevice());
+    for (BindlessHandle *slot : {&m_skyboxSlot, &m_irradianceSlot,
+                                 &m_prefilteredSlot, &m_brdfLutSlot}) {
+      descriptorManager.release(*slot);
+      *slot = BindlessHandle{};
+    }
+  }
+
   ImageSpecs equirectSpecs;
   equirectSpecs.width = static_cast<uint32_t>(width);
   equirectSpecs.height = static_cast<uint32_t>(height);
@@ -67,6 +85,16 @@ void EnvironmentManager::loadHDR(const std::string &path) {
   generatePrefiltered();
   generateBrdfLut();
 
+  // Every generation pass waited for the queue, nothing references these anymore
+  for (const BindlessHandle &slot : m_scratchSlots) {
+    descriptorManager.release(slot);
+  }
+  for (VkImageView view : m_scratchViews) {
+    vkDestroyImageView(m_context->getDevice(), view, nullptr);
+  }
+  m_scratchSlots.clear();
+  m_scratchViews.clear();
+
   spdlog::info("Environment IBL maps generated successfully.");
 }
 
@@ -96,12 +124,18 @@ void EnvironmentManager::convertEquirectToCube(
   VkSampler sampler;
   vkCreateSampler(m_context->getDevice(), &samplerInfo, nullptr, &sampler);
 
-  uint32_t equirectIdx = m_context->getDescriptorManager().registerImage(
-      equirect->getView(), sampler);
-  uint32_t cubeIdx = m_context->getDescriptorManager().registerStorageImage(
-      m_skybox->getView());
-  m_skyboxIndex = m_context->getDescriptorManager().registerImageCube(
-      m_skybox->getView(), sampler);
+  auto &descriptorManager = m_context->getDescriptorManager();
+  uint32_t equirectIdx =
+      registerScratch(DescriptorManager::IMAGE_BINDING,
+                      descriptorManager.registerImage(equirect->getView(), sampler))
+          .index;
+  uint32_t cubeIdx =
+      registerScratch(DescriptorManager::STORAGE_IMAGE_BINDING,
+                      descriptorManager.registerStorageImage(m_skybox->getView()))
+          .index;
+  m_skyboxSlot = descriptorManager.getHandle(
+      DescriptorManager::CUBE_IMAGE_BINDING,
+      descriptorManager.registerImageCube(m_skybox->getView(), sampler));
 
   auto compShader = std::make_shared<Shader>(
       m_context, readFile("assets/shaders/equirect_to_cube.comp.spv"),
@@ -199,10 +233,14 @@ void EnvironmentManager::generateIrradiance() {
   VkSampler sampler;
   vkCreateSampler(m_context->getDevice(), &samplerInfo, nullptr, &sampler);
 
-  uint32_t outputIdx = m_context->getDescriptorManager().registerStorageImage(
-      m_irradiance->getView());
-  m_irradianceIndex = m_context->getDescriptorManager().registerImageCube(
-      m_irradiance->getView(), sampler);
+  auto &descriptorManager = m_context->getDescriptorManager();
+  uint32_t outputIdx =
+      registerScratch(DescriptorManager::STORAGE_IMAGE_BINDING,
+                      descriptorManager.registerStorageImage(m_irradiance->getView()))
+          .index;
+  m_irradianceSlot = descriptorManager.getHandle(
+      DescriptorManager::CUBE_IMAGE_BINDING,
+      descriptorManager.registerImageCube(m_irradiance->getView(), sampler));
 
   auto compShader = std::make_shared<Shader>(
       m_context, readFile("assets/shaders/irradiance.comp.spv"),
@@ -254,7 +292,7 @@ void EnvironmentManager::generateIrradiance() {
   vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1,
                           &set, 0, nullptr);
 
-  uint32_t pcs[] = {m_skyboxIndex, outputIdx};
+  uint32_t pcs[] = {m_skyboxSlot.index, outputIdx};
   vkCmdPushConstants(cb, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pcs),
                      pcs);
 
@@ -305,8 +343,10 @@ void EnvironmentManager::generatePrefiltered() {
   VkSampler sampler;
   vkCreateSampler(m_context->getDevice(), &samplerInfo, nullptr, &sampler);
 
-  m_prefilteredIndex = m_context->getDescriptorManager().registerImageCube(
-      m_prefiltered->getView(), sampler);
+  auto &descriptorManager = m_context->getDescriptorManager();
+  m_prefilteredSlot = descriptorManager.getHandle(
+      DescriptorManager::CUBE_IMAGE_BINDING,
+      descriptorManager.registerImageCube(m_prefiltered->getView(), sampler));
 
   auto compShader = std::make_shared<Shader>(
       m_context, readFile("assets/shaders/prefilter.comp.spv"),
@@ -371,8 +411,11 @@ void EnvironmentManager::generatePrefiltered() {
 
     VkImageView mipView;
     vkCreateImageView(m_context->getDevice(), &viewInfo, nullptr, &mipView);
+    m_scratchViews.push_back(mipView);
     uint32_t mipOutputIdx =
-        m_context->getDescriptorManager().registerStorageImage(mipView);
+        registerScratch(DescriptorManager::STORAGE_IMAGE_BINDING,
+                        descriptorManager.registerStorageImage(mipView))
+            .index;
 
     vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getHandle());
     VkDescriptorSet set = m_context->getDescriptorManager().getDescriptorSet();
@@ -384,7 +427,7 @@ void EnvironmentManager::generatePrefiltered() {
       uint32_t outputIdx;
       float roughness;
     } pc;
-    pc.inputIdx = m_skyboxIndex;
+    pc.inputIdx = m_skyboxSlot.index;
     pc.outputIdx = mipOutputIdx;
     pc.roughness = roughness;
     vkCmdPushConstants(cb, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
@@ -392,10 +435,6 @@ void EnvironmentManager::generatePrefiltered() {
 
     vkCmdDispatch(cb, std::max(1u, mipWidth / 16), std::max(1u, mipHeight / 16),
                   6);
-
-    // Note: In a production renderer, we would cleanup these views or reuse
-    // them. For now we just let them leak as this is a one-time startup
-    // operation.
   }
 
   // Barrier for prefiltered generation
@@ -436,10 +475,14 @@ void EnvironmentManager::generateBrdfLut() {
   VkSampler sampler;
   vkCreateSampler(m_context->getDevice(), &samplerInfo, nullptr, &sampler);
 
-  uint32_t outputIdx = m_context->getDescriptorManager().registerStorageImage(
-      m_brdfLut->getView());
-  m_brdfLutIndex = m_context->getDescriptorManager().registerImage(
-      m_brdfLut->getView(), sampler);
+  auto &descriptorManager = m_context->getDescriptorManager();
+  uint32_t outputIdx =
+      registerScratch(DescriptorManager::STORAGE_IMAGE_BINDING,
+                      descriptorManager.registerStorageImage(m_brdfLut->getView()))
+          .index;
+  m_brdfLutSlot = descriptorManager.getHandle(
+      DescriptorManager::IMAGE_BINDING,
+      descriptorManager.registerImage(m_brdfLut->getView(), sampler));
 
   auto compShader = std::make_shared<Shader>(
       m_context, readFile("assets/shaders/brdf_lut.comp.spv"),
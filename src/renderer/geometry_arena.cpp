@@ -0,0 +1,304 @@
+#include "astral/renderer/geometry_arena.hpp"
+#include "astral/renderer/descriptor_manager.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace astral {
+
+namespace {
+
+// Every stream is also a storage buffer, the visibility resolve fetches its triangles by hand
+constexpr VkBufferUsageFlags VERTEX_USAGE = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+constexpr VkBufferUsageFlags INDEX_USAGE = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+constexpr VkBufferUsageFlags MESHLET_USAGE = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+constexpr uint32_t GEOMETRY_BINDING = 6; // Next to the instance data that points into it
+
+} // namespace
+
+GeometryArena::RangeList::RangeList(uint32_t capacity) : m_capacity(capacity), m_free(capacity) {
+    if (capacity > 0) {
+        m_ranges[0] = capacity;
+    }
+}
+
+uint32_t GeometryArena::RangeList::allocate(uint32_t count) {
+    if (count == 0) {
+        return 0;
+    }
+    for (auto it = m_ranges.begin(); it != m_ranges.end(); ++it) {
+        if (it->second < count) {
+            continue;
+        }
+        uint32_t offset = it->first;
+        uint32_t remaining = it->second - count;
+        m_ranges.erase(it);
+        if (remaining > 0) {
+            m_ranges[offset + count] = remaining;
+        }
+        m_free -= count;
+        return offset;
+    }
+    return UINT32_MAX;
+}
+
+void GeometryArena::RangeList::release(uint32_t offset, uint32_t count) {
+    if (count == 0) {
+        return;
+    }
+    m_free += count;
+    auto next = m_ranges.lower_bound(offset);
+    if (next != m_ranges.end() && offset + count == next->first) {
+        count += next->second;
+        next = m_ranges.erase(next);
+    }
+    if (next != m_ranges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += count;
+            return;
+        }
+    }
+    m_ranges[offset] = count;
+}
+
+void GeometryArena::RangeList::grow(uint32_t newCapacity) {
+    uint32_t added = newCapacity - m_capacity;
+    uint32_t oldCapacity = m_capacity;
+    m_capacity = newCapacity;
+    release(oldCapacity, added);
+}
+
+void GeometryArena::RangeList::reset(uint32_t used) {
+    m_ranges.clear();
+    m_free = m_capacity - used;
+    if (m_free > 0) {
+        m_ranges[used] = m_free;
+    }
+}
+
+GeometryArena::GeometryArena(Context* context, uint32_t initialVertexCapacity, uint32_t initialIndexCapacity,
+                             uint32_t initialMeshletCapacity)
+    : m_context(context), m_vertexRanges(initialVertexCapacity), m_indexRanges(initialIndexCapacity),
+      m_meshletRanges(initialMeshletCapacity) {
+    m_positionBuffer = createBuffer(static_cast<VkDeviceSize>(initialVertexCapacity) * sizeof(glm::vec3), VERTEX_USAGE);
+    m_attributeBuffer = createBuffer(static_cast<VkDeviceSize>(initialVertexCapacity) * sizeof(PackedVertex), VERTEX_USAGE);
+    m_indexBuffer = createBuffer(static_cast<VkDeviceSize>(initialIndexCapacity) * sizeof(uint32_t), INDEX_USAGE);
+    m_meshletBuffer = createBuffer(static_cast<VkDeviceSize>(initialMeshletCapacity) * sizeof(Meshlet), MESHLET_USAGE);
+
+    auto& descriptorManager = m_context->getDescriptorManager();
+    m_positionBufferIndex = descriptorManager.reserveBuffer(GEOMETRY_BINDING);
+    m_attributeBufferIndex = descriptorManager.reserveBuffer(GEOMETRY_BINDING);
+    m_indexBufferIndex = descriptorManager.reserveBuffer(GEOMETRY_BINDING);
+    m_meshletBufferIndex = descriptorManager.reserveBuffer(GEOMETRY_BINDING);
+    updateDescriptors();
+}
+
+void GeometryArena::updateDescriptors() {
+    auto& descriptorManager = m_context->getDescriptorManager();
+    descriptorManager.updateBuffer(m_positionBufferIndex, m_positionBuffer->getHandle(), 0, m_positionBuffer->getSize(),
+                                   GEOMETRY_BINDING);
+    descriptorManager.updateBuffer(m_attributeBufferIndex, m_attributeBuffer->getHandle(), 0,
+                                   m_attributeBuffer->getSize(), GEOMETRY_BINDING);
+    descriptorManager.updateBuffer(m_indexBufferIndex, m_indexBuffer->getHandle(), 0, m_indexBuffer->getSize(),
+                                   GEOMETRY_BINDING);
+    descriptorManager.updateBuffer(m_meshletBufferIndex, m_meshletBuffer->getHandle(), 0, m_meshletBuffer->getSize(),
+                                   GEOMETRY_BINDING);
+}
+
+std::unique_ptr<Buffer> GeometryArena::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage) const {
+    auto buffer = std::make_unique<Buffer>(m_context, std::max<VkDeviceSize>(size, 16), usage,
+                                           VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    if (!buffer->getMappedData()) {
+        throw std::runtime_error("Failed to persistently map geometry arena!");
+    }
+    return buffer;
+}
+
+void GeometryArena::growBuffer(std::unique_ptr<Buffer>& buffer, VkDeviceSize newSize, VkBufferUsageFlags usage) {
+    auto grown = createBuffer(newSize, usage);
+    memcpy(grown->getMappedData(), buffer->getMappedData(), buffer->getSize());
+    grown->flush(0, buffer->getSize());
+    buffer = std::move(grown);
+}
+
+GeometryHandle GeometryArena::allocate(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                                       std::span<const Meshlet> meshlets) {
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    const uint32_t indexCount = static_cast<uint32_t>(indices.size());
+    const uint32_t meshletCount = static_cast<uint32_t>(meshlets.size());
+
+    uint32_t vertexOffset = m_vertexRanges.allocate(vertexCount);
+    uint32_t firstIndex = m_indexRanges.allocate(indexCount);
+    uint32_t firstMeshlet = m_meshletRanges.allocate(meshletCount);
+    if (vertexOffset == UINT32_MAX || firstIndex == UINT32_MAX || firstMeshlet == UINT32_MAX) {
+        // Hand back whatever succeeded, then make room for all of it
+        if (vertexOffset != UINT32_MAX) {
+            m_vertexRanges.release(vertexOffset, vertexCount);
+        }
+        if (firstIndex != UINT32_MAX) {
+            m_indexRanges.release(firstIndex, indexCount);
+        }
+        if (firstMeshlet != UINT32_MAX) {
+            m_meshletRanges.release(firstMeshlet, meshletCount);
+        }
+
+        // Frames in flight draw from the current layout
+        vkDeviceWaitIdle(m_context->getDevice());
+        if (m_vertexRanges.getFree() >= vertexCount && m_indexRanges.getFree() >= indexCount &&
+            m_meshletRanges.getFree() >= meshletCount) {
+            defragment();
+        }
+        if (m_vertexRanges.getFree() < vertexCount) {
+            uint32_t capacity = std::max(m_vertexRanges.getCapacity() * 2, m_vertexRanges.getUsed() + vertexCount);
+            growBuffer(m_positionBuffer, static_cast<VkDeviceSize>(capacity) * sizeof(glm::vec3), VERTEX_USAGE);
+            growBuffer(m_attributeBuffer, static_cast<VkDeviceSize>(capacity) * sizeof(PackedVertex), VERTEX_USAGE);
+            m_vertexRanges.grow(capacity);
+        }
+        if (m_indexRanges.getFree() < indexCount) {
+            uint32_t capacity = std::max(m_indexRanges.getCapacity() * 2, m_indexRanges.getUsed() + indexCount);
+            growBuffer(m_indexBuffer, static_cast<VkDeviceSize>(capacity) * sizeof(uint32_t), INDEX_USAGE);
+            m_indexRanges.grow(capacity);
+        }
+        if (m_meshletRanges.getFree() < meshletCount) {
+            uint32_t capacity = std::max(m_meshletRanges.getCapacity() * 2, m_meshletRanges.getUsed() + meshletCount);
+            growBuffer(m_meshletBuffer, static_cast<VkDeviceSize>(capacity) * sizeof(Meshlet), MESHLET_USAGE);
+            m_meshletRanges.grow(capacity);
+        }
+        // The device is idle, the slots can be rewritten in place
+        updateDescriptors();
+        m_layoutVersion++;
+        spdlog::info("GeometryArena: resized to {} vertices / {} indices / {} meshlets ({:.1f} MB)",
+                     m_vertexRanges.getCapacity(), m_indexRanges.getCapacity(), m_meshletRanges.getCapacity(),
+                     (m_positionBuffer->getSize() + m_attributeBuffer->getSize() + m_indexBuffer->getSize() +
+                      m_meshletBuffer->getSize()) / (1024.0 * 1024.0));
+
+        vertexOffset = m_vertexRanges.allocate(vertexCount);
+        firstIndex = m_indexRanges.allocate(indexCount);
+        firstMeshlet = m_meshletRanges.allocate(meshletCount);
+        if (vertexOffset == UINT32_MAX || firstIndex == UINT32_MAX || firstMeshlet == UINT32_MAX) {
+            throw std::runtime_error("GeometryArena: allocation failed after growing!");
+        }
+    }
+
+    // Written straight into the mapped (write-combined) memory, strictly sequential
+    auto* positions = static_cast<glm::vec3*>(m_positionBuffer->getMappedData()) + vertexOffset;
+    auto* attributes = static_cast<PackedVertex*>(m_attributeBuffer->getMappedData()) + vertexOffset;
+    for (uint32_t i = 0; i < vertexCount; ++i) {
+        positions[i] = vertices[i].position;
+    }
+    for (uint32_t i = 0; i < vertexCount; ++i) {
+        attributes[i] = PackedVertex::pack(vertices[i]);
+    }
+    memcpy(static_cast<uint32_t*>(m_indexBuffer->getMappedData()) + firstIndex, indices.data(), indices.size_bytes());
+    memcpy(static_cast<Meshlet*>(m_meshletBuffer->getMappedData()) + firstMeshlet, meshlets.data(), meshlets.size_bytes());
+    m_positionBuffer->flush(static_cast<VkDeviceSize>(vertexOffset) * sizeof(glm::vec3), vertexCount * sizeof(glm::vec3));
+    m_attributeBuffer->flush(static_cast<VkDeviceSize>(vertexOffset) * sizeof(PackedVertex),
+                             vertexCount * sizeof(PackedVertex));
+    m_indexBuffer->flush(static_cast<VkDeviceSize>(firstIndex) * sizeof(uint32_t), indices.size_bytes());
+    m_meshletBuffer->flush(static_cast<VkDeviceSize>(firstMeshlet) * sizeof(Meshlet), meshlets.size_bytes());
+
+    GeometryAllocation allocation{vertexOffset, vertexCount, firstIndex, indexCount, firstMeshlet, meshletCount};
+    GeometryHandle handle;
+    if (!m_freeHandles.empty()) {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+        m_allocations[handle] = allocation;
+        m_live[handle] = true;
+    } else {
+        handle = static_cast<GeometryHandle>(m_allocations.size());
+        m_allocations.push_back(allocation);
+        m_live.push_back(true);
+    }
+    return handle;
+}
+
+void GeometryArena::free(GeometryHandle handle) {
+    if (handle >= m_allocations.size() || !m_live[handle]) {
+        return;
+    }
+    const GeometryAllocation& allocation = m_allocations[handle];
+    m_vertexRanges.release(allocation.vertexOffset, allocation.vertexCount);
+    m_indexRanges.release(allocation.firstIndex, allocation.indexCount);
+    m_meshletRanges.release(allocation.firstMeshlet, allocation.meshletCount);
+    m_live[handle] = false;
+    m_freeHandles.push_back(handle);
+}
+
+bool GeometryArena::defragment() {
+    std::vector<GeometryHandle> live;
+    for (GeometryHandle handle = 0; handle < m_allocations.size(); ++handle) {
+        if (m_live[handle]) {
+            live.push_back(handle);
+        }
+    }
+
+    // Sliding each allocation down in offset order never overwrites one not yet moved
+    auto* positions = static_cast<glm::vec3*>(m_positionBuffer->getMappedData());
+    auto* attributes = static_cast<PackedVertex*>(m_attributeBuffer->getMappedData());
+    auto* indices = static_cast<uint32_t*>(m_indexBuffer->getMappedData());
+    bool moved = false;
+
+    std::sort(live.begin(), live.end(), [&](GeometryHandle a, GeometryHandle b) {
+        return m_allocations[a].vertexOffset < m_allocations[b].vertexOffset;
+    });
+    uint32_t vertexHead = 0;
+    for (GeometryHandle handle : live) {
+        GeometryAllocation& allocation = m_allocations[handle];
+        if (allocation.vertexOffset != vertexHead) {
+            memmove(positions + vertexHead, positions + allocation.vertexOffset,
+                    allocation.vertexCount * sizeof(glm::vec3));
+            memmove(attributes + vertexHead, attributes + allocation.vertexOffset,
+                    allocation.vertexCount * sizeof(PackedVertex));
+            allocation.vertexOffset = vertexHead;
+            moved = true;
+        }
+        vertexHead += allocation.vertexCount;
+    }
+
+    std::sort(live.begin(), live.end(), [&](GeometryHandle a, GeometryHandle b) {
+        return m_allocations[a].firstIndex < m_allocations[b].firstIndex;
+    });
+    uint32_t indexHead = 0;
+    for (GeometryHandle handle : live) {
+        GeometryAllocation& allocation = m_allocations[handle];
+        if (allocation.firstIndex != indexHead) {
+            memmove(indices + indexHead, indices + allocation.firstIndex, allocation.indexCount * sizeof(uint32_t));
+            allocation.firstIndex = indexHead;
+            moved = true;
+        }
+        indexHead += allocation.indexCount;
+    }
+
+    auto* meshletData = static_cast<Meshlet*>(m_meshletBuffer->getMappedData());
+    std::sort(live.begin(), live.end(), [&](GeometryHandle a, GeometryHandle b) {
+        return m_allocations[a].firstMeshlet < m_allocations[b].firstMeshlet;
+    });
+    uint32_t meshletHead = 0;
+    for (GeometryHandle handle : live) {
+        GeometryAllocation& allocation = m_allocations[handle];
+        if (allocation.firstMeshlet != meshletHead) {
+            memmove(meshletData + meshletHead, meshletData + allocation.firstMeshlet,
+                    allocation.meshletCount * sizeof(Meshlet));
+            allocation.firstMeshlet = meshletHead;
+            moved = true;
+        }
+        meshletHead += allocation.meshletCount;
+    }
+
+    m_vertexRanges.reset(vertexHead);
+    m_indexRanges.reset(indexHead);
+    m_meshletRanges.reset(meshletHead);
+    if (moved) {
+        m_positionBuffer->flush(0, static_cast<VkDeviceSize>(vertexHead) * sizeof(glm::vec3));
+        m_attributeBuffer->flush(0, static_cast<VkDeviceSize>(vertexHead) * sizeof(PackedVertex));
+        m_indexBuffer->flush(0, static_cast<VkDeviceSize>(indexHead) * sizeof(uint32_t));
+        m_meshletBuffer->flush(0, static_cast<VkDeviceSize>(meshletHead) * sizeof(Meshlet));
+        m_layoutVersion++;
+        spdlog::info("GeometryArena: compacted {} allocations", live.size());
+    }
+    return moved;
+}
+
+} // namespace astral
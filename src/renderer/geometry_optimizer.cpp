@@ -0,0 +1,352 @@
+#include "astral/renderer/geometry_optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+namespace astral {
+
+namespace {
+
+// Cache model the triangle order is optimized for (LRU), and the one it's measured with (FIFO,
+// what most hardware is closer to)
+constexpr uint32_t OPTIMIZER_CACHE_SIZE = 32;
+constexpr uint32_t ANALYZER_CACHE_SIZE = 16;
+
+// Forsyth's scoring: recently used vertices score high (the last triangle's a bit lower, it
+// would just get the same three again), vertices with few triangles left get a boost so
+// they're finished off instead of being left as stragglers
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+// Index ranges of every primitive LOD, in model index space
+struct IndexRange {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+std::vector<IndexRange> collectRanges(const ModelData& data) {
+    std::vector<IndexRange> ranges;
+    for (const auto& mesh : data.meshes) {
+        for (const auto& primitive : mesh.primitives) {
+            for (uint32_t level = 0; level < primitive.lodCount; ++level) {
+                PrimitiveLod lod = primitive.getLod(level);
+                ranges.push_back({lod.firstIndex, lod.indexCount / 3 * 3});
+            }
+        }
+    }
+    return ranges;
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, const std::vector<IndexRange>& ranges,
+                                    size_t vertexCount) {
+    // A vertex is in the FIFO if it missed less than ANALYZER_CACHE_SIZE misses ago
+    std::vector<uint32_t> missTime(vertexCount, 0);
+    std::vector<uint32_t> seenInRange(vertexCount, UINT32_MAX);
+    uint64_t misses = 0;
+    uint64_t triangles = 0;
+    uint64_t uniqueVertices = 0;
+
+    uint32_t clock = ANALYZER_CACHE_SIZE + 1;
+    for (uint32_t r = 0; r < ranges.size(); ++r) {
+        clock += ANALYZER_CACHE_SIZE + 1; // Cold for every draw
+        for (uint32_t i = 0; i < ranges[r].indexCount; ++i) {
+            uint32_t index = indices[ranges[r].firstIndex + i];
+            if (clock - missTime[index] > ANALYZER_CACHE_SIZE) {
+                missTime[index] = clock++;
+                misses++;
+            }
+            if (seenInRange[index] != r) {
+                seenInRange[index] = r;
+                uniqueVertices++;
+            }
+        }
+        triangles += ranges[r].indexCount / 3;
+    }
+
+    VertexCacheStats stats;
+    if (triangles > 0) {
+        stats.acmr = static_cast<float>(misses) / static_cast<float>(triangles);
+        stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    }
+    return stats;
+}
+
+float vertexScore(int32_t cachePosition, uint32_t remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f; // Done, no triangle left to pick through it
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            score = LAST_TRIANGLE_SCORE;
+        } else {
+            float scale = 1.0f / static_cast<float>(OPTIMIZER_CACHE_SIZE - 3);
+            score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scale, CACHE_DECAY_POWER);
+        }
+    }
+    return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+}
+
+// Greedy: always emit the best scoring triangle around the simulated cache, fall back to a
+// linear scan when none of those has any left. Indices are local (dense) vertex ids.
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount) {
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Triangles around each vertex, the first 'remaining' of a vertex's list aren't emitted yet
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (uint32_t index : indices) {
+        offsets[index + 1]++;
+    }
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    std::vector<uint32_t> adjacency(indices.size());
+    for (uint32_t i = 0; i < indices.size(); ++i) {
+        uint32_t vertex = indices[i];
+        adjacency[offsets[vertex] + remaining[vertex]++] = i / 3;
+    }
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        vertexScores[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                            vertexScores[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(OPTIMIZER_CACHE_SIZE + 3);
+    nextCache.reserve(OPTIMIZER_CACHE_SIZE + 3);
+
+    uint32_t best = static_cast<uint32_t>(
+        std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    uint32_t scanCursor = 0;
+
+    while (result.size() < indices.size()) {
+        if (best == UINT32_MAX) {
+            // Nothing in the cache has triangles left, start over at the next unemitted one
+            while (emitted[scanCursor]) {
+                scanCursor++;
+            }
+            best = scanCursor;
+        }
+
+        const uint32_t* triangle = &indices[best * 3];
+        emitted[best] = 1;
+        result.insert(result.end(), triangle, triangle + 3);
+
+        // Off the vertices' remaining lists
+        for (uint32_t k = 0; k < 3; ++k) {
+            uint32_t vertex = triangle[k];
+            uint32_t* list = &adjacency[offsets[vertex]];
+            uint32_t* last = list + remaining[vertex];
+            *std::find(list, last, best) = *(last - 1);
+            remaining[vertex]--;
+        }
+
+        // LRU update: the triangle's vertices to the front, the rest shifted back
+        nextCache.assign(triangle, triangle + 3);
+        for (uint32_t vertex : cache) {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                nextCache.push_back(vertex);
+            }
+        }
+        std::swap(cache, nextCache);
+        for (uint32_t i = 0; i < cache.size(); ++i) {
+            cachePosition[cache[i]] = i < OPTIMIZER_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+        }
+
+        // Rescore what the cache touched, the best of their triangles goes next
+        best = UINT32_MAX;
+        float bestScore = -1.0f;
+        for (uint32_t vertex : cache) {
+            vertexScores[vertex] = vertexScore(cachePosition[vertex], remaining[vertex]);
+        }
+        for (uint32_t vertex : cache) {
+            for (uint32_t i = 0; i < remaining[vertex]; ++i) {
+                uint32_t t = adjacency[offsets[vertex] + i];
+                float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                              vertexScores[indices[t * 3 + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+        if (cache.size() > OPTIMIZER_CACHE_SIZE) {
+            cache.resize(OPTIMIZER_CACHE_SIZE);
+        }
+    }
+
+    indices = std::move(result);
+}
+
+// Splits the cache ordered triangles where the (FIFO) cache would restart anyway and sorts
+// those clusters by how far out they face from the range's centroid, keeping the order inside.
+// Outward facing clusters on the hull then draw first and reject the rest by depth.
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions) {
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount < 2) {
+        return;
+    }
+
+    std::vector<uint32_t> clusterStarts;
+    std::vector<uint32_t> missTime(positions.size(), 0);
+    uint32_t clock = ANALYZER_CACHE_SIZE + 1;
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        uint32_t misses = 0;
+        for (uint32_t k = 0; k < 3; ++k) {
+            uint32_t index = indices[t * 3 + k];
+            if (clock - missTime[index] > ANALYZER_CACHE_SIZE) {
+                missTime[index] = clock++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3) {
+            clusterStarts.push_back(t);
+        }
+    }
+    if (clusterStarts.size() < 2) {
+        return;
+    }
+
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    struct Cluster {
+        uint32_t first;
+        uint32_t count;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters(clusterStarts.size());
+    std::vector<glm::vec3> clusterCentroids(clusters.size());
+    std::vector<glm::vec3> clusterNormals(clusters.size());
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        uint32_t first = clusterStarts[c];
+        uint32_t end = c + 1 < clusters.size() ? clusterStarts[c + 1] : triangleCount;
+        clusters[c] = {first, end - first, 0.0f};
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (uint32_t t = first; t < end; ++t) {
+            const glm::vec3& a = positions[indices[t * 3]];
+            const glm::vec3& b = positions[indices[t * 3 + 1]];
+            const glm::vec3& d = positions[indices[t * 3 + 2]];
+            glm::vec3 cross = glm::cross(b - a, d - a);
+            float triangleArea = glm::length(cross);
+            centroid += (a + b + d) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        clusterCentroids[c] = area > 0.0f ? centroid / area : centroid;
+        float normalLength = glm::length(normal);
+        clusterNormals[c] = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+    }
+    if (meshArea <= 0.0f) {
+        return;
+    }
+    meshCentroid /= meshArea;
+
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        clusters[c].sortKey = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]);
+    }
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const Cluster& cluster : clusters) {
+        result.insert(result.end(), indices.begin() + cluster.first * 3,
+                      indices.begin() + (cluster.first + cluster.count) * 3);
+    }
+    indices = std::move(result);
+}
+
+} // namespace
+
+GeometryOptimizationReport optimizeGeometry(ModelData& data) {
+    // Indices and vertices are rewritten in place, fresh imports already view the storage
+    if (data.indices.data() != data.indexStorage.data()) {
+        data.indexStorage.assign(data.indices.begin(), data.indices.end());
+    }
+    if (data.vertices.data() != data.vertexStorage.data()) {
+        data.vertexStorage.assign(data.vertices.begin(), data.vertices.end());
+    }
+
+    GeometryOptimizationReport report;
+    const std::vector<IndexRange> ranges = collectRanges(data);
+    std::vector<uint32_t>& indices = data.indexStorage;
+    const size_t vertexCount = data.vertexStorage.size();
+    report.before = analyzeVertexCache(indices, ranges, vertexCount);
+
+    // Ranges are optimized in compact local vertex ids
+    std::vector<uint32_t> globalToLocal(vertexCount, UINT32_MAX);
+    std::vector<uint32_t> localToGlobal;
+    std::vector<uint32_t> local;
+    std::vector<glm::vec3> localPositions;
+    for (const IndexRange& range : ranges) {
+        localToGlobal.clear();
+        local.resize(range.indexCount);
+        for (uint32_t i = 0; i < range.indexCount; ++i) {
+            uint32_t global = indices[range.firstIndex + i];
+            if (globalToLocal[global] == UINT32_MAX) {
+                globalToLocal[global] = static_cast<uint32_t>(localToGlobal.size());
+                localToGlobal.push_back(global);
+            }
+            local[i] = globalToLocal[global];
+        }
+        localPositions.resize(localToGlobal.size());
+        for (size_t v = 0; v < localToGlobal.size(); ++v) {
+            localPositions[v] = data.vertexStorage[localToGlobal[v]].position;
+            globalToLocal[localToGlobal[v]] = UINT32_MAX;
+        }
+
+        optimizeVertexCache(local, static_cast<uint32_t>(localToGlobal.size()));
+        optimizeOverdraw(local, localPositions);
+
+        for (uint32_t i = 0; i < range.indexCount; ++i) {
+            indices[range.firstIndex + i] = localToGlobal[local[i]];
+        }
+    }
+
+    // Vertices in the order the index buffer first reaches them
+    std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    uint32_t nextVertex = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = nextVertex++;
+        }
+        index = remap[index];
+    }
+    std::vector<Vertex> vertices(nextVertex);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (remap[v] != UINT32_MAX) {
+            vertices[remap[v]] = data.vertexStorage[v];
+        }
+    }
+    report.droppedVertices = static_cast<uint32_t>(vertexCount) - nextVertex;
+    data.vertexStorage = std::move(vertices);
+    data.adoptStorage();
+
+    report.after = analyzeVertexCache(indices, ranges, data.vertexStorage.size());
+    return report;
+}
+
+} // namespace astral
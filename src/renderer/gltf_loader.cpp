@@ -1,29 +1,18 @@
 #include "astral/renderer/gltf_loader.hpp"
-#include "astral/renderer/asset_manager.hpp"
-#include "astral/core/context.hpp"
-#include "astral/renderer/scene_manager.hpp"
-#include "astral/renderer/descriptor_manager.hpp"
 #include <fastgltf/core.hpp>
 #include <fastgltf/types.hpp>
 #include <fastgltf/glm_element_traits.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <stb_image.h>
 #include <spdlog/spdlog.h>
 #include <fstream>
+#include <functional>
 #include <memory>
 #include <vulkan/vulkan.h>
-#include "astral/resources/image.hpp"
 
 namespace astral {
 
-GltfLoader::GltfLoader(Context* context) : m_context(context) {
-    // No default sampler creation
-}
-
-GltfLoader::~GltfLoader() {
-    // Samplers managed by AssetManager
-}
-
 bool GltfLoader::supportsExtension(const std::string& extension) const {
     return extension == ".gltf" || extension == ".glb";
 }
@@ -65,7 +54,7 @@ static VkSamplerAddressMode getVkWrapMode(fastgltf::Wrap wrap) {
 
 // createDefaultSampler removed
 
-std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, SceneManager* sceneManager, AssetManager* assetManager) {
+std::unique_ptr<ModelData> GltfLoader::import(const std::filesystem::path& path) {
     if (!std::filesystem::exists(path)) {
         spdlog::error("glTF file not found: {}", path.string());
         return nullptr;
@@ -88,13 +77,12 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
     }
 
     auto& asset = expectedAsset.get();
-    auto model = std::make_unique<Model>();
-    
-    // 1. Sampler'ları Yükle
+    auto model = std::make_unique<ModelData>();
+
     // 1. Sampler'ları Yükle
-    std::vector<VkSampler> loadedSamplers;
+    std::vector<SamplerSpecs> loadedSamplers;
     loadedSamplers.reserve(asset.samplers.size());
-    
+
     for (auto& gltfSampler : asset.samplers) {
         SamplerSpecs specs;
         specs.magFilter = gltfSampler.magFilter.has_value() ? getVkFilter(gltfSampler.magFilter.value()) : VK_FILTER_LINEAR;
@@ -106,13 +94,10 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
         specs.anisotropyEnable = true;
         specs.maxAnisotropy = 16.0f;
 
-        loadedSamplers.push_back(assetManager->getSampler(specs));
+        loadedSamplers.push_back(specs);
     }
-    
-    SamplerSpecs defaultSpecs;
-    VkSampler defaultSampler = assetManager->getSampler(defaultSpecs);
 
-    // 2. Image'ları Yükle (Ham veriler)
+    // 2. Image'ları Yükle (sadece kaynaklar, decode AssetManager'da)
     // 2.1 USAGE Pre-pass to determine fallback types and formats
     std::vector<TextureType> imageTypes(asset.images.size(), TextureType::Albedo);
     for (auto& gltfMat : asset.materials) {
@@ -129,7 +114,7 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
         checkTex(gltfMat.normalTexture, TextureType::Normal);
         checkTex(gltfMat.occlusionTexture, TextureType::Occlusion);
         checkTex(gltfMat.emissiveTexture, TextureType::Emissive);
-        
+
         if (gltfMat.transmission) {
             checkTex(gltfMat.transmission->transmissionTexture, TextureType::Transmission);
         }
@@ -138,20 +123,19 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
         }
     }
 
-    std::vector<std::shared_ptr<Image>> loadedImages;
-    loadedImages.reserve(asset.images.size());
+    model->images.resize(asset.images.size());
     for (size_t i = 0; i < asset.images.size(); ++i) {
         auto& gltfImage = asset.images[i];
-        std::shared_ptr<Image> image;
-        TextureType type = imageTypes[i];
-        
+        auto& image = model->images[i];
+        image.type = imageTypes[i];
+
         std::visit(fastgltf::visitor {
             [&](fastgltf::sources::URI& uri) {
                 if (uri.fileByteOffset != 0) {
                     spdlog::warn("URI with offset not supported yet: image index {}", i);
                     return;
                 }
-                
+
                 std::filesystem::path imagePath;
                 if (uri.uri.scheme() == "file") {
                     imagePath = uri.uri.fspath();
@@ -162,176 +146,69 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
                     return;
                 }
 
-                // Use AssetManager for caching with Type awareness!
-                image = assetManager->getOrLoadTexture(imagePath, type);
+                image.path = std::filesystem::absolute(imagePath).string();
             },
             [&](fastgltf::sources::BufferView& view) {
                 auto& bufferView = asset.bufferViews[view.bufferViewIndex];
                 auto& buffer = asset.buffers[bufferView.bufferIndex];
-                
+
                 std::visit(fastgltf::visitor {
                     [&](fastgltf::sources::Array& array) {
-                        int width, height, channels;
-                        stbi_uc* pixels = stbi_load_from_memory(
-                            reinterpret_cast<const stbi_uc*>(array.bytes.data() + bufferView.byteOffset),
-                            static_cast<int>(bufferView.byteLength),
-                            &width, &height, &channels, STBI_rgb_alpha
-                        );
-                        
-                        if (pixels) {
-                            ImageSpecs specs;
-                            specs.width = static_cast<uint32_t>(width);
-                            specs.height = static_cast<uint32_t>(height);
-                            // Set format based on type
-                            specs.format = (type == TextureType::Normal) ? 
-                                VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8G8B8A8_SRGB;
-                                
-                            specs.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-                            
-                            image = std::make_shared<Image>(m_context, specs);
-                            image->upload(pixels, specs.width * specs.height * 4);
-                            stbi_image_free(pixels);
-                            spdlog::info("Loaded image from BufferView ({}x{}) as {}", width, height, 
-                                (type == TextureType::Normal ? "UNORM" : "SRGB"));
-                        }
+                        const auto* bytes = reinterpret_cast<const uint8_t*>(array.bytes.data() + bufferView.byteOffset);
+                        image.embedded.assign(bytes, bytes + bufferView.byteLength);
                     },
                     [&](auto&) {}
                 }, buffer.data);
             },
             [&](auto&) {}
         }, gltfImage.data);
-        
-        loadedImages.push_back(std::move(image));
     }
 
     // 3. Texture'ları Yükle (Image + Sampler kombinasyonları)
-    model->textureIndices.reserve(asset.textures.size());
-    for (size_t i = 0; i < asset.textures.size(); ++i) {
-        auto& gltfTex = asset.textures[i];
-        if (!gltfTex.imageIndex.has_value()) {
-            model->textureIndices.push_back(0); // Default fallback
-            continue;
-        }
-
-        uint32_t imgIdx = static_cast<uint32_t>(gltfTex.imageIndex.value());
-        VkSampler sampler = gltfTex.samplerIndex.has_value() ? 
-            loadedSamplers[gltfTex.samplerIndex.value()] : defaultSampler;
-
-        if (imgIdx < loadedImages.size() && loadedImages[imgIdx]) {
-            uint32_t texIdx = m_context->getDescriptorManager().registerImage(loadedImages[imgIdx]->getView(), sampler);
-            model->textureIndices.push_back(texIdx);
-            spdlog::debug("Registered texture {} using image {}", i, imgIdx);
-        } else {
-            spdlog::warn("Texture {} references missing or moved image {}", i, imgIdx);
-            model->textureIndices.push_back(0);
+    model->textures.reserve(asset.textures.size());
+    for (auto& gltfTex : asset.textures) {
+        ModelData::TextureRef texture;
+        if (gltfTex.imageIndex.has_value()) {
+            texture.image = static_cast<int32_t>(gltfTex.imageIndex.value());
         }
-    }
-
-    // Move images to model at the very end
-    for (auto& img : loadedImages) {
-        if (img) {
-            model->images.push_back(img); // Shared ptr copy
+        if (gltfTex.samplerIndex.has_value()) {
+            texture.sampler = loadedSamplers[gltfTex.samplerIndex.value()];
         }
+        model->textures.push_back(texture);
     }
 
-    // 4. Materyal Yükleme
-    std::vector<int32_t> materialIndices;
+    // 4. Materyal Yükleme (texture indeksleri model->textures'a işaret eder)
     for (auto& gltfMat : asset.materials) {
-        Material material;
+        ModelData::MaterialData material;
         material.name = gltfMat.name.c_str();
 
+        auto textureIndex = [](auto& info) -> int32_t {
+            return info.has_value() ? static_cast<int32_t>(info->textureIndex) : -1;
+        };
+
         // Base Color
         material.gpuData.baseColorFactor = glm::make_vec4(gltfMat.pbrData.baseColorFactor.data());
-        if (gltfMat.pbrData.baseColorTexture.has_value()) {
-            size_t texIdx = gltfMat.pbrData.baseColorTexture->textureIndex;
-            material.gpuData.baseColorIndex = model->textureIndices[texIdx];
-            // Keep ref
-            if (model->images.size() > texIdx) {
-                // Warning: model->images might not index 1:1 with textures map in gltf if some textures failed
-                // But generally model->images corresponds to loadedImages which maps to unique images.
-                // gltfMat textures index into asset.textures. 
-                // We populated model->textureIndices from asset.textures.
-                // We need the corresponding Image pointer to store in Material host struct.
-                // The gltfTex ref has imageIndex. 
-                auto& gltfTex = asset.textures[texIdx];
-                 if (gltfTex.imageIndex.has_value()) {
-                     size_t imgIdx = gltfTex.imageIndex.value();
-                     if (imgIdx < loadedImages.size()) {
-                         material.baseColorTexture = loadedImages[imgIdx];
-                     }
-                 }
-            }
-        }
+        material.gpuData.baseColorIndex = textureIndex(gltfMat.pbrData.baseColorTexture);
 
         // Metallic Roughness
         material.gpuData.metallicFactor = gltfMat.pbrData.metallicFactor;
         material.gpuData.roughnessFactor = gltfMat.pbrData.roughnessFactor;
-        if (gltfMat.pbrData.metallicRoughnessTexture.has_value()) {
-            size_t texIdx = gltfMat.pbrData.metallicRoughnessTexture->textureIndex;
-            material.gpuData.metallicRoughnessIndex = model->textureIndices[texIdx];
-            
-             auto& gltfTex = asset.textures[texIdx];
-             if (gltfTex.imageIndex.has_value()) {
-                 size_t imgIdx = gltfTex.imageIndex.value();
-                 if (imgIdx < loadedImages.size()) material.metallicRoughnessTexture = loadedImages[imgIdx];
-             }
-        }
+        material.gpuData.metallicRoughnessIndex = textureIndex(gltfMat.pbrData.metallicRoughnessTexture);
 
         // Normal
-        if (gltfMat.normalTexture.has_value()) {
-            size_t texIdx = gltfMat.normalTexture->textureIndex;
-            material.gpuData.normalIndex = model->textureIndices[texIdx];
-            
-             auto& gltfTex = asset.textures[texIdx];
-             if (gltfTex.imageIndex.has_value()) {
-                 size_t imgIdx = gltfTex.imageIndex.value();
-                 if (imgIdx < loadedImages.size()) material.normalTexture = loadedImages[imgIdx];
-             }
-        }
+        material.gpuData.normalIndex = textureIndex(gltfMat.normalTexture);
 
         // Emissive
         material.gpuData.emissiveFactor = glm::vec4(gltfMat.emissiveFactor[0], gltfMat.emissiveFactor[1], gltfMat.emissiveFactor[2], 1.0f);
-        
-        if (gltfMat.emissiveTexture.has_value()) {
-            size_t texIdx = gltfMat.emissiveTexture->textureIndex;
-            material.gpuData.emissiveIndex = model->textureIndices[texIdx];
-            
-             auto& gltfTex = asset.textures[texIdx];
-             if (gltfTex.imageIndex.has_value()) {
-                 size_t imgIdx = gltfTex.imageIndex.value();
-                 if (imgIdx < loadedImages.size()) material.emissiveTexture = loadedImages[imgIdx];
-             }
-        }
-        
+        material.gpuData.emissiveIndex = textureIndex(gltfMat.emissiveTexture);
+
         // Occlusion
-        if (gltfMat.occlusionTexture.has_value()) {
-            size_t texIdx = gltfMat.occlusionTexture->textureIndex;
-            material.gpuData.occlusionIndex = model->textureIndices[texIdx];
-            
-             auto& gltfTex = asset.textures[texIdx];
-             if (gltfTex.imageIndex.has_value()) {
-                 size_t imgIdx = gltfTex.imageIndex.value();
-                 if (imgIdx < loadedImages.size()) material.occlusionTexture = loadedImages[imgIdx];
-             }
-        }
-        
+        material.gpuData.occlusionIndex = textureIndex(gltfMat.occlusionTexture);
+
         // Transmission
         if (gltfMat.transmission) {
-            auto& trans = *gltfMat.transmission;
-            material.gpuData.transmissionFactor = trans.transmissionFactor;
-            
-            if (trans.transmissionTexture.has_value()) {
-                size_t texIdx = trans.transmissionTexture->textureIndex;
-                material.gpuData.transmissionIndex = model->textureIndices[texIdx];
-                
-                auto& gltfTex = asset.textures[texIdx];
-                if (gltfTex.imageIndex.has_value()) {
-                    size_t imgIdx = gltfTex.imageIndex.value();
-                    if (imgIdx < loadedImages.size()) {
-                        material.transmissionTexture = loadedImages[imgIdx];
-                    }
-                }
-            }
+            material.gpuData.transmissionFactor = gltfMat.transmission->transmissionFactor;
+            material.gpuData.transmissionIndex = textureIndex(gltfMat.transmission->transmissionTexture);
         }
 
         // IOR
@@ -339,21 +216,8 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
 
         // Volume
         if (gltfMat.volume) {
-            auto& vol = *gltfMat.volume;
-            material.gpuData.thicknessFactor = vol.thicknessFactor;
-            
-            if (vol.thicknessTexture.has_value()) {
-                size_t texIdx = vol.thicknessTexture->textureIndex;
-                material.gpuData.thicknessIndex = model->textureIndices[texIdx];
-                
-                auto& gltfTex = asset.textures[texIdx];
-                if (gltfTex.imageIndex.has_value()) {
-                    size_t imgIdx = gltfTex.imageIndex.value();
-                    if (imgIdx < loadedImages.size()) {
-                        material.thicknessTexture = loadedImages[imgIdx];
-                    }
-                }
-            }
+            material.gpuData.thicknessFactor = gltfMat.volume->thicknessFactor;
+            material.gpuData.thicknessIndex = textureIndex(gltfMat.volume->thicknessTexture);
         }
 
         if (gltfMat.alphaMode == fastgltf::AlphaMode::Mask) {
@@ -364,31 +228,24 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
         } else {
             material.gpuData.alphaMode = static_cast<uint32_t>(AlphaMode::Opaque);
         }
-        
-        material.gpuData.doubleSided = gltfMat.doubleSided ? 1 : 0;
 
-        materialIndices.push_back(sceneManager->addMaterial(material));
-    }
+        material.gpuData.doubleSided = gltfMat.doubleSided ? 1 : 0;
 
-    // Default material if none exist
-    if (materialIndices.empty()) {
-        Material defaultMat;
-        defaultMat.name = "Default";
-        materialIndices.push_back(sceneManager->addMaterial(defaultMat));
+        model->materials.push_back(material);
     }
 
-    // 3. Geometri Yükleme
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
+    // 5. Geometri Yükleme
+    auto& vertices = model->vertexStorage;
+    auto& indices = model->indexStorage;
 
     for (size_t meshIdx = 0; meshIdx < asset.meshes.size(); ++meshIdx) {
         auto& gltfMesh = asset.meshes[meshIdx];
-        Mesh mesh;
+        ModelData::MeshData mesh;
         mesh.name = gltfMesh.name.c_str();
 
         for (size_t primIdx = 0; primIdx < gltfMesh.primitives.size(); ++primIdx) {
             auto& gltfPrimitive = gltfMesh.primitives[primIdx];
-            Primitive primitive;
+            Primitive primitive{};
             primitive.firstIndex = static_cast<uint32_t>(indices.size());
             uint32_t vertexStart = static_cast<uint32_t>(vertices.size());
 
@@ -396,7 +253,7 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
             if (gltfPrimitive.indicesAccessor.has_value()) {
                 size_t accIdx = gltfPrimitive.indicesAccessor.value();
                 indices.reserve(indices.size() + asset.accessors[accIdx].count);
-                
+
                 fastgltf::iterateAccessor<uint32_t>(asset, asset.accessors[accIdx], [&](uint32_t index) {
                     indices.push_back(vertexStart + index);
                 });
@@ -409,21 +266,21 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
                 if (posIt != gltfPrimitive.attributes.end()) {
                     size_t accIdx = posIt->accessorIndex;
                     vertices.resize(vertexStart + asset.accessors[accIdx].count);
-                    
+
                     glm::vec3 minPos(std::numeric_limits<float>::max());
                     glm::vec3 maxPos(std::numeric_limits<float>::lowest());
-    
+
                     fastgltf::iterateAccessorWithIndex<glm::vec3>(asset, asset.accessors[accIdx], [&](glm::vec3 pos, size_t idx) {
                         vertices[vertexStart + idx].position = pos;
                         minPos = glm::min(minPos, pos);
                         maxPos = glm::max(maxPos, pos);
                     });
-    
+
                     primitive.boundingCenter = (minPos + maxPos) * 0.5f;
                     primitive.boundingRadius = glm::distance(maxPos, primitive.boundingCenter);
                 }
             }
- 
+
             // NORMAL
             {
                 auto normIt = gltfPrimitive.findAttribute("NORMAL");
@@ -434,7 +291,7 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
                     });
                 }
             }
- 
+
             // TEXCOORD_0
             {
                 auto uvIt = gltfPrimitive.findAttribute("TEXCOORD_0");
@@ -445,7 +302,7 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
                     });
                 }
             }
- 
+
             // TANGENT
             {
                 auto tangIt = gltfPrimitive.findAttribute("TANGENT");
@@ -457,25 +314,22 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
                 }
             }
 
-            if (gltfPrimitive.materialIndex.has_value()) {
-                size_t matIdx = gltfPrimitive.materialIndex.value();
-                primitive.materialIndex = materialIndices[matIdx];
-            } else {
-                primitive.materialIndex = materialIndices[0];
-            }
-                
+            primitive.materialIndex = gltfPrimitive.materialIndex.has_value()
+                ? static_cast<int32_t>(gltfPrimitive.materialIndex.value()) : -1;
+
             mesh.primitives.push_back(primitive);
         }
         model->meshes.push_back(mesh);
     }
+    model->adoptStorage();
 
-    // 4. Node Hierarchy
-    std::function<void(uint32_t, Model::Node*, glm::mat4)> loadNode;
-    loadNode = [&](uint32_t nodeIdx, Model::Node* parent, glm::mat4 parentTransform) {
+    // 6. Node Hierarchy (düz liste, parent her zaman önce gelir)
+    std::function<void(uint32_t, int32_t, glm::mat4)> loadNode;
+    loadNode = [&](uint32_t nodeIdx, int32_t parent, glm::mat4 parentTransform) {
         auto& gltfNode = asset.nodes[nodeIdx];
-        auto node = std::make_unique<Model::Node>();
-        node->parent = parent;
-        node->name = gltfNode.name.c_str();
+        ModelData::NodeData node;
+        node.parent = parent;
+        node.name = gltfNode.name.c_str();
 
         // Node transform
         glm::mat4 localTransform = glm::mat4(1.0f);
@@ -487,51 +341,29 @@ std::unique_ptr<Model> GltfLoader::load(const std::filesystem::path& path, Scene
         } else if (auto* mat = std::get_if<fastgltf::math::fmat4x4>(&gltfNode.transform)) {
             localTransform = glm::make_mat4(mat->data());
         }
-        
-        node->matrix = parentTransform * localTransform;
+
+        node.matrix = parentTransform * localTransform;
 
         if (gltfNode.meshIndex.has_value()) {
-            node->meshIndex = static_cast<int32_t>(gltfNode.meshIndex.value());
+            node.meshIndex = static_cast<int32_t>(gltfNode.meshIndex.value());
         }
 
-        Model::Node* nodePtr = node.get();
-        model->linearNodes.push_back(nodePtr);
+        int32_t index = static_cast<int32_t>(model->nodes.size());
+        glm::mat4 world = node.matrix;
+        model->nodes.push_back(std::move(node));
 
         for (auto& childIdx : gltfNode.children) {
-            loadNode(static_cast<uint32_t>(childIdx), nodePtr, nodePtr->matrix);
-        }
-
-        if (parent) {
-            parent->children.push_back(std::move(node));
-        } else {
-            model->nodes.push_back(std::move(node));
+            loadNode(static_cast<uint32_t>(childIdx), index, world);
         }
     };
 
     auto& scene = asset.scenes[asset.defaultScene ? *asset.defaultScene : 0];
     for (auto& nodeIdx : scene.nodeIndices) {
-        loadNode(static_cast<uint32_t>(nodeIdx), nullptr, glm::mat4(1.0f));
+        loadNode(static_cast<uint32_t>(nodeIdx), -1, glm::mat4(1.0f));
     }
 
-    // GPU Buffer'larını yarat
-    model->vertexBuffer = std::make_unique<Buffer>(
-        m_context,
-        vertices.size() * sizeof(Vertex),
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VMA_MEMORY_USAGE_CPU_TO_GPU
-    );
-    model->vertexBuffer->upload(vertices.data(), vertices.size() * sizeof(Vertex));
-
-    model->indexBuffer = std::make_unique<Buffer>(
-        m_context,
-        indices.size() * sizeof(uint32_t),
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VMA_MEMORY_USAGE_CPU_TO_GPU
-    );
-    model->indexBuffer->upload(indices.data(), indices.size() * sizeof(uint32_t));
-
-    spdlog::info("glTF model loaded: {} meshes, {} materials, {} textures", 
-                 model->meshes.size(), materialIndices.size(), model->images.size());
+    spdlog::info("glTF model imported: {} meshes, {} materials, {} images",
+                 model->meshes.size(), model->materials.size(), model->images.size());
     return model;
 }
 
@@ -0,0 +1,347 @@
+#include "astral/renderer/lod_builder.hpp"
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace astral {
+
+namespace {
+
+// Each level aims for this fraction of the previous level's triangles
+constexpr float LOD_TRIANGLE_RATIO = 0.5f;
+// A level still above this fraction of the previous one isn't worth its indices, the chain
+// stops there
+constexpr float LOD_MIN_REDUCTION = 0.8f;
+// Largest surface deviation a collapse may introduce at LOD 1, relative to the primitive's
+// bounding radius. Doubles per level.
+constexpr double LOD_BASE_ERROR = 0.01;
+// Smaller primitives keep a single level
+constexpr uint32_t LOD_MIN_TRIANGLES = 128;
+// Collapses that tilt a neighbouring triangle further than this (cos) are rejected
+constexpr double MIN_NORMAL_DOT = 0.25;
+
+// Area weighted sum of squared distances to a set of planes (Garland & Heckbert)
+struct Quadric {
+    double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+    double b2 = 0.0, bc = 0.0, bd = 0.0;
+    double c2 = 0.0, cd = 0.0;
+    double d2 = 0.0;
+    double weight = 0.0;
+
+    void addPlane(const glm::dvec3& n, double d, double w) {
+        a2 += w * n.x * n.x; ab += w * n.x * n.y; ac += w * n.x * n.z; ad += w * n.x * d;
+        b2 += w * n.y * n.y; bc += w * n.y * n.z; bd += w * n.y * d;
+        c2 += w * n.z * n.z; cd += w * n.z * d;
+        d2 += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric& q) {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        weight += q.weight;
+    }
+
+    // Mean squared distance of p to the planes
+    double evaluate(const glm::dvec3& p) const {
+        if (weight <= 0.0) {
+            return 0.0;
+        }
+        double sum = a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z +
+                     2.0 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z) +
+                     2.0 * (ad * p.x + bd * p.y + cd * p.z) + d2;
+        return std::max(sum, 0.0) / weight;
+    }
+};
+
+// Vertices that share their position with another one (UV / normal / tangent splits)
+std::vector<uint8_t> findSeamVertices(const ModelData& data) {
+    std::vector<uint32_t> order(data.vertices.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const glm::vec3& pa = data.vertices[a].position;
+        const glm::vec3& pb = data.vertices[b].position;
+        return std::tie(pa.x, pa.y, pa.z) < std::tie(pb.x, pb.y, pb.z);
+    });
+
+    std::vector<uint8_t> seams(data.vertices.size(), 0);
+    for (size_t i = 1; i < order.size(); ++i) {
+        if (data.vertices[order[i]].position == data.vertices[order[i - 1]].position) {
+            seams[order[i]] = 1;
+            seams[order[i - 1]] = 1;
+        }
+    }
+    return seams;
+}
+
+// One primitive's LOD 0 in compact local vertex ids, with its locks and base quadrics.
+// Every level is simplified from here, not from the level before, so errors don't stack.
+class PrimitiveSimplifier {
+public:
+    PrimitiveSimplifier(const ModelData& data, const Primitive& primitive, const std::vector<uint8_t>& seams,
+                        std::vector<uint32_t>& globalToLocal);
+
+    // Model vertex indices of at most targetIndexCount indices, or fewer collapses if the next one
+    // would move the surface further than maxError
+    std::vector<uint32_t> simplify(uint32_t targetIndexCount, double maxError) const;
+
+private:
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double error;
+    };
+
+    double collapseError(const std::vector<Quadric>& quadrics, uint32_t from, uint32_t to) const;
+    bool keepsOrientation(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& triangleOffsets,
+                          const std::vector<uint32_t>& vertexTriangles, uint32_t from, uint32_t to) const;
+
+    std::vector<uint32_t> m_localToGlobal;
+    std::vector<glm::dvec3> m_positions;
+    std::vector<uint8_t> m_locked;
+    std::vector<Quadric> m_quadrics;
+    std::vector<uint32_t> m_indices;
+};
+
+PrimitiveSimplifier::PrimitiveSimplifier(const ModelData& data, const Primitive& primitive,
+                                         const std::vector<uint8_t>& seams, std::vector<uint32_t>& globalToLocal) {
+    const uint32_t* source = data.indexStorage.data() + primitive.firstIndex;
+    m_indices.reserve(primitive.indexCount);
+    for (uint32_t i = 0; i + 2 < primitive.indexCount; i += 3) {
+        uint32_t triangle[3];
+        for (uint32_t k = 0; k < 3; ++k) {
+            uint32_t global = source[i + k];
+            if (globalToLocal[global] == UINT32_MAX) {
+                globalToLocal[global] = static_cast<uint32_t>(m_localToGlobal.size());
+                m_localToGlobal.push_back(global);
+            }
+            triangle[k] = globalToLocal[global];
+        }
+        if (triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[0] != triangle[2]) {
+            m_indices.insert(m_indices.end(), triangle, triangle + 3);
+        }
+    }
+    // Ready for the next primitive
+    for (uint32_t global : m_localToGlobal) {
+        globalToLocal[global] = UINT32_MAX;
+    }
+
+    const size_t vertexCount = m_localToGlobal.size();
+    m_positions.resize(vertexCount);
+    m_locked.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        m_positions[v] = glm::dvec3(data.vertices[m_localToGlobal[v]].position);
+        m_locked[v] = seams[m_localToGlobal[v]];
+    }
+
+    // Open and non-manifold edges pin both ends, the outline never moves
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    edgeUses.reserve(m_indices.size());
+    for (size_t i = 0; i < m_indices.size(); i += 3) {
+        for (uint32_t k = 0; k < 3; ++k) {
+            uint32_t a = m_indices[i + k];
+            uint32_t b = m_indices[i + (k + 1) % 3];
+            edgeUses[(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b)]++;
+        }
+    }
+    for (const auto& [edge, uses] : edgeUses) {
+        if (uses != 2) {
+            m_locked[static_cast<uint32_t>(edge >> 32)] = 1;
+            m_locked[static_cast<uint32_t>(edge)] = 1;
+        }
+    }
+
+    m_quadrics.resize(vertexCount);
+    for (size_t i = 0; i < m_indices.size(); i += 3) {
+        const glm::dvec3& p0 = m_positions[m_indices[i]];
+        glm::dvec3 normal = glm::cross(m_positions[m_indices[i + 1]] - p0, m_positions[m_indices[i + 2]] - p0);
+        double length = glm::length(normal);
+        if (length <= 0.0) {
+            continue;
+        }
+        normal /= length;
+        double distance = -glm::dot(normal, p0);
+        for (uint32_t k = 0; k < 3; ++k) {
+            m_quadrics[m_indices[i + k]].addPlane(normal, distance, length * 0.5);
+        }
+    }
+}
+
+double PrimitiveSimplifier::collapseError(const std::vector<Quadric>& quadrics, uint32_t from, uint32_t to) const {
+    Quadric merged = quadrics[from];
+    merged.add(quadrics[to]);
+    return merged.evaluate(m_positions[to]);
+}
+
+// No triangle that survives the collapse may flip or tilt too far
+bool PrimitiveSimplifier::keepsOrientation(const std::vector<uint32_t>& indices,
+                                           const std::vector<uint32_t>& triangleOffsets,
+                                           const std::vector<uint32_t>& vertexTriangles, uint32_t from,
+                                           uint32_t to) const {
+    for (uint32_t t = triangleOffsets[from]; t < triangleOffsets[from + 1]; ++t) {
+        const uint32_t* triangle = &indices[vertexTriangles[t] * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+            continue; // Collapses away
+        }
+        glm::dvec3 before[3];
+        glm::dvec3 after[3];
+        for (uint32_t k = 0; k < 3; ++k) {
+            before[k] = m_positions[triangle[k]];
+            after[k] = triangle[k] == from ? m_positions[to] : before[k];
+        }
+        glm::dvec3 oldNormal = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::dvec3 newNormal = glm::cross(after[1] - after[0], after[2] - after[0]);
+        if (glm::dot(oldNormal, newNormal) <= MIN_NORMAL_DOT * glm::length(oldNormal) * glm::length(newNormal)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<uint32_t> PrimitiveSimplifier::simplify(uint32_t targetIndexCount, double maxError) const {
+    const uint32_t vertexCount = static_cast<uint32_t>(m_positions.size());
+    const uint32_t targetTriangles = targetIndexCount / 3;
+    const double maxErrorSquared = maxError * maxError;
+
+    std::vector<uint32_t> indices = m_indices;
+    std::vector<Quadric> quadrics = m_quadrics;
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+    std::vector<uint32_t> vertexTriangles;
+    std::vector<uint32_t> cursor;
+    std::vector<Collapse> collapses;
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint32_t> remap(vertexCount);
+
+    // Passes of independent collapses, cheapest first. A collapse freezes the triangles around
+    // it for the rest of the pass, so the adjacency below stays valid until the rewrite.
+    while (indices.size() / 3 > targetTriangles) {
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0u);
+        for (uint32_t index : indices) {
+            triangleOffsets[index + 1]++;
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            triangleOffsets[v + 1] += triangleOffsets[v];
+        }
+        cursor.assign(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        vertexTriangles.resize(indices.size());
+        for (uint32_t i = 0; i < indices.size(); ++i) {
+            vertexTriangles[cursor[indices[i]]++] = i / 3;
+        }
+
+        // Interior edges show up once per side, a < b keeps one of the two
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (uint32_t k = 0; k < 3; ++k) {
+                uint32_t a = indices[i + k];
+                uint32_t b = indices[i + (k + 1) % 3];
+                if (a > b) {
+                    continue;
+                }
+                if (!m_locked[a]) {
+                    collapses.push_back({a, b, collapseError(quadrics, a, b)});
+                }
+                if (!m_locked[b]) {
+                    collapses.push_back({b, a, collapseError(quadrics, b, a)});
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        std::fill(touched.begin(), touched.end(), 0);
+        std::iota(remap.begin(), remap.end(), 0u);
+        uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        bool collapsed = false;
+        for (const Collapse& collapse : collapses) {
+            if (collapse.error > maxErrorSquared || triangleCount <= targetTriangles) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to] ||
+                !keepsOrientation(indices, triangleOffsets, vertexTriangles, collapse.from, collapse.to)) {
+                continue;
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; ++t) {
+                const uint32_t* triangle = &indices[vertexTriangles[t] * 3];
+                bool removed = false;
+                for (uint32_t k = 0; k < 3; ++k) {
+                    touched[triangle[k]] = 1;
+                    removed |= triangle[k] == collapse.to;
+                }
+                if (removed) {
+                    triangleCount--;
+                }
+            }
+            collapsed = true;
+        }
+        if (!collapsed) {
+            break; // Everything left is locked, flips or costs too much
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            uint32_t a = remap[indices[i]];
+            uint32_t b = remap[indices[i + 1]];
+            uint32_t c = remap[indices[i + 2]];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            indices[write++] = a;
+            indices[write++] = b;
+            indices[write++] = c;
+        }
+        indices.resize(write);
+    }
+
+    for (uint32_t& index : indices) {
+        index = m_localToGlobal[index];
+    }
+    return indices;
+}
+
+} // namespace
+
+void buildLods(ModelData& data) {
+    // The levels are appended to the index storage, fresh imports already view it
+    if (data.indices.data() != data.indexStorage.data()) {
+        data.indexStorage.assign(data.indices.begin(), data.indices.end());
+    }
+
+    std::vector<uint8_t> seams = findSeamVertices(data);
+    std::vector<uint32_t> globalToLocal(data.vertices.size(), UINT32_MAX);
+
+    for (auto& mesh : data.meshes) {
+        for (auto& primitive : mesh.primitives) {
+            primitive.lodCount = 1;
+            if (primitive.indexCount / 3 < LOD_MIN_TRIANGLES) {
+                continue;
+            }
+
+            PrimitiveSimplifier simplifier(data, primitive, seams, globalToLocal);
+            uint32_t previousCount = primitive.indexCount;
+            for (uint32_t level = 1; level < MAX_LODS; ++level) {
+                uint32_t target = static_cast<uint32_t>(previousCount * LOD_TRIANGLE_RATIO) / 3 * 3;
+                double maxError = primitive.boundingRadius * LOD_BASE_ERROR * static_cast<double>(1u << (level - 1));
+                std::vector<uint32_t> lodIndices = simplifier.simplify(target, maxError);
+                if (lodIndices.empty() || lodIndices.size() > previousCount * LOD_MIN_REDUCTION) {
+                    break;
+                }
+
+                PrimitiveLod& lod = primitive.lods[level - 1];
+                lod.firstIndex = static_cast<uint32_t>(data.indexStorage.size());
+                lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+                data.indexStorage.insert(data.indexStorage.end(), lodIndices.begin(), lodIndices.end());
+                primitive.lodCount = level + 1;
+                previousCount = lod.indexCount;
+            }
+        }
+    }
+    data.indices = data.indexStorage;
+}
+
+} // namespace astral
@@ -0,0 +1,354 @@
+#include "astral/renderer/mesh_cache.hpp"
+#include "astral/core/mapped_file.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+namespace astral {
+
+namespace {
+
+constexpr uint32_t MESH_CACHE_MAGIC = 0x48534D41; // "AMSH"
+// Bump whenever ModelData, Vertex or the layout below changes
+constexpr uint32_t MESH_CACHE_VERSION = 4;
+constexpr uint64_t GEOMETRY_ALIGNMENT = 16;
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexStride;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t metadataOffset;
+    uint64_t metadataSize;
+    uint64_t vertexOffset;
+    uint64_t vertexCount;
+    uint64_t indexOffset;
+    uint64_t indexCount;
+};
+
+class BinaryWriter {
+public:
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        m_data.insert(m_data.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    void writeVector(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write<uint64_t>(values.size());
+        const auto* bytes = reinterpret_cast<const uint8_t*>(values.data());
+        m_data.insert(m_data.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    void writeString(const std::string& value) {
+        write<uint64_t>(value.size());
+        m_data.insert(m_data.end(), value.begin(), value.end());
+    }
+
+    const std::vector<uint8_t>& getData() const { return m_data; }
+
+private:
+    std::vector<uint8_t> m_data;
+};
+
+// Bounds checked, a truncated or corrupt entry throws instead of reading past the mapping
+class BinaryReader {
+public:
+    BinaryReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    template <typename T>
+    T read() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> readVector() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        uint64_t count = read<uint64_t>();
+        if (count > m_size / std::max<size_t>(sizeof(T), 1)) {
+            throw std::runtime_error("corrupt element count");
+        }
+        std::vector<T> values(count);
+        memcpy(values.data(), take(count * sizeof(T)), count * sizeof(T));
+        return values;
+    }
+
+    std::string readString() {
+        uint64_t length = read<uint64_t>();
+        if (length > m_size) {
+            throw std::runtime_error("corrupt string length");
+        }
+        const auto* chars = reinterpret_cast<const char*>(take(length));
+        return std::string(chars, chars + length);
+    }
+
+private:
+    const uint8_t* take(size_t bytes) {
+        if (bytes > m_size - m_offset) {
+            throw std::runtime_error("unexpected end of data");
+        }
+        const uint8_t* ptr = m_data + m_offset;
+        m_offset += bytes;
+        return ptr;
+    }
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+};
+
+// [first, first + count) lies inside [0, size), without overflowing
+bool rangeInside(uint64_t first, uint64_t count, uint64_t size) {
+    return first <= size && count <= size - first;
+}
+
+// The renderer indexes with these straight away (arena upload, meshlet and LOD
+// draws), so an entry that points outside its own arrays is rejected up front
+void validateGeometry(const ModelData& data) {
+    for (const auto& mesh : data.meshes) {
+        for (const auto& primitive : mesh.primitives) {
+            if (primitive.lodCount == 0 || primitive.lodCount > MAX_LODS) {
+                throw std::runtime_error("corrupt LOD count");
+            }
+            for (uint32_t level = 0; level < primitive.lodCount; ++level) {
+                PrimitiveLod lod = primitive.getLod(level);
+                if (!rangeInside(lod.firstIndex, lod.indexCount, data.indices.size())) {
+                    throw std::runtime_error("primitive index range out of bounds");
+                }
+                if (!rangeInside(lod.firstMeshlet, lod.meshletCount, data.meshlets.size())) {
+                    throw std::runtime_error("primitive meshlet range out of bounds");
+                }
+                for (uint32_t m = lod.firstMeshlet; m < lod.firstMeshlet + lod.meshletCount; ++m) {
+                    const Meshlet& meshlet = data.meshlets[m];
+                    if (!rangeInside(meshlet.firstIndex, meshlet.indexCount, lod.indexCount)) {
+                        throw std::runtime_error("meshlet index range out of bounds");
+                    }
+                }
+            }
+        }
+    }
+    const size_t vertexCount = data.vertices.size();
+    if (std::any_of(data.indices.begin(), data.indices.end(),
+                    [vertexCount](uint32_t index) { return index >= vertexCount; })) {
+        throw std::runtime_error("index out of range");
+    }
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+bool getSourceStamp(const std::filesystem::path& source, uint64_t& size, int64_t& time) {
+    std::error_code ec;
+    size = std::filesystem::file_size(source, ec);
+    if (ec) {
+        return false;
+    }
+    auto writeTime = std::filesystem::last_write_time(source, ec);
+    if (ec) {
+        return false;
+    }
+    time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+    return true;
+}
+
+} // namespace
+
+MeshCache::MeshCache(std::filesystem::path cacheDirectory) : m_cacheDirectory(std::move(cacheDirectory)) {
+    std::error_code ec;
+    std::filesystem::create_directories(m_cacheDirectory, ec);
+    if (ec) {
+        spdlog::warn("MeshCache: can't create cache directory {} ({})", m_cacheDirectory.string(), ec.message());
+    }
+}
+
+std::filesystem::path MeshCache::getCachePath(const std::filesystem::path& source) const {
+    // FNV-1a of the absolute path
+    std::string key = std::filesystem::absolute(source).lexically_normal().string();
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : key) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    std::ostringstream name;
+    name << source.stem().string() << "_" << std::hex << hash << ".amesh";
+    return m_cacheDirectory / name.str();
+}
+
+std::unique_ptr<ModelData> MeshCache::load(const std::filesystem::path& source) const {
+    std::filesystem::path cachePath = getCachePath(source);
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    std::error_code ec;
+    uintmax_t cacheSize = std::filesystem::file_size(cachePath, ec);
+    if (ec || cacheSize < sizeof(MeshCacheHeader) || !getSourceStamp(source, sourceSize, sourceTime)) {
+        return nullptr;
+    }
+
+    try {
+        auto file = std::make_shared<MappedFile>(cachePath);
+        const uint8_t* base = file->getData();
+
+        MeshCacheHeader header;
+        memcpy(&header, base, sizeof(header));
+        if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION ||
+            header.vertexStride != sizeof(Vertex)) {
+            spdlog::info("MeshCache: {} is from another version, re-importing", cachePath.filename().string());
+            return nullptr;
+        }
+        if (header.sourceSize != sourceSize || header.sourceTime != sourceTime) {
+            spdlog::info("MeshCache: {} changed since it was cooked, re-importing", source.filename().string());
+            return nullptr;
+        }
+        const uint64_t fileSize = file->getSize();
+        if (header.vertexCount > fileSize / sizeof(Vertex) || header.indexCount > fileSize / sizeof(uint32_t) ||
+            !rangeInside(header.metadataOffset, header.metadataSize, fileSize) ||
+            !rangeInside(header.vertexOffset, header.vertexCount * sizeof(Vertex), fileSize) ||
+            !rangeInside(header.indexOffset, header.indexCount * sizeof(uint32_t), fileSize) ||
+            header.vertexOffset % GEOMETRY_ALIGNMENT != 0 || header.indexOffset % GEOMETRY_ALIGNMENT != 0) {
+            throw std::runtime_error("section out of bounds");
+        }
+
+        auto data = std::make_unique<ModelData>();
+        BinaryReader reader(base + header.metadataOffset, header.metadataSize);
+
+        uint64_t imageCount = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < imageCount; ++i) {
+            ModelData::ImageSource image;
+            image.path = reader.readString();
+            image.embedded = reader.readVector<uint8_t>();
+            image.type = reader.read<TextureType>();
+            data->images.push_back(std::move(image));
+        }
+        data->textures = reader.readVector<ModelData::TextureRef>();
+
+        uint64_t materialCount = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < materialCount; ++i) {
+            ModelData::MaterialData material;
+            material.name = reader.readString();
+            material.gpuData = reader.read<MaterialGPU>();
+            data->materials.push_back(std::move(material));
+        }
+
+        uint64_t meshCount = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < meshCount; ++i) {
+            ModelData::MeshData mesh;
+            mesh.name = reader.readString();
+            mesh.primitives = reader.readVector<Primitive>();
+            data->meshes.push_back(std::move(mesh));
+        }
+        data->meshlets = reader.readVector<Meshlet>();
+
+        uint64_t nodeCount = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < nodeCount; ++i) {
+            ModelData::NodeData node;
+            node.parent = reader.read<int32_t>();
+            node.meshIndex = reader.read<int32_t>();
+            node.matrix = reader.read<glm::mat4>();
+            node.name = reader.readString();
+            data->nodes.push_back(std::move(node));
+        }
+
+        // Zero-copy: the views point into the mapping, which the ModelData keeps alive
+        data->vertices = std::span<const Vertex>(reinterpret_cast<const Vertex*>(base + header.vertexOffset), header.vertexCount);
+        data->indices = std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(base + header.indexOffset), header.indexCount);
+        validateGeometry(*data);
+        data->backing = file;
+        return data;
+    } catch (const std::exception& e) {
+        spdlog::warn("MeshCache: entry {} unusable ({}), re-importing", cachePath.string(), e.what());
+        return nullptr;
+    }
+}
+
+void MeshCache::store(const std::filesystem::path& source, const ModelData& data) const {
+    MeshCacheHeader header{};
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.vertexStride = sizeof(Vertex);
+    if (!getSourceStamp(source, header.sourceSize, header.sourceTime)) {
+        return;
+    }
+
+    BinaryWriter writer;
+    writer.write<uint64_t>(data.images.size());
+    for (const auto& image : data.images) {
+        writer.writeString(image.path);
+        writer.writeVector(image.embedded);
+        writer.write(image.type);
+    }
+    writer.writeVector(data.textures);
+    writer.write<uint64_t>(data.materials.size());
+    for (const auto& material : data.materials) {
+        writer.writeString(material.name);
+        writer.write(material.gpuData);
+    }
+    writer.write<uint64_t>(data.meshes.size());
+    for (const auto& mesh : data.meshes) {
+        writer.writeString(mesh.name);
+        writer.writeVector(mesh.primitives);
+    }
+    writer.writeVector(data.meshlets);
+    writer.write<uint64_t>(data.nodes.size());
+    for (const auto& node : data.nodes) {
+        writer.write(node.parent);
+        writer.write(node.meshIndex);
+        writer.write(node.matrix);
+        writer.writeString(node.name);
+    }
+
+    const auto& metadata = writer.getData();
+    header.metadataOffset = sizeof(MeshCacheHeader);
+    header.metadataSize = metadata.size();
+    header.vertexOffset = alignUp(header.metadataOffset + header.metadataSize, GEOMETRY_ALIGNMENT);
+    header.vertexCount = data.vertices.size();
+    header.indexOffset = alignUp(header.vertexOffset + header.vertexCount * sizeof(Vertex), GEOMETRY_ALIGNMENT);
+    header.indexCount = data.indices.size();
+
+    std::filesystem::path cachePath = getCachePath(source);
+    std::ostringstream suffix;
+    suffix << ".tmp" << std::this_thread::get_id();
+    std::filesystem::path tempPath = cachePath;
+    tempPath += suffix.str();
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        const char padding[GEOMETRY_ALIGNMENT] = {};
+        auto pad = [&](uint64_t offset) {
+            file.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+        };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(metadata.data()), metadata.size());
+        pad(header.vertexOffset);
+        file.write(reinterpret_cast<const char*>(data.vertices.data()), data.vertices.size_bytes());
+        pad(header.indexOffset);
+        file.write(reinterpret_cast<const char*>(data.indices.data()), data.indices.size_bytes());
+        if (!file) {
+            spdlog::warn("MeshCache: failed to write {}", tempPath.string());
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cachePath, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return;
+    }
+    spdlog::info("MeshCache: cooked {} ({:.1f} MB)", cachePath.filename().string(),
+                 std::filesystem::file_size(cachePath, ec) / (1024.0 * 1024.0));
+}
+
+} // namespace astral
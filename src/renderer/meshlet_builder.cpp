@@ -0,0 +1,147 @@
+#include "astral/renderer/meshlet_builder.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace astral {
+
+namespace {
+
+// Triangle normals below this spread still give a useful cone (cos of the widest angle)
+constexpr float MIN_CONE_SPREAD = 0.1f;
+
+void computeBounds(const ModelData& data, uint32_t primitiveFirstIndex, bool useCone, Meshlet& meshlet) {
+    const uint32_t* indices = data.indices.data() + primitiveFirstIndex + meshlet.firstIndex;
+
+    glm::vec3 minPos(std::numeric_limits<float>::max());
+    glm::vec3 maxPos(std::numeric_limits<float>::lowest());
+    for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+        const glm::vec3& position = data.vertices[indices[i]].position;
+        minPos = glm::min(minPos, position);
+        maxPos = glm::max(maxPos, position);
+    }
+    meshlet.center = (minPos + maxPos) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+        meshlet.radius = std::max(meshlet.radius, glm::distance(meshlet.center, data.vertices[indices[i]].position));
+    }
+
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+    if (!useCone) {
+        return;
+    }
+
+    // Area weighted average facing, then the widest deviation from it
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.indexCount / 3);
+    glm::vec3 axis(0.0f);
+    for (uint32_t i = 0; i + 2 < meshlet.indexCount; i += 3) {
+        const glm::vec3& a = data.vertices[indices[i]].position;
+        const glm::vec3& b = data.vertices[indices[i + 1]].position;
+        const glm::vec3& c = data.vertices[indices[i + 2]].position;
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float area = glm::length(normal);
+        if (area <= 1e-12f) {
+            continue; // Degenerate, faces nowhere
+        }
+        axis += normal;
+        normals.push_back(normal / area);
+    }
+    float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength <= 1e-12f) {
+        return;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& normal : normals) {
+        minDot = std::min(minDot, glm::dot(normal, axis));
+    }
+    if (minDot <= MIN_CONE_SPREAD) {
+        return; // Faces too many ways, some triangle is front facing from almost anywhere
+    }
+    meshlet.coneAxis = axis;
+    // Back facing everywhere outside the cone's complement, widened by the sphere in the test
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+// Greedy runs of consecutive triangles over one index range (a primitive's LOD), appended to
+// data.meshlets with firstIndex relative to the range
+void buildRange(ModelData& data, std::vector<uint32_t>& vertexStamp, uint32_t firstIndex, uint32_t indexCount,
+                bool useCone, uint32_t& firstMeshlet, uint32_t& meshletCount) {
+    firstMeshlet = static_cast<uint32_t>(data.meshlets.size());
+    Meshlet meshlet{};
+    uint32_t stamp = static_cast<uint32_t>(data.meshlets.size());
+    uint32_t vertexCount = 0;
+
+    auto finish = [&]() {
+        if (meshlet.indexCount == 0) {
+            return;
+        }
+        computeBounds(data, firstIndex, useCone, meshlet);
+        data.meshlets.push_back(meshlet);
+        meshlet = Meshlet{};
+        stamp = static_cast<uint32_t>(data.meshlets.size());
+        vertexCount = 0;
+    };
+
+    // Corners not in the current meshlet yet, a degenerate triangle repeats one
+    auto countNewVertices = [&](const uint32_t* triangle) {
+        uint32_t count = 0;
+        for (uint32_t k = 0; k < 3; ++k) {
+            bool repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+            if (!repeated && vertexStamp[triangle[k]] != stamp) {
+                count++;
+            }
+        }
+        return count;
+    };
+
+    for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+        const uint32_t* triangle = data.indices.data() + firstIndex + i;
+        uint32_t newVertices = countNewVertices(triangle);
+        if (meshlet.indexCount / 3 == MAX_MESHLET_TRIANGLES || vertexCount + newVertices > MAX_MESHLET_VERTICES) {
+            finish();
+            newVertices = countNewVertices(triangle);
+        }
+        if (meshlet.indexCount == 0) {
+            meshlet.firstIndex = i;
+        }
+        for (uint32_t k = 0; k < 3; ++k) {
+            vertexStamp[triangle[k]] = stamp;
+        }
+        vertexCount += newVertices;
+        meshlet.indexCount += 3;
+    }
+    finish();
+
+    meshletCount = static_cast<uint32_t>(data.meshlets.size()) - firstMeshlet;
+}
+
+} // namespace
+
+void buildMeshlets(ModelData& data) {
+    data.meshlets.clear();
+    // Which meshlet last used a vertex, so counting unique vertices is one compare
+    std::vector<uint32_t> vertexStamp(data.vertices.size(), UINT32_MAX);
+
+    for (auto& mesh : data.meshes) {
+        for (auto& primitive : mesh.primitives) {
+            bool doubleSided = primitive.materialIndex >= 0 &&
+                               primitive.materialIndex < static_cast<int32_t>(data.materials.size()) &&
+                               data.materials[primitive.materialIndex].gpuData.doubleSided != 0;
+
+            buildRange(data, vertexStamp, primitive.firstIndex, primitive.indexCount, !doubleSided,
+                       primitive.firstMeshlet, primitive.meshletCount);
+            for (uint32_t level = 1; level < primitive.lodCount; ++level) {
+                PrimitiveLod& lod = primitive.lods[level - 1];
+                buildRange(data, vertexStamp, lod.firstIndex, lod.indexCount, !doubleSided, lod.firstMeshlet,
+                           lod.meshletCount);
+            }
+        }
+    }
+}
+
+} // namespace astral
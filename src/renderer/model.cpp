@@ -1,44 +1,82 @@
 #include "astral/renderer/model.hpp"
+#include "astral/renderer/geometry_arena.hpp"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
 
 namespace astral {
 
-VkVertexInputBindingDescription Vertex::getBindingDescription() {
-    VkVertexInputBindingDescription bindingDescription{};
-    bindingDescription.binding = 0;
-    bindingDescription.stride = sizeof(Vertex);
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    return bindingDescription;
+namespace {
+
+constexpr uint32_t POSITION_BINDING = 0;
+constexpr uint32_t ATTRIBUTE_BINDING = 1;
+
+float signNotZero(float value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
 }
 
-std::vector<VkVertexInputAttributeDescription> Vertex::getAttributeDescriptions() {
-    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(5);
+// Unit vector -> [-1, 1]^2, decoded by octDecode in pbr.vert
+glm::vec2 octEncode(glm::vec3 n) {
+    float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1 <= 0.0f) {
+        return glm::vec2(1.0f, 0.0f); // Degenerate input, any unit vector beats NaNs
+    }
+    n /= l1;
+    glm::vec2 p(n.x, n.y);
+    if (n.z < 0.0f) {
+        p = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * glm::vec2(signNotZero(n.x), signNotZero(n.y));
+    }
+    return p;
+}
 
-    attributeDescriptions[0].binding = 0;
-    attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[0].offset = offsetof(Vertex, position);
+int16_t toSnorm16(float value) {
+    return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
 
-    attributeDescriptions[1].binding = 0;
-    attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[1].offset = offsetof(Vertex, normal);
+} // namespace
 
-    attributeDescriptions[2].binding = 0;
-    attributeDescriptions[2].location = 2;
-    attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[2].offset = offsetof(Vertex, uv);
+PackedVertex PackedVertex::pack(const Vertex& vertex) {
+    PackedVertex packed;
+    packed.normal = glm::packSnorm2x16(octEncode(vertex.normal));
 
-    attributeDescriptions[3].binding = 0;
-    attributeDescriptions[3].location = 3;
-    attributeDescriptions[3].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    attributeDescriptions[3].offset = offsetof(Vertex, tangent);
+    glm::vec2 tangent = octEncode(glm::vec3(vertex.tangent));
+    uint16_t x = static_cast<uint16_t>(toSnorm16(tangent.x));
+    uint16_t y = static_cast<uint16_t>(toSnorm16(tangent.y));
+    y = static_cast<uint16_t>((y & ~1u) | (vertex.tangent.w < 0.0f ? 1u : 0u));
+    packed.tangent = static_cast<uint32_t>(x) | (static_cast<uint32_t>(y) << 16);
 
-    attributeDescriptions[4].binding = 0;
-    attributeDescriptions[4].location = 4;
-    attributeDescriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    attributeDescriptions[4].offset = offsetof(Vertex, color);
+    packed.uv = glm::packHalf2x16(vertex.uv);
+    packed.color = glm::packUnorm4x8(vertex.color);
+    return packed;
+}
+
+std::vector<VkVertexInputBindingDescription> PackedVertex::getBindingDescriptions() {
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions = getPositionBindingDescriptions();
+    bindingDescriptions.push_back({ATTRIBUTE_BINDING, sizeof(PackedVertex), VK_VERTEX_INPUT_RATE_VERTEX});
+    return bindingDescriptions;
+}
 
+std::vector<VkVertexInputAttributeDescription> PackedVertex::getAttributeDescriptions() {
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions = getPositionAttributeDescriptions();
+    attributeDescriptions.push_back({1, ATTRIBUTE_BINDING, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal)});
+    attributeDescriptions.push_back({2, ATTRIBUTE_BINDING, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv)});
+    attributeDescriptions.push_back({3, ATTRIBUTE_BINDING, VK_FORMAT_R16G16_SINT, offsetof(PackedVertex, tangent)});
+    attributeDescriptions.push_back({4, ATTRIBUTE_BINDING, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color)});
     return attributeDescriptions;
 }
 
+std::vector<VkVertexInputBindingDescription> PackedVertex::getPositionBindingDescriptions() {
+    return {{POSITION_BINDING, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX}};
+}
+
+std::vector<VkVertexInputAttributeDescription> PackedVertex::getPositionAttributeDescriptions() {
+    return {{0, POSITION_BINDING, VK_FORMAT_R32G32B32_SFLOAT, 0}};
+}
+
+Model::~Model() {
+    if (arena && geometry != INVALID_GEOMETRY) {
+        arena->free(geometry);
+    }
+}
+
 } // namespace astral
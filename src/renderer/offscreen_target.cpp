@@ -0,0 +1,159 @@
+#include "astral/renderer/offscreen_target.hpp"
+#include <spdlog/spdlog.h>
+#include <stb_image_write.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace astral {
+
+OffscreenTarget::OffscreenTarget(Context* context, uint32_t width, uint32_t height, VkFormat format,
+                                 uint32_t framesInFlight, const std::filesystem::path& outputDirectory)
+    : m_context(context), m_width(width), m_height(height), m_format(format),
+      m_outputDirectory(outputDirectory) {
+
+    if (format != VK_FORMAT_R8G8B8A8_UNORM && format != VK_FORMAT_B8G8R8A8_UNORM &&
+        format != VK_FORMAT_R8G8B8A8_SRGB && format != VK_FORMAT_B8G8R8A8_SRGB) {
+        throw std::runtime_error("OffscreenTarget only supports 8-bit RGBA/BGRA formats!");
+    }
+
+    std::filesystem::create_directories(m_outputDirectory);
+
+    ImageSpecs specs;
+    specs.width = width;
+    specs.height = height;
+    specs.format = format;
+    specs.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    specs.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
+
+    VkDeviceSize frameSize = static_cast<VkDeviceSize>(width) * height * 4;
+
+    m_frames.resize(framesInFlight);
+    for (auto& frame : m_frames) {
+        frame.image = std::make_unique<Image>(m_context, specs);
+        frame.readback = std::make_unique<Buffer>(
+            m_context, frameSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+        // Stays mapped for the target's lifetime, Buffer unmaps on destruction
+        frame.readback->map(&frame.mapped);
+    }
+
+    m_writer = std::thread(&OffscreenTarget::writerLoop, this);
+
+    spdlog::info("OffscreenTarget: {}x{}, {} frames in flight, writing to {}",
+                 width, height, framesInFlight, m_outputDirectory.string());
+}
+
+OffscreenTarget::~OffscreenTarget() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_jobCv.notify_all();
+    if (m_writer.joinable()) {
+        m_writer.join();
+    }
+}
+
+void OffscreenTarget::recordReadback(VkCommandBuffer cmd, uint32_t frameIndex, uint32_t frameNumber) {
+    auto& frame = m_frames[frameIndex];
+
+    VkBufferImageCopy region = {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {m_width, m_height, 1};
+
+    vkCmdCopyImageToBuffer(cmd, frame.image->getHandle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           frame.readback->getHandle(), 1, &region);
+
+    // Make the copy visible to the host once the fence signals
+    VkBufferMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+    barrier.buffer = frame.readback->getHandle();
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    VkDependencyInfo depInfo = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    depInfo.bufferMemoryBarrierCount = 1;
+    depInfo.pBufferMemoryBarriers = &barrier;
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+
+    frame.pending = true;
+    frame.frameNumber = frameNumber;
+}
+
+void OffscreenTarget::collect(uint32_t frameIndex) {
+    auto& frame = m_frames[frameIndex];
+    if (!frame.pending) return;
+
+    {
+        // Wait before copying out so at most kMaxQueuedJobs + 1 frames are held in memory
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idleCv.wait(lock, [this] { return m_jobs.size() < kMaxQueuedJobs; });
+    }
+
+    vmaInvalidateAllocation(m_context->getAllocator(), frame.readback->getAllocation(), 0, VK_WHOLE_SIZE);
+
+    WriteJob job;
+    job.frameNumber = frame.frameNumber;
+    job.pixels.resize(frame.readback->getSize());
+    memcpy(job.pixels.data(), frame.mapped, job.pixels.size());
+    frame.pending = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_jobCv.notify_one();
+}
+
+void OffscreenTarget::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idleCv.wait(lock, [this] { return m_jobs.empty() && !m_busy; });
+}
+
+void OffscreenTarget::writerLoop() {
+    bool isBGRA = (m_format == VK_FORMAT_B8G8R8A8_UNORM || m_format == VK_FORMAT_B8G8R8A8_SRGB);
+
+    while (true) {
+        WriteJob job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobCv.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty()) break; // m_stop and drained
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_busy = true;
+        }
+        m_idleCv.notify_all(); // A queue slot freed up for collect()
+
+        if (isBGRA) {
+            for (size_t i = 0; i + 3 < job.pixels.size(); i += 4) {
+                std::swap(job.pixels[i], job.pixels[i + 2]);
+            }
+        }
+
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "frame_%06u.png", job.frameNumber);
+        std::filesystem::path path = m_outputDirectory / fileName;
+
+        if (!stbi_write_png(path.string().c_str(), (int)m_width, (int)m_height, 4,
+                            job.pixels.data(), (int)m_width * 4)) {
+            spdlog::error("OffscreenTarget: Failed to write {}", path.string());
+        } else {
+            m_framesWritten++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy = false;
+        }
+        m_idleCv.notify_all();
+    }
+}
+
+} // namespace astral
@@ -31,6 +31,7 @@ GraphicsPipeline::GraphicsPipeline(Context* context, const PipelineSpecs& specs)
     rasterizer.polygonMode = specs.polygonMode;
     rasterizer.lineWidth = 1.0f;
     rasterizer.cullMode = specs.cullMode;
+    rasterizer.depthClampEnable = specs.depthClamp ? VK_TRUE : VK_FALSE;
     rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
 
     VkPipelineMultisampleStateCreateInfo multisampling = {};
@@ -1,21 +1,165 @@
 #include "astral/renderer/render_graph.hpp"
+#include "astral/renderer/descriptor_manager.hpp"
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
 
 namespace astral {
 
-RenderGraph::RenderGraph(Context* context) : m_context(context) {}
+namespace {
 
-RenderGraph::~RenderGraph() {}
+bool isDepthFormat(VkFormat format) {
+    return format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+}
+
+struct UsageInfo {
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    VkImageLayout layout; // Ignored for buffers
+    bool write;
+    bool readsContents; // Consumes what earlier passes wrote (drives culling)
+};
+
+constexpr VkAccessFlags2 kWriteAccessMask =
+    VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+    VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+// loadsAttachment: the pass keeps the previous attachment contents (LOAD_OP_LOAD)
+UsageInfo getUsageInfo(ResourceUsage usage, bool loadsAttachment) {
+    switch (usage) {
+    case ResourceUsage::ColorAttachment:
+        return {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | (loadsAttachment ? VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT : VK_ACCESS_2_NONE),
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true, loadsAttachment};
+    case ResourceUsage::DepthAttachment:
+        return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, true, loadsAttachment};
+    case ResourceUsage::DepthAttachmentLoad:
+        return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, true, true};
+    case ResourceUsage::DepthAttachmentReadOnly:
+        return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, false, true};
+    case ResourceUsage::SampledFragment:
+        return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false, true};
+    case ResourceUsage::SampledCompute:
+        return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false, true};
+    case ResourceUsage::StorageReadVertex:
+        return {VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL, false, true};
+    case ResourceUsage::StorageReadFragment:
+        return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL, false, true};
+    case ResourceUsage::StorageReadCompute:
+        return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL, false, true};
+    case ResourceUsage::StorageWriteCompute:
+        return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                VK_IMAGE_LAYOUT_GENERAL, true, false};
+    case ResourceUsage::StorageReadWriteCompute:
+        return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                VK_IMAGE_LAYOUT_GENERAL, true, true};
+    case ResourceUsage::IndirectRead:
+        return {VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED, false, true};
+    case ResourceUsage::CopySrc:
+        return {VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false, true};
+    case ResourceUsage::CopyDst:
+        return {VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true, false};
+    case ResourceUsage::BlitSrc:
+        return {VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false, true};
+    case ResourceUsage::BlitDst:
+        return {VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true, false};
+    case ResourceUsage::Clear:
+        return {VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true, false};
+    }
+    return {VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, true, true};
+}
+
+bool isAttachment(ResourceUsage usage) {
+    return usage == ResourceUsage::ColorAttachment || usage == ResourceUsage::DepthAttachment ||
+           usage == ResourceUsage::DepthAttachmentReadOnly || usage == ResourceUsage::DepthAttachmentLoad;
+}
+
+bool samePhysical(const RenderPassResource& a, const RenderPassResource& b) {
+    // Transients have no handle before compile() realizes them, and aliasing is only
+    // ever between lifetimes that don't overlap, so identity by name is enough
+    if (a.isTransient || b.isTransient) return a.isTransient && b.isTransient && a.name == b.name;
+    if (a.buffer != VK_NULL_HANDLE || b.buffer != VK_NULL_HANDLE) return a.buffer == b.buffer;
+    return a.image != VK_NULL_HANDLE && a.image == b.image;
+}
+
+bool layersOverlap(const RenderPassResource& a, const RenderPassResource& b) {
+    if (a.buffer != VK_NULL_HANDLE) return true;
+    uint64_t aEnd = a.layerCount == VK_REMAINING_ARRAY_LAYERS ? UINT64_MAX : (uint64_t)a.baseArrayLayer + a.layerCount;
+    uint64_t bEnd = b.layerCount == VK_REMAINING_ARRAY_LAYERS ? UINT64_MAX : (uint64_t)b.baseArrayLayer + b.layerCount;
+    return a.baseArrayLayer < bEnd && b.baseArrayLayer < aEnd;
+}
+
+struct BarrierMasks {
+    VkPipelineStageFlags2 srcStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+    VkPipelineStageFlags2 dstStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 dstAccess = VK_ACCESS_2_NONE;
+    VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+} // namespace
+
+RenderGraph::RenderGraph(Context* context, JobSystem* jobSystem) : m_context(context), m_jobSystem(jobSystem) {}
 
-void RenderGraph::addPass(const std::string& name, 
-                         const std::vector<std::string>& inputs, 
-                         const std::vector<std::string>& outputs, 
+RenderGraph::~RenderGraph() {
+    if (m_transients.empty() && m_recordPools.empty()) return;
+
+    vkDeviceWaitIdle(m_context->getDevice());
+    destroyTransients();
+    for (auto& framePools : m_recordPools) {
+        for (auto& pool : framePools) {
+            vkDestroyCommandPool(m_context->getDevice(), pool.pool, nullptr);
+        }
+    }
+}
+
+void RenderGraph::addPass(const std::string& name,
+                         const std::vector<std::string>& inputs,
+                         const std::vector<std::string>& outputs,
+                         RenderPassExecuteCallback execute,
+                         bool clearOutputs) {
+    std::vector<RenderPassAccess> accesses;
+    for (const auto& input : inputs) {
+        accesses.push_back({input, ResourceUsage::SampledFragment});
+    }
+    for (const auto& output : outputs) {
+        // Resources can be registered after the pass, so the depth check waits for compile()
+        accesses.push_back({output, ResourceUsage::ColorAttachment});
+    }
+    m_passes.push_back({name, accesses, execute, clearOutputs});
+}
+
+void RenderGraph::addPass(const std::string& name,
+                         const std::vector<RenderPassAccess>& accesses,
                          RenderPassExecuteCallback execute,
                          bool clearOutputs) {
-    m_passes.push_back({name, inputs, outputs, execute, clearOutputs});
+    m_passes.push_back({name, accesses, execute, clearOutputs});
 }
 
-void RenderGraph::addExternalResource(const std::string& name, VkImage image, VkImageView view, VkFormat format, uint32_t width, uint32_t height, VkImageLayout initialLayout) {
+void RenderGraph::addExternalResource(const std::string& name, VkImage image, VkImageView view, VkFormat format, uint32_t width, uint32_t height,
+                                      VkImageLayout initialLayout, uint32_t baseArrayLayer, uint32_t layerCount) {
     RenderPassResource res;
     res.name = name;
     res.image = image;
@@ -23,11 +167,48 @@ void RenderGraph::addExternalResource(const std::string& name, VkImage image, Vk
     res.format = format;
     res.width = width;
     res.height = height;
+    res.baseArrayLayer = baseArrayLayer;
+    res.layerCount = layerCount;
     res.isExternal = true;
     res.currentLayout = initialLayout;
     res.clearValue.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
     m_resources[name] = res;
-    m_imageLayouts[image] = initialLayout;
+    // Only the layout is reset, stage history carries over from the previous frame
+    m_imageStates[image].layout = initialLayout;
+}
+
+void RenderGraph::addExternalBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize size) {
+    RenderPassResource res;
+    res.name = name;
+    res.buffer = buffer;
+    res.size = size;
+    res.format = VK_FORMAT_UNDEFINED;
+    res.width = 0;
+    res.height = 0;
+    res.isExternal = true;
+    m_resources[name] = res;
+}
+
+void RenderGraph::addTransientImage(const std::string& name, const TransientImageDesc& desc) {
+    RenderPassResource res;
+    res.name = name;
+    res.format = desc.format;
+    res.width = desc.width;
+    res.height = desc.height;
+    res.isTransient = true;
+    res.clearValue.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    m_resources[name] = res;
+    m_transientDescs[name] = desc;
+}
+
+VkImage RenderGraph::getImage(const std::string& name) const {
+    auto it = m_resources.find(name);
+    return it != m_resources.end() ? it->second.image : VK_NULL_HANDLE;
+}
+
+VkImageView RenderGraph::getImageView(const std::string& name) const {
+    auto it = m_resources.find(name);
+    return it != m_resources.end() ? it->second.view : VK_NULL_HANDLE;
 }
 
 void RenderGraph::setResourceClearValue(const std::string& name, VkClearValue clearValue) {
@@ -36,172 +217,757 @@ void RenderGraph::setResourceClearValue(const std::string& name, VkClearValue cl
     }
 }
 
-void RenderGraph::execute(VkCommandBuffer cmd, VkExtent2D extent) {
-    for (size_t i = 0; i < m_passes.size(); ++i) {
-        const auto& pass = m_passes[i];
-        bool isLastPass = (i == m_passes.size() - 1);
+void RenderGraph::setResourceFinalLayout(const std::string& name, VkImageLayout finalLayout) {
+    if (m_resources.find(name) != m_resources.end()) {
+        m_resources[name].finalLayout = finalLayout;
+    }
+}
 
-        std::vector<VkImageMemoryBarrier2> barriers;
+void RenderGraph::markExported(const std::string& name) {
+    auto it = m_resources.find(name);
+    if (it == m_resources.end()) {
+        throw std::runtime_error("RenderGraph: Cannot export unknown resource '" + name + "'!");
+    }
+    it->second.isExported = true;
+}
 
-        // Handle Inputs (Transition to Shader Read)
-        for (const auto& inputName : pass.inputs) {
-            auto& res = m_resources[inputName];
-            if (m_imageLayouts[res.image] != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-                bool isDepth = (res.format == VK_FORMAT_D32_SFLOAT || res.format == VK_FORMAT_D32_SFLOAT_S8_UINT || res.format == VK_FORMAT_D24_UNORM_S8_UINT);
-                
-                VkImageMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
-                barrier.image = res.image;
-                
-                if (isDepth) {
-                    barrier.srcStageMask = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
-                    barrier.srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-                    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-                } else {
-                    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
-                    barrier.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
-                    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+void RenderGraph::setPassHooks(const std::string& passName, RenderPassExecuteCallback before,
+                               RenderPassExecuteCallback after) {
+    auto it = std::find_if(m_passes.rbegin(), m_passes.rend(),
+                           [&passName](const RenderPassNode& pass) { return pass.name == passName; });
+    if (it == m_passes.rend()) {
+        throw std::runtime_error("RenderGraph: Cannot hook unknown pass '" + passName + "'!");
+    }
+    it->before = std::move(before);
+    it->after = std::move(after);
+}
+
+const RenderPassResource& RenderGraph::getResource(const RenderPassNode& pass, const std::string& name) const {
+    auto it = m_resources.find(name);
+    if (it == m_resources.end()) {
+        throw std::runtime_error("RenderGraph: Pass '" + pass.name + "' uses unknown resource '" + name + "'!");
+    }
+    return it->second;
+}
+
+bool RenderGraph::dependsOn(const RenderPassNode& later, const RenderPassNode& earlier) const {
+    for (const auto& a : earlier.accesses) {
+        const auto& resA = getResource(earlier, a.resource);
+        UsageInfo infoA = getUsageInfo(a.usage, !earlier.clearOutputs);
+        for (const auto& b : later.accesses) {
+            const auto& resB = getResource(later, b.resource);
+            if (!samePhysical(resA, resB)) continue;
+            UsageInfo infoB = getUsageInfo(b.usage, !later.clearOutputs);
+
+            // Layout is tracked per image, so a different layout is a hazard even on disjoint layers
+            if (resA.buffer == VK_NULL_HANDLE && infoA.layout != infoB.layout) return true;
+            if ((infoA.write || infoB.write) && layersOverlap(resA, resB)) return true;
+        }
+    }
+    return false;
+}
+
+bool RenderGraph::readsFrom(const RenderPassNode& reader, const RenderPassNode& writer) const {
+    for (const auto& w : writer.accesses) {
+        if (!getUsageInfo(w.usage, !writer.clearOutputs).write) continue;
+        const auto& resW = getResource(writer, w.resource);
+        for (const auto& r : reader.accesses) {
+            if (!getUsageInfo(r.usage, !reader.clearOutputs).readsContents) continue;
+            const auto& resR = getResource(reader, r.resource);
+            if (samePhysical(resW, resR) && layersOverlap(resW, resR)) return true;
+        }
+    }
+    return false;
+}
+
+void RenderGraph::compile() {
+    // Legacy outputs are declared as color attachments, fix up depth targets now that formats are known
+    for (auto& pass : m_passes) {
+        for (auto& access : pass.accesses) {
+            if (access.usage == ResourceUsage::ColorAttachment && isDepthFormat(getResource(pass, access.resource).format)) {
+                access.usage = ResourceUsage::DepthAttachment;
+            }
+        }
+    }
+
+    const size_t passCount = m_passes.size();
+    m_levels.clear();
+    m_stats = {};
+    m_stats.passCount = static_cast<uint32_t>(passCount);
+
+    // Roots are passes writing something that leaves the graph (swapchain / readback image)
+    // or that is read after execute() (exported)
+    std::vector<const RenderPassResource*> exported;
+    for (const auto& [name, res] : m_resources) {
+        if (res.isExported) exported.push_back(&res);
+    }
+    std::vector<bool> live(passCount, false);
+    bool hasRoots = false;
+    for (size_t i = 0; i < passCount; ++i) {
+        for (const auto& access : m_passes[i].accesses) {
+            if (!getUsageInfo(access.usage, false).write) continue;
+            const auto& res = getResource(m_passes[i], access.resource);
+            bool leavesGraph = res.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED ||
+                               std::any_of(exported.begin(), exported.end(), [&res](const RenderPassResource* e) {
+                                   return samePhysical(res, *e) && layersOverlap(res, *e);
+                               });
+            if (leavesGraph) {
+                live[i] = true;
+                hasRoots = true;
+            }
+        }
+    }
+
+    if (!hasRoots) {
+        // Nothing declared as graph output, nothing to cull against
+        std::fill(live.begin(), live.end(), true);
+    } else {
+        // Walk backwards, a pass survives if a surviving later pass consumes its writes
+        for (size_t i = passCount; i-- > 0;) {
+            if (live[i]) continue;
+            for (size_t j = i + 1; j < passCount && !live[i]; ++j) {
+                if (live[j] && readsFrom(m_passes[j], m_passes[i])) {
+                    live[i] = true;
                 }
-                
-                barrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
-                barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
-                barrier.oldLayout = m_imageLayouts[res.image];
-                barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                barrier.subresourceRange.baseMipLevel = 0;
-                barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
-                barrier.subresourceRange.baseArrayLayer = 0;
-                barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
-                barriers.push_back(barrier);
-                m_imageLayouts[res.image] = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                res.currentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            }
-        }
-
-        // Handle Outputs (Transition to Color/Depth Attachment)
-        for (const auto& outName : pass.outputs) {
-            auto& res = m_resources[outName];
-            bool isDepth = (res.format == VK_FORMAT_D32_SFLOAT || res.format == VK_FORMAT_D32_SFLOAT_S8_UINT || res.format == VK_FORMAT_D24_UNORM_S8_UINT);
-            VkImageLayout targetLayout = isDepth ? VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-            if (m_imageLayouts[res.image] != targetLayout) {
-                VkImageMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
-                barrier.image = res.image;
-                barrier.srcStageMask = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT;
-                barrier.srcAccessMask = 0;
-                barrier.dstStageMask = isDepth ? VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT : VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
-                barrier.dstAccessMask = isDepth ? VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
-                barrier.oldLayout = m_imageLayouts[res.image];
-                barrier.newLayout = targetLayout;
-                barrier.subresourceRange.aspectMask = isDepth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
-                barrier.subresourceRange.baseMipLevel = 0;
-                barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
-                barrier.subresourceRange.baseArrayLayer = 0;
-                barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
-                barriers.push_back(barrier);
-                m_imageLayouts[res.image] = targetLayout;
-                res.currentLayout = targetLayout;
-            }
-        }
-
-        if (!barriers.empty()) {
-            VkDependencyInfo depInfo = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
-            depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
-            depInfo.pImageMemoryBarriers = barriers.data();
-            vkCmdPipelineBarrier2(cmd, &depInfo);
+            }
+            if (!live[i]) {
+                spdlog::trace("RenderGraph: Culled pass '{}'", m_passes[i].name);
+                m_stats.culledPassCount++;
+            }
+        }
+    }
+
+    // Declaration order is already a valid topological order (edges only point forward),
+    // so the level of a pass is one past the deepest pass it depends on
+    std::vector<uint32_t> levels(passCount, 0);
+    for (size_t i = 0; i < passCount; ++i) {
+        if (!live[i]) continue;
+        for (size_t j = 0; j < i; ++j) {
+            if (live[j] && dependsOn(m_passes[i], m_passes[j])) {
+                levels[i] = std::max(levels[i], levels[j] + 1);
+            }
+        }
+        if (levels[i] >= m_levels.size()) {
+            m_levels.resize(levels[i] + 1);
         }
+        m_levels[levels[i]].push_back(static_cast<uint32_t>(i));
+    }
+    m_stats.levelCount = static_cast<uint32_t>(m_levels.size());
 
-        // Prepare Attachments
-        std::vector<VkRenderingAttachmentInfo> colorAttachments;
-        VkRenderingAttachmentInfo depthAttachment = {VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
-        bool hasDepth = false;
-
-        for (const auto& outName : pass.outputs) {
-            auto& res = m_resources[outName];
-            
-            bool isDepth = (res.format == VK_FORMAT_D32_SFLOAT || res.format == VK_FORMAT_D32_SFLOAT_S8_UINT || res.format == VK_FORMAT_D24_UNORM_S8_UINT);
-            
-            VkRenderingAttachmentInfo attachment = {VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
-            attachment.imageView = res.view;
-            attachment.imageLayout = isDepth ? VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-            attachment.loadOp = pass.clearOutputs ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
-            attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-            attachment.clearValue = res.clearValue;
-
-            if (isDepth) {
-                depthAttachment = attachment;
-                hasDepth = true;
+    realizeTransients();
+}
+
+void RenderGraph::realizeTransients() {
+    if (m_transientDescs.empty()) return;
+
+    // Lifetime is the level span of the live passes touching it, levels are walked in order
+    std::map<std::string, TransientImage> planned;
+    for (uint32_t level = 0; level < m_levels.size(); ++level) {
+        for (uint32_t passIndex : m_levels[level]) {
+            for (const auto& access : m_passes[passIndex].accesses) {
+                auto desc = m_transientDescs.find(access.resource);
+                if (desc == m_transientDescs.end()) continue;
+                auto [it, inserted] = planned.try_emplace(access.resource);
+                if (inserted) {
+                    it->second.desc = desc->second;
+                    it->second.firstLevel = level;
+                }
+                it->second.lastLevel = level;
+            }
+        }
+    }
+    // Declared but untouched (e.g. its passes were culled): keep it valid for the whole frame
+    uint32_t lastLevel = m_levels.empty() ? 0 : static_cast<uint32_t>(m_levels.size() - 1);
+    for (const auto& [name, desc] : m_transientDescs) {
+        auto [it, inserted] = planned.try_emplace(name);
+        if (inserted) {
+            it->second.desc = desc;
+            it->second.firstLevel = 0;
+            it->second.lastLevel = lastLevel;
+        }
+    }
+
+    // The plan covers every transient declared since the last resize, not just this frame's.
+    // Targets of a feature that is off stay allocated, so toggling features (SSAO, visibility
+    // buffer, prepass...) keeps the plan as long as its aliasing still holds.
+    bool newTransient = false;
+    bool descChanged = false;
+    for (const auto& [name, transient] : planned) {
+        auto current = m_transients.find(name);
+        if (current == m_transients.end()) {
+            newTransient = true;
+            continue;
+        }
+        const auto& a = transient.desc;
+        const auto& b = current->second.desc;
+        descChanged |= a.width != b.width || a.height != b.height || a.format != b.format || a.usage != b.usage ||
+                       a.bindlessIndex != b.bindlessIndex || a.sampler != b.sampler || a.storageIndex != b.storageIndex;
+    }
+
+    // Same images and blocks: still valid if no two images sharing a block are alive at once
+    bool aliasConflict = false;
+    if (!newTransient && !descChanged) {
+        for (auto a = planned.begin(); a != planned.end() && !aliasConflict; ++a) {
+            for (auto b = std::next(a); b != planned.end() && !aliasConflict; ++b) {
+                aliasConflict = m_transients[a->first].block == m_transients[b->first].block &&
+                                a->second.firstLevel <= b->second.lastLevel && b->second.firstLevel <= a->second.lastLevel;
+            }
+        }
+    }
+
+    if (newTransient || descChanged || aliasConflict) {
+        VkDevice device = m_context->getDevice();
+        VmaAllocator allocator = m_context->getAllocator();
+
+        // A changed desc means a resize / reconfiguration, the undeclared targets would be
+        // stale, so only then the superset starts over
+        if (!descChanged) {
+            for (const auto& [name, transient] : m_transients) {
+                planned.try_emplace(name, transient); // Last lifetime it was declared with
+            }
+        }
+
+        // Only happens on resize / when the frame structure changes, the old images may still be in flight
+        vkDeviceWaitIdle(device);
+        destroyTransients();
+        m_transients = planned;
+
+        std::vector<TransientImage*> order;
+        for (auto& [name, transient] : m_transients) {
+            VkImageCreateInfo imageInfo = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent = {transient.desc.width, transient.desc.height, 1};
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = transient.desc.format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = transient.desc.usage;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            if (vkCreateImage(device, &imageInfo, nullptr, &transient.image) != VK_SUCCESS) {
+                throw std::runtime_error("RenderGraph: Failed to create transient image '" + name + "'!");
+            }
+            vkGetImageMemoryRequirements(device, transient.image, &transient.requirements);
+            order.push_back(&transient);
+        }
+
+        // Largest first, each image joins the first block whose users are all dead before
+        // it starts (or start after it ends), otherwise it opens a new block
+        std::sort(order.begin(), order.end(), [](const TransientImage* a, const TransientImage* b) {
+            return a->requirements.size > b->requirements.size;
+        });
+
+        std::vector<VkMemoryRequirements> blockRequirements;
+        std::vector<std::vector<TransientImage*>> blockUsers;
+        for (TransientImage* transient : order) {
+            size_t target = blockRequirements.size();
+            for (size_t b = 0; b < blockRequirements.size(); ++b) {
+                if ((blockRequirements[b].memoryTypeBits & transient->requirements.memoryTypeBits) == 0) continue;
+                bool overlaps = std::any_of(blockUsers[b].begin(), blockUsers[b].end(), [transient](const TransientImage* user) {
+                    return user->firstLevel <= transient->lastLevel && transient->firstLevel <= user->lastLevel;
+                });
+                if (!overlaps) {
+                    target = b;
+                    break;
+                }
+            }
+
+            if (target == blockRequirements.size()) {
+                blockRequirements.push_back(transient->requirements);
+                blockUsers.emplace_back();
             } else {
-                colorAttachments.push_back(attachment);
+                auto& req = blockRequirements[target];
+                req.size = std::max(req.size, transient->requirements.size);
+                req.alignment = std::max(req.alignment, transient->requirements.alignment);
+                req.memoryTypeBits &= transient->requirements.memoryTypeBits;
             }
+            transient->block = static_cast<uint32_t>(target);
+            blockUsers[target].push_back(transient);
         }
 
-        if (!pass.outputs.empty()) {
-            VkRenderingInfo renderingInfo = {VK_STRUCTURE_TYPE_RENDERING_INFO};
-            const auto& firstOut = m_resources[pass.outputs[0]];
-            renderingInfo.renderArea = {{0, 0}, {firstOut.width, firstOut.height}};
-            renderingInfo.layerCount = 1;
-            renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
-            renderingInfo.pColorAttachments = colorAttachments.data();
-            if (hasDepth) {
-                renderingInfo.pDepthAttachment = &depthAttachment;
+        m_transientBytesRequested = 0;
+        m_transientBytesAllocated = 0;
+        for (size_t b = 0; b < blockRequirements.size(); ++b) {
+            VmaAllocationCreateInfo allocInfo = {};
+            allocInfo.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+            VmaAllocation allocation;
+            if (vmaAllocateMemory(allocator, &blockRequirements[b], &allocInfo, &allocation, nullptr) != VK_SUCCESS) {
+                throw std::runtime_error("RenderGraph: Failed to allocate transient memory block!");
             }
+            m_transientBlocks.push_back(allocation);
+            m_blockImages.emplace_back();
+            m_transientBytesAllocated += blockRequirements[b].size;
 
-            spdlog::trace("RenderGraph: Executing pass '{}' with {} color attachments, hasDepth={}",
-                          pass.name, colorAttachments.size(), hasDepth);
+            for (TransientImage* user : blockUsers[b]) {
+                vmaBindImageMemory(allocator, allocation, user->image);
+                m_blockImages.back().push_back(user->image);
+                m_transientBytesRequested += user->requirements.size;
+            }
+        }
 
-            vkCmdBeginRendering(cmd, &renderingInfo);
-            pass.execute(cmd);
-            vkCmdEndRendering(cmd);
+        for (auto& [name, transient] : m_transients) {
+            bool isDepth = isDepthFormat(transient.desc.format);
+
+            VkImageViewCreateInfo viewInfo = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+            viewInfo.image = transient.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = transient.desc.format;
+            viewInfo.subresourceRange.aspectMask = isDepth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+            if (vkCreateImageView(device, &viewInfo, nullptr, &transient.view) != VK_SUCCESS) {
+                throw std::runtime_error("RenderGraph: Failed to create transient image view '" + name + "'!");
+            }
+
+            if (transient.desc.bindlessIndex != UINT32_MAX) {
+                m_context->getDescriptorManager().updateImage(transient.desc.bindlessIndex, transient.view, transient.desc.sampler);
+            }
+            if (transient.desc.storageIndex != UINT32_MAX) {
+                m_context->getDescriptorManager().updateStorageImage(transient.desc.storageIndex, transient.view);
+            }
+        }
+
+        spdlog::info("RenderGraph: {} transient images aliased into {} blocks, {:.1f} MB instead of {:.1f} MB (saved {:.1f} MB)",
+                     m_transients.size(), m_transientBlocks.size(),
+                     m_transientBytesAllocated / (1024.0 * 1024.0), m_transientBytesRequested / (1024.0 * 1024.0),
+                     (m_transientBytesRequested - m_transientBytesAllocated) / (1024.0 * 1024.0));
+    }
+
+    for (const auto& [name, lifetime] : planned) {
+        auto& transient = m_transients[name];
+        transient.firstLevel = lifetime.firstLevel;
+        transient.lastLevel = lifetime.lastLevel;
+        if (m_transientDescs.find(name) == m_transientDescs.end()) continue; // Not declared this frame
+
+        auto& res = m_resources[name];
+        res.image = transient.image;
+        res.view = transient.view;
+        // Contents never carry over between frames (or past an alias taking the memory)
+        m_imageStates[transient.image].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
+    m_stats.transientImageCount = static_cast<uint32_t>(m_transients.size());
+    m_stats.transientBlockCount = static_cast<uint32_t>(m_transientBlocks.size());
+    m_stats.transientBytesRequested = m_transientBytesRequested;
+    m_stats.transientBytesAllocated = m_transientBytesAllocated;
+}
+
+void RenderGraph::destroyTransients() {
+    VkDevice device = m_context->getDevice();
+    for (auto& [name, transient] : m_transients) {
+        vkDestroyImageView(device, transient.view, nullptr);
+        vkDestroyImage(device, transient.image, nullptr);
+        m_imageStates.erase(transient.image);
+    }
+    for (VmaAllocation allocation : m_transientBlocks) {
+        vmaFreeMemory(m_context->getAllocator(), allocation);
+    }
+    m_transients.clear();
+    m_transientBlocks.clear();
+    m_blockImages.clear();
+}
+
+// Decides what has to happen before `usage` can touch a resource in `state`,
+// and advances the state. Returns false when no barrier is needed.
+static bool resolveAccess(ResourceSyncState& state, const UsageInfo& usage, bool isImage, BarrierMasks& out) {
+    bool layoutChange = isImage && state.layout != usage.layout;
+    bool needed = false;
+
+    out.oldLayout = state.layout;
+    out.newLayout = usage.layout;
+    out.dstStage = usage.stages;
+    out.dstAccess = usage.access;
+
+    if (usage.write || layoutChange) {
+        // WAW/WAR (or a transition, which is a write): wait for the last write and every read since
+        out.srcStage = state.writeStages | state.readStages;
+        out.srcAccess = state.writeAccess;
+        needed = layoutChange || out.srcStage != VK_PIPELINE_STAGE_2_NONE;
+
+        state.layout = usage.layout;
+        state.writeStages = usage.stages;
+        state.writeAccess = usage.write ? (usage.access & kWriteAccessMask) : VK_ACCESS_2_NONE;
+        state.readStages = usage.write ? VK_PIPELINE_STAGE_2_NONE : usage.stages;
+        state.visibleStages = usage.stages;
+        state.visibleAccess = usage.access;
+    } else {
+        // RAW: only if the last write isn't visible to this stage/access yet
+        bool covered = (usage.stages & ~state.visibleStages) == 0 && (usage.access & ~state.visibleAccess) == 0;
+        if (state.writeStages != VK_PIPELINE_STAGE_2_NONE && !covered) {
+            out.srcStage = state.writeStages;
+            out.srcAccess = state.writeAccess;
+            needed = true;
+            state.visibleStages |= usage.stages;
+            state.visibleAccess |= usage.access;
+        }
+        state.readStages |= usage.stages;
+    }
+    return needed;
+}
+
+void RenderGraph::recordPass(VkCommandBuffer cmd, const RenderPassNode& pass, VkCommandBuffer secondary) {
+    if (pass.before) {
+        pass.before(cmd);
+    }
+
+    // Prepare Attachments
+    std::vector<VkRenderingAttachmentInfo> colorAttachments;
+    VkRenderingAttachmentInfo depthAttachment = {VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+    bool hasDepth = false;
+    const RenderPassResource* firstOut = nullptr;
+
+    for (const auto& access : pass.accesses) {
+        if (!isAttachment(access.usage)) continue;
+        const auto& res = getResource(pass, access.resource);
+        if (!firstOut) firstOut = &res;
+
+        bool readOnly = (access.usage == ResourceUsage::DepthAttachmentReadOnly);
+        bool keepsContents = readOnly || access.usage == ResourceUsage::DepthAttachmentLoad;
+
+        VkRenderingAttachmentInfo attachment = {VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+        attachment.imageView = res.view;
+        attachment.imageLayout = getUsageInfo(access.usage, !pass.clearOutputs).layout;
+        attachment.loadOp = (pass.clearOutputs && !keepsContents) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+        attachment.storeOp = readOnly ? VK_ATTACHMENT_STORE_OP_NONE : VK_ATTACHMENT_STORE_OP_STORE;
+        attachment.clearValue = res.clearValue;
+
+        if (access.usage == ResourceUsage::ColorAttachment) {
+            colorAttachments.push_back(attachment);
+        } else {
+            depthAttachment = attachment;
+            hasDepth = true;
+        }
+    }
+
+    if (firstOut) {
+        VkRenderingInfo renderingInfo = {VK_STRUCTURE_TYPE_RENDERING_INFO};
+        renderingInfo.renderArea = {{0, 0}, {firstOut->width, firstOut->height}};
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+        renderingInfo.pColorAttachments = colorAttachments.data();
+        if (hasDepth) {
+            renderingInfo.pDepthAttachment = &depthAttachment;
+        }
+
+        spdlog::trace("RenderGraph: Executing pass '{}' with {} color attachments, hasDepth={}",
+                      pass.name, colorAttachments.size(), hasDepth);
+
+        if (secondary != VK_NULL_HANDLE) {
+            renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+        }
+
+        vkCmdBeginRendering(cmd, &renderingInfo);
+        if (secondary != VK_NULL_HANDLE) {
+            vkCmdExecuteCommands(cmd, 1, &secondary);
         } else {
-            // Compute pass or pass with no attachments
             pass.execute(cmd);
         }
+        vkCmdEndRendering(cmd);
+    } else if (secondary != VK_NULL_HANDLE) {
+        vkCmdExecuteCommands(cmd, 1, &secondary);
+    } else {
+        // Compute / transfer pass or pass with no attachments
+        pass.execute(cmd);
+    }
+
+    if (pass.after) {
+        pass.after(cmd);
+    }
+}
+
+VkCommandBuffer RenderGraph::acquireSecondary(uint32_t frameIndex, uint32_t threadIndex) {
+    // Only ever touched by its own thread while recording
+    auto& pool = m_recordPools[frameIndex][threadIndex];
+    if (pool.used == pool.buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocInfo.commandPool = pool.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer buffer;
+        if (vkAllocateCommandBuffers(m_context->getDevice(), &allocInfo, &buffer) != VK_SUCCESS) {
+            throw std::runtime_error("RenderGraph: Failed to allocate secondary command buffer!");
+        }
+        pool.buffers.push_back(buffer);
+    }
+    return pool.buffers[pool.used++];
+}
+
+void RenderGraph::recordSecondaries(uint32_t frameIndex) {
+    uint32_t threadCount = m_jobSystem->getThreadCount();
+    VkDevice device = m_context->getDevice();
+
+    if (m_recordPools.size() <= frameIndex) {
+        m_recordPools.resize(frameIndex + 1);
+    }
+    auto& framePools = m_recordPools[frameIndex];
+    for (auto& pool : framePools) {
+        vkResetCommandPool(device, pool.pool, 0);
+        pool.used = 0;
+    }
+    while (framePools.size() < threadCount) {
+        VkCommandPoolCreateInfo poolInfo = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        poolInfo.queueFamilyIndex = m_context->getQueueFamilyIndices().graphicsFamily.value();
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        RecordPool pool;
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool.pool) != VK_SUCCESS) {
+            throw std::runtime_error("RenderGraph: Failed to create recording command pool!");
+        }
+        framePools.push_back(std::move(pool));
+    }
+
+    std::vector<uint32_t> livePasses;
+    for (const auto& level : m_levels) {
+        livePasses.insert(livePasses.end(), level.begin(), level.end());
+    }
+
+    // Command recording doesn't depend on GPU ordering, every live pass can be recorded
+    // at once. Barriers and vkCmdBeginRendering stay in the primary, see execute().
+    m_jobSystem->parallelFor(static_cast<uint32_t>(livePasses.size()), [&](uint32_t index, uint32_t threadIndex) {
+        const auto& pass = m_passes[livePasses[index]];
+
+        std::vector<VkFormat> colorFormats;
+        VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+        bool rendersAttachments = false;
+        for (const auto& access : pass.accesses) {
+            if (!isAttachment(access.usage)) continue;
+            rendersAttachments = true;
+            const auto& res = getResource(pass, access.resource);
+            if (access.usage == ResourceUsage::ColorAttachment) {
+                colorFormats.push_back(res.format);
+            } else {
+                depthFormat = res.format;
+            }
+        }
+
+        VkCommandBufferInheritanceRenderingInfo renderingInheritance = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+        renderingInheritance.colorAttachmentCount = static_cast<uint32_t>(colorFormats.size());
+        renderingInheritance.pColorAttachmentFormats = colorFormats.data();
+        renderingInheritance.depthAttachmentFormat = depthFormat;
+        renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
-        // If it's the last pass and output is external (swapchain), transition to Present
-        if (isLastPass) {
-            std::vector<VkImageMemoryBarrier2> finalBarriers;
-            for (const auto& outName : pass.outputs) {
-                auto& res = m_resources[outName];
-                if (res.isExternal) {
-                    bool isDepth = (res.format == VK_FORMAT_D32_SFLOAT || res.format == VK_FORMAT_D32_SFLOAT_S8_UINT || res.format == VK_FORMAT_D24_UNORM_S8_UINT);
-                    if (isDepth) continue; // Don't present depth
-
-                    VkImageMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
-                    barrier.image = res.image;
-                    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
-                    barrier.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
-                    barrier.dstStageMask = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT;
-                    barrier.dstAccessMask = 0;
-                    barrier.oldLayout = m_imageLayouts[res.image];
-                    barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-                    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                    barrier.subresourceRange.baseMipLevel = 0;
-                    barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
-                    barrier.subresourceRange.baseArrayLayer = 0;
-                    barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
-                    finalBarriers.push_back(barrier);
-                    m_imageLayouts[res.image] = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-                    res.currentLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        VkCommandBufferInheritanceInfo inheritance = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+        if (rendersAttachments) {
+            inheritance.pNext = &renderingInheritance;
+        }
+
+        VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (rendersAttachments) {
+            beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        }
+        beginInfo.pInheritanceInfo = &inheritance;
+
+        VkCommandBuffer secondary = acquireSecondary(frameIndex, threadIndex);
+        if (vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("RenderGraph: Failed to begin secondary command buffer for pass '" + pass.name + "'!");
+        }
+        pass.execute(secondary);
+        if (vkEndCommandBuffer(secondary) != VK_SUCCESS) {
+            throw std::runtime_error("RenderGraph: Failed to record pass '" + pass.name + "'!");
+        }
+        m_secondaries[livePasses[index]] = secondary;
+    });
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd, VkExtent2D extent, uint32_t frameIndex) {
+    compile();
+
+    using Clock = std::chrono::steady_clock;
+    Clock::duration recordTime{};
+
+    m_secondaries.assign(m_passes.size(), VK_NULL_HANDLE);
+    bool parallel = m_jobSystem && m_jobSystem->getThreadCount() > 1 && m_passes.size() - m_stats.culledPassCount > 1;
+    if (parallel) {
+        auto recordStart = Clock::now();
+        recordSecondaries(frameIndex);
+        recordTime = Clock::now() - recordStart;
+        m_stats.recordThreadCount = m_jobSystem->getThreadCount();
+    }
+
+    for (const auto& level : m_levels) {
+        // Merge every access of the level per physical resource. Passes in one level never
+        // conflict, so images agree on the layout and the masks can simply be OR'd.
+        struct MergedAccess {
+            const RenderPassResource* res = nullptr;
+            UsageInfo info{};
+        };
+        std::map<VkImage, MergedAccess> images;
+        std::map<VkBuffer, MergedAccess> buffers;
+
+        for (uint32_t passIndex : level) {
+            const auto& pass = m_passes[passIndex];
+            for (const auto& access : pass.accesses) {
+                const auto& res = getResource(pass, access.resource);
+                UsageInfo info = getUsageInfo(access.usage, !pass.clearOutputs);
+                auto& merged = (res.buffer != VK_NULL_HANDLE) ? buffers[res.buffer] : images[res.image];
+                if (!merged.res) {
+                    merged.res = &res;
+                    merged.info = info;
+                } else {
+                    merged.info.stages |= info.stages;
+                    merged.info.access |= info.access;
+                    merged.info.write |= info.write;
                 }
             }
+        }
+
+        std::vector<VkImageMemoryBarrier2> imageBarriers;
+        std::vector<VkBufferMemoryBarrier2> bufferBarriers;
 
-            if (!finalBarriers.empty()) {
-                VkDependencyInfo depInfo = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
-                depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(finalBarriers.size());
-                depInfo.pImageMemoryBarriers = finalBarriers.data();
-                vkCmdPipelineBarrier2(cmd, &depInfo);
+        for (const auto& [image, merged] : images) {
+            auto& state = m_imageStates[image];
+            if (merged.res->isTransient && state.layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+                // First use this frame: the memory may still be in use by an alias, wait for those too
+                for (VkImage alias : m_blockImages[m_transients[merged.res->name].block]) {
+                    if (alias == image) continue;
+                    const auto& other = m_imageStates[alias];
+                    state.writeStages |= other.writeStages | other.readStages;
+                    state.writeAccess |= other.writeAccess;
+                }
             }
+
+            BarrierMasks masks;
+            if (!resolveAccess(state, merged.info, true, masks)) continue;
+
+            VkImageMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+            barrier.image = image;
+            barrier.srcStageMask = masks.srcStage;
+            barrier.srcAccessMask = masks.srcAccess;
+            barrier.dstStageMask = masks.dstStage;
+            barrier.dstAccessMask = masks.dstAccess;
+            barrier.oldLayout = masks.oldLayout;
+            barrier.newLayout = masks.newLayout;
+            barrier.subresourceRange.aspectMask = isDepthFormat(merged.res->format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+            imageBarriers.push_back(barrier);
+        }
+
+        for (const auto& [buffer, merged] : buffers) {
+            BarrierMasks masks;
+            if (!resolveAccess(m_bufferStates[buffer], merged.info, false, masks)) continue;
+
+            VkBufferMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+            barrier.buffer = buffer;
+            barrier.srcStageMask = masks.srcStage;
+            barrier.srcAccessMask = masks.srcAccess;
+            barrier.dstStageMask = masks.dstStage;
+            barrier.dstAccessMask = masks.dstAccess;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            bufferBarriers.push_back(barrier);
+        }
+
+        if (!imageBarriers.empty() || !bufferBarriers.empty()) {
+            VkDependencyInfo depInfo = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+            depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+            depInfo.pImageMemoryBarriers = imageBarriers.data();
+            depInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+            depInfo.pBufferMemoryBarriers = bufferBarriers.data();
+            vkCmdPipelineBarrier2(cmd, &depInfo);
+
+            m_stats.barrierBatchCount++;
+            m_stats.imageBarrierCount += static_cast<uint32_t>(imageBarriers.size());
+            m_stats.bufferBarrierCount += static_cast<uint32_t>(bufferBarriers.size());
+        }
+
+        for (uint32_t passIndex : level) {
+            if (parallel) {
+                recordPass(cmd, m_passes[passIndex], m_secondaries[passIndex]);
+            } else {
+                auto recordStart = Clock::now();
+                recordPass(cmd, m_passes[passIndex]);
+                recordTime += Clock::now() - recordStart;
+            }
+        }
+    }
+    m_stats.recordCpuMs = std::chrono::duration<double, std::milli>(recordTime).count();
+
+    // Leave graph outputs (swapchain / offscreen) in the layout their consumer expects
+    std::vector<VkImageMemoryBarrier2> finalBarriers;
+    for (auto& [name, res] : m_resources) {
+        if (res.image == VK_NULL_HANDLE || res.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED) continue;
+        if (isDepthFormat(res.format)) continue; // Don't present depth
+
+        auto& state = m_imageStates[res.image];
+        if (state.layout == res.finalLayout) continue;
+
+        bool isReadback = (res.finalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        UsageInfo info = {isReadback ? VK_PIPELINE_STAGE_2_COPY_BIT : VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
+                          isReadback ? VK_ACCESS_2_TRANSFER_READ_BIT : VK_ACCESS_2_NONE,
+                          res.finalLayout, false, true};
+
+        BarrierMasks masks;
+        resolveAccess(state, info, true, masks);
+        if (!isReadback) {
+            // The acquire semaphore waits at COLOR_ATTACHMENT_OUTPUT, chain the next use of this image off it
+            state.writeStages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+            state.readStages = VK_PIPELINE_STAGE_2_NONE;
+        }
+
+        VkImageMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+        barrier.image = res.image;
+        barrier.srcStageMask = masks.srcStage;
+        barrier.srcAccessMask = masks.srcAccess;
+        barrier.dstStageMask = masks.dstStage;
+        barrier.dstAccessMask = masks.dstAccess;
+        barrier.oldLayout = masks.oldLayout;
+        barrier.newLayout = masks.newLayout;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        finalBarriers.push_back(barrier);
+    }
+
+    if (!finalBarriers.empty()) {
+        VkDependencyInfo depInfo = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(finalBarriers.size());
+        depInfo.pImageMemoryBarriers = finalBarriers.data();
+        vkCmdPipelineBarrier2(cmd, &depInfo);
+        m_stats.barrierBatchCount++;
+        m_stats.imageBarrierCount += static_cast<uint32_t>(finalBarriers.size());
+    }
+
+    for (auto& [name, res] : m_resources) {
+        if (res.image != VK_NULL_HANDLE) {
+            res.currentLayout = m_imageStates[res.image].layout;
         }
     }
+
+    spdlog::trace("RenderGraph: {} passes ({} culled) in {} levels, {} barrier batches, recorded in {:.3f} ms on {} threads",
+                  m_stats.passCount, m_stats.culledPassCount, m_stats.levelCount, m_stats.barrierBatchCount,
+                  m_stats.recordCpuMs, m_stats.recordThreadCount);
+}
+
+bool RenderGraph::wasExecuted(const std::string& passName) const {
+    for (const auto& level : m_levels) {
+        for (uint32_t passIndex : level) {
+            if (m_passes[passIndex].name == passName) return true;
+        }
+    }
+    return false;
 }
 
 void RenderGraph::clear() {
     m_passes.clear();
-    
-    // Clear internal resources and their layout tracking
+    m_levels.clear();
+    m_transientDescs.clear();
+
+    // Clear internal (transient) resources, the realized images and physical state are kept
+    // so the next frame can reuse them and sync against it
     auto it = m_resources.begin();
     while (it != m_resources.end()) {
         if (!it->second.isExternal) {
-            m_imageLayouts.erase(it->second.image);
             it = m_resources.erase(it);
         } else {
             ++it;
@@ -7,36 +7,254 @@
 #include "astral/core/context.hpp"
 #include "astral/resources/image.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <random>
 #include <spdlog/spdlog.h>
 #include <sstream>
 
 namespace astral {
 
-RendererSystem::RendererSystem(Context *context, Swapchain *swapchain,
-                               uint32_t width, uint32_t height)
-    : m_context(context), m_swapchainFormat(swapchain->getImageFormat()),
-      m_width(width), m_height(height) {}
+namespace {
+
+constexpr uint32_t kShadowMapSize = 4096;
+// Instances the culling output buffers start out sized for, they grow on demand
+constexpr uint32_t kInitialCullCapacity = 1024;
+// Average lights per cluster the light index buffers start out sized for
+constexpr uint32_t kInitialLightsPerCluster = 16;
+// Timestamp queries per frame slot: light culling begin / end, SSAO begin / end
+constexpr uint32_t kTimestampsPerFrame = 4;
+
+// Must match the push constants of cluster_cull.comp
+struct LightCullPushConstants {
+  uint32_t clusterBufferIndex;
+  uint32_t lightBufferIndex;
+  uint32_t lightIndexBufferIndex;
+  uint32_t clusterGridBufferIndex;
+  uint32_t counterBufferIndex;
+  uint32_t lightCount;
+  uint32_t phase; // 0 = count, 1 = scan, 2 = write
+  uint32_t lightIndexCapacity;
+  uint32_t gridX;
+  uint32_t gridY;
+  uint32_t gridZ;
+  uint32_t depthPyramidIndex; // UINT32_MAX = no depth bounds
+  uint32_t depthPyramidLevel;
+  float nearClip;
+  float farClip;
+  uint32_t padding;
+  glm::mat4 viewMatrix;
+};
+static_assert(sizeof(LightCullPushConstants) <= 128,
+              "Light culling push constants exceed the guaranteed 128 bytes");
+
+// Must match the push constants of cluster_build.comp
+struct ClusterBuildPushConstants {
+  uint32_t clusterBufferIndex;
+  uint32_t gridX;
+  uint32_t gridY;
+  uint32_t gridZ;
+  glm::mat4 invProj;
+  float nearClip;
+  float farClip;
+  float padding[2];
+};
+
+// Must match the push constants of visbuffer.vert / visbuffer.frag
+struct VisibilityPushConstants {
+  uint32_t sceneDataIndex;
+  uint32_t instanceBufferIndex;
+  uint32_t materialBufferIndex;
+  uint32_t firstCommand; // Draw command index of the pass' first draw
+  uint32_t triangleBits; // Low bits of the visibility ID holding the triangle
+  uint32_t padding[3];
+};
+
+// Must match the push constants of visbuffer_resolve.comp
+struct VisibilityResolvePushConstants {
+  uint32_t sceneDataIndex;
+  uint32_t instanceBufferIndex;
+  uint32_t materialBufferIndex;
+  uint32_t drawCommandIndex;
+  uint32_t positionBufferIndex;
+  uint32_t attributeBufferIndex;
+  uint32_t indexBufferIndex;
+  uint32_t visibilityIndex;
+  uint32_t hdrIndex;
+  uint32_t normalIndex;
+  uint32_t velocityIndex;
+  uint32_t triangleBits;
+  uint32_t width;
+  uint32_t height;
+};
+
+// Must match the push constants of ssao_downsample.comp
+struct SSAODownsamplePushConstants {
+  uint32_t depthIndex;
+  uint32_t normalIndex;
+  uint32_t halfDepthIndex;  // Storage slots
+  uint32_t halfNormalIndex;
+  uint32_t halfWidth;
+  uint32_t halfHeight;
+  float nearClip;
+  float farClip;
+};
+
+// Must match the push constants of ssao.comp
+struct SSAOComputePushConstants {
+  uint32_t sceneDataIndex;
+  uint32_t halfDepthIndex; // Sampled slots
+  uint32_t halfNormalIndex;
+  uint32_t kernelBufferIndex;
+  uint32_t outputIndex;    // Storage slot
+  uint32_t sampleCount;
+  uint32_t halfWidth;
+  uint32_t halfHeight;
+  float radius;
+  float bias;
+  float power;
+  float padding;
+};
+
+// Must match the push constants of ssao_upsample.frag
+struct SSAOUpsamplePushConstants {
+  uint32_t halfIndex;
+  uint32_t depthIndex;
+  float nearClip;
+  float farClip;
+};
+
+uint32_t ssaoSampleCount(RendererSystem::SSAOQuality quality) {
+  switch (quality) {
+  case RendererSystem::SSAOQuality::Low:
+    return 8;
+  case RendererSystem::SSAOQuality::Medium:
+    return 16;
+  case RendererSystem::SSAOQuality::High:
+    return 32;
+  }
+  return 16;
+}
+
+// Same bounding sphere and plane test as the shadow phase of cull.comp
+bool casterOverlapsCascade(const MeshInstance &instance,
+                           const glm::mat4 &cascadeViewProj) {
+  glm::vec3 center =
+      glm::vec3(instance.transform * glm::vec4(instance.sphereCenter, 1.0f));
+  float scale = std::max({glm::length(glm::vec3(instance.transform[0])),
+                          glm::length(glm::vec3(instance.transform[1])),
+                          glm::length(glm::vec3(instance.transform[2]))});
+  float radius = instance.sphereRadius * scale;
+
+  auto row = [&](int r) {
+    return glm::vec4(cascadeViewProj[0][r], cascadeViewProj[1][r],
+                     cascadeViewProj[2][r], cascadeViewProj[3][r]);
+  };
+  // No near plane, casters between the light and the cascade count
+  glm::vec4 planes[5] = {row(3) + row(0), row(3) - row(0), row(3) + row(1),
+                         row(3) - row(1), row(3) - row(2)};
+  for (const glm::vec4 &plane : planes) {
+    glm::vec4 normalized = plane / glm::length(glm::vec3(plane));
+    if (glm::dot(normalized, glm::vec4(center, 1.0f)) < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Which dynamic casters touch the cascade and their change stamps. The list
+// keeps creation order and the stamps are unique, so a caster moving, entering
+// or leaving the cascade changes the hash.
+uint64_t hashDynamicCasters(const std::vector<MeshInstance> &instances,
+                            const std::vector<uint64_t> &versions,
+                            const glm::mat4 &cascadeViewProj) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < instances.size(); i++) {
+    if (!casterOverlapsCascade(instances[i], cascadeViewProj)) {
+      continue;
+    }
+    hash = (hash ^ versions[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// Whether the box a cascade was cached with moved by a texel or more. Texel
+// snapping keeps the xy shift on whole texels, depth gets the same resolution.
+bool cascadeMoved(const glm::mat4 &cached, const glm::mat4 &fresh) {
+  glm::mat4 toWorld = glm::inverse(cached);
+  for (int i = 0; i < 8; i++) {
+    glm::vec4 ndc((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f,
+                  (i & 4) ? 1.0f : 0.0f, 1.0f);
+    glm::vec4 world = toWorld * ndc;
+    glm::vec4 moved = fresh * (world / world.w);
+    glm::vec3 delta = glm::vec3(moved) / moved.w - glm::vec3(ndc);
+    if (std::abs(delta.x) * 0.5f * kShadowMapSize >= 0.5f ||
+        std::abs(delta.y) * 0.5f * kShadowMapSize >= 0.5f ||
+        std::abs(delta.z) * kShadowMapSize >= 1.0f) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+RendererSystem::RendererSystem(Context *context, VkFormat outputFormat,
+                               uint32_t width, uint32_t height,
+                               const ClusterGridSpecs &clusterGrid)
+    : m_context(context), m_outputFormat(outputFormat), m_width(width),
+      m_height(height) {
+  const uint32_t tileSize = std::max(1u, clusterGrid.tileSize);
+  m_clusterGridX = std::max(1u, (width + tileSize - 1) / tileSize);
+  m_clusterGridY = std::max(1u, (height + tileSize - 1) / tileSize);
+  m_clusterGridZ = std::max(1u, clusterGrid.depthSlices);
+  m_clusterCount = m_clusterGridX * m_clusterGridY * m_clusterGridZ;
+  spdlog::info("Cluster grid {}x{}x{} ({} clusters)", m_clusterGridX,
+               m_clusterGridY, m_clusterGridZ, m_clusterCount);
+}
 
 RendererSystem::~RendererSystem() {
   vkDestroySampler(m_context->getDevice(), m_hdrSampler, nullptr);
   vkDestroySampler(m_context->getDevice(), m_noiseSampler, nullptr);
   vkDestroySampler(m_context->getDevice(), m_shadowSampler, nullptr);
+  vkDestroySampler(m_context->getDevice(), m_depthPyramidSampler, nullptr);
+  if (m_timestampPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(m_context->getDevice(), m_timestampPool, nullptr);
+  }
+  for (VkImageView view : m_resources.depthPyramidMipViews) {
+    vkDestroyImageView(m_context->getDevice(), view, nullptr);
+  }
+  for (VkImageView view : m_resources.shadowLayerViews) {
+    vkDestroyImageView(m_context->getDevice(), view, nullptr);
+  }
+  for (VkImageView view : m_resources.shadowCacheLayerViews) {
+    vkDestroyImageView(m_context->getDevice(), view, nullptr);
+  }
 
   vkDestroyPipelineLayout(m_context->getDevice(), m_pipelineLayout, nullptr);
   vkDestroyPipelineLayout(m_context->getDevice(), m_taaLayout, nullptr);
   vkDestroyPipelineLayout(m_context->getDevice(), m_ssaoLayout, nullptr);
   vkDestroyPipelineLayout(m_context->getDevice(), m_ssaoBlurLayout, nullptr);
+  vkDestroyPipelineLayout(m_context->getDevice(), m_ssaoDownsampleLayout,
+                          nullptr);
+  vkDestroyPipelineLayout(m_context->getDevice(), m_ssaoComputeLayout, nullptr);
+  vkDestroyPipelineLayout(m_context->getDevice(), m_ssaoUpsampleLayout, nullptr);
   vkDestroyPipelineLayout(m_context->getDevice(), m_compositeLayout, nullptr);
   vkDestroyPipelineLayout(m_context->getDevice(), m_bloomLayout, nullptr);
   vkDestroyPipelineLayout(m_context->getDevice(), m_fxaaLayout, nullptr);
   vkDestroyPipelineLayout(m_context->getDevice(), m_cullLayout, nullptr);
+  vkDestroyPipelineLayout(m_context->getDevice(), m_depthPyramidLayout,
+                          nullptr);
   vkDestroyPipelineLayout(m_context->getDevice(), m_clusterBuildLayout,
                           nullptr);
   vkDestroyPipelineLayout(m_context->getDevice(), m_clusterCullLayout, nullptr);
   vkDestroyPipelineLayout(m_context->getDevice(), m_skyboxLayout, nullptr);
+  vkDestroyPipelineLayout(m_context->getDevice(), m_visibilityLayout, nullptr);
+  vkDestroyPipelineLayout(m_context->getDevice(), m_visibilityResolveLayout,
+                          nullptr);
 }
 
 std::string RendererSystem::readFile(const std::string &filename) {
@@ -67,6 +285,7 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   vkCreateSampler(m_context->getDevice(), &hdrSamplerInfo, nullptr,
                   &m_hdrSampler);
 
+  // TAA histories are read back the next frame, so they can't be graph transients
   ImageSpecs hdrSpecs;
   hdrSpecs.width = m_width;
   hdrSpecs.height = m_height;
@@ -75,21 +294,39 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
   hdrSpecs.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
 
-  m_resources.hdrImage = std::make_unique<Image>(m_context, hdrSpecs);
   m_resources.taaHistoryImage1 = std::make_unique<Image>(m_context, hdrSpecs);
   m_resources.taaHistoryImage2 = std::make_unique<Image>(m_context, hdrSpecs);
 
-  m_hdrTextureIndex = m_context->getDescriptorManager().registerImage(
-      m_resources.hdrImage->getView(), m_hdrSampler);
   m_taaHistoryIndex1 = m_context->getDescriptorManager().registerImage(
       m_resources.taaHistoryImage1->getView(), m_hdrSampler);
   m_taaHistoryIndex2 = m_context->getDescriptorManager().registerImage(
       m_resources.taaHistoryImage2->getView(), m_hdrSampler);
 
-  ImageSpecs normalSpecs = hdrSpecs;
-  m_resources.normalImage = std::make_unique<Image>(m_context, normalSpecs);
-  m_normalTextureIndex = m_context->getDescriptorManager().registerImage(
-      m_resources.normalImage->getView(), m_hdrSampler);
+  // Intermediate targets (HDR, Normal, Velocity, SceneColor, LDR, SSAO, Bloom)
+  // are transients owned by the RenderGraph, declared in render(). Their
+  // bindless slots are reserved here and rewritten whenever the graph
+  // (re)creates the images.
+  DescriptorManager &descriptors = m_context->getDescriptorManager();
+  m_hdrTextureIndex = descriptors.reserveImage();
+  m_normalTextureIndex = descriptors.reserveImage();
+  m_velocityTextureIndex = descriptors.reserveImage();
+  m_sceneColorTextureIndex = descriptors.reserveImage();
+  m_ldrTextureIndex = descriptors.reserveImage();
+  m_ssaoTextureIndex = descriptors.reserveImage();
+  m_ssaoBlurTextureIndex = descriptors.reserveImage();
+  m_ssaoHalfDepthIndex = descriptors.reserveImage();
+  m_ssaoHalfDepthStorageIndex = descriptors.reserveStorageImage();
+  m_ssaoHalfNormalIndex = descriptors.reserveImage();
+  m_ssaoHalfNormalStorageIndex = descriptors.reserveStorageImage();
+  m_ssaoHalfIndex = descriptors.reserveImage();
+  m_ssaoHalfStorageIndex = descriptors.reserveStorageImage();
+  m_bloomTextureIndex = descriptors.reserveImage();
+  m_bloomBlurTextureIndex = descriptors.reserveImage();
+  m_visibilityTextureIndex = descriptors.reserveImage();
+  // Opaque targets the visibility resolve writes as storage images
+  m_hdrStorageIndex = descriptors.reserveStorageImage();
+  m_normalStorageIndex = descriptors.reserveStorageImage();
+  m_velocityStorageIndex = descriptors.reserveStorageImage();
 
   ImageSpecs depthSpecs;
   depthSpecs.width = m_width;
@@ -102,28 +339,46 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   m_depthTextureIndex = m_context->getDescriptorManager().registerImage(
       m_resources.depthImage->getView(), m_hdrSampler);
 
-  // Scene Color Image (Copy of Opaque Pass for Transmission)
-  ImageSpecs sceneColorSpecs = hdrSpecs;
-  m_resources.sceneColorImage = std::make_unique<Image>(m_context, sceneColorSpecs);
-  m_sceneColorTextureIndex = m_context->getDescriptorManager().registerImage(
-      m_resources.sceneColorImage->getView(), m_hdrSampler);
-
-  ImageSpecs velocitySpecs;
-  velocitySpecs.width = m_width;
-  velocitySpecs.height = m_height;
-  velocitySpecs.format = VK_FORMAT_R16G16_SFLOAT;
-  velocitySpecs.usage =
-      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-  velocitySpecs.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
-  m_resources.velocityImage = std::make_unique<Image>(m_context, velocitySpecs);
-  m_velocityTextureIndex = m_context->getDescriptorManager().registerImage(
-      m_resources.velocityImage->getView(), m_hdrSampler);
+  // Depth pyramid, mip sizes follow the usual floor(size / 2) chain
+  ImageSpecs pyramidSpecs;
+  pyramidSpecs.width = std::max(1u, m_width / 2);
+  pyramidSpecs.height = std::max(1u, m_height / 2);
+  pyramidSpecs.format = VK_FORMAT_R32_SFLOAT;
+  pyramidSpecs.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  m_resources.depthPyramid = std::make_unique<Image>(m_context, pyramidSpecs);
+
+  VkSamplerCreateInfo pyramidSamplerInfo = {
+      VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+  pyramidSamplerInfo.magFilter = VK_FILTER_NEAREST;
+  pyramidSamplerInfo.minFilter = VK_FILTER_NEAREST;
+  pyramidSamplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  pyramidSamplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  pyramidSamplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  pyramidSamplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  pyramidSamplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+  vkCreateSampler(m_context->getDevice(), &pyramidSamplerInfo, nullptr,
+                  &m_depthPyramidSampler);
+  m_depthPyramidIndex = m_context->getDescriptorManager().registerImage(
+      m_resources.depthPyramid->getView(), m_depthPyramidSampler);
+
+  for (uint32_t i = 0; i < m_resources.depthPyramid->getSpecs().mipLevels;
+       i++) {
+    VkImageViewCreateInfo viewInfo = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    viewInfo.image = m_resources.depthPyramid->getHandle();
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = i;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    VkImageView view;
+    vkCreateImageView(m_context->getDevice(), &viewInfo, nullptr, &view);
+    m_resources.depthPyramidMipViews.push_back(view);
+    m_resources.depthPyramidMipIndices.push_back(
+        m_context->getDescriptorManager().registerStorageImage(view));
+  }
 
-  ImageSpecs ldrSpecs = hdrSpecs;
-  ldrSpecs.format = m_swapchainFormat;
-  m_resources.ldrImage = std::make_unique<Image>(m_context, ldrSpecs);
-  m_ldrTextureIndex = m_context->getDescriptorManager().registerImage(
-      m_resources.ldrImage->getView(), m_hdrSampler);
 
   std::uniform_real_distribution<float> randomFloats(0.0, 1.0);
   std::default_random_engine generator;
@@ -175,37 +430,26 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   m_noiseTextureIndex = m_context->getDescriptorManager().registerImage(
       m_resources.noiseImage->getView(), m_noiseSampler);
 
-  ImageSpecs ssaoSpecs = hdrSpecs;
-  ssaoSpecs.format = VK_FORMAT_R8_UNORM;
-  m_resources.ssaoImage = std::make_unique<Image>(m_context, ssaoSpecs);
-  m_resources.ssaoBlurImage = std::make_unique<Image>(m_context, ssaoSpecs);
-  m_ssaoTextureIndex = m_context->getDescriptorManager().registerImage(
-      m_resources.ssaoImage->getView(), m_hdrSampler);
-  m_ssaoBlurTextureIndex = m_context->getDescriptorManager().registerImage(
-      m_resources.ssaoBlurImage->getView(), m_hdrSampler);
-
-  ImageSpecs bloomSpecs = hdrSpecs;
-  bloomSpecs.width /= 4;
-  bloomSpecs.height /= 4;
-  m_resources.bloomImage = std::make_unique<Image>(m_context, bloomSpecs);
-  m_resources.bloomBlurImage = std::make_unique<Image>(m_context, bloomSpecs);
-  m_bloomTextureIndex = m_context->getDescriptorManager().registerImage(
-      m_resources.bloomImage->getView(), m_hdrSampler);
-  m_bloomBlurTextureIndex = m_context->getDescriptorManager().registerImage(
-      m_resources.bloomBlurImage->getView(), m_hdrSampler);
-
-  const uint32_t shadowMapSize = 4096;
+  const uint32_t shadowMapSize = kShadowMapSize;
   ImageSpecs shadowSpecs;
   shadowSpecs.width = shadowMapSize;
   shadowSpecs.height = shadowMapSize;
   shadowSpecs.format = VK_FORMAT_D32_SFLOAT;
-  shadowSpecs.usage =
-      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  shadowSpecs.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                      VK_IMAGE_USAGE_SAMPLED_BIT |
+                      VK_IMAGE_USAGE_TRANSFER_DST_BIT;
   shadowSpecs.aspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT;
   shadowSpecs.arrayLayers = 4;
   shadowSpecs.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
   m_resources.shadowImage = std::make_unique<Image>(m_context, shadowSpecs);
 
+  ImageSpecs shadowCacheSpecs = shadowSpecs;
+  shadowCacheSpecs.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                           VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  shadowCacheSpecs.arrayLayers = 3;
+  m_resources.shadowCacheImage =
+      std::make_unique<Image>(m_context, shadowCacheSpecs);
+
   VkSamplerCreateInfo shadowSamplerInfo = {
       VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
   shadowSamplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -233,9 +477,16 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
     VkImageView view;
     vkCreateImageView(m_context->getDevice(), &viewInfo, nullptr, &view);
     m_resources.shadowLayerViews.push_back(view);
+
+    if (i > 0) {
+      viewInfo.image = m_resources.shadowCacheImage->getHandle();
+      viewInfo.subresourceRange.baseArrayLayer = i - 1;
+      vkCreateImageView(m_context->getDevice(), &viewInfo, nullptr, &view);
+      m_resources.shadowCacheLayerViews.push_back(view);
+    }
   }
 
-  const uint32_t totalClusters = 16 * 9 * 24;
+  const uint32_t totalClusters = m_clusterCount;
   struct ClusterAABB {
     glm::vec4 min;
     glm::vec4 max;
@@ -246,36 +497,97 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   };
   m_resources.clusterBuffer = std::make_unique<Buffer>(
       m_context, totalClusters * sizeof(ClusterAABB),
-      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO);
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VMA_MEMORY_USAGE_AUTO);
   m_clusterBufferIndex = m_context->getDescriptorManager().registerBuffer(
       m_resources.clusterBuffer->getHandle(), 0,
       m_resources.clusterBuffer->getSize(), 8);
 
-  for (int i = 0; i < 2; i++) {
+  for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     m_resources.clusterGridBuffers.push_back(std::make_unique<Buffer>(
         m_context, totalClusters * sizeof(ClusterGrid),
         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO));
-    m_resources.lightIndexBuffers.push_back(std::make_unique<Buffer>(
-        m_context, totalClusters * 256 * sizeof(uint32_t),
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO));
-    m_resources.clusterAtomicBuffers.push_back(std::make_unique<Buffer>(
-        m_context, sizeof(uint32_t),
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    m_resources.lightIndexBuffers.push_back(std::make_unique<GrowableBuffer>(
+        m_context, totalClusters * kInitialLightsPerCluster * sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO, 0, 10));
+    m_resources.lightCullCounterBuffers.push_back(std::make_unique<Buffer>(
+        m_context, sizeof(LightCullCounters),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VMA_MEMORY_USAGE_AUTO));
 
     m_resources.clusterGridBufferIndices.push_back(
         m_context->getDescriptorManager().registerBuffer(
             m_resources.clusterGridBuffers[i]->getHandle(), 0,
             m_resources.clusterGridBuffers[i]->getSize(), 9));
-    m_resources.lightIndexBufferIndices.push_back(
+    m_resources.lightCullCounterBufferIndices.push_back(
         m_context->getDescriptorManager().registerBuffer(
-            m_resources.lightIndexBuffers[i]->getHandle(), 0,
-            m_resources.lightIndexBuffers[i]->getSize(), 10));
-    m_resources.clusterAtomicBufferIndices.push_back(
+            m_resources.lightCullCounterBuffers[i]->getHandle(), 0,
+            sizeof(LightCullCounters), 11));
+  }
+  m_lightCullLightCounts.assign(MAX_FRAMES_IN_FLIGHT, 0);
+  m_lightCullTimingPending.assign(MAX_FRAMES_IN_FLIGHT, false);
+  m_ssaoTimingPending.assign(MAX_FRAMES_IN_FLIGHT, false);
+  m_ssaoTimingCompute.assign(MAX_FRAMES_IN_FLIGHT, false);
+
+  // Light culling and SSAO GPU time, only where the graphics queue has
+  // timestamps
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(m_context->getPhysicalDevice(), &properties);
+  if (properties.limits.timestampComputeAndGraphics) {
+    m_timestampPeriod = properties.limits.timestampPeriod;
+    VkQueryPoolCreateInfo queryInfo = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryInfo.queryCount = MAX_FRAMES_IN_FLIGHT * kTimestampsPerFrame;
+    if (vkCreateQueryPool(m_context->getDevice(), &queryInfo, nullptr,
+                          &m_timestampPool) != VK_SUCCESS) {
+      spdlog::warn("Timestamp query pool unavailable, no light culling or "
+                   "SSAO timings");
+      m_timestampPool = VK_NULL_HANDLE;
+    }
+  }
+
+  // Early opaque commands are compacted from the start of the draw buffer,
+  // transparents keep their sorted slot right after them (culled ones get
+  // instanceCount 0) and the late opaque commands start at the second half.
+  // Shadow casters get a static and a dynamic list per cascade, same region
+  // size. Both are resized to the frame's instance count in render().
+  const VkDeviceSize commandStride = sizeof(VkDrawIndexedIndirectCommand);
+  for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    m_resources.drawCommandBuffers.push_back(std::make_unique<GrowableBuffer>(
+        m_context, 2 * kInitialCullCapacity * commandStride,
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VMA_MEMORY_USAGE_AUTO, 0, 7));
+    m_resources.shadowDrawCommandBuffers.push_back(
+        std::make_unique<GrowableBuffer>(
+            m_context, 8 * kInitialCullCapacity * commandStride,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_AUTO, 0, 7));
+    m_resources.cullCounterBuffers.push_back(std::make_unique<Buffer>(
+        m_context, sizeof(CullCounters),
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VMA_MEMORY_USAGE_AUTO));
+    m_resources.cullCandidateBuffers.push_back(std::make_unique<GrowableBuffer>(
+        m_context, kInitialCullCapacity * sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO, 0, 11));
+    // Culling counters, then the light culling ones
+    m_resources.cullReadbackBuffers.push_back(std::make_unique<Buffer>(
+        m_context, sizeof(CullCounters) + sizeof(LightCullCounters),
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VMA_MEMORY_USAGE_AUTO,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+            VMA_ALLOCATION_CREATE_MAPPED_BIT));
+
+    m_resources.cullCounterBufferIndices.push_back(
         m_context->getDescriptorManager().registerBuffer(
-            m_resources.clusterAtomicBuffers[i]->getHandle(), 0,
-            m_resources.clusterAtomicBuffers[i]->getSize(), 11));
+            m_resources.cullCounterBuffers[i]->getHandle(), 0,
+            sizeof(CullCounters), 11));
   }
+  m_cullReadbackPending.assign(MAX_FRAMES_IN_FLIGHT, false);
+  m_cullInstanceCounts.assign(MAX_FRAMES_IN_FLIGHT, 0);
 
   spdlog::info("Loading PBR Shaders...");
   m_vertShader = std::make_shared<Shader>(
@@ -296,6 +608,15 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   m_ssaoBlurFragShader = std::make_shared<Shader>(
       m_context, readFile("assets/shaders/ssao_blur.frag.spv"),
       ShaderStage::Fragment, "SSAOBlurFrag");
+  m_ssaoDownsampleShader = std::make_shared<Shader>(
+      m_context, readFile("assets/shaders/ssao_downsample.comp.spv"),
+      ShaderStage::Compute, "SSAODownsampleShader");
+  m_ssaoComputeShader = std::make_shared<Shader>(
+      m_context, readFile("assets/shaders/ssao.comp.spv"),
+      ShaderStage::Compute, "SSAOComputeShader");
+  m_ssaoUpsampleFragShader = std::make_shared<Shader>(
+      m_context, readFile("assets/shaders/ssao_upsample.frag.spv"),
+      ShaderStage::Fragment, "SSAOUpsampleFrag");
   m_compositeFragShader = std::make_shared<Shader>(
       m_context, readFile("assets/shaders/composite.frag.spv"),
       ShaderStage::Fragment, "CompositeFrag");
@@ -308,12 +629,18 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   m_shadowVertShader = std::make_shared<Shader>(
       m_context, readFile("assets/shaders/shadow.vert.spv"),
       ShaderStage::Vertex, "ShadowVert");
+  m_depthPrepassVertShader = std::make_shared<Shader>(
+      m_context, readFile("assets/shaders/depth_prepass.vert.spv"),
+      ShaderStage::Vertex, "DepthPrepassVert");
   m_shadowFragShader = std::make_shared<Shader>(
       m_context, readFile("assets/shaders/shadow.frag.spv"),
       ShaderStage::Fragment, "ShadowFrag");
   m_cullShader = std::make_shared<Shader>(
       m_context, readFile("assets/shaders/cull.comp.spv"), ShaderStage::Compute,
       "CullShader");
+  m_depthPyramidShader = std::make_shared<Shader>(
+      m_context, readFile("assets/shaders/depth_pyramid.comp.spv"),
+      ShaderStage::Compute, "DepthPyramidShader");
   m_clusterBuildShader = std::make_shared<Shader>(
       m_context, readFile("assets/shaders/cluster_build.comp.spv"),
       ShaderStage::Compute, "ClusterBuildShader");
@@ -353,10 +680,19 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   // DEBUG: Disable Depth/Cull to rule out rasterizer discard
   pbrSpecs.depthTest = true;
   pbrSpecs.cullMode = VK_CULL_MODE_NONE;
-  pbrSpecs.vertexBindings.push_back(Vertex::getBindingDescription());
-  pbrSpecs.vertexAttributes = Vertex::getAttributeDescriptions();
+  pbrSpecs.vertexBindings = PackedVertex::getBindingDescriptions();
+  pbrSpecs.vertexAttributes = PackedVertex::getAttributeDescriptions();
   m_pbrPipeline = std::make_unique<GraphicsPipeline>(m_context, pbrSpecs);
 
+  PipelineSpecs pbrEqualSpecs = pbrSpecs;
+  pbrEqualSpecs.depthCompareOp = VK_COMPARE_OP_EQUAL;
+  pbrEqualSpecs.depthWrite = false;
+  m_pbrEqualPipeline = std::make_unique<GraphicsPipeline>(m_context, pbrEqualSpecs);
+  PipelineSpecs pbrLessEqualSpecs = pbrSpecs;
+  pbrLessEqualSpecs.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+  m_pbrLessEqualPipeline =
+      std::make_unique<GraphicsPipeline>(m_context, pbrLessEqualSpecs);
+
   PipelineSpecs pbrTransparentSpecs = pbrSpecs;
   // Transparent Pipeline Settings
   pbrTransparentSpecs.enableBlending = true;
@@ -381,16 +717,22 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   shadowSpecsP.depthTest = true;
   shadowSpecsP.depthWrite = true;
   shadowSpecsP.cullMode = VK_CULL_MODE_FRONT_BIT;
-  shadowSpecsP.vertexBindings.push_back(Vertex::getBindingDescription());
-  std::vector<VkVertexInputAttributeDescription> shadowVertexAttrs(1);
-  shadowVertexAttrs[0].binding = 0;
-  shadowVertexAttrs[0].location = 0;
-  shadowVertexAttrs[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-  shadowVertexAttrs[0].offset = offsetof(Vertex, position);
-  shadowSpecsP.vertexAttributes = shadowVertexAttrs;
+  // Casters in front of a cascade's near plane aren't culled, flatten them onto it
+  shadowSpecsP.depthClamp = m_context->supportsDepthClamp();
+  shadowSpecsP.vertexBindings = PackedVertex::getPositionBindingDescriptions();
+  shadowSpecsP.vertexAttributes = PackedVertex::getPositionAttributeDescriptions();
   m_shadowPipeline =
       std::make_unique<GraphicsPipeline>(m_context, shadowSpecsP);
 
+  // Camera depth prepass, same position code (mesh_position.glsl) and
+  // rasterization state as the opaque pipeline so its depth matches exactly
+  PipelineSpecs prepassSpecs = shadowSpecsP;
+  prepassSpecs.vertexShader = m_depthPrepassVertShader;
+  prepassSpecs.cullMode = pbrSpecs.cullMode;
+  prepassSpecs.depthClamp = false;
+  m_depthPrepassPipeline =
+      std::make_unique<GraphicsPipeline>(m_context, prepassSpecs);
+
   VkPushConstantRange taaPushRange = {};
   taaPushRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
   taaPushRange.size = 16;
@@ -455,9 +797,62 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   m_ssaoBlurPipeline =
       std::make_unique<GraphicsPipeline>(m_context, ssaoBlurSpecs);
 
+  // Half-resolution compute SSAO: downsample, AO, bilateral upsample into the
+  // same full resolution R8 target the fragment path blurs into
+  VkPushConstantRange ssaoDownsamplePush = {};
+  ssaoDownsamplePush.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  ssaoDownsamplePush.size = sizeof(SSAODownsamplePushConstants);
+  VkPipelineLayoutCreateInfo ssaoDownsampleLayoutInfo = {
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+  ssaoDownsampleLayoutInfo.pushConstantRangeCount = 1;
+  ssaoDownsampleLayoutInfo.pPushConstantRanges = &ssaoDownsamplePush;
+  ssaoDownsampleLayoutInfo.setLayoutCount = layoutCount;
+  ssaoDownsampleLayoutInfo.pSetLayouts = setLayouts;
+  vkCreatePipelineLayout(m_context->getDevice(), &ssaoDownsampleLayoutInfo,
+                         nullptr, &m_ssaoDownsampleLayout);
+  ComputePipelineSpecs ssaoDownsampleSpecs;
+  ssaoDownsampleSpecs.computeShader = m_ssaoDownsampleShader;
+  ssaoDownsampleSpecs.layout = m_ssaoDownsampleLayout;
+  m_ssaoDownsamplePipeline =
+      std::make_unique<ComputePipeline>(m_context, ssaoDownsampleSpecs);
+
+  VkPushConstantRange ssaoComputePush = {};
+  ssaoComputePush.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  ssaoComputePush.size = sizeof(SSAOComputePushConstants);
+  VkPipelineLayoutCreateInfo ssaoComputeLayoutInfo = {
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+  ssaoComputeLayoutInfo.pushConstantRangeCount = 1;
+  ssaoComputeLayoutInfo.pPushConstantRanges = &ssaoComputePush;
+  ssaoComputeLayoutInfo.setLayoutCount = layoutCount;
+  ssaoComputeLayoutInfo.pSetLayouts = setLayouts;
+  vkCreatePipelineLayout(m_context->getDevice(), &ssaoComputeLayoutInfo,
+                         nullptr, &m_ssaoComputeLayout);
+  ComputePipelineSpecs ssaoComputeSpecs;
+  ssaoComputeSpecs.computeShader = m_ssaoComputeShader;
+  ssaoComputeSpecs.layout = m_ssaoComputeLayout;
+  m_ssaoComputePipeline =
+      std::make_unique<ComputePipeline>(m_context, ssaoComputeSpecs);
+
+  VkPushConstantRange ssaoUpsamplePush = {};
+  ssaoUpsamplePush.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  ssaoUpsamplePush.size = sizeof(SSAOUpsamplePushConstants);
+  VkPipelineLayoutCreateInfo ssaoUpsampleLayoutInfo = {
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+  ssaoUpsampleLayoutInfo.pushConstantRangeCount = 1;
+  ssaoUpsampleLayoutInfo.pPushConstantRanges = &ssaoUpsamplePush;
+  ssaoUpsampleLayoutInfo.setLayoutCount = layoutCount;
+  ssaoUpsampleLayoutInfo.pSetLayouts = setLayouts;
+  vkCreatePipelineLayout(m_context->getDevice(), &ssaoUpsampleLayoutInfo,
+                         nullptr, &m_ssaoUpsampleLayout);
+  PipelineSpecs ssaoUpsampleSpecs = ssaoBlurSpecs;
+  ssaoUpsampleSpecs.fragmentShader = m_ssaoUpsampleFragShader;
+  ssaoUpsampleSpecs.layout = m_ssaoUpsampleLayout;
+  m_ssaoUpsamplePipeline =
+      std::make_unique<GraphicsPipeline>(m_context, ssaoUpsampleSpecs);
+
   VkPushConstantRange compPush = {};
   compPush.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-  compPush.size = 24;
+  compPush.size = 28;
   VkPipelineLayoutCreateInfo compLayoutInfo = {
       VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
   compLayoutInfo.pushConstantRangeCount = 1;
@@ -470,7 +865,7 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   compSpecs.vertexShader = m_postVertShader;
   compSpecs.fragmentShader = m_compositeFragShader;
   compSpecs.layout = m_compositeLayout;
-  compSpecs.colorFormats = {m_swapchainFormat};
+  compSpecs.colorFormats = {m_outputFormat};
   compSpecs.depthTest = false;
   compSpecs.depthFormat = VK_FORMAT_UNDEFINED;
   compSpecs.cullMode = VK_CULL_MODE_NONE;
@@ -513,7 +908,7 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   fxaaSpecs.vertexShader = m_postVertShader;
   fxaaSpecs.fragmentShader = m_fxaaFragShader;
   fxaaSpecs.layout = m_fxaaLayout;
-  fxaaSpecs.colorFormats = {m_resources.ldrImage->getSpecs().format};
+  fxaaSpecs.colorFormats = {m_outputFormat}; // LDR_Color
   fxaaSpecs.depthTest = false;
   fxaaSpecs.depthFormat = VK_FORMAT_UNDEFINED;
   fxaaSpecs.cullMode = VK_CULL_MODE_NONE;
@@ -521,7 +916,7 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
 
   VkPushConstantRange cullPush = {};
   cullPush.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-  cullPush.size = 16;
+  cullPush.size = 64;
   VkPipelineLayoutCreateInfo cullLayoutInfo = {
       VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
   cullLayoutInfo.pushConstantRangeCount = 1;
@@ -535,9 +930,26 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   cullSpecs.layout = m_cullLayout;
   m_cullPipeline = std::make_unique<ComputePipeline>(m_context, cullSpecs);
 
+  VkPushConstantRange pyramidPush = {};
+  pyramidPush.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pyramidPush.size = 32;
+  VkPipelineLayoutCreateInfo pyramidLayoutInfo = {
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+  pyramidLayoutInfo.pushConstantRangeCount = 1;
+  pyramidLayoutInfo.pPushConstantRanges = &pyramidPush;
+  pyramidLayoutInfo.setLayoutCount = layoutCount;
+  pyramidLayoutInfo.pSetLayouts = setLayouts;
+  vkCreatePipelineLayout(m_context->getDevice(), &pyramidLayoutInfo, nullptr,
+                         &m_depthPyramidLayout);
+  ComputePipelineSpecs pyramidSpecsP;
+  pyramidSpecsP.computeShader = m_depthPyramidShader;
+  pyramidSpecsP.layout = m_depthPyramidLayout;
+  m_depthPyramidPipeline =
+      std::make_unique<ComputePipeline>(m_context, pyramidSpecsP);
+
   VkPushConstantRange cbPush = {};
   cbPush.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-  cbPush.size = 96;
+  cbPush.size = sizeof(ClusterBuildPushConstants);
   VkPipelineLayoutCreateInfo cbLayoutInfo = {
       VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
   cbLayoutInfo.pushConstantRangeCount = 1;
@@ -554,7 +966,7 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
 
   VkPushConstantRange ccPush = {};
   ccPush.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-  ccPush.size = 96;
+  ccPush.size = sizeof(LightCullPushConstants);
   VkPipelineLayoutCreateInfo ccLayoutInfo = {
       VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
   ccLayoutInfo.pushConstantRangeCount = 1;
@@ -595,21 +1007,151 @@ void RendererSystem::initializePipelines(VkDescriptorSetLayout *setLayouts,
   skySpecs.cullMode = VK_CULL_MODE_NONE;
   m_skyboxPipeline = std::make_unique<GraphicsPipeline>(m_context, skySpecs);
 
+  // Visibility buffer path, its shaders need gl_PrimitiveID in the fragment
+  // stage and typeless storage image writes (see Context)
+  if (m_context->supportsVisibilityBuffer()) {
+    m_visibilityVertShader = std::make_shared<Shader>(
+        m_context, readFile("assets/shaders/visbuffer.vert.spv"),
+        ShaderStage::Vertex, "VisibilityVert");
+    m_visibilityFragShader = std::make_shared<Shader>(
+        m_context, readFile("assets/shaders/visbuffer.frag.spv"),
+        ShaderStage::Fragment, "VisibilityFrag");
+    m_visibilityResolveShader = std::make_shared<Shader>(
+        m_context, readFile("assets/shaders/visbuffer_resolve.comp.spv"),
+        ShaderStage::Compute, "VisibilityResolveShader");
+
+    VkPushConstantRange visPush = {};
+    visPush.stageFlags =
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    visPush.size = sizeof(VisibilityPushConstants);
+    VkPipelineLayoutCreateInfo visLayoutInfo = {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    visLayoutInfo.pushConstantRangeCount = 1;
+    visLayoutInfo.pPushConstantRanges = &visPush;
+    visLayoutInfo.setLayoutCount = layoutCount;
+    visLayoutInfo.pSetLayouts = setLayouts;
+    vkCreatePipelineLayout(m_context->getDevice(), &visLayoutInfo, nullptr,
+                           &m_visibilityLayout);
+
+    // Same rasterization state as the opaque pipeline, so the depth matches
+    PipelineSpecs visSpecs;
+    visSpecs.vertexShader = m_visibilityVertShader;
+    visSpecs.fragmentShader = m_visibilityFragShader;
+    visSpecs.layout = m_visibilityLayout;
+    visSpecs.colorFormats = {VK_FORMAT_R32_UINT};
+    visSpecs.depthFormat = VK_FORMAT_D32_SFLOAT;
+    visSpecs.depthTest = true;
+    visSpecs.cullMode = pbrSpecs.cullMode;
+    visSpecs.vertexBindings = PackedVertex::getBindingDescriptions();
+    visSpecs.vertexAttributes = PackedVertex::getAttributeDescriptions();
+    m_visibilityPipeline =
+        std::make_unique<GraphicsPipeline>(m_context, visSpecs);
+
+    VkPushConstantRange resolvePush = {};
+    resolvePush.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    resolvePush.size = sizeof(VisibilityResolvePushConstants);
+    VkPipelineLayoutCreateInfo resolveLayoutInfo = {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    resolveLayoutInfo.pushConstantRangeCount = 1;
+    resolveLayoutInfo.pPushConstantRanges = &resolvePush;
+    resolveLayoutInfo.setLayoutCount = layoutCount;
+    resolveLayoutInfo.pSetLayouts = setLayouts;
+    vkCreatePipelineLayout(m_context->getDevice(), &resolveLayoutInfo, nullptr,
+                           &m_visibilityResolveLayout);
+    ComputePipelineSpecs resolveSpecs;
+    resolveSpecs.computeShader = m_visibilityResolveShader;
+    resolveSpecs.layout = m_visibilityResolveLayout;
+    m_visibilityResolvePipeline =
+        std::make_unique<ComputePipeline>(m_context, resolveSpecs);
+  }
+
   spdlog::info("Renderer System Initialized.");
 }
 
 void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
                             SceneManager &sceneManager, uint32_t currentFrame,
-                            uint32_t imageIndex, const SceneData &sceneData,
-                            Swapchain *swapchain, FrameSync *sync,
-                            const UIParams &uiParams, const Model *model,
-                            uint32_t skyboxIndex) {
+                            const OutputTarget &output,
+                            const SceneData &sceneData, FrameSync *sync,
+                            const UIParams &uiParams, uint32_t skyboxIndex) {
+
+  // This slot's fence has been waited on, the counters it copied are final
+  if (m_cullReadbackPending[currentFrame]) {
+    const Buffer &readback = *m_resources.cullReadbackBuffers[currentFrame];
+    vmaInvalidateAllocation(m_context->getAllocator(), readback.getAllocation(),
+                            0, VK_WHOLE_SIZE);
+    CullCounters counters;
+    memcpy(&counters, readback.getMappedData(), sizeof(CullCounters));
+    m_cullStats.instanceCount = m_cullInstanceCounts[currentFrame];
+    m_cullStats.drawnCount = counters.earlyDrawCount + counters.lateDrawCount +
+                             counters.transparentDrawn;
+    m_cullStats.frustumCulled = counters.frustumCulled;
+    m_cullStats.occlusionCulled = counters.occlusionCulled;
+    m_cullStats.meshletsDrawn = counters.meshletDrawCount;
+    m_cullStats.meshletsCulled = counters.meshletsCulled;
+    m_cullStats.shadowDrawn = 0;
+    for (uint32_t i = 0; i < 4; i++) {
+      m_cullStats.shadowDrawn +=
+          counters.shadowDrawCount[i] + counters.shadowDynamicDrawCount[i];
+    }
+
+    LightCullCounters lightCounters;
+    memcpy(&lightCounters,
+           static_cast<const uint8_t *>(readback.getMappedData()) +
+               sizeof(CullCounters),
+           sizeof(LightCullCounters));
+    m_lightCullStats.lightCount = m_lightCullLightCounts[currentFrame];
+    m_lightCullStats.indexCount = lightCounters.requiredIndices;
+    // Clusters that didn't fit lost lights for that frame, make room for the
+    // next one (with headroom, so a slowly growing count doesn't grow it twice)
+    GrowableBuffer &lightIndices = *m_resources.lightIndexBuffers[currentFrame];
+    VkDeviceSize required =
+        static_cast<VkDeviceSize>(lightCounters.requiredIndices) *
+        sizeof(uint32_t);
+    if (required > lightIndices.getSize()) {
+      lightIndices.reserve(required + required / 4);
+    }
+    m_cullReadbackPending[currentFrame] = false;
+  }
+
+  if (m_lightCullTimingPending[currentFrame]) {
+    uint64_t timestamps[2] = {};
+    if (vkGetQueryPoolResults(m_context->getDevice(), m_timestampPool,
+                              currentFrame * kTimestampsPerFrame, 2,
+                              sizeof(timestamps),
+                              timestamps, sizeof(uint64_t),
+                              VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+      m_lightCullStats.gpuMs = static_cast<float>(
+          static_cast<double>(timestamps[1] - timestamps[0]) *
+          m_timestampPeriod * 1e-6);
+    }
+    m_lightCullTimingPending[currentFrame] = false;
+  }
+  if (m_ssaoTimingPending[currentFrame]) {
+    uint64_t timestamps[2] = {};
+    if (vkGetQueryPoolResults(m_context->getDevice(), m_timestampPool,
+                              currentFrame * kTimestampsPerFrame + 2, 2,
+                              sizeof(timestamps), timestamps, sizeof(uint64_t),
+                              VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+      m_ssaoStats.gpuMs = static_cast<float>(
+          static_cast<double>(timestamps[1] - timestamps[0]) *
+          m_timestampPeriod * 1e-6);
+      m_ssaoStats.compute = m_ssaoTimingCompute[currentFrame];
+    }
+    m_ssaoTimingPending[currentFrame] = false;
+  }
+  m_lightCullStats.indexCapacity = static_cast<uint32_t>(
+      m_resources.lightIndexBuffers[currentFrame]->getSize() /
+      sizeof(uint32_t));
 
   SceneData sd = sceneData;
   sd.shadowMapIndex = m_shadowMapIndex;
   sd.clusterBufferIndex = m_clusterBufferIndex;
   sd.clusterGridBufferIndex = m_resources.clusterGridBufferIndices[currentFrame];
-  sd.clusterLightIndexBufferIndex = m_resources.lightIndexBufferIndices[currentFrame];
+  sd.clusterLightIndexBufferIndex =
+      m_resources.lightIndexBuffers[currentFrame]->getIndex();
+  sd.gridX = static_cast<int>(m_clusterGridX);
+  sd.gridY = static_cast<int>(m_clusterGridY);
+  sd.gridZ = static_cast<int>(m_clusterGridZ);
   sd.shadowBias = uiParams.shadowBias;
   sd.shadowNormalBias = uiParams.shadowNormalBias;
   sd.pcfRange = uiParams.pcfRange;
@@ -621,12 +1163,56 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
   sd.visualizeCascades = uiParams.visualizeCascades ? 1 : 0;
   sd.sceneColorIndex = m_sceneColorTextureIndex;
 
+  // Cascade 0 is redrawn every frame. The far cascades keep their static
+  // casters in shadowCacheImage and only redraw them when the cascade moved by
+  // a texel (camera, light direction, csmLambda) or the static scene changed;
+  // otherwise the cache is copied back and the dynamic casters drawn on top,
+  // and only when the dynamic casters touching the cascade changed.
+  enum class ShadowMode { Full, Refresh, Restore, Skip };
+  ShadowMode shadowModes[4];
+  uint32_t shadowStaticMask = 0;
+  uint64_t staticVersion = sceneManager.getStaticSceneVersion();
+  if (!uiParams.enableShadowCaching ||
+      staticVersion != m_shadowCacheStaticVersion) {
+    invalidateShadowCache();
+    m_shadowCacheStaticVersion = staticVersion;
+  }
+  const auto &dynamicInstances = sceneManager.getDynamicInstances(currentFrame);
+  const auto &dynamicVersions =
+      sceneManager.getDynamicInstanceVersions(currentFrame);
+  // Decided against what the last submitted frame left behind, this frame's
+  // result is staged and committed by onFrameSubmitted
+  for (uint32_t i = 0; i < 4; i++) {
+    const ShadowCascadeCache &cache = m_shadowCascades[i];
+    ShadowCascadeCache &pending = m_pendingShadowCache.cascades[i];
+    pending = cache;
+    if (!uiParams.enableShadowCaching || i == 0) {
+      shadowModes[i] = ShadowMode::Full;
+      shadowStaticMask |= 1u << i;
+      continue;
+    }
+    if (!cache.valid || !m_shadowMapValid ||
+        cascadeMoved(cache.viewProj, sd.cascadeViewProj[i])) {
+      pending.viewProj = sd.cascadeViewProj[i];
+      pending.valid = true;
+      shadowModes[i] = ShadowMode::Refresh;
+      shadowStaticMask |= 1u << i;
+    } else {
+      // Less than a texel off, keep sampling with what the cache was drawn with
+      sd.cascadeViewProj[i] = cache.viewProj;
+      shadowModes[i] = ShadowMode::Skip;
+    }
+    uint64_t dynamicHash =
+        hashDynamicCasters(dynamicInstances, dynamicVersions, pending.viewProj);
+    if (shadowModes[i] == ShadowMode::Skip && dynamicHash != cache.dynamicHash) {
+      shadowModes[i] = ShadowMode::Restore;
+    }
+    pending.dynamicHash = dynamicHash;
+  }
+
   sceneManager.updateSceneData(currentFrame, sd);
 
-  VkExtent2D ext = swapchain->getExtent();
-  VkImage swapImage = swapchain->getImages()[imageIndex];
-  VkImageView swapView = swapchain->getImageViews()[imageIndex];
-  VkFormat swapFormat = swapchain->getImageFormat();
+  VkExtent2D ext = output.extent;
 
   VkClearValue colorClear;
   // DEBUG: Magenta clear color to verify RenderPass execution
@@ -638,20 +1224,64 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
   VkClearValue ssaoClear;
   ssaoClear.color = {{1.0f, 0.0f, 0.0f, 0.0f}};
 
-  graph.addExternalResource("Swapchain", swapImage, swapView, swapFormat,
-                            ext.width, ext.height, VK_IMAGE_LAYOUT_UNDEFINED);
-  graph.setResourceClearValue("Swapchain", colorClear);
+  uint32_t instanceCount =
+      static_cast<uint32_t>(sceneManager.getMeshInstanceCount(currentFrame));
+  uint32_t opaqueCount = static_cast<uint32_t>(
+      sceneManager.getOpaqueMeshInstanceCount(currentFrame));
+  m_cullInstanceCounts[currentFrame] = instanceCount;
+  // Every model lives in the geometry arena, nothing to bind while it's empty
+  const bool hasGeometry =
+      sceneManager.getGeometryArena().getUsedIndices() > 0;
+
+  // Meshlets of whole-visible opaque instances are culled once more, each
+  // survivor gets its own command behind the two instance regions
+  const uint32_t meshletCount = sceneManager.getMeshletCount();
+  const bool meshletsEnabled = uiParams.enableMeshletCulling && meshletCount > 0;
+
+  // Visibility buffer: the opaque draws only write depth and which triangle of
+  // which draw command covers the pixel, visbuffer_resolve.comp then shades
+  // every covered pixel exactly once. The 32 bit ID holds the command index
+  // above the triangle index, scenes that don't fit render forward.
+  bool visibilityBuffer = uiParams.enableVisibilityBuffer && hasGeometry &&
+                          m_context->supportsVisibilityBuffer();
+  uint32_t triangleBits = 0;
+  if (visibilityBuffer) {
+    triangleBits = static_cast<uint32_t>(
+        std::bit_width(std::max(sceneManager.getMaxDrawTriangles(), 1u) - 1));
+    uint64_t commandCount = 2 * static_cast<uint64_t>(instanceCount) +
+                            (meshletsEnabled ? meshletCount : 0);
+    if ((commandCount << triangleBits) >= UINT32_MAX) {
+      if (!m_visibilityFallbackWarned) {
+        spdlog::warn("Visibility buffer: {} draw commands of up to {} "
+                     "triangles don't fit a 32 bit ID, rendering forward",
+                     commandCount, sceneManager.getMaxDrawTriangles());
+        m_visibilityFallbackWarned = true;
+      }
+      visibilityBuffer = false;
+    }
+  }
+
+  // Intermediates live only within the frame, the graph aliases their memory
+  const VkImageUsageFlags targetUsage =
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  // The visibility resolve writes the opaque targets from a compute shader
+  const VkImageUsageFlags opaqueTargetUsage =
+      targetUsage | (visibilityBuffer ? VK_IMAGE_USAGE_STORAGE_BIT : 0);
+  auto storageSlot = [visibilityBuffer](uint32_t index) {
+    return visibilityBuffer ? index : UINT32_MAX;
+  };
 
-  graph.addExternalResource("HDR_Color", m_resources.hdrImage->getHandle(),
-                            m_resources.hdrImage->getView(),
-                            m_resources.hdrImage->getSpecs().format, ext.width,
-                            ext.height, VK_IMAGE_LAYOUT_UNDEFINED);
+  graph.addTransientImage("HDR_Color",
+                          {ext.width, ext.height, VK_FORMAT_R16G16B16A16_SFLOAT,
+                           opaqueTargetUsage | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                           m_hdrTextureIndex, m_hdrSampler,
+                           storageSlot(m_hdrStorageIndex)});
   graph.setResourceClearValue("HDR_Color", colorClear);
 
-  graph.addExternalResource("Normal", m_resources.normalImage->getHandle(),
-                            m_resources.normalImage->getView(),
-                            m_resources.normalImage->getSpecs().format,
-                            ext.width, ext.height, VK_IMAGE_LAYOUT_UNDEFINED);
+  graph.addTransientImage("Normal",
+                          {ext.width, ext.height, VK_FORMAT_R16G16B16A16_SFLOAT,
+                           opaqueTargetUsage, m_normalTextureIndex, m_hdrSampler,
+                           storageSlot(m_normalStorageIndex)});
   graph.setResourceClearValue("Normal", colorClear);
 
   graph.addExternalResource("Depth", m_resources.depthImage->getHandle(),
@@ -660,17 +1290,167 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
                             ext.width, ext.height, VK_IMAGE_LAYOUT_UNDEFINED);
   graph.setResourceClearValue("Depth", depthClear);
 
-  graph.addExternalResource("Velocity", m_resources.velocityImage->getHandle(),
-                            m_resources.velocityImage->getView(),
-                            m_resources.velocityImage->getSpecs().format,
-                            ext.width, ext.height, VK_IMAGE_LAYOUT_UNDEFINED);
+  graph.addTransientImage("Velocity",
+                          {ext.width, ext.height, VK_FORMAT_R16G16_SFLOAT,
+                           opaqueTargetUsage, m_velocityTextureIndex,
+                           m_hdrSampler, storageSlot(m_velocityStorageIndex)});
+
+  if (visibilityBuffer) {
+    graph.addTransientImage("Visibility",
+                            {ext.width, ext.height, VK_FORMAT_R32_UINT,
+                             targetUsage, m_visibilityTextureIndex,
+                             m_depthPyramidSampler});
+    VkClearValue visibilityClear;
+    visibilityClear.color.uint32[0] = UINT32_MAX; // EMPTY_VISIBILITY
+    visibilityClear.color.uint32[1] = 0;
+    visibilityClear.color.uint32[2] = 0;
+    visibilityClear.color.uint32[3] = 0;
+    graph.setResourceClearValue("Visibility", visibilityClear);
+  }
 
+  // Skipped cascades keep last frame's contents, so only the very first frame
+  // may start from UNDEFINED
+  const VkImageLayout shadowLayout = m_shadowMapValid
+                                         ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                         : VK_IMAGE_LAYOUT_UNDEFINED;
   graph.addExternalResource("ShadowMap", m_resources.shadowImage->getHandle(),
                             m_resources.shadowImage->getView(),
-                            m_resources.shadowImage->getSpecs().format, 4096,
-                            4096, VK_IMAGE_LAYOUT_UNDEFINED);
+                            m_resources.shadowImage->getSpecs().format,
+                            kShadowMapSize, kShadowMapSize, shadowLayout);
+
+  // Buffers shared between the compute and raster passes, RenderGraph derives
+  // their barriers from the declared accesses below
+  graph.addExternalBuffer("MeshInstances",
+                          sceneManager.getMeshInstanceBuffer(currentFrame),
+                          VK_WHOLE_SIZE);
+  graph.addExternalBuffer("IndirectCommands",
+                          sceneManager.getIndirectBuffer(currentFrame),
+                          VK_WHOLE_SIZE);
+  graph.addExternalBuffer("ClusterAABBs", m_resources.clusterBuffer->getHandle(),
+                          m_resources.clusterBuffer->getSize());
+  graph.addExternalBuffer(
+      "ClusterGrid", m_resources.clusterGridBuffers[currentFrame]->getHandle(),
+      m_resources.clusterGridBuffers[currentFrame]->getSize());
+  graph.addExternalBuffer(
+      "ClusterLightIndices",
+      m_resources.lightIndexBuffers[currentFrame]->getHandle(),
+      m_resources.lightIndexBuffers[currentFrame]->getSize());
+  graph.addExternalBuffer(
+      "LightCullCounters",
+      m_resources.lightCullCounterBuffers[currentFrame]->getHandle(),
+      m_resources.lightCullCounterBuffers[currentFrame]->getSize());
+
+  // Two phase culling: the early phase tests last frame's depth pyramid and
+  // only draws what was visible there, the pyramid is then rebuilt from that
+  // depth and the late phase retests the rest against it. Each shadow cascade
+  // gets its own lists, culled against the cascade's light space box.
+  //
+  // Every list region holds one command per instance (per meshlet for the
+  // last one). The frame's fence has signaled, so its culling buffers can be
+  // replaced if the scene outgrew them. The candidate buffer holds the late
+  // candidates, then the instances queued for meshlet culling.
+  const VkDeviceSize commandStride = sizeof(VkDrawIndexedIndirectCommand);
+  m_resources.drawCommandBuffers[currentFrame]->reserve(
+      (2 * static_cast<VkDeviceSize>(instanceCount) + meshletCount) *
+      commandStride);
+  m_resources.shadowDrawCommandBuffers[currentFrame]->reserve(
+      8 * instanceCount * commandStride);
+  m_resources.cullCandidateBuffers[currentFrame]->reserve(
+      2 * instanceCount * sizeof(uint32_t));
+
+  graph.addExternalBuffer(
+      "DrawCommands", m_resources.drawCommandBuffers[currentFrame]->getHandle(),
+      m_resources.drawCommandBuffers[currentFrame]->getSize());
+  graph.addExternalBuffer(
+      "CullCounters", m_resources.cullCounterBuffers[currentFrame]->getHandle(),
+      m_resources.cullCounterBuffers[currentFrame]->getSize());
+  graph.addExternalBuffer(
+      "CullCandidates",
+      m_resources.cullCandidateBuffers[currentFrame]->getHandle(),
+      m_resources.cullCandidateBuffers[currentFrame]->getSize());
+  graph.addExternalBuffer(
+      "ShadowDrawCommands",
+      m_resources.shadowDrawCommandBuffers[currentFrame]->getHandle(),
+      m_resources.shadowDrawCommandBuffers[currentFrame]->getSize());
+  // Persists across frames, the late culling read leaves it SHADER_READ_ONLY
+  const ImageSpecs &pyramidSpecs = m_resources.depthPyramid->getSpecs();
+  graph.addExternalResource("DepthPyramid",
+                            m_resources.depthPyramid->getHandle(),
+                            m_resources.depthPyramid->getView(),
+                            pyramidSpecs.format, pyramidSpecs.width,
+                            pyramidSpecs.height,
+                            m_resources.depthPyramidValid
+                                ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                : VK_IMAGE_LAYOUT_UNDEFINED);
+
+  // Read after execute(): the counters by recordCullReadback, the pyramid,
+  // the cluster bounds and the cached shadow cascades by later frames. Their
+  // writers must run even when nothing else this frame reads them.
+  graph.markExported("CullCounters");
+  graph.markExported("LightCullCounters");
+  graph.markExported("DepthPyramid");
+  graph.markExported("ClusterAABBs");
+  graph.markExported("ShadowMap");
+
+  struct CullPushConstants {
+    uint32_t sceneDataIndex;
+    uint32_t instanceBufferIndex;
+    uint32_t sourceCommandIndex;
+    uint32_t drawCommandIndex;
+    uint32_t counterIndex;
+    uint32_t candidateIndex;
+    uint32_t pyramidIndex;
+    uint32_t pyramidLevels;
+    uint32_t instanceCount;
+    uint32_t opaqueCount;
+    uint32_t regionSize;
+    uint32_t phase;
+    uint32_t occlusionEnabled;
+    uint32_t shadowStaticMask;
+    uint32_t meshletBufferIndex;
+    uint32_t meshletsEnabled;
+  } cpc = {};
+  cpc.sceneDataIndex = sceneManager.getSceneBufferIndex(currentFrame);
+  cpc.instanceBufferIndex = sceneManager.getMeshInstanceBufferIndex(currentFrame);
+  cpc.sourceCommandIndex = sceneManager.getIndirectBufferIndex(currentFrame);
+  cpc.drawCommandIndex = m_resources.drawCommandBuffers[currentFrame]->getIndex();
+  cpc.counterIndex = m_resources.cullCounterBufferIndices[currentFrame];
+  cpc.candidateIndex = m_resources.cullCandidateBuffers[currentFrame]->getIndex();
+  cpc.pyramidIndex = m_depthPyramidIndex;
+  cpc.pyramidLevels = pyramidSpecs.mipLevels;
+  cpc.instanceCount = instanceCount;
+  cpc.opaqueCount = opaqueCount;
+  cpc.regionSize = instanceCount;
+  cpc.meshletBufferIndex =
+      sceneManager.getGeometryArena().getMeshletBufferIndex();
+  cpc.meshletsEnabled = meshletsEnabled ? 1 : 0;
+  // Nothing to test against until the pyramid has been built once
+  cpc.occlusionEnabled =
+      uiParams.enableOcclusionCulling && m_resources.depthPyramidValid ? 1 : 0;
+
+  graph.addPass("CullCounterResetPass",
+                {{"CullCounters", ResourceUsage::Clear}},
+                [this, currentFrame](VkCommandBuffer cb) {
+    // Zeroes, except the meshlet dispatch's y / z
+    CullCounters initial = {};
+    initial.meshletDispatch[1] = 1;
+    initial.meshletDispatch[2] = 1;
+    vkCmdUpdateBuffer(cb,
+                      m_resources.cullCounterBuffers[currentFrame]->getHandle(),
+                      0, sizeof(CullCounters), &initial);
+  });
 
-  graph.addPass("CullingPass", {}, {}, [this, &sceneManager, currentFrame](VkCommandBuffer cb) {
+  graph.addPass("CullingPass",
+                {{"MeshInstances", ResourceUsage::StorageReadCompute},
+                 {"IndirectCommands", ResourceUsage::StorageReadCompute},
+                 {"DepthPyramid", ResourceUsage::SampledCompute},
+                 {"CullCounters", ResourceUsage::StorageReadWriteCompute},
+                 {"CullCandidates", ResourceUsage::StorageWriteCompute},
+                 {"DrawCommands", ResourceUsage::StorageWriteCompute}},
+                [this, cpc](VkCommandBuffer cb) {
+    if (cpc.instanceCount == 0) {
+      return;
+    }
     vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
                       m_cullPipeline->getHandle());
     VkDescriptorSet globalSet =
@@ -678,304 +1458,853 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
     vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullLayout, 0,
                             1, &globalSet, 0, nullptr);
 
-    struct CullPushConstants {
-      uint32_t sceneDataIndex;
-      uint32_t instanceBufferIndex;
-      uint32_t indirectBufferIndex;
-      uint32_t instanceCount;
-    } cpc;
-    cpc.sceneDataIndex = sceneManager.getSceneBufferIndex(currentFrame);
-    cpc.instanceBufferIndex =
-        sceneManager.getMeshInstanceBufferIndex(currentFrame);
-    cpc.indirectBufferIndex = sceneManager.getIndirectBufferIndex(currentFrame);
-    cpc.instanceCount =
-        static_cast<uint32_t>(sceneManager.getMeshInstanceCount(currentFrame));
+    CullPushConstants push = cpc;
+    push.phase = 0;
+    vkCmdPushConstants(cb, m_cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(CullPushConstants), &push);
+    vkCmdDispatch(cb, (push.instanceCount + 63) / 64, 1, 1);
+  });
 
+  // One workgroup per instance the early phase queued, the count comes
+  // straight from the counters
+  graph.addPass("MeshletCullingPass",
+                {{"MeshInstances", ResourceUsage::StorageReadCompute},
+                 {"IndirectCommands", ResourceUsage::StorageReadCompute},
+                 {"CullCandidates", ResourceUsage::StorageReadCompute},
+                 {"CullCounters", ResourceUsage::IndirectRead},
+                 {"CullCounters", ResourceUsage::StorageReadWriteCompute},
+                 {"DrawCommands", ResourceUsage::StorageWriteCompute}},
+                [this, cpc, currentFrame](VkCommandBuffer cb) {
+    if (cpc.meshletsEnabled == 0 || cpc.opaqueCount == 0) {
+      return;
+    }
+    vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      m_cullPipeline->getHandle());
+    VkDescriptorSet globalSet =
+        m_context->getDescriptorManager().getDescriptorSet();
+    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullLayout, 0,
+                            1, &globalSet, 0, nullptr);
+
+    CullPushConstants push = cpc;
+    push.phase = 3;
     vkCmdPushConstants(cb, m_cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
-                       sizeof(CullPushConstants), &cpc);
-    uint32_t groupCount = (cpc.instanceCount + 63) / 64;
-    // vkCmdDispatch(cb, groupCount, 1, 1); // DEBUG: Disabled culling dispatch
-    
-    VkBufferMemoryBarrier barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
-    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
-    barrier.buffer = sceneManager.getIndirectBuffer(currentFrame);
-    barrier.offset = 0;
-    barrier.size = VK_WHOLE_SIZE;
-    vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr, 1,
-                         &barrier, 0, nullptr);
+                       sizeof(CullPushConstants), &push);
+    vkCmdDispatchIndirect(
+        cb, m_resources.cullCounterBuffers[currentFrame]->getHandle(),
+        offsetof(CullCounters, meshletDispatch));
   });
 
-  if (!m_clustersBuilt) {
-      // Cluster Build Pass
-    graph.addPass("ClusterBuildPass", {}, {}, [this, &sceneManager, sd](VkCommandBuffer cb) {
-        vkCmdFillBuffer(cb, m_resources.clusterBuffer->getHandle(), 0,
-                        m_resources.clusterBuffer->getSize(), 0);
-        
-        VkBufferMemoryBarrier barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
-        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
-        barrier.buffer = m_resources.clusterBuffer->getHandle();
-        barrier.size = VK_WHOLE_SIZE;
-        
-        vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1,
-                             &barrier, 0, nullptr);
+  // Frustum only, the Hi-Z pyramid is from the camera's point of view
+  uint32_t shadowDrawCommandIndex =
+      m_resources.shadowDrawCommandBuffers[currentFrame]->getIndex();
+  graph.addPass("ShadowCullingPass",
+                {{"MeshInstances", ResourceUsage::StorageReadCompute},
+                 {"IndirectCommands", ResourceUsage::StorageReadCompute},
+                 {"CullCounters", ResourceUsage::StorageReadWriteCompute},
+                 {"ShadowDrawCommands", ResourceUsage::StorageWriteCompute}},
+                [this, cpc, shadowDrawCommandIndex,
+                 shadowStaticMask](VkCommandBuffer cb) {
+    if (cpc.instanceCount == 0) {
+      return;
+    }
+    vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      m_cullPipeline->getHandle());
+    VkDescriptorSet globalSet =
+        m_context->getDescriptorManager().getDescriptorSet();
+    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullLayout, 0,
+                            1, &globalSet, 0, nullptr);
 
-        vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
-                          m_clusterBuildPipeline->getHandle());
-        VkDescriptorSet globalSet =
-            m_context->getDescriptorManager().getDescriptorSet();
-        vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
-                                m_clusterBuildLayout, 0, 1, &globalSet, 0, nullptr);
+    CullPushConstants push = cpc;
+    push.drawCommandIndex = shadowDrawCommandIndex;
+    push.phase = 2;
+    push.shadowStaticMask = shadowStaticMask;
+    vkCmdPushConstants(cb, m_cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(CullPushConstants), &push);
+    vkCmdDispatch(cb, (push.instanceCount + 63) / 64, 4, 1);
+  });
 
-        struct {
-          uint32_t cbIdx;
-          float v[16]; // viewInverse
-          float p[16]; // projInverse
-          float n, f;
-          float sW, sH;
-        } push;
-        push.cbIdx = m_clusterBufferIndex;
-        memcpy(push.v, &sd.invView[0][0], 64);
-        memcpy(push.p, &sd.invProj[0][0], 64);
-        push.n = sd.nearClip;
-        push.f = sd.farClip;
-        push.sW = sd.screenWidth;
-        push.sH = sd.screenHeight;
-        vkCmdPushConstants(cb, m_clusterBuildLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
-                           sizeof(push), &push);
-        vkCmdDispatch(cb, 16, 9, 24);
+  // Cluster AABBs only depend on the projection, they're rebuilt when it (or
+  // the clip planes) change rather than every frame
+  const bool clustersStale = !m_clusterBuild.valid ||
+                             m_clusterBuild.invProj != sd.invProj ||
+                             m_clusterBuild.nearClip != sd.nearClip ||
+                             m_clusterBuild.farClip != sd.farClip;
+  if (clustersStale) {
+    ClusterBuildPushConstants buildPush = {};
+    buildPush.clusterBufferIndex = m_clusterBufferIndex;
+    buildPush.gridX = m_clusterGridX;
+    buildPush.gridY = m_clusterGridY;
+    buildPush.gridZ = m_clusterGridZ;
+    buildPush.invProj = sd.invProj;
+    buildPush.nearClip = sd.nearClip;
+    buildPush.farClip = sd.farClip;
+
+    // The buffer is shared by both frame slots. The graph's state for it
+    // carries over between frames, so the write waits on the other slot's
+    // light culling reads of the old AABBs.
+    graph.addPass("ClusterBuildPass",
+                  {{"ClusterAABBs", ResourceUsage::StorageWriteCompute}},
+                  [this, buildPush](VkCommandBuffer cb) {
+      vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                        m_clusterBuildPipeline->getHandle());
+      VkDescriptorSet globalSet =
+          m_context->getDescriptorManager().getDescriptorSet();
+      vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                              m_clusterBuildLayout, 0, 1, &globalSet, 0,
+                              nullptr);
+      vkCmdPushConstants(cb, m_clusterBuildLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                         0, sizeof(buildPush), &buildPush);
+      vkCmdDispatch(cb, (m_clusterCount + 63) / 64, 1, 1);
     });
-    m_clustersBuilt = true;
+    m_pendingClusterBuild.invProj = sd.invProj;
+    m_pendingClusterBuild.nearClip = sd.nearClip;
+    m_pendingClusterBuild.farClip = sd.farClip;
+    m_pendingClusterBuild.valid = true;
   }
 
-  // Cluster Cull Pass
-  graph.addPass("ClusterCullPass", {}, {}, [this, &sceneManager, currentFrame, sd](VkCommandBuffer cb) {
-    vkCmdFillBuffer(cb,
-                    m_resources.clusterAtomicBuffers[currentFrame]->getHandle(),
-                    0, sizeof(uint32_t), 0);
-    VkBufferMemoryBarrier fillBarrier = {
-        VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
-    fillBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-    fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    fillBarrier.dstAccessMask =
-        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
-    fillBarrier.buffer =
-        m_resources.clusterAtomicBuffers[currentFrame]->getHandle();
-    fillBarrier.size = sizeof(uint32_t);
-    vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1,
-                         &fillBarrier, 0, nullptr);
+  // Hi-Z pyramid from the early depth (the prepass when it runs, else the early
+  // opaque draws), read by the late phase and by next frame's early phase
+  auto addDepthPyramidPass = [this, &graph]() {
+    graph.addPass(
+        "DepthPyramidPass",
+        {{"Depth", ResourceUsage::SampledCompute},
+         {"DepthPyramid", ResourceUsage::StorageReadWriteCompute}},
+        [this](VkCommandBuffer cb) {
+          vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            m_depthPyramidPipeline->getHandle());
+          VkDescriptorSet globalSet =
+              m_context->getDescriptorManager().getDescriptorSet();
+          vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                  m_depthPyramidLayout, 0, 1, &globalSet, 0,
+                                  nullptr);
 
+          const ImageSpecs &depthSpecs = m_resources.depthImage->getSpecs();
+          const ImageSpecs &pyramidSpecs = m_resources.depthPyramid->getSpecs();
+          struct {
+            uint32_t srcIndex, dstIndex, fromDepth, pad;
+            int32_t srcWidth, srcHeight, dstWidth, dstHeight;
+          } push = {};
+          push.srcWidth = static_cast<int32_t>(depthSpecs.width);
+          push.srcHeight = static_cast<int32_t>(depthSpecs.height);
+
+          for (uint32_t level = 0; level < pyramidSpecs.mipLevels; level++) {
+            push.srcIndex = level == 0
+                                ? m_depthTextureIndex
+                                : m_resources.depthPyramidMipIndices[level - 1];
+            push.dstIndex = m_resources.depthPyramidMipIndices[level];
+            push.fromDepth = level == 0 ? 1 : 0;
+            push.dstWidth =
+                static_cast<int32_t>(std::max(1u, pyramidSpecs.width >> level));
+            push.dstHeight =
+                static_cast<int32_t>(std::max(1u, pyramidSpecs.height >> level));
+            vkCmdPushConstants(cb, m_depthPyramidLayout,
+                               VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push),
+                               &push);
+            vkCmdDispatch(cb, (push.dstWidth + 7) / 8, (push.dstHeight + 7) / 8,
+                          1);
+
+            if (level + 1 < pyramidSpecs.mipLevels) {
+              // Mip to mip dependency inside the pass, the graph only syncs
+              // between passes (see ResourceUsage in render_graph.hpp)
+              VkImageMemoryBarrier2 barrier = {
+                  VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+              barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+              barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+              barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+              barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+              barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+              barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+              barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+              barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+              barrier.image = m_resources.depthPyramid->getHandle();
+              barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0,
+                                          1};
+              VkDependencyInfo depInfo = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+              depInfo.imageMemoryBarrierCount = 1;
+              depInfo.pImageMemoryBarriers = &barrier;
+              vkCmdPipelineBarrier2(cb, &depInfo);
+            }
+
+            push.srcWidth = push.dstWidth;
+            push.srcHeight = push.dstHeight;
+          }
+        });
+  };
+
+  // Depth prepass: the early draws position-only, so the opaque pass shades
+  // each pixel once and the light culling / pyramid see this frame's depth.
+  // The late draws get theirs in DepthLatePrepass, after the late culling.
+  // Alpha tested materials aren't in it, with any around the opaque pass falls
+  // back from EQUAL to LESS_OR_EQUAL with depth writes. The visibility pass
+  // already is a depth-only-cost pass, it replaces the prepass.
+  const bool depthPrepass =
+      uiParams.enableDepthPrepass && hasGeometry && !visibilityBuffer;
+  const bool prepassEqual = depthPrepass && !sceneManager.hasMaskedMaterials();
+  // Both opaque passes go on top of the prepass depth (the late one on top of
+  // DepthLatePrepass)
+  const ResourceUsage opaqueDepthUsage =
+      !depthPrepass ? ResourceUsage::DepthAttachment
+      : prepassEqual ? ResourceUsage::DepthAttachmentReadOnly
+                     : ResourceUsage::DepthAttachmentLoad;
+  const VkPipeline opaquePipeline =
+      !depthPrepass ? m_pbrPipeline->getHandle()
+      : prepassEqual ? m_pbrEqualPipeline->getHandle()
+                     : m_pbrLessEqualPipeline->getHandle();
+
+  // State for the position-only prepass draws
+  auto beginDepthPrepass = [this, &sceneManager, currentFrame,
+                            ext](VkCommandBuffer cb) {
+    VkViewport viewport = {0.0f, 0.0f, (float)ext.width, (float)ext.height,
+                           0.0f, 1.0f};
+    vkCmdSetViewport(cb, 0, 1, &viewport);
+    VkRect2D scissor = {{0, 0}, {ext.width, ext.height}};
+    vkCmdSetScissor(cb, 0, 1, &scissor);
+
+    vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      m_depthPrepassPipeline->getHandle());
+    VkDescriptorSet globalSet =
+        m_context->getDescriptorManager().getDescriptorSet();
+    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            m_pipelineLayout, 0, 1, &globalSet, 0, nullptr);
+    bindGeometry(cb, sceneManager, true);
+
+    struct {
+      uint32_t sIdx, iIdx, mIdx;
+    } spc;
+    spc.sIdx = sceneManager.getSceneBufferIndex(currentFrame);
+    spc.iIdx = sceneManager.getMeshInstanceBufferIndex(currentFrame);
+    spc.mIdx = sceneManager.getMaterialBufferIndex(currentFrame);
+    vkCmdPushConstants(cb, m_pipelineLayout,
+                       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                       0, sizeof(spc), &spc);
+  };
+
+  if (depthPrepass) {
+    graph.addPass(
+        "DepthPrepass",
+        {{"Depth", ResourceUsage::DepthAttachment},
+         {"MeshInstances", ResourceUsage::StorageReadVertex},
+         {"DrawCommands", ResourceUsage::IndirectRead},
+         {"CullCounters", ResourceUsage::IndirectRead}},
+        [this, currentFrame, beginDepthPrepass, opaqueCount, instanceCount,
+         meshletsEnabled, meshletCount](VkCommandBuffer cb) {
+          beginDepthPrepass(cb);
+
+          const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+          VkBuffer commands =
+              m_resources.drawCommandBuffers[currentFrame]->getHandle();
+          VkBuffer counters =
+              m_resources.cullCounterBuffers[currentFrame]->getHandle();
+          vkCmdDrawIndexedIndirectCount(
+              cb, commands, 0, counters,
+              offsetof(CullCounters, earlyDrawCount), opaqueCount, stride);
+          if (meshletsEnabled) {
+            vkCmdDrawIndexedIndirectCount(
+                cb, commands, 2 * static_cast<VkDeviceSize>(instanceCount) * stride,
+                counters, offsetof(CullCounters, meshletDrawCount),
+                meshletCount, stride);
+          }
+        });
+    addDepthPyramidPass();
+  }
+
+  // Visibility draws of one culling phase, same command lists as the opaque
+  // pass. gl_DrawID counts from firstCommand, so the IDs index the whole list.
+  auto drawVisibility = [this, &sceneManager, currentFrame, ext,
+                         triangleBits](VkCommandBuffer cb, uint32_t firstCommand,
+                                       VkDeviceSize countOffset,
+                                       uint32_t maxDrawCount) {
+    VkViewport viewport = {0.0f, 0.0f, (float)ext.width, (float)ext.height,
+                           0.0f, 1.0f};
+    vkCmdSetViewport(cb, 0, 1, &viewport);
+    VkRect2D scissor = {{0, 0}, {ext.width, ext.height}};
+    vkCmdSetScissor(cb, 0, 1, &scissor);
+
+    if (maxDrawCount == 0) {
+      return;
+    }
+    vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      m_visibilityPipeline->getHandle());
+    VkDescriptorSet globalSet =
+        m_context->getDescriptorManager().getDescriptorSet();
+    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            m_visibilityLayout, 0, 1, &globalSet, 0, nullptr);
+    bindGeometry(cb, sceneManager, false);
+
+    VisibilityPushConstants push = {};
+    push.sceneDataIndex = sceneManager.getSceneBufferIndex(currentFrame);
+    push.instanceBufferIndex =
+        sceneManager.getMeshInstanceBufferIndex(currentFrame);
+    push.materialBufferIndex = sceneManager.getMaterialBufferIndex(currentFrame);
+    push.firstCommand = firstCommand;
+    push.triangleBits = triangleBits;
+    vkCmdPushConstants(cb, m_visibilityLayout,
+                       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                       0, sizeof(push), &push);
+
+    const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+    vkCmdDrawIndexedIndirectCount(
+        cb, m_resources.drawCommandBuffers[currentFrame]->getHandle(),
+        firstCommand * stride,
+        m_resources.cullCounterBuffers[currentFrame]->getHandle(), countOffset,
+        maxDrawCount, stride);
+  };
+
+  // Early visibility pass, like the prepass its depth feeds the pyramid and
+  // the light culling depth bounds of this frame
+  if (visibilityBuffer) {
+    graph.addPass(
+        "VisibilityPass",
+        {{"Visibility", ResourceUsage::ColorAttachment},
+         {"Depth", ResourceUsage::DepthAttachment},
+         {"MeshInstances", ResourceUsage::StorageReadVertex},
+         {"DrawCommands", ResourceUsage::IndirectRead},
+         {"CullCounters", ResourceUsage::IndirectRead}},
+        [drawVisibility, opaqueCount, instanceCount, meshletsEnabled,
+         meshletCount](VkCommandBuffer cb) {
+          drawVisibility(cb, 0, offsetof(CullCounters, earlyDrawCount),
+                         opaqueCount);
+          if (meshletsEnabled) {
+            drawVisibility(cb, 2 * instanceCount,
+                           offsetof(CullCounters, meshletDrawCount),
+                           meshletCount);
+          }
+        });
+    addDepthPyramidPass();
+  }
+
+  // Light culling: count the lights per cluster, turn the counts into offsets,
+  // then write the compact light index list
+  m_lightCullLightCounts[currentFrame] = sd.lightCount;
+  LightCullPushConstants lightCullPush = {};
+  lightCullPush.clusterBufferIndex = m_clusterBufferIndex;
+  lightCullPush.lightBufferIndex = sd.lightBufferIndex;
+  lightCullPush.lightIndexBufferIndex =
+      m_resources.lightIndexBuffers[currentFrame]->getIndex();
+  lightCullPush.clusterGridBufferIndex =
+      m_resources.clusterGridBufferIndices[currentFrame];
+  lightCullPush.counterBufferIndex =
+      m_resources.lightCullCounterBufferIndices[currentFrame];
+  lightCullPush.lightCount = sd.lightCount;
+  lightCullPush.gridX = m_clusterGridX;
+  lightCullPush.gridY = m_clusterGridY;
+  lightCullPush.gridZ = m_clusterGridZ;
+  lightCullPush.nearClip = sd.nearClip;
+  lightCullPush.farClip = sd.farClip;
+  // Depth bounds from this frame's pyramid, at the mip whose texels are about
+  // half a tile wide (level L texels cover 2^(L+1) pixels). Only with the
+  // prepass or the visibility pass: last frame's depth would cull lights off
+  // clusters that newly visible geometry now occupies.
+  const bool clusterDepthBounds =
+      uiParams.enableClusterDepthBounds && (depthPrepass || visibilityBuffer);
+  lightCullPush.depthPyramidIndex =
+      clusterDepthBounds ? m_depthPyramidIndex : UINT32_MAX;
+  if (clusterDepthBounds) {
+    uint32_t tilePixels = std::max(1u, m_width / m_clusterGridX);
+    uint32_t level = 0;
+    while ((8u << level) <= tilePixels) {
+      level++;
+    }
+    lightCullPush.depthPyramidLevel =
+        std::min(level, m_resources.depthPyramid->getSpecs().mipLevels - 1);
+  }
+  lightCullPush.lightIndexCapacity = static_cast<uint32_t>(
+      m_resources.lightIndexBuffers[currentFrame]->getSize() / sizeof(uint32_t));
+  lightCullPush.viewMatrix = sd.view;
+
+  auto dispatchLightCull = [this](VkCommandBuffer cb,
+                                  LightCullPushConstants push, uint32_t phase,
+                                  uint32_t groups) {
     vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
                       m_clusterCullPipeline->getHandle());
     VkDescriptorSet globalSet =
         m_context->getDescriptorManager().getDescriptorSet();
     vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
                             m_clusterCullLayout, 0, 1, &globalSet, 0, nullptr);
+    push.phase = phase;
+    vkCmdPushConstants(cb, m_clusterCullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(push), &push);
+    vkCmdDispatch(cb, groups, 1, 1);
+  };
+  const uint32_t lightCullGroups = (m_clusterCount + 63) / 64;
+  const bool timeLightCull = m_timestampPool != VK_NULL_HANDLE;
+  if (timeLightCull) {
+    m_lightCullTimingPending[currentFrame] = true;
+  }
 
-    struct {
-      uint32_t cbIdx, cgbIdx, libIdx, lbIdx, abIdx, lc;
-      float pad[2];
-      glm::mat4 v;
-    } push;
-    push.cbIdx = m_clusterBufferIndex;
-    push.cgbIdx = m_resources.clusterGridBufferIndices[currentFrame];
-    push.libIdx = m_resources.lightIndexBufferIndices[currentFrame];
-    push.lbIdx = sd.lightBufferIndex;
-    push.abIdx = m_resources.clusterAtomicBufferIndices[currentFrame];
-    push.lc = sd.lightCount;
-    push.v = sd.view;
+  graph.addPass("ClusterLightCountPass",
+                {{"ClusterAABBs", ResourceUsage::StorageReadCompute},
+                 {"DepthPyramid", ResourceUsage::SampledCompute},
+                 {"ClusterGrid", ResourceUsage::StorageWriteCompute}},
+                [lightCullPush, dispatchLightCull,
+                 lightCullGroups](VkCommandBuffer cb) {
+    dispatchLightCull(cb, lightCullPush, 0, lightCullGroups);
+  });
 
-    vkCmdPushConstants(cb, m_clusterCullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
-                       96, &push);
-    vkCmdDispatch(cb, (16 * 9 * 24 + 63) / 64, 1, 1);
-
-    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
-    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier,
-                         0, nullptr, 0, nullptr);
+  graph.addPass("ClusterLightScanPass",
+                {{"ClusterGrid", ResourceUsage::StorageReadWriteCompute},
+                 {"LightCullCounters", ResourceUsage::StorageWriteCompute}},
+                [lightCullPush, dispatchLightCull](VkCommandBuffer cb) {
+    dispatchLightCull(cb, lightCullPush, 1, 1);
+  });
+
+  graph.addPass("ClusterLightWritePass",
+                {{"ClusterAABBs", ResourceUsage::StorageReadCompute},
+                 {"ClusterGrid", ResourceUsage::StorageReadCompute},
+                 {"ClusterLightIndices", ResourceUsage::StorageWriteCompute}},
+                [lightCullPush, dispatchLightCull,
+                 lightCullGroups](VkCommandBuffer cb) {
+    dispatchLightCull(cb, lightCullPush, 2, lightCullGroups);
   });
 
+  // On the primary command buffer like the SSAO timings, the slot was reset
+  // by recordFrameBegin
+  if (timeLightCull) {
+    graph.setPassHooks("ClusterLightCountPass", [this, currentFrame](VkCommandBuffer cb) {
+      vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          m_timestampPool, currentFrame * kTimestampsPerFrame);
+    });
+    graph.setPassHooks("ClusterLightWritePass", nullptr,
+                       [this, currentFrame](VkCommandBuffer cb) {
+      vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                          m_timestampPool,
+                          currentFrame * kTimestampsPerFrame + 1);
+    });
+  }
+
+  // Draws one cascade's static and / or dynamic caster list
+  auto drawShadowCasters = [this, &sceneManager, currentFrame, hasGeometry,
+                            instanceCount](VkCommandBuffer cb, uint32_t cascade,
+                                           bool staticCasters,
+                                           bool dynamicCasters) {
+    vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      m_shadowPipeline->getHandle());
+    VkDescriptorSet globalSet =
+        m_context->getDescriptorManager().getDescriptorSet();
+    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            m_pipelineLayout, 0, 1, &globalSet, 0, nullptr);
+
+    VkViewport viewport = {0, 0, (float)kShadowMapSize, (float)kShadowMapSize,
+                           0, 1};
+    vkCmdSetViewport(cb, 0, 1, &viewport);
+    VkRect2D scissor = {{0, 0}, {kShadowMapSize, kShadowMapSize}};
+    vkCmdSetScissor(cb, 0, 1, &scissor);
+
+    if (!hasGeometry) {
+      return;
+    }
+    bindGeometry(cb, sceneManager, true);
+
+    struct {
+      uint32_t sIdx, iIdx, mIdx, cIdx;
+    } spc;
+    spc.sIdx = sceneManager.getSceneBufferIndex(currentFrame);
+    spc.iIdx = sceneManager.getMeshInstanceBufferIndex(currentFrame);
+    spc.mIdx = sceneManager.getMaterialBufferIndex(currentFrame);
+    spc.cIdx = cascade;
+
+    vkCmdPushConstants(cb, m_pipelineLayout,
+                       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                       0, sizeof(spc), &spc);
+
+    // Compacted casters, counts written by ShadowCullingPass. Static ones are
+    // in region 'cascade', dynamic ones in region 4 + cascade.
+    const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+    const VkDeviceSize region = instanceCount * stride;
+    VkBuffer commands =
+        m_resources.shadowDrawCommandBuffers[currentFrame]->getHandle();
+    VkBuffer counters = m_resources.cullCounterBuffers[currentFrame]->getHandle();
+    if (staticCasters) {
+      vkCmdDrawIndexedIndirectCount(
+          cb, commands, cascade * region, counters,
+          offsetof(CullCounters, shadowDrawCount) + cascade * sizeof(uint32_t),
+          instanceCount, stride);
+    }
+    if (dynamicCasters) {
+      vkCmdDrawIndexedIndirectCount(
+          cb, commands,
+          (4 + cascade) * region, counters,
+          offsetof(CullCounters, shadowDynamicDrawCount) +
+              cascade * sizeof(uint32_t),
+          instanceCount, stride);
+    }
+  };
+
+  const VkImageLayout shadowCacheLayout =
+      m_shadowCacheValid ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                         : VK_IMAGE_LAYOUT_UNDEFINED;
   for (uint32_t i = 0; i < 4; i++) {
     std::string resName = "ShadowMap_" + std::to_string(i);
     graph.addExternalResource(resName, m_resources.shadowImage->getHandle(),
                               m_resources.shadowLayerViews[i],
-                              VK_FORMAT_D32_SFLOAT, 4096, 4096,
-                              VK_IMAGE_LAYOUT_UNDEFINED);
+                              VK_FORMAT_D32_SFLOAT, kShadowMapSize,
+                              kShadowMapSize, shadowLayout, i, 1);
     graph.setResourceClearValue(resName, shadowClear);
 
-    graph.addPass("ShadowPass_" + std::to_string(i), {}, {resName},
-                  [this, &sceneManager, currentFrame, i, model](VkCommandBuffer cb) {
-                    vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                      m_shadowPipeline->getHandle());
-                    VkDescriptorSet globalSet =
-                        m_context->getDescriptorManager().getDescriptorSet();
-                    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                            m_pipelineLayout, 0, 1, &globalSet,
-                                            0, nullptr);
-
-                    VkViewport viewport = {0, 0, 4096, 4096, 0, 1};
-                    vkCmdSetViewport(cb, 0, 1, &viewport);
-                    VkRect2D scissor = {{0, 0}, {4096, 4096}};
-                    vkCmdSetScissor(cb, 0, 1, &scissor);
-
-                    if (model) {
-                      VkDeviceSize offsets[] = {0};
-                      VkBuffer vBuffer = model->vertexBuffer->getHandle();
-                      vkCmdBindVertexBuffers(cb, 0, 1, &vBuffer, offsets);
-                      vkCmdBindIndexBuffer(cb, model->indexBuffer->getHandle(),
-                                           0, VK_INDEX_TYPE_UINT32);
-
-                      struct {
-                        uint32_t sIdx, iIdx, mIdx, cIdx;
-                      } spc;
-                      spc.sIdx = sceneManager.getSceneBufferIndex(currentFrame);
-                      spc.iIdx =
-                          sceneManager.getMeshInstanceBufferIndex(currentFrame);
-                      spc.mIdx = sceneManager.getMaterialBufferIndex();
-                      spc.cIdx = i;
-
-                      vkCmdPushConstants(cb, m_pipelineLayout,
-                                         VK_SHADER_STAGE_VERTEX_BIT |
-                                             VK_SHADER_STAGE_FRAGMENT_BIT,
-                                         0, sizeof(spc), &spc);
-                      vkCmdDrawIndexedIndirect(
-                          cb, sceneManager.getIndirectBuffer(currentFrame), 0,
-                          static_cast<uint32_t>(
-                              sceneManager.getMeshInstanceCount(currentFrame)),
-                          sizeof(VkDrawIndexedIndirectCommand));
-                    }
-                  });
+    const ShadowMode mode = shadowModes[i];
+    if (mode == ShadowMode::Skip) {
+      continue;
+    }
+    const std::vector<RenderPassAccess> casterAccesses = {
+        {"MeshInstances", ResourceUsage::StorageReadVertex},
+        {"ShadowDrawCommands", ResourceUsage::IndirectRead},
+        {"CullCounters", ResourceUsage::IndirectRead}};
+
+    if (mode != ShadowMode::Full) {
+      std::string cacheName = "ShadowCache_" + std::to_string(i);
+      graph.addExternalResource(cacheName,
+                                m_resources.shadowCacheImage->getHandle(),
+                                m_resources.shadowCacheLayerViews[i - 1],
+                                VK_FORMAT_D32_SFLOAT, kShadowMapSize,
+                                kShadowMapSize, shadowCacheLayout, i - 1, 1);
+      graph.setResourceClearValue(cacheName, shadowClear);
+
+      if (mode == ShadowMode::Refresh) {
+        std::vector<RenderPassAccess> accesses = casterAccesses;
+        accesses.insert(accesses.begin(),
+                        RenderPassAccess{cacheName, ResourceUsage::DepthAttachment});
+        graph.addPass("ShadowStaticPass_" + std::to_string(i), accesses,
+                      [drawShadowCasters, i](VkCommandBuffer cb) {
+          drawShadowCasters(cb, i, true, false);
+        });
+      }
+
+      graph.addPass("ShadowRestorePass_" + std::to_string(i),
+                    {{cacheName, ResourceUsage::CopySrc},
+                     {resName, ResourceUsage::CopyDst}},
+                    [this, i](VkCommandBuffer cb) {
+        VkImageCopy region = {};
+        region.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, i - 1, 1};
+        region.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, i, 1};
+        region.extent = {kShadowMapSize, kShadowMapSize, 1};
+        vkCmdCopyImage(cb, m_resources.shadowCacheImage->getHandle(),
+                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       m_resources.shadowImage->getHandle(),
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+      });
+    }
+
+    // Full cascades clear and draw everything, cached ones load the restored
+    // static depth and only add the dynamic casters
+    std::vector<RenderPassAccess> accesses = casterAccesses;
+    accesses.insert(accesses.begin(),
+                    RenderPassAccess{resName, ResourceUsage::DepthAttachment});
+    const bool full = mode == ShadowMode::Full;
+    graph.addPass("ShadowPass_" + std::to_string(i), accesses,
+                  [drawShadowCasters, i, full](VkCommandBuffer cb) {
+      drawShadowCasters(cb, i, full, true);
+    }, full);
+  }
+  m_pendingShadowCache.cacheRefreshed = false;
+  for (ShadowMode mode : shadowModes) {
+    m_pendingShadowCache.cacheRefreshed |= mode == ShadowMode::Refresh;
   }
 
-  graph.addExternalResource("Bloom_Base", m_resources.bloomImage->getHandle(),
-                            m_resources.bloomImage->getView(),
-                            m_resources.bloomImage->getSpecs().format,
-                            m_width / 4, m_height / 4,
-                            VK_IMAGE_LAYOUT_UNDEFINED);
-  graph.addExternalResource(
-      "Bloom_Blur", m_resources.bloomBlurImage->getHandle(),
-      m_resources.bloomBlurImage->getView(),
-      m_resources.bloomBlurImage->getSpecs().format, m_width / 4, m_height / 4,
-      VK_IMAGE_LAYOUT_UNDEFINED);
-  graph.addExternalResource("SSAO_Base", m_resources.ssaoImage->getHandle(),
-                            m_resources.ssaoImage->getView(),
-                            m_resources.ssaoImage->getSpecs().format, ext.width,
-                            ext.height, VK_IMAGE_LAYOUT_UNDEFINED);
-  graph.addExternalResource("SSAO_Blur", m_resources.ssaoBlurImage->getHandle(),
-                            m_resources.ssaoBlurImage->getView(),
-                            m_resources.ssaoBlurImage->getSpecs().format,
-                            ext.width, ext.height, VK_IMAGE_LAYOUT_UNDEFINED);
+  graph.addTransientImage("Bloom_Base",
+                          {m_width / 4, m_height / 4,
+                           VK_FORMAT_R16G16B16A16_SFLOAT, targetUsage,
+                           m_bloomTextureIndex, m_hdrSampler});
+  graph.addTransientImage("Bloom_Blur",
+                          {m_width / 4, m_height / 4,
+                           VK_FORMAT_R16G16B16A16_SFLOAT, targetUsage,
+                           m_bloomBlurTextureIndex, m_hdrSampler});
+  graph.addTransientImage("SSAO_Base",
+                          {ext.width, ext.height, VK_FORMAT_R8_UNORM,
+                           targetUsage, m_ssaoTextureIndex, m_hdrSampler});
+  graph.addTransientImage("SSAO_Blur",
+                          {ext.width, ext.height, VK_FORMAT_R8_UNORM,
+                           targetUsage, m_ssaoBlurTextureIndex, m_hdrSampler});
   graph.setResourceClearValue("SSAO_Base", ssaoClear);
   graph.setResourceClearValue("SSAO_Blur", ssaoClear);
-  graph.addExternalResource("LDR_Color", m_resources.ldrImage->getHandle(),
-                            m_resources.ldrImage->getView(),
-                            m_resources.ldrImage->getSpecs().format, ext.width,
-                            ext.height, VK_IMAGE_LAYOUT_UNDEFINED);
-  graph.addExternalResource("TAA_History1",
-                            m_resources.taaHistoryImage1->getHandle(),
-                            m_resources.taaHistoryImage1->getView(),
-                            m_resources.taaHistoryImage1->getSpecs().format,
-                            ext.width, ext.height, VK_IMAGE_LAYOUT_UNDEFINED);
-  graph.addExternalResource("TAA_History2",
-                            m_resources.taaHistoryImage2->getHandle(),
-                            m_resources.taaHistoryImage2->getView(),
-                            m_resources.taaHistoryImage2->getSpecs().format,
-                            ext.width, ext.height, VK_IMAGE_LAYOUT_UNDEFINED);
+  // Compute SSAO intermediates: linear depth, packed view normal and
+  // (AO, linear depth) for the upsample, all at half resolution
+  const bool ssaoCompute = uiParams.enableSSAO && uiParams.ssaoCompute;
+  const uint32_t ssaoHalfWidth = (ext.width + 1) / 2;
+  const uint32_t ssaoHalfHeight = (ext.height + 1) / 2;
+  if (ssaoCompute) {
+    const VkImageUsageFlags halfUsage =
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    graph.addTransientImage("SSAO_HalfDepth",
+                            {ssaoHalfWidth, ssaoHalfHeight, VK_FORMAT_R32_SFLOAT,
+                             halfUsage, m_ssaoHalfDepthIndex, m_hdrSampler,
+                             m_ssaoHalfDepthStorageIndex});
+    graph.addTransientImage("SSAO_HalfNormal",
+                            {ssaoHalfWidth, ssaoHalfHeight,
+                             VK_FORMAT_R8G8B8A8_UNORM, halfUsage,
+                             m_ssaoHalfNormalIndex, m_hdrSampler,
+                             m_ssaoHalfNormalStorageIndex});
+    graph.addTransientImage("SSAO_Half",
+                            {ssaoHalfWidth, ssaoHalfHeight,
+                             VK_FORMAT_R32G32_SFLOAT, halfUsage,
+                             m_ssaoHalfIndex, m_hdrSampler,
+                             m_ssaoHalfStorageIndex});
+  }
+  graph.addTransientImage("LDR_Color",
+                          {ext.width, ext.height, m_outputFormat, targetUsage,
+                           m_ldrTextureIndex, m_hdrSampler});
 
-  // Register Swapchain Image for Final Output
+  // Register Final Output (swapchain image or headless offscreen image)
   // Note: Initial layout is UNDEFINED because we acquire it fresh.
-  // RenderGraph will transition it to COLOR_ATTACHMENT.
-  graph.addExternalResource("Swapchain", 
-                            swapchain->getImages()[imageIndex],
-                            swapchain->getImageViews()[imageIndex],
-                            swapchain->getImageFormat(),
-                            ext.width, ext.height,
+  // RenderGraph will transition it to COLOR_ATTACHMENT, then to finalLayout.
+  graph.addExternalResource("FinalOutput", output.image, output.view,
+                            output.format, ext.width, ext.height,
                             VK_IMAGE_LAYOUT_UNDEFINED);
+  graph.setResourceClearValue("FinalOutput", colorClear);
+  graph.setResourceFinalLayout("FinalOutput", output.finalLayout);
+
+  // Opaque draws of one culling phase, the count comes from the GPU
+  VkBuffer drawCommandBuffer =
+      m_resources.drawCommandBuffers[currentFrame]->getHandle();
+  VkBuffer cullCounterBuffer =
+      m_resources.cullCounterBuffers[currentFrame]->getHandle();
+  auto drawOpaque = [this, &sceneManager, currentFrame, hasGeometry,
+                     drawCommandBuffer,
+                     cullCounterBuffer](VkCommandBuffer cb, VkPipeline pipeline,
+                                        VkDeviceSize commandOffset,
+                                        VkDeviceSize countOffset,
+                                        uint32_t maxDrawCount) {
+    vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    VkDescriptorSet globalSet =
+        m_context->getDescriptorManager().getDescriptorSet();
+    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            m_pipelineLayout, 0, 1, &globalSet, 0, nullptr);
+
+    if (hasGeometry && maxDrawCount > 0) {
+      bindGeometry(cb, sceneManager, false);
+
+      struct {
+        uint32_t sIdx, iIdx, mIdx, pad;
+      } pbrSPC;
+      pbrSPC.sIdx = sceneManager.getSceneBufferIndex(currentFrame);
+      pbrSPC.iIdx = sceneManager.getMeshInstanceBufferIndex(currentFrame);
+      pbrSPC.mIdx = sceneManager.getMaterialBufferIndex(currentFrame);
+
+      vkCmdPushConstants(cb, m_pipelineLayout,
+                         VK_SHADER_STAGE_VERTEX_BIT |
+                             VK_SHADER_STAGE_FRAGMENT_BIT,
+                         0, 16, &pbrSPC);
+
+      vkCmdDrawIndexedIndirectCount(cb, drawCommandBuffer, commandOffset,
+                                    cullCounterBuffer, countOffset, maxDrawCount,
+                                    sizeof(VkDrawIndexedIndirectCommand));
+    }
+  };
 
-  // Opaque Pass
-  graph.addPass(
-      "OpaquePass", {}, {"HDR_Color", "Normal", "Velocity", "Depth"},
-      [this, &sceneManager, currentFrame, ext, uiParams, skyboxIndex, model](VkCommandBuffer cb) {
-        VkViewport viewport = {0.0f, 0.0f, (float)ext.width, (float)ext.height, 0.0f, 1.0f};
-        vkCmdSetViewport(cb, 0, 1, &viewport);
-        VkRect2D scissor = {{0, 0}, {ext.width, ext.height}};
-        vkCmdSetScissor(cb, 0, 1, &scissor);
+  auto drawSkybox = [this, &sceneManager, currentFrame, ext, uiParams,
+                     skyboxIndex](VkCommandBuffer cb) {
+    VkViewport viewport = {0.0f, 0.0f, (float)ext.width, (float)ext.height, 0.0f, 1.0f};
+    vkCmdSetViewport(cb, 0, 1, &viewport);
+    VkRect2D scissor = {{0, 0}, {ext.width, ext.height}};
+    vkCmdSetScissor(cb, 0, 1, &scissor);
+
+    if (uiParams.showSkybox) {
+      vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                        m_skyboxPipeline->getHandle());
+      VkDescriptorSet globalSet =
+          m_context->getDescriptorManager().getDescriptorSet();
+      vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              m_skyboxLayout, 0, 1, &globalSet, 0, nullptr);
+      struct {
+        uint32_t sIdx, skIdx;
+      } skySPC;
+      skySPC.sIdx = sceneManager.getSceneBufferIndex(currentFrame);
+      skySPC.skIdx = skyboxIndex;
+      vkCmdPushConstants(cb, m_skyboxLayout,
+                         VK_SHADER_STAGE_VERTEX_BIT |
+                             VK_SHADER_STAGE_FRAGMENT_BIT,
+                         0, 8, &skySPC);
+      vkCmdDraw(cb, 36, 1, 0, 0);
+    }
+  };
 
-        if (uiParams.showSkybox) {
-          vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            m_skyboxPipeline->getHandle());
+  if (visibilityBuffer) {
+    // Clears the opaque targets and fills the background, the resolve writes
+    // every covered pixel on top
+    graph.addPass("SkyboxPass",
+                  {{"HDR_Color", ResourceUsage::ColorAttachment},
+                   {"Normal", ResourceUsage::ColorAttachment},
+                   {"Velocity", ResourceUsage::ColorAttachment},
+                   {"Depth", ResourceUsage::DepthAttachmentReadOnly}},
+                  [drawSkybox](VkCommandBuffer cb) { drawSkybox(cb); });
+  } else {
+    // Opaque Pass, on top of the prepass depth when there is one
+    graph.addPass(
+        "OpaquePass",
+        {{"HDR_Color", ResourceUsage::ColorAttachment},
+         {"Normal", ResourceUsage::ColorAttachment},
+         {"Velocity", ResourceUsage::ColorAttachment},
+         {"Depth", opaqueDepthUsage},
+         {"ShadowMap", ResourceUsage::SampledFragment},
+         {"MeshInstances", ResourceUsage::StorageReadVertex},
+         {"DrawCommands", ResourceUsage::IndirectRead},
+         {"CullCounters", ResourceUsage::IndirectRead},
+         {"ClusterGrid", ResourceUsage::StorageReadFragment},
+         {"ClusterLightIndices", ResourceUsage::StorageReadFragment}},
+        [drawSkybox, drawOpaque, opaquePipeline, opaqueCount, instanceCount,
+         meshletsEnabled, meshletCount](VkCommandBuffer cb) {
+          drawSkybox(cb);
+
+          drawOpaque(cb, opaquePipeline, 0,
+                     offsetof(CullCounters, earlyDrawCount), opaqueCount);
+          if (meshletsEnabled) {
+            drawOpaque(cb, opaquePipeline,
+                       2 * static_cast<VkDeviceSize>(instanceCount) *
+                           sizeof(VkDrawIndexedIndirectCommand),
+                       offsetof(CullCounters, meshletDrawCount), meshletCount);
+          }
+        });
+
+    if (!depthPrepass) {
+      addDepthPyramidPass();
+    }
+  }
+
+  graph.addPass("LateCullingPass",
+                {{"MeshInstances", ResourceUsage::StorageReadCompute},
+                 {"IndirectCommands", ResourceUsage::StorageReadCompute},
+                 {"DepthPyramid", ResourceUsage::SampledCompute},
+                 {"CullCandidates", ResourceUsage::StorageReadCompute},
+                 {"CullCounters", ResourceUsage::StorageReadWriteCompute},
+                 {"DrawCommands", ResourceUsage::StorageWriteCompute}},
+                [this, cpc](VkCommandBuffer cb) {
+    // Candidates only come from the early occlusion test
+    if (cpc.occlusionEnabled == 0 || cpc.opaqueCount == 0) {
+      return;
+    }
+    vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      m_cullPipeline->getHandle());
+    VkDescriptorSet globalSet =
+        m_context->getDescriptorManager().getDescriptorSet();
+    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullLayout, 0,
+                            1, &globalSet, 0, nullptr);
+
+    CullPushConstants push = cpc;
+    push.phase = 1;
+    vkCmdPushConstants(cb, m_cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(CullPushConstants), &push);
+    // Sized for the worst case, threads past lateCandidateCount exit right away
+    vkCmdDispatch(cb, (push.opaqueCount + 63) / 64, 1, 1);
+  });
+
+  if (visibilityBuffer) {
+    graph.addPass(
+        "VisibilityLatePass",
+        {{"Visibility", ResourceUsage::ColorAttachment},
+         {"Depth", ResourceUsage::DepthAttachment},
+         {"MeshInstances", ResourceUsage::StorageReadVertex},
+         {"DrawCommands", ResourceUsage::IndirectRead},
+         {"CullCounters", ResourceUsage::IndirectRead}},
+        [drawVisibility, instanceCount, opaqueCount](VkCommandBuffer cb) {
+          drawVisibility(cb, instanceCount,
+                         offsetof(CullCounters, lateDrawCount), opaqueCount);
+        }, false); // Draws on top of VisibilityPass
+
+    VisibilityResolvePushConstants resolvePush = {};
+    resolvePush.sceneDataIndex = sceneManager.getSceneBufferIndex(currentFrame);
+    resolvePush.instanceBufferIndex =
+        sceneManager.getMeshInstanceBufferIndex(currentFrame);
+    resolvePush.materialBufferIndex =
+        sceneManager.getMaterialBufferIndex(currentFrame);
+    resolvePush.drawCommandIndex =
+        m_resources.drawCommandBuffers[currentFrame]->getIndex();
+    const GeometryArena &arena = sceneManager.getGeometryArena();
+    resolvePush.positionBufferIndex = arena.getPositionBufferIndex();
+    resolvePush.attributeBufferIndex = arena.getAttributeBufferIndex();
+    resolvePush.indexBufferIndex = arena.getIndexBufferIndex();
+    resolvePush.visibilityIndex = m_visibilityTextureIndex;
+    resolvePush.hdrIndex = m_hdrStorageIndex;
+    resolvePush.normalIndex = m_normalStorageIndex;
+    resolvePush.velocityIndex = m_velocityStorageIndex;
+    resolvePush.triangleBits = triangleBits;
+    resolvePush.width = ext.width;
+    resolvePush.height = ext.height;
+
+    // Read-write keeps what SkyboxPass wrote to the background pixels
+    graph.addPass(
+        "VisibilityResolvePass",
+        {{"Visibility", ResourceUsage::SampledCompute},
+         {"HDR_Color", ResourceUsage::StorageReadWriteCompute},
+         {"Normal", ResourceUsage::StorageReadWriteCompute},
+         {"Velocity", ResourceUsage::StorageReadWriteCompute},
+         {"ShadowMap", ResourceUsage::SampledCompute},
+         {"MeshInstances", ResourceUsage::StorageReadCompute},
+         {"DrawCommands", ResourceUsage::StorageReadCompute},
+         {"ClusterGrid", ResourceUsage::StorageReadCompute},
+         {"ClusterLightIndices", ResourceUsage::StorageReadCompute}},
+        [this, resolvePush](VkCommandBuffer cb) {
+          vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            m_visibilityResolvePipeline->getHandle());
           VkDescriptorSet globalSet =
               m_context->getDescriptorManager().getDescriptorSet();
-          vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                  m_skyboxLayout, 0, 1, &globalSet, 0, nullptr);
-          struct {
-            uint32_t sIdx, skIdx;
-          } skySPC;
-          skySPC.sIdx = sceneManager.getSceneBufferIndex(currentFrame);
-          skySPC.skIdx = skyboxIndex;
-          vkCmdPushConstants(cb, m_skyboxLayout,
-                             VK_SHADER_STAGE_VERTEX_BIT |
-                                 VK_SHADER_STAGE_FRAGMENT_BIT,
-                             0, 8, &skySPC);
-          vkCmdDraw(cb, 36, 1, 0, 0); 
-        }
-
-        vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          m_pbrPipeline->getHandle());
-        VkDescriptorSet globalSet =
-            m_context->getDescriptorManager().getDescriptorSet();
-        vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                m_pipelineLayout, 0, 1, &globalSet, 0, nullptr);
+          vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                  m_visibilityResolveLayout, 0, 1, &globalSet,
+                                  0, nullptr);
+          vkCmdPushConstants(cb, m_visibilityResolveLayout,
+                             VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                             sizeof(resolvePush), &resolvePush);
+          vkCmdDispatch(cb, (resolvePush.width + 7) / 8,
+                        (resolvePush.height + 7) / 8, 1);
+        });
+  } else {
+    // Objects the late culling found visible after all get their depth first
+    // too, so they aren't shaded with full overdraw
+    if (depthPrepass) {
+      graph.addPass(
+          "DepthLatePrepass",
+          {{"Depth", ResourceUsage::DepthAttachment},
+           {"MeshInstances", ResourceUsage::StorageReadVertex},
+           {"DrawCommands", ResourceUsage::IndirectRead},
+           {"CullCounters", ResourceUsage::IndirectRead}},
+          [this, currentFrame, beginDepthPrepass, opaqueCount,
+           instanceCount](VkCommandBuffer cb) {
+            beginDepthPrepass(cb);
+            const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+            vkCmdDrawIndexedIndirectCount(
+                cb, m_resources.drawCommandBuffers[currentFrame]->getHandle(),
+                static_cast<VkDeviceSize>(instanceCount) * stride,
+                m_resources.cullCounterBuffers[currentFrame]->getHandle(),
+                offsetof(CullCounters, lateDrawCount), opaqueCount, stride);
+          }, false); // Draws on top of the early depth
+    }
 
-        if (model) {
-          VkDeviceSize offsets[] = {0};
-          VkBuffer vBuffer = model->vertexBuffer->getHandle();
-          vkCmdBindVertexBuffers(cb, 0, 1, &vBuffer, offsets);
-          vkCmdBindIndexBuffer(cb, model->indexBuffer->getHandle(), 0,
-                               VK_INDEX_TYPE_UINT32);
+    graph.addPass(
+        "OpaqueLatePass",
+        {{"HDR_Color", ResourceUsage::ColorAttachment},
+         {"Normal", ResourceUsage::ColorAttachment},
+         {"Velocity", ResourceUsage::ColorAttachment},
+         {"Depth", opaqueDepthUsage},
+         {"ShadowMap", ResourceUsage::SampledFragment},
+         {"MeshInstances", ResourceUsage::StorageReadVertex},
+         {"DrawCommands", ResourceUsage::IndirectRead},
+         {"CullCounters", ResourceUsage::IndirectRead},
+         {"ClusterGrid", ResourceUsage::StorageReadFragment},
+         {"ClusterLightIndices", ResourceUsage::StorageReadFragment}},
+        [ext, drawOpaque, opaquePipeline, instanceCount,
+         opaqueCount](VkCommandBuffer cb) {
+          VkViewport viewport = {0.0f, 0.0f, (float)ext.width, (float)ext.height, 0.0f, 1.0f};
+          vkCmdSetViewport(cb, 0, 1, &viewport);
+          VkRect2D scissor = {{0, 0}, {ext.width, ext.height}};
+          vkCmdSetScissor(cb, 0, 1, &scissor);
 
-          struct {
-            uint32_t sIdx, iIdx, mIdx, pad;
-          } pbrSPC;
-          pbrSPC.sIdx = sceneManager.getSceneBufferIndex(currentFrame);
-          pbrSPC.iIdx = sceneManager.getMeshInstanceBufferIndex(currentFrame);
-          pbrSPC.mIdx = sceneManager.getMaterialBufferIndex();
-
-          vkCmdPushConstants(cb, m_pipelineLayout,
-                             VK_SHADER_STAGE_VERTEX_BIT |
-                                 VK_SHADER_STAGE_FRAGMENT_BIT,
-                             0, 16, &pbrSPC);
-
-          size_t opaqueCount = sceneManager.getOpaqueMeshInstanceCount(currentFrame);
-          
-          if (opaqueCount > 0) {
-              vkCmdDrawIndexedIndirect(
-                 cb, sceneManager.getIndirectBuffer(currentFrame), 0,
-                 static_cast<uint32_t>(opaqueCount),
-                 sizeof(VkDrawIndexedIndirectCommand));
-          }
-        }
-      });
+          drawOpaque(cb, opaquePipeline,
+                     instanceCount * sizeof(VkDrawIndexedIndirectCommand),
+                     offsetof(CullCounters, lateDrawCount), opaqueCount);
+        }, false); // Draws on top of OpaquePass
+  }
 
   // Scene Color Copy (for Transmission)
   // We need to register SceneColor resource with the graph first
-  graph.addExternalResource("SceneColor", m_resources.sceneColorImage->getHandle(),
-                            m_resources.sceneColorImage->getView(),
-                            m_resources.sceneColorImage->getSpecs().format,
-                            ext.width, ext.height, VK_IMAGE_LAYOUT_UNDEFINED);
+  graph.addTransientImage("SceneColor",
+                          {ext.width, ext.height, VK_FORMAT_R16G16B16A16_SFLOAT,
+                           VK_IMAGE_USAGE_SAMPLED_BIT |
+                               VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                           m_sceneColorTextureIndex, m_hdrSampler});
 
   graph.addPass(
-      "SceneColorCopyPass", {"HDR_Color"}, {"SceneColor"},
-      [this, ext](VkCommandBuffer cb) {
+      "SceneColorCopyPass",
+      {{"HDR_Color", ResourceUsage::BlitSrc},
+       {"SceneColor", ResourceUsage::BlitDst}},
+      [this, ext, &graph](VkCommandBuffer cb) {
           // Blit HDR_Color to SceneColor
           // Note: RenderGraph handles transitions. HDR_Color -> TransferSrc, SceneColor -> TransferDst
           VkImageBlit blitRegion{};
@@ -987,16 +2316,26 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
           blitRegion.dstOffsets[1] = { (int32_t)ext.width, (int32_t)ext.height, 1 };
 
           vkCmdBlitImage(cb, 
-              m_resources.hdrImage->getHandle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-              m_resources.sceneColorImage->getHandle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+              graph.getImage("HDR_Color"), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+              graph.getImage("SceneColor"), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
               1, &blitRegion, VK_FILTER_NEAREST);
-      }, true); // isTransferPass = true
+      });
 
 
   // Transparent Pass
   graph.addPass(
-      "TransparentPass", {"SceneColor", "Normal", "Velocity", "Depth"}, {"HDR_Color"},
-      [this, &sceneManager, currentFrame, ext, model](VkCommandBuffer cb) {
+      "TransparentPass",
+      {{"SceneColor", ResourceUsage::SampledFragment},
+       {"Normal", ResourceUsage::SampledFragment},
+       {"Velocity", ResourceUsage::SampledFragment},
+       {"Depth", ResourceUsage::SampledFragment},
+       {"HDR_Color", ResourceUsage::ColorAttachment},
+       {"ShadowMap", ResourceUsage::SampledFragment},
+       {"MeshInstances", ResourceUsage::StorageReadVertex},
+       {"DrawCommands", ResourceUsage::IndirectRead},
+       {"ClusterGrid", ResourceUsage::StorageReadFragment},
+       {"ClusterLightIndices", ResourceUsage::StorageReadFragment}},
+      [this, &sceneManager, currentFrame, ext, hasGeometry, drawCommandBuffer](VkCommandBuffer cb) {
           vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
                             m_pbrTransparentPipeline->getHandle());
           VkDescriptorSet globalSet =
@@ -1009,19 +2348,15 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
           VkRect2D scissor = {{0, 0}, {ext.width, ext.height}};
           vkCmdSetScissor(cb, 0, 1, &scissor);
 
-          if (model) {
-              VkDeviceSize offsets[] = {0};
-              VkBuffer vBuffer = model->vertexBuffer->getHandle();
-              vkCmdBindVertexBuffers(cb, 0, 1, &vBuffer, offsets);
-              vkCmdBindIndexBuffer(cb, model->indexBuffer->getHandle(), 0,
-                                   VK_INDEX_TYPE_UINT32);
+          if (hasGeometry) {
+              bindGeometry(cb, sceneManager, false);
 
               struct {
                 uint32_t sIdx, iIdx, mIdx, pad;
               } pbrSPC;
               pbrSPC.sIdx = sceneManager.getSceneBufferIndex(currentFrame);
               pbrSPC.iIdx = sceneManager.getMeshInstanceBufferIndex(currentFrame);
-              pbrSPC.mIdx = sceneManager.getMaterialBufferIndex();
+              pbrSPC.mIdx = sceneManager.getMaterialBufferIndex(currentFrame);
 
               vkCmdPushConstants(cb, m_pipelineLayout,
                                  VK_SHADER_STAGE_VERTEX_BIT |
@@ -1032,20 +2367,143 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
               size_t totalCount = sceneManager.getMeshInstanceCount(currentFrame);
               size_t transparentCount = totalCount - opaqueCount;
 
+              // Frustum culled in place, culled slots draw zero instances
               if (transparentCount > 0) {
                   VkDeviceSize offset = opaqueCount * sizeof(VkDrawIndexedIndirectCommand);
                   vkCmdDrawIndexedIndirect(
-                     cb, sceneManager.getIndirectBuffer(currentFrame), offset,
+                     cb, drawCommandBuffer, offset,
                      static_cast<uint32_t>(transparentCount),
                      sizeof(VkDrawIndexedIndirectCommand));
               }
           }
       }, false); // Do NOT clear outputs (HDR_Color), we want to blend on top of OpaquePass
 
-  if (uiParams.enableSSAO) {
+  // SSAO, timed from the first pass to the last one of either path
+  const uint32_t sceneDataIndex = sceneManager.getSceneBufferIndex(currentFrame);
+  const bool timeSSAO = uiParams.enableSSAO && m_timestampPool != VK_NULL_HANDLE;
+  if (timeSSAO) {
+    m_ssaoTimingPending[currentFrame] = true;
+    m_ssaoTimingCompute[currentFrame] = ssaoCompute;
+  } else if (!uiParams.enableSSAO) {
+    m_ssaoStats = {};
+  }
+  // On the primary command buffer around the first and last SSAO pass, the
+  // passes themselves may be recorded into secondaries inside rendering
+  auto writeSSAOBegin = [this, currentFrame](VkCommandBuffer cb) {
+    vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampPool,
+                        currentFrame * kTimestampsPerFrame + 2);
+  };
+  auto writeSSAOEnd = [this, currentFrame](VkCommandBuffer cb) {
+    vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        m_timestampPool,
+                        currentFrame * kTimestampsPerFrame + 3);
+  };
+  // AO = pow(1 - occlusion, power), same for both paths
+  constexpr float kSSAOPower = 2.5f;
+  if (ssaoCompute) {
+    // Half resolution depth (linear) and normals, one full resolution 2x2
+    // quad per texel
+    SSAODownsamplePushConstants downsamplePush = {};
+    downsamplePush.depthIndex = m_depthTextureIndex;
+    downsamplePush.normalIndex = m_normalTextureIndex;
+    downsamplePush.halfDepthIndex = m_ssaoHalfDepthStorageIndex;
+    downsamplePush.halfNormalIndex = m_ssaoHalfNormalStorageIndex;
+    downsamplePush.halfWidth = ssaoHalfWidth;
+    downsamplePush.halfHeight = ssaoHalfHeight;
+    downsamplePush.nearClip = sd.nearClip;
+    downsamplePush.farClip = sd.farClip;
+    graph.addPass(
+        "SSAODownsamplePass",
+        {{"Depth", ResourceUsage::SampledCompute},
+         {"Normal", ResourceUsage::SampledCompute},
+         {"SSAO_HalfDepth", ResourceUsage::StorageWriteCompute},
+         {"SSAO_HalfNormal", ResourceUsage::StorageWriteCompute}},
+        [this, downsamplePush](VkCommandBuffer cb) {
+          vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            m_ssaoDownsamplePipeline->getHandle());
+          VkDescriptorSet globalSet =
+              m_context->getDescriptorManager().getDescriptorSet();
+          vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                  m_ssaoDownsampleLayout, 0, 1, &globalSet, 0,
+                                  nullptr);
+          vkCmdPushConstants(cb, m_ssaoDownsampleLayout,
+                             VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                             sizeof(downsamplePush), &downsamplePush);
+          vkCmdDispatch(cb, (downsamplePush.halfWidth + 7) / 8,
+                        (downsamplePush.halfHeight + 7) / 8, 1);
+        });
+
+    // AO with the preset's sample count, the kernel subset and its rotation
+    // interleaved over 4x4 pixel tiles
+    SSAOComputePushConstants aoPush = {};
+    aoPush.sceneDataIndex = sceneDataIndex;
+    aoPush.halfDepthIndex = m_ssaoHalfDepthIndex;
+    aoPush.halfNormalIndex = m_ssaoHalfNormalIndex;
+    aoPush.kernelBufferIndex = m_ssaoKernelBufferIndex;
+    aoPush.outputIndex = m_ssaoHalfStorageIndex;
+    aoPush.sampleCount = ssaoSampleCount(uiParams.ssaoQuality);
+    aoPush.halfWidth = ssaoHalfWidth;
+    aoPush.halfHeight = ssaoHalfHeight;
+    aoPush.radius = uiParams.ssaoRadius;
+    aoPush.bias = uiParams.ssaoBias;
+    aoPush.power = kSSAOPower;
+    graph.addPass(
+        "SSAOComputePass",
+        {{"SSAO_HalfDepth", ResourceUsage::SampledCompute},
+         {"SSAO_HalfNormal", ResourceUsage::SampledCompute},
+         {"SSAO_Half", ResourceUsage::StorageWriteCompute}},
+        [this, aoPush](VkCommandBuffer cb) {
+          vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            m_ssaoComputePipeline->getHandle());
+          VkDescriptorSet globalSet =
+              m_context->getDescriptorManager().getDescriptorSet();
+          vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                  m_ssaoComputeLayout, 0, 1, &globalSet, 0,
+                                  nullptr);
+          vkCmdPushConstants(cb, m_ssaoComputeLayout,
+                             VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(aoPush),
+                             &aoPush);
+          vkCmdDispatch(cb, (aoPush.halfWidth + 7) / 8,
+                        (aoPush.halfHeight + 7) / 8, 1);
+        });
+
+    // Depth-aware 4x4 upsample, also filters the interleaving pattern out
+    SSAOUpsamplePushConstants upsamplePush = {};
+    upsamplePush.halfIndex = m_ssaoHalfIndex;
+    upsamplePush.depthIndex = m_depthTextureIndex;
+    upsamplePush.nearClip = sd.nearClip;
+    upsamplePush.farClip = sd.farClip;
+    graph.addPass(
+        "SSAOUpsamplePass",
+        {{"SSAO_Half", ResourceUsage::SampledFragment},
+         {"Depth", ResourceUsage::SampledFragment},
+         {"SSAO_Blur", ResourceUsage::ColorAttachment}},
+        [this, ext, upsamplePush](VkCommandBuffer cb) {
+          VkViewport viewport = {0.0f, 0.0f, (float)ext.width, (float)ext.height, 0.0f, 1.0f};
+          vkCmdSetViewport(cb, 0, 1, &viewport);
+          VkRect2D scissor = {{0, 0}, {ext.width, ext.height}};
+          vkCmdSetScissor(cb, 0, 1, &scissor);
+
+          vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            m_ssaoUpsamplePipeline->getHandle());
+          VkDescriptorSet globalSet =
+              m_context->getDescriptorManager().getDescriptorSet();
+          vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                  m_ssaoUpsampleLayout, 0, 1, &globalSet, 0,
+                                  nullptr);
+          vkCmdPushConstants(cb, m_ssaoUpsampleLayout,
+                             VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                             sizeof(upsamplePush), &upsamplePush);
+          vkCmdDraw(cb, 3, 1, 0, 0);
+        });
+    if (timeSSAO) {
+      graph.setPassHooks("SSAODownsamplePass", writeSSAOBegin);
+      graph.setPassHooks("SSAOUpsamplePass", nullptr, writeSSAOEnd);
+    }
+  } else if (uiParams.enableSSAO) {
     graph.addPass(
         "SSAOPass", {"Normal", "Depth"}, {"SSAO_Base"},
-        [this, ext, uiParams](VkCommandBuffer cb) {
+        [this, ext, uiParams, sceneDataIndex](VkCommandBuffer cb) {
           VkViewport viewport = {0.0f, 0.0f, (float)ext.width, (float)ext.height, 0.0f, 1.0f};
           vkCmdSetViewport(cb, 0, 1, &viewport);
           VkRect2D scissor = {{0, 0}, {ext.width, ext.height}};
@@ -1061,7 +2519,7 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
             uint32_t nI, dI, nsI, kI;
             float r, b;
             float power;
-            float pad;
+            uint32_t sIdx;
           } ssaoSPC;
           ssaoSPC.nI = m_normalTextureIndex;
           ssaoSPC.dI = m_depthTextureIndex;
@@ -1069,13 +2527,15 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
           ssaoSPC.kI = m_ssaoKernelBufferIndex;
           ssaoSPC.r = uiParams.ssaoRadius;
           ssaoSPC.b = uiParams.ssaoBias;
-          ssaoSPC.power = 2.5f; // Hardcoded intensity for now, can be added to UI
+          ssaoSPC.power = kSSAOPower;
+          ssaoSPC.sIdx = sceneDataIndex;
           vkCmdPushConstants(cb, m_ssaoLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0,
                              32, &ssaoSPC);
           vkCmdDraw(cb, 3, 1, 0, 0);
         });
     graph.addPass(
-        "SSAOBlurPass", {"SSAO_Base"}, {"SSAO_Blur"}, [this, ext](VkCommandBuffer cb) {
+        "SSAOBlurPass", {"SSAO_Base"}, {"SSAO_Blur"},
+        [this, ext](VkCommandBuffer cb) {
           VkViewport viewport = {0.0f, 0.0f, (float)ext.width, (float)ext.height, 0.0f, 1.0f};
           vkCmdSetViewport(cb, 0, 1, &viewport);
           VkRect2D scissor = {{0, 0}, {ext.width, ext.height}};
@@ -1101,6 +2561,10 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
                              0, 16, &bPush);
           vkCmdDraw(cb, 3, 1, 0, 0);
         });
+    if (timeSSAO) {
+      graph.setPassHooks("SSAOPass", writeSSAOBegin);
+      graph.setPassHooks("SSAOBlurPass", nullptr, writeSSAOEnd);
+    }
   }
 
   // Bloom
@@ -1269,7 +2733,7 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
   // FXAA Pass (Always added, bypassing handled in shader)
   if (true) {
     graph.addPass(
-        "FXAAPass", {inputForFinal}, {"Swapchain"}, [this, ext, inputIdxForFinal, uiParams](VkCommandBuffer cb) {
+        "FXAAPass", {inputForFinal}, {"FinalOutput"}, [this, ext, inputIdxForFinal, uiParams](VkCommandBuffer cb) {
           VkViewport viewport = {0.0f, 0.0f, (float)ext.width, (float)ext.height, 0.0f, 1.0f};
           vkCmdSetViewport(cb, 0, 1, &viewport);
           VkRect2D scissor = {{0, 0}, {ext.width, ext.height}};
@@ -1447,4 +2911,100 @@ void RendererSystem::render(CommandBuffer &cmd, RenderGraph &graph,
   // graph.execute(cmd.getHandle(), ext); // Executed by Application now to allow UI Pass injection
 }
 
+void RendererSystem::bindGeometry(VkCommandBuffer cb,
+                                  const SceneManager &sceneManager,
+                                  bool positionsOnly) const {
+  const GeometryArena &arena = sceneManager.getGeometryArena();
+  VkDeviceSize offsets[] = {0, 0};
+  VkBuffer vBuffers[] = {arena.getPositionBuffer(),
+                         arena.getAttributeBuffer()};
+  vkCmdBindVertexBuffers(cb, 0, positionsOnly ? 1 : 2, vBuffers, offsets);
+  vkCmdBindIndexBuffer(cb, arena.getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void RendererSystem::invalidateShadowCache() {
+  for (ShadowCascadeCache &cache : m_shadowCascades) {
+    cache.valid = false;
+  }
+}
+
+void RendererSystem::recordFrameBegin(VkCommandBuffer cmd,
+                                      uint32_t currentFrame) {
+  // The whole slot at once, ahead of every pass that writes one of its
+  // timestamps (resets aren't allowed inside rendering)
+  if (m_timestampPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(cmd, m_timestampPool,
+                        currentFrame * kTimestampsPerFrame,
+                        kTimestampsPerFrame);
+  }
+}
+
+void RendererSystem::onFrameSubmitted(const RenderGraph &graph) {
+  // Stays valid on frames without the pass, the image keeps its contents
+  if (graph.wasExecuted("DepthPyramidPass")) {
+    m_resources.depthPyramidValid = true;
+  }
+  // Only added when stale, a frame that didn't run it leaves the cache alone
+  if (graph.wasExecuted("ClusterBuildPass")) {
+    m_clusterBuild = m_pendingClusterBuild;
+  }
+  // ShadowMap is exported, so cascade 0 runs on every frame that draws shadows
+  if (graph.wasExecuted("ShadowPass_0")) {
+    std::copy(std::begin(m_pendingShadowCache.cascades),
+              std::end(m_pendingShadowCache.cascades),
+              std::begin(m_shadowCascades));
+    m_shadowMapValid = true;
+    m_shadowCacheValid |= m_pendingShadowCache.cacheRefreshed;
+  }
+}
+
+void RendererSystem::recordCullReadback(VkCommandBuffer cmd,
+                                        uint32_t currentFrame) {
+  VkBuffer counters = m_resources.cullCounterBuffers[currentFrame]->getHandle();
+  VkBuffer lightCounters =
+      m_resources.lightCullCounterBuffers[currentFrame]->getHandle();
+  VkBuffer readback = m_resources.cullReadbackBuffers[currentFrame]->getHandle();
+
+  // Outside the graph, it only knows the counters were last read by the draws.
+  // The reset fill is the last write when there was nothing to cull.
+  VkBufferMemoryBarrier2 barriers[2] = {};
+  barriers[0].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+  barriers[0].srcStageMask =
+      VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT;
+  barriers[0].srcAccessMask =
+      VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+  barriers[0].dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+  barriers[0].dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+  barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].buffer = counters;
+  barriers[0].offset = 0;
+  barriers[0].size = VK_WHOLE_SIZE;
+  // The light scan pass writes the light culling counters
+  barriers[1] = barriers[0];
+  barriers[1].srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+  barriers[1].srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+  barriers[1].buffer = lightCounters;
+  VkDependencyInfo depInfo = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+  depInfo.bufferMemoryBarrierCount = 2;
+  depInfo.pBufferMemoryBarriers = barriers;
+  vkCmdPipelineBarrier2(cmd, &depInfo);
+
+  VkBufferCopy region = {0, 0, sizeof(CullCounters)};
+  vkCmdCopyBuffer(cmd, counters, readback, 1, &region);
+  VkBufferCopy lightRegion = {0, sizeof(CullCounters), sizeof(LightCullCounters)};
+  vkCmdCopyBuffer(cmd, lightCounters, readback, 1, &lightRegion);
+
+  // Make the copies visible to the host once the fence signals
+  barriers[0].srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+  barriers[0].srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+  barriers[0].dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+  barriers[0].dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+  barriers[0].buffer = readback;
+  depInfo.bufferMemoryBarrierCount = 1;
+  vkCmdPipelineBarrier2(cmd, &depInfo);
+
+  m_cullReadbackPending[currentFrame] = true;
+}
+
 } // namespace astral
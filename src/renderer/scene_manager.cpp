@@ -3,121 +3,330 @@
 #include <spdlog/spdlog.h>
 #include <stdexcept>
 #include <algorithm>
+#include <cstring>
+#include <numeric>
 
 namespace astral {
 
+namespace {
+
+// Starting sizes of the growable GPU buffers, they double whenever the scene outgrows them
+constexpr uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+constexpr uint32_t INITIAL_MATERIAL_CAPACITY = 256;
+constexpr uint32_t INITIAL_LIGHT_CAPACITY = 64;
+// The geometry arena grows the same way, but has to wait for the device to do it
+constexpr uint32_t INITIAL_ARENA_VERTICES = 1u << 18; // 7 MB over both streams
+constexpr uint32_t INITIAL_ARENA_INDICES = 1u << 20;  // 4 MB
+constexpr uint32_t INITIAL_ARENA_MESHLETS = 1u << 14; // 768 KB
+
+// LOD n is used once the bounding sphere covers less than LOD_SCREEN_SIZES[n] of
+// the screen height. Switching needs to cross the threshold by LOD_HYSTERESIS.
+constexpr float LOD_SCREEN_SIZES[MAX_LODS] = {1.0f, 0.3f, 0.15f, 0.06f};
+constexpr float LOD_HYSTERESIS = 0.15f;
+
+} // namespace
+
 SceneManager::SceneManager(Context *context) : m_context(context) {
   auto &descriptorManager = m_context->getDescriptorManager();
 
   // Resize vectors for double buffering
-  m_sceneBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-  m_meshInstanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  m_instanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
   m_indirectBuffers.resize(MAX_FRAMES_IN_FLIGHT);
   m_lightBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  m_materialBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  m_sceneSlots.resize(MAX_FRAMES_IN_FLIGHT);
+
+  m_frameInstanceCounts.resize(MAX_FRAMES_IN_FLIGHT, 0);
+  m_opaqueInstanceCounts.resize(MAX_FRAMES_IN_FLIGHT, 0);
+  m_dynamicInstances.resize(MAX_FRAMES_IN_FLIGHT);
+  m_dynamicVersions.resize(MAX_FRAMES_IN_FLIGHT);
 
-  m_sceneBufferIndices.resize(MAX_FRAMES_IN_FLIGHT);
-  m_meshInstanceBufferIndices.resize(MAX_FRAMES_IN_FLIGHT);
-  m_indirectBufferIndices.resize(MAX_FRAMES_IN_FLIGHT);
-  m_lightBufferIndices.resize(MAX_FRAMES_IN_FLIGHT);
+  m_geometryArena = std::make_unique<GeometryArena>(
+      m_context, INITIAL_ARENA_VERTICES, INITIAL_ARENA_INDICES,
+      INITIAL_ARENA_MESHLETS);
 
-  m_frameInstances.resize(MAX_FRAMES_IN_FLIGHT);
+  // Scene data only, plus slack for the descriptor offset alignment
+  m_uploadRing = std::make_unique<UploadRing>(
+      m_context, sizeof(SceneData) + 256, MAX_FRAMES_IN_FLIGHT,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
 
+  // Everything else starts small and doubles on demand (see GrowableBuffer)
   for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-    // Scene Data Buffer
-    m_sceneBuffers[i] = std::make_unique<Buffer>(
-        m_context, sizeof(SceneData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-        VMA_MEMORY_USAGE_CPU_TO_GPU);
-    m_sceneBufferIndices[i] = descriptorManager.registerBuffer(
-        m_sceneBuffers[i]->getHandle(), 0, sizeof(SceneData), 1);
-
-    // Light Buffer
-    m_lightBuffers[i] = std::make_unique<Buffer>(
-        m_context, sizeof(Light) * MAX_LIGHTS,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-    m_lightBufferIndices[i] = descriptorManager.registerBuffer(
-        m_lightBuffers[i]->getHandle(), 0, sizeof(Light) * MAX_LIGHTS,
-        3); // Binding 3
-
-    // Mesh Instance Buffer
-    m_meshInstanceBuffers[i] = std::make_unique<Buffer>(
-        m_context, sizeof(MeshInstance) * MAX_MESH_INSTANCES,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-    m_meshInstanceBufferIndices[i] = descriptorManager.registerBuffer(
-        m_meshInstanceBuffers[i]->getHandle(), 0,
-        sizeof(MeshInstance) * MAX_MESH_INSTANCES, 6); // Binding 6
-
-    // Indirect Buffer
-    m_indirectBuffers[i] = std::make_unique<Buffer>(
-        m_context, sizeof(VkDrawIndexedIndirectCommand) * MAX_MESH_INSTANCES,
+    // Scene data (1) points into the upload ring, written on first upload
+    m_sceneSlots[i].index = descriptorManager.reserveBuffer(1);
+
+    m_instanceBuffers[i] = std::make_unique<GrowableBuffer>(
+        m_context, sizeof(MeshInstance) * INITIAL_INSTANCE_CAPACITY,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
+        VMA_ALLOCATION_CREATE_MAPPED_BIT, 6); // Binding 6
+    m_indirectBuffers[i] = std::make_unique<GrowableBuffer>(
+        m_context,
+        sizeof(VkDrawIndexedIndirectCommand) * INITIAL_INSTANCE_CAPACITY,
         VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-        VMA_MEMORY_USAGE_CPU_TO_GPU);
-    m_indirectBufferIndices[i] = descriptorManager.registerBuffer(
-        m_indirectBuffers[i]->getHandle(), 0,
-        sizeof(VkDrawIndexedIndirectCommand) * MAX_MESH_INSTANCES,
+        VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT,
         7); // Binding 7
+    m_lightBuffers[i] = std::make_unique<GrowableBuffer>(
+        m_context, sizeof(Light) * INITIAL_LIGHT_CAPACITY,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
+        VMA_ALLOCATION_CREATE_MAPPED_BIT, 3); // Binding 3
+    m_materialBuffers[i] = std::make_unique<GrowableBuffer>(
+        m_context, sizeof(MaterialGPU) * INITIAL_MATERIAL_CAPACITY,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
+        VMA_ALLOCATION_CREATE_MAPPED_BIT, 2); // Binding 2
+  }
+}
 
-    m_frameInstances[i].reserve(MAX_MESH_INSTANCES);
-  }
-
-  // Material Buffer (Static/Shared/Bindless-indexed)
-  // Using binding 2 for now, should match shader logic.
-  m_materialBuffer = std::make_unique<Buffer>(
-      m_context, sizeof(MaterialGPU) * MAX_MATERIALS,
-      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-  m_materialBufferIndex = descriptorManager.registerBuffer(
-       m_materialBuffer->getHandle(), 0,
-       sizeof(MaterialGPU) * MAX_MATERIALS, 2); 
-  // m_materialBufferIndex = 0; // Dummy value
-       
-  m_materials.reserve(MAX_MATERIALS);
-  m_gpuMaterials.reserve(MAX_MATERIALS);
-  m_lights.reserve(MAX_LIGHTS);
-}
-
-void SceneManager::addMeshInstance(uint32_t frameIndex,
-                                   const glm::mat4 &transform,
-                                   uint32_t materialIndex, uint32_t indexCount,
-                                   uint32_t firstIndex, int vertexOffset,
-                                   const glm::vec3 &center, float radius) {
-  auto &instances = m_frameInstances[frameIndex];
-  if (instances.size() >= MAX_MESH_INSTANCES) {
-    spdlog::warn("Maximum mesh instances reached for frame {}!", frameIndex);
+bool SceneManager::isTransparentMaterial(uint32_t materialIndex) const {
+  return materialIndex < m_gpuMaterials.size() &&
+         m_gpuMaterials[materialIndex].alphaMode ==
+             static_cast<uint32_t>(AlphaMode::Blend);
+}
+
+bool SceneManager::hasMaskedMaterials() const {
+  return std::any_of(m_gpuMaterials.begin(), m_gpuMaterials.end(),
+                     [](const MaterialGPU &material) {
+                       return material.alphaMode ==
+                              static_cast<uint32_t>(AlphaMode::Mask);
+                     });
+}
+
+void SceneManager::markSlotDirty(uint32_t slot) {
+  if (m_slotStaleFrames[slot] == 0) {
+    m_staleSlots.push_back(slot);
+  }
+  m_slotStaleFrames[slot] = (1u << MAX_FRAMES_IN_FLIGHT) - 1;
+  m_handleVersions[m_slotHandles[slot]] = ++m_instanceVersion;
+}
+
+void SceneManager::swapSlots(uint32_t a, uint32_t b) {
+  if (a == b) {
     return;
   }
+  std::swap(m_instances[a], m_instances[b]);
+  std::swap(m_commands[a], m_commands[b]);
+  std::swap(m_slotHandles[a], m_slotHandles[b]);
+  for (uint32_t slot : {a, b}) {
+    m_commands[slot].firstInstance = slot;
+    m_handleSlots[m_slotHandles[slot]] = slot;
+    markSlotDirty(slot);
+  }
+}
 
+// Moves the slot across the opaque / transparent boundary, look it up through
+// its handle again afterwards
+void SceneManager::setSlotTransparent(uint32_t slot, bool transparent) {
+  bool isTransparent = slot >= m_opaqueCount;
+  if (transparent == isTransparent) {
+    return;
+  }
+  if (transparent) {
+    swapSlots(slot, m_opaqueCount - 1);
+    m_opaqueCount--;
+  } else {
+    swapSlots(slot, m_opaqueCount);
+    m_opaqueCount++;
+  }
+}
+
+InstanceHandle SceneManager::createMeshInstance(const MeshInstanceDesc &desc) {
   MeshInstance instance{};
-  instance.transform = transform;
-  instance.sphereCenter = center;
-  instance.sphereRadius = radius;
-  instance.materialIndex = materialIndex;
-  
-  FrameMeshInstance fmi;
-  fmi.meshInstance = instance;
-  fmi.indexCount = indexCount;
-  fmi.firstIndex = firstIndex;
-  fmi.vertexOffset = vertexOffset;
+  instance.transform = desc.transform;
+  instance.sphereCenter = desc.boundingCenter;
+  instance.sphereRadius = desc.boundingRadius;
+  instance.materialIndex = desc.materialIndex;
+  instance.flags = desc.dynamic ? MESH_INSTANCE_DYNAMIC : 0;
+  instance.firstMeshlet = desc.firstMeshlet;
+  instance.meshletCount = desc.meshletCount;
+
+  // Starts at full detail, selectLods moves it
+  InstanceLods lods;
+  lods.count = std::clamp(desc.lodCount, 1u, MAX_LODS);
+  lods.levels[0] = {desc.firstIndex, desc.indexCount, desc.firstMeshlet,
+                    desc.meshletCount};
+  for (uint32_t level = 1; level < lods.count; ++level) {
+    lods.levels[level] = desc.lods[level - 1];
+  }
+  for (uint32_t level = 0; level < lods.count; ++level) {
+    lods.meshletBound =
+        std::max(lods.meshletBound, lods.levels[level].meshletCount);
+  }
+  m_meshletCount += lods.meshletBound;
+  m_maxDrawTriangles = std::max(m_maxDrawTriangles, desc.indexCount / 3);
+
+  uint32_t slot = static_cast<uint32_t>(m_instances.size());
+  VkDrawIndexedIndirectCommand cmd{};
+  cmd.indexCount = desc.indexCount;
+  cmd.instanceCount = 1;
+  cmd.firstIndex = desc.firstIndex;
+  cmd.vertexOffset = desc.vertexOffset;
+  cmd.firstInstance = slot;
+
+  InstanceHandle handle;
+  if (!m_freeHandles.empty()) {
+    handle = m_freeHandles.back();
+    m_freeHandles.pop_back();
+    m_handleSlots[handle] = slot;
+  } else {
+    handle = static_cast<InstanceHandle>(m_handleSlots.size());
+    m_handleSlots.push_back(slot);
+    m_handleLods.emplace_back();
+    m_handleVersions.push_back(0);
+  }
+  m_handleLods[handle] = lods;
+
+  // Appended as transparent, opaque ones then swap to the boundary
+  m_instances.push_back(instance);
+  m_commands.push_back(cmd);
+  m_slotHandles.push_back(handle);
+  if (m_slotStaleFrames.size() <= slot) {
+    m_slotStaleFrames.push_back(0);
+  }
+  markSlotDirty(slot);
+  setSlotTransparent(slot, isTransparentMaterial(desc.materialIndex));
+
+  if (desc.dynamic) {
+    m_dynamicHandles.push_back(handle);
+  } else {
+    m_staticVersion++;
+  }
+  return handle;
+}
+
+void SceneManager::destroyMeshInstance(InstanceHandle handle) {
+  if (handle >= m_handleSlots.size() || m_handleSlots[handle] == UINT32_MAX) {
+    return;
+  }
+  uint32_t slot = m_handleSlots[handle];
+  m_meshletCount -= m_handleLods[handle].meshletBound;
+  if (m_instances[slot].flags & MESH_INSTANCE_DYNAMIC) {
+    m_dynamicHandles.erase(std::find(m_dynamicHandles.begin(), m_dynamicHandles.end(), handle));
+  } else {
+    m_staticVersion++;
+  }
+
+  // Out of the opaque range first, then swapped with the last slot
+  setSlotTransparent(slot, true);
+  slot = m_handleSlots[handle];
+  swapSlots(slot, static_cast<uint32_t>(m_instances.size()) - 1);
+
+  m_instances.pop_back();
+  m_commands.pop_back();
+  m_slotHandles.pop_back();
+  m_handleSlots[handle] = UINT32_MAX;
+  m_freeHandles.push_back(handle);
+}
+
+void SceneManager::setInstanceTransform(InstanceHandle handle,
+                                        const glm::mat4 &transform) {
+  if (handle >= m_handleSlots.size() || m_handleSlots[handle] == UINT32_MAX) {
+    return;
+  }
+  uint32_t slot = m_handleSlots[handle];
+  m_instances[slot].transform = transform;
+  markSlotDirty(slot);
+  if (!(m_instances[slot].flags & MESH_INSTANCE_DYNAMIC)) {
+    m_staticVersion++;
+  }
+}
 
-  instances.push_back(fmi);
+void SceneManager::setInstanceMaterial(InstanceHandle handle,
+                                       uint32_t materialIndex) {
+  if (handle >= m_handleSlots.size() || m_handleSlots[handle] == UINT32_MAX) {
+    return;
+  }
+  uint32_t slot = m_handleSlots[handle];
+  m_instances[slot].materialIndex = materialIndex;
+  markSlotDirty(slot);
+  setSlotTransparent(slot, isTransparentMaterial(materialIndex));
 }
 
-void SceneManager::clearMeshInstances(uint32_t frameIndex) {
-  m_frameInstances[frameIndex].clear();
+void SceneManager::clearMeshInstances() {
+  m_instances.clear();
+  m_commands.clear();
+  m_slotHandles.clear();
+  m_handleSlots.clear();
+  m_freeHandles.clear();
+  m_dynamicHandles.clear();
+  m_handleLods.clear();
+  m_handleVersions.clear();
+  m_opaqueCount = 0;
+  m_meshletCount = 0;
+  m_maxDrawTriangles = 0;
+  m_staticVersion++;
 }
 
-void SceneManager::prepareIndirectCommands() {
-  // Already handled in addMeshInstance
+void SceneManager::selectLods(const glm::vec3 &cameraPos, float projectionScale,
+                              bool enabled) {
+  for (uint32_t slot = 0; slot < m_instances.size(); ++slot) {
+    InstanceLods &lods = m_handleLods[m_slotHandles[slot]];
+    if (lods.count <= 1) {
+      continue;
+    }
+
+    uint32_t level = 0;
+    if (enabled) {
+      const MeshInstance &instance = m_instances[slot];
+      glm::vec3 center = glm::vec3(instance.transform *
+                                   glm::vec4(instance.sphereCenter, 1.0f));
+      float scale = std::max({glm::length(glm::vec3(instance.transform[0])),
+                              glm::length(glm::vec3(instance.transform[1])),
+                              glm::length(glm::vec3(instance.transform[2]))});
+      float radius = instance.sphereRadius * scale;
+      float distance = glm::distance(center, cameraPos);
+      // Projected diameter over the screen height, from inside it fills the screen
+      float screenSize = distance > radius ? radius * projectionScale / distance
+                                           : LOD_SCREEN_SIZES[0];
+
+      level = lods.current;
+      while (level + 1 < lods.count &&
+             screenSize < LOD_SCREEN_SIZES[level + 1] * (1.0f - LOD_HYSTERESIS)) {
+        level++;
+      }
+      while (level > 0 &&
+             screenSize > LOD_SCREEN_SIZES[level] * (1.0f + LOD_HYSTERESIS)) {
+        level--;
+      }
+    }
+    if (level == lods.current) {
+      continue;
+    }
+
+    // Shadow passes draw the same command, casters follow the camera's choice
+    lods.current = level;
+    const PrimitiveLod &lod = lods.levels[level];
+    m_commands[slot].firstIndex = lod.firstIndex;
+    m_commands[slot].indexCount = lod.indexCount;
+    m_instances[slot].firstMeshlet = lod.firstMeshlet;
+    m_instances[slot].meshletCount = lod.meshletCount;
+    markSlotDirty(slot);
+  }
+}
+
+void SceneManager::beginFrame(uint32_t frameIndex) {
+  m_uploadRing->beginFrame(frameIndex);
+}
+
+void SceneManager::bindUpload(UploadSlot &slot,
+                              const UploadAllocation &allocation,
+                              uint32_t binding) {
+  // Allocation order is the same every frame, so this only fires when a size changes
+  if (slot.offset == allocation.offset && slot.range == allocation.size) {
+    return;
+  }
+  m_context->getDescriptorManager().updateBuffer(
+      slot.index, allocation.buffer, allocation.offset, allocation.size,
+      binding);
+  slot.offset = allocation.offset;
+  slot.range = allocation.size;
 }
 
 void SceneManager::updateSceneData(uint32_t frameIndex, const SceneData &data) {
-  m_sceneBuffers[frameIndex]->upload(&data, sizeof(SceneData));
+  UploadAllocation allocation = m_uploadRing->upload(&data, sizeof(SceneData));
+  bindUpload(m_sceneSlots[frameIndex], allocation, 1);
 }
 
 uint32_t SceneManager::addLight(const Light &light) {
-  if (m_lights.size() >= MAX_LIGHTS) {
-    throw std::runtime_error("Maximum lights reached in SceneManager!");
-  }
   uint32_t index = static_cast<uint32_t>(m_lights.size());
   m_lights.push_back(light);
   // Note: We don't upload immediately here, we wait for updateLightsBuffer call
@@ -132,8 +341,10 @@ void SceneManager::updateLight(uint32_t index, const Light &light) {
 
 void SceneManager::updateLightsBuffer(uint32_t frameIndex) {
   if (!m_lights.empty()) {
-    m_lightBuffers[frameIndex]->upload(m_lights.data(),
-                                       sizeof(Light) * m_lights.size(), 0);
+    VkDeviceSize size = sizeof(Light) * m_lights.size();
+    GrowableBuffer &buffer = *m_lightBuffers[frameIndex];
+    buffer.reserve(size);
+    buffer.get().upload(m_lights.data(), size);
   }
 }
 
@@ -151,105 +362,148 @@ void SceneManager::addModel(std::unique_ptr<Model> model) {
 }
 
 int32_t SceneManager::addMaterial(const Material& material) {
-    if (m_materials.size() >= MAX_MATERIALS) {
-        spdlog::warn("Maximum materials reached!");
-        return -1;
-    }
-    
     int32_t index = static_cast<int32_t>(m_materials.size());
     m_materials.push_back(material);
     m_gpuMaterials.push_back(material.gpuData);
     
-    m_materialsDirty = true;
+    m_materialStaleFrames = (1u << MAX_FRAMES_IN_FLIGHT) - 1;
     return index;
 }
 
-void SceneManager::updateMaterialBuffer() {
-  if (m_materialsDirty) {
+void SceneManager::updateMaterialBuffer(uint32_t frameIndex) {
+  const uint8_t frameBit = static_cast<uint8_t>(1u << frameIndex);
+  if (m_materialStaleFrames & frameBit) {
     if (m_gpuMaterials.size() > 0) {
-       m_materialBuffer->upload(m_gpuMaterials.data(), m_gpuMaterials.size() * sizeof(MaterialGPU));
+       VkDeviceSize size = m_gpuMaterials.size() * sizeof(MaterialGPU);
+       m_materialBuffers[frameIndex]->reserve(size);
+       m_materialBuffers[frameIndex]->get().upload(m_gpuMaterials.data(), size);
     }
-    m_materialsDirty = false;
+    m_materialStaleFrames &= ~frameBit;
   }
 }
 
 void SceneManager::updateMaterial(uint32_t index, const Material& material) {
     if (index < m_materials.size()) {
+        bool wasTransparent = isTransparentMaterial(index);
         m_materials[index] = material;
         // Update GPU copy
         m_gpuMaterials[index] = material.gpuData;
         
-        m_materialsDirty = true;
+        m_materialStaleFrames = (1u << MAX_FRAMES_IN_FLIGHT) - 1;
+
+        // Blend mode toggled, its instances move to the other side of the boundary
+        if (wasTransparent != isTransparentMaterial(index)) {
+            for (InstanceHandle handle : std::vector<InstanceHandle>(m_slotHandles)) {
+                uint32_t slot = m_handleSlots[handle];
+                if (m_instances[slot].materialIndex == index) {
+                    setSlotTransparent(slot, !wasTransparent);
+                }
+            }
+        }
     }
 }
 
-void SceneManager::sortAndUploadInstances(uint32_t frameIndex, const glm::vec3& cameraPos) {
-    auto& instances = m_frameInstances[frameIndex];
-    if (instances.empty()) return;
-
-    // 1. Separate Opaque and Transparent
-    std::vector<FrameMeshInstance> opaque;
-    std::vector<FrameMeshInstance> transparent;
-    opaque.reserve(instances.size());
-    transparent.reserve(instances.size()); 
-
-    for (const auto& inst : instances) {
-        if (inst.meshInstance.materialIndex < m_gpuMaterials.size()) {
-             if (m_gpuMaterials[inst.meshInstance.materialIndex].alphaMode == static_cast<uint32_t>(AlphaMode::Blend)) {
-                 transparent.push_back(inst);
-             } else {
-                 opaque.push_back(inst);
-             }
-        } else {
-            opaque.push_back(inst);
-        }
+void SceneManager::remapTextureIndex(int32_t from, int32_t to) {
+  auto remap = [&](MaterialGPU &gpu) {
+    bool changed = false;
+    for (int32_t *index : {&gpu.baseColorIndex, &gpu.normalIndex,
+                           &gpu.metallicRoughnessIndex, &gpu.emissiveIndex,
+                           &gpu.occlusionIndex, &gpu.transmissionIndex,
+                           &gpu.thicknessIndex}) {
+      if (*index == from) {
+        *index = to;
+        changed = true;
+      }
     }
+    return changed;
+  };
 
-    // 2. Sort Opaque (Front to Back)
-    std::sort(opaque.begin(), opaque.end(), [&](const FrameMeshInstance& a, const FrameMeshInstance& b) {
-        float distA = glm::distance(a.meshInstance.sphereCenter, cameraPos);
-        float distB = glm::distance(b.meshInstance.sphereCenter, cameraPos);
-        return distA < distB;
-    });
-
-    // 3. Sort Transparent (Back to Front)
-    std::sort(transparent.begin(), transparent.end(), [&](const FrameMeshInstance& a, const FrameMeshInstance& b) {
-        float distA = glm::distance(a.meshInstance.sphereCenter, cameraPos);
-        float distB = glm::distance(b.meshInstance.sphereCenter, cameraPos);
-        return distA > distB;
-    });
-
-    // 4. Merge back to instances
-    instances.clear();
-    instances.insert(instances.end(), opaque.begin(), opaque.end());
-    instances.insert(instances.end(), transparent.begin(), transparent.end());
-    
-    // Store Opaque Count
-    if (m_opaqueInstanceCounts.size() < MAX_FRAMES_IN_FLIGHT) {
-        m_opaqueInstanceCounts.resize(MAX_FRAMES_IN_FLIGHT);
+  for (size_t i = 0; i < m_materials.size(); ++i) {
+    remap(m_materials[i].gpuData);
+    if (remap(m_gpuMaterials[i])) {
+      m_materialStaleFrames = (1u << MAX_FRAMES_IN_FLIGHT) - 1;
+    }
+  }
+}
+
+void SceneManager::uploadInstances(uint32_t frameIndex, const glm::vec3& cameraPos) {
+    // Transparents are drawn in slot order, keep them back to front. The sort is
+    // stable, so only the slots that actually changed place get re-uploaded.
+    uint32_t count = static_cast<uint32_t>(m_instances.size());
+    uint32_t transparentCount = count - m_opaqueCount;
+    if (transparentCount > 1) {
+        if (m_sortKeys.size() < transparentCount) {
+            m_sortKeys.resize(count);
+            m_sortScratch.resize(count);
+        }
+        std::span<DrawKey> keys(m_sortKeys.data(), transparentCount);
+        for (uint32_t i = 0; i < transparentCount; ++i) {
+            const MeshInstance& instance = m_instances[m_opaqueCount + i];
+            glm::vec3 offset = glm::vec3(instance.transform * glm::vec4(instance.sphereCenter, 1.0f)) - cameraPos;
+            keys[i].key = makeDrawKey(DrawPass::Transparent, 0, instance.materialIndex, glm::dot(offset, offset));
+            keys[i].payload = m_slotHandles[m_opaqueCount + i];
+        }
+        radixSortDrawKeys(keys, std::span<DrawKey>(m_sortScratch.data(), transparentCount));
+        for (uint32_t i = 0; i < transparentCount; ++i) {
+            swapSlots(m_opaqueCount + i, m_handleSlots[keys[i].payload]);
+        }
     }
-    m_opaqueInstanceCounts[frameIndex] = static_cast<uint32_t>(opaque.size());
 
-    // 5. Upload to GPU
-    std::vector<MeshInstance> gpuInstances;
-    std::vector<VkDrawIndexedIndirectCommand> commands;
-    gpuInstances.reserve(instances.size());
-    commands.reserve(instances.size());
+    // Slots this frame's copy hasn't seen, coalesced into contiguous ranges
+    const uint8_t frameBit = static_cast<uint8_t>(1u << frameIndex);
+    auto& pending = m_uploadScratch;
+    pending.clear();
+    for (uint32_t slot : m_staleSlots) {
+        if (m_slotStaleFrames[slot] & frameBit) {
+            m_slotStaleFrames[slot] &= ~frameBit;
+            if (slot < count) {
+                pending.push_back(slot);
+            }
+        }
+    }
+    m_staleSlots.erase(std::remove_if(m_staleSlots.begin(), m_staleSlots.end(),
+                                      [&](uint32_t slot) { return m_slotStaleFrames[slot] == 0; }),
+                       m_staleSlots.end());
+
+    // A replaced buffer starts out empty, it needs every slot
+    GrowableBuffer& instanceBuffer = *m_instanceBuffers[frameIndex];
+    GrowableBuffer& indirectBuffer = *m_indirectBuffers[frameIndex];
+    bool grown = instanceBuffer.reserve(count * sizeof(MeshInstance));
+    grown |= indirectBuffer.reserve(count * sizeof(VkDrawIndexedIndirectCommand));
+    if (grown) {
+        pending.resize(count);
+        std::iota(pending.begin(), pending.end(), 0u);
+    } else {
+        std::sort(pending.begin(), pending.end());
+    }
 
-    for (size_t i = 0; i < instances.size(); ++i) {
-        gpuInstances.push_back(instances[i].meshInstance);
-        
-        VkDrawIndexedIndirectCommand cmd{};
-        cmd.indexCount = instances[i].indexCount;
-        cmd.instanceCount = 1;
-        cmd.firstIndex = instances[i].firstIndex;
-        cmd.vertexOffset = instances[i].vertexOffset;
-        cmd.firstInstance = static_cast<uint32_t>(i);
-        commands.push_back(cmd);
+    auto* gpuInstances = static_cast<MeshInstance*>(instanceBuffer.getMappedData());
+    auto* gpuCommands = static_cast<VkDrawIndexedIndirectCommand*>(indirectBuffer.getMappedData());
+    for (size_t i = 0; i < pending.size();) {
+        uint32_t first = pending[i];
+        uint32_t last = first;
+        while (++i < pending.size() && pending[i] == last + 1) {
+            last = pending[i];
+        }
+        uint32_t rangeCount = last - first + 1;
+        memcpy(gpuInstances + first, &m_instances[first], rangeCount * sizeof(MeshInstance));
+        memcpy(gpuCommands + first, &m_commands[first], rangeCount * sizeof(VkDrawIndexedIndirectCommand));
+        instanceBuffer.get().flush(first * sizeof(MeshInstance), rangeCount * sizeof(MeshInstance));
+        indirectBuffer.get().flush(first * sizeof(VkDrawIndexedIndirectCommand),
+                                   rangeCount * sizeof(VkDrawIndexedIndirectCommand));
     }
 
-    m_meshInstanceBuffers[frameIndex]->upload(gpuInstances.data(), gpuInstances.size() * sizeof(MeshInstance));
-    m_indirectBuffers[frameIndex]->upload(commands.data(), commands.size() * sizeof(VkDrawIndexedIndirectCommand));
+    m_frameInstanceCounts[frameIndex] = count;
+    m_opaqueInstanceCounts[frameIndex] = m_opaqueCount;
+
+    auto& dynamicInstances = m_dynamicInstances[frameIndex];
+    auto& dynamicVersions = m_dynamicVersions[frameIndex];
+    dynamicInstances.clear();
+    dynamicVersions.clear();
+    for (InstanceHandle handle : m_dynamicHandles) {
+        dynamicInstances.push_back(m_instances[m_handleSlots[handle]]);
+        dynamicVersions.push_back(m_handleVersions[handle]);
+    }
 }
 
 } // namespace astral
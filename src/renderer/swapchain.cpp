@@ -139,7 +139,7 @@ SwapchainSupportDetails Swapchain::querySupport(VkPhysicalDevice device) {
 VkSurfaceFormatKHR Swapchain::chooseFormat(
     const std::vector<VkSurfaceFormatKHR> &availableFormats) {
   for (const auto &availableFormat : availableFormats) {
-    if (availableFormat.format == VK_FORMAT_B8G8R8A8_UNORM &&
+    if (availableFormat.format == PREFERRED_FORMAT &&
         availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
       return availableFormat;
     }
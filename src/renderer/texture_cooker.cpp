@@ -0,0 +1,247 @@
+#include "astral/renderer/texture_cooker.hpp"
+#include "astral/resources/texture_compression.hpp"
+#include <spdlog/spdlog.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace astral {
+
+namespace {
+
+constexpr uint32_t COOKED_MAGIC = 0x58455441; // "ATEX"
+// Bump whenever the cooked output changes (encoder, mip filter...) to invalidate old caches
+constexpr uint32_t COOKED_VERSION = 1;
+
+struct CookedHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+    uint64_t dataSize;
+};
+
+uint64_t hashBytes(const std::vector<uint8_t>& bytes) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (uint8_t b : bytes) {
+        hash ^= b;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool isSrgb(VkFormat format) {
+    return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+struct SrgbTables {
+    float toLinear[256];
+
+    SrgbTables() {
+        for (int i = 0; i < 256; ++i) {
+            float c = i / 255.0f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+    }
+};
+
+const SrgbTables& srgbTables() {
+    static SrgbTables tables;
+    return tables;
+}
+
+uint8_t linearToSrgb(float c) {
+    c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+// 2x2 box filter, edge texels repeat on odd sizes. sRGB colour is averaged in linear space.
+void downsample(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight,
+                uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, bool srgb) {
+    const float* toLinear = srgbTables().toLinear;
+    for (uint32_t y = 0; y < dstHeight; ++y) {
+        uint32_t y0 = std::min(y * 2, srcHeight - 1);
+        uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+        for (uint32_t x = 0; x < dstWidth; ++x) {
+            uint32_t x0 = std::min(x * 2, srcWidth - 1);
+            uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+            const uint8_t* p[4] = {
+                src + (y0 * srcWidth + x0) * 4, src + (y0 * srcWidth + x1) * 4,
+                src + (y1 * srcWidth + x0) * 4, src + (y1 * srcWidth + x1) * 4
+            };
+            uint8_t* out = dst + (y * dstWidth + x) * 4;
+            for (int c = 0; c < 4; ++c) {
+                if (srgb && c < 3) {
+                    float sum = toLinear[p[0][c]] + toLinear[p[1][c]] + toLinear[p[2][c]] + toLinear[p[3][c]];
+                    out[c] = linearToSrgb(sum * 0.25f);
+                } else {
+                    out[c] = static_cast<uint8_t>((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+TextureCooker::TextureCooker(std::filesystem::path cacheDirectory) : m_cacheDirectory(std::move(cacheDirectory)) {
+    if (!m_cacheDirectory.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(m_cacheDirectory, ec);
+        if (ec) {
+            spdlog::warn("TextureCooker: can't create cache directory {} ({}), cooking without cache",
+                         m_cacheDirectory.string(), ec.message());
+            m_cacheDirectory.clear();
+        }
+    }
+}
+
+bool TextureCooker::cook(const std::vector<uint8_t>& encoded, VkFormat format, const std::string& name, CookedTexture& out) const {
+    std::filesystem::path cachePath;
+    if (!m_cacheDirectory.empty()) {
+        cachePath = getCachePath(encoded, format);
+        if (loadCache(cachePath, format, out)) {
+            return true;
+        }
+        out = CookedTexture{}; // A rejected entry may have filled part of it
+    }
+
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load_from_memory(encoded.data(), static_cast<int>(encoded.size()),
+                                            &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        spdlog::error("TextureCooker: failed to decode {}: {}", name, stbi_failure_reason());
+        return false;
+    }
+
+    out.width = static_cast<uint32_t>(width);
+    out.height = static_cast<uint32_t>(height);
+    out.format = format;
+    out.data.clear();
+    out.mipOffsets.clear();
+
+    // Same chain length Image allocates
+    uint32_t mipCount = static_cast<uint32_t>(std::floor(std::log2(std::max(out.width, out.height)))) + 1;
+    bool srgb = isSrgb(format);
+
+    std::vector<uint8_t> mip(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+    std::vector<uint8_t> next;
+
+    for (uint32_t level = 0; level < mipCount; ++level) {
+        uint32_t w = std::max(1u, out.width >> level);
+        uint32_t h = std::max(1u, out.height >> level);
+        if (level > 0) {
+            uint32_t prevW = std::max(1u, out.width >> (level - 1));
+            uint32_t prevH = std::max(1u, out.height >> (level - 1));
+            next.resize(static_cast<size_t>(w) * h * 4);
+            downsample(mip.data(), prevW, prevH, next.data(), w, h, srgb);
+            mip.swap(next);
+        }
+
+        out.mipOffsets.push_back(out.data.size());
+        out.data.resize(out.data.size() + BlockCompressor::getImageSize(format, w, h));
+        BlockCompressor::compressImage(format, mip.data(), w, h, out.data.data() + out.mipOffsets.back());
+    }
+
+    if (!cachePath.empty()) {
+        storeCache(cachePath, out);
+    }
+    return true;
+}
+
+std::filesystem::path TextureCooker::getCachePath(const std::vector<uint8_t>& encoded, VkFormat format) const {
+    std::ostringstream name;
+    name << std::hex << hashBytes(encoded) << std::dec << "_" << static_cast<uint32_t>(format) << ".atex";
+    return m_cacheDirectory / name.str();
+}
+
+bool TextureCooker::loadCache(const std::filesystem::path& path, VkFormat format, CookedTexture& out) const {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    CookedHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != COOKED_MAGIC || header.version != COOKED_VERSION ||
+        header.format != static_cast<uint32_t>(format) || header.width == 0 || header.height == 0) {
+        return false; // Stale or foreign, gets re-cooked and overwritten
+    }
+
+    // Sizes come from disk: bound them by the extent and the file before allocating anything
+    std::error_code ec;
+    uint64_t fileSize = std::filesystem::file_size(path, ec);
+    uint32_t maxMips = static_cast<uint32_t>(std::floor(std::log2(std::max(header.width, header.height)))) + 1;
+    uint64_t payload = ec || fileSize < sizeof(header) ? 0 : fileSize - sizeof(header);
+    if (header.mipCount == 0 || header.mipCount > maxMips ||
+        header.mipCount * sizeof(VkDeviceSize) > payload ||
+        header.dataSize != payload - header.mipCount * sizeof(VkDeviceSize)) {
+        spdlog::warn("TextureCooker: corrupt cache entry {}, re-cooking", path.string());
+        return false;
+    }
+
+    out.width = header.width;
+    out.height = header.height;
+    out.format = format;
+    out.mipOffsets.resize(header.mipCount);
+    out.data.resize(header.dataSize);
+    file.read(reinterpret_cast<char*>(out.mipOffsets.data()), header.mipCount * sizeof(VkDeviceSize));
+    file.read(reinterpret_cast<char*>(out.data.data()), header.dataSize);
+    if (!file) {
+        return false;
+    }
+
+    // Every mip must lie inside the data, the streamer copies them without further checks
+    for (uint32_t level = 0; level < header.mipCount; ++level) {
+        VkDeviceSize size = BlockCompressor::getImageSize(format, std::max(1u, header.width >> level),
+                                                          std::max(1u, header.height >> level));
+        if (out.mipOffsets[level] > header.dataSize || size > header.dataSize - out.mipOffsets[level]) {
+            spdlog::warn("TextureCooker: corrupt cache entry {}, re-cooking", path.string());
+            return false;
+        }
+    }
+    return true;
+}
+
+void TextureCooker::storeCache(const std::filesystem::path& path, const CookedTexture& texture) const {
+    CookedHeader header{};
+    header.magic = COOKED_MAGIC;
+    header.version = COOKED_VERSION;
+    header.format = static_cast<uint32_t>(texture.format);
+    header.width = texture.width;
+    header.height = texture.height;
+    header.mipCount = static_cast<uint32_t>(texture.mipOffsets.size());
+    header.dataSize = texture.data.size();
+
+    // Write to a temp file and rename, a reader never sees a half written entry
+    std::ostringstream suffix;
+    suffix << ".tmp" << std::this_thread::get_id();
+    std::filesystem::path tempPath = path;
+    tempPath += suffix.str();
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(texture.mipOffsets.data()), texture.mipOffsets.size() * sizeof(VkDeviceSize));
+        file.write(reinterpret_cast<const char*>(texture.data.data()), texture.data.size());
+        if (!file) {
+            spdlog::warn("TextureCooker: failed to write cache entry {}", tempPath.string());
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+    }
+}
+
+} // namespace astral
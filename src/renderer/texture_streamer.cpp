@@ -0,0 +1,300 @@
+#include "astral/renderer/texture_streamer.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace astral {
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+TextureStreamer::TextureStreamer(Context* context, std::filesystem::path cacheDirectory, uint32_t decodeThreads)
+    : m_context(context), m_cooker(std::move(cacheDirectory)) {
+    m_commandPool = std::make_unique<CommandPool>(m_context, m_context->getQueueFamilyIndices().transferFamily.value());
+
+    VkSemaphoreTypeCreateInfo typeInfo{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+    VkSemaphoreCreateInfo semaphoreInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(m_context->getDevice(), &semaphoreInfo, nullptr, &m_timeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create texture streaming timeline semaphore!");
+    }
+
+    if (decodeThreads == 0) {
+        decodeThreads = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    }
+    for (uint32_t i = 0; i < decodeThreads; ++i) {
+        m_workers.emplace_back(&TextureStreamer::decodeLoop, this);
+    }
+
+    bool dedicated = m_context->getTransferQueue() != m_context->getGraphicsQueue();
+    spdlog::info("TextureStreamer: {} decode thread(s), uploads on {} queue", decodeThreads,
+                 dedicated ? "dedicated transfer" : "graphics");
+}
+
+TextureStreamer::~TextureStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+
+    if (!m_inFlight.empty()) {
+        uint64_t last = m_inFlight.back().timelineValue;
+        VkSemaphoreWaitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_timeline;
+        waitInfo.pValues = &last;
+        vkWaitSemaphores(m_context->getDevice(), &waitInfo, UINT64_MAX);
+    }
+    m_inFlight.clear();
+    vkDestroySemaphore(m_context->getDevice(), m_timeline, nullptr);
+}
+
+void TextureStreamer::enqueue(std::shared_ptr<Image> image, const std::filesystem::path& path) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back({std::move(image), path, {}});
+    }
+    m_cv.notify_one();
+}
+
+void TextureStreamer::enqueue(std::shared_ptr<Image> image, std::vector<uint8_t> encoded) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back({std::move(image), {}, std::move(encoded)});
+    }
+    m_cv.notify_one();
+}
+
+bool TextureStreamer::isIdle() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_requests.empty() && m_decoding == 0 && m_decoded.empty() && m_inFlight.empty();
+}
+
+void TextureStreamer::decodeLoop() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || !m_requests.empty(); });
+            if (m_stop) {
+                return;
+            }
+            request = std::move(m_requests.front());
+            m_requests.pop_front();
+            m_decoding++;
+        }
+
+        Decoded decoded = decode(request);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decoding--;
+        m_decoded.push_back(std::move(decoded));
+    }
+}
+
+TextureStreamer::Decoded TextureStreamer::decode(Request& request) {
+    Decoded result;
+    result.image = std::move(request.image);
+    const ImageSpecs& specs = result.image->getSpecs();
+    std::string name = request.encoded.empty() ? request.path.string() : "embedded image";
+
+    if (request.encoded.empty()) {
+        std::ifstream file(request.path, std::ios::binary);
+        request.encoded.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (request.encoded.empty()) {
+            spdlog::error("TextureStreamer: failed to read {}", name);
+            result.failed = true;
+            return result;
+        }
+    }
+
+    // Decode + mips + block compression, or straight from the cook cache
+    CookedTexture cooked;
+    if (!m_cooker.cook(request.encoded, specs.format, name, cooked)) {
+        result.failed = true;
+        return result;
+    }
+    if (cooked.width != specs.width || cooked.height != specs.height || cooked.mipOffsets.size() != specs.mipLevels) {
+        spdlog::error("TextureStreamer: {} changed size while streaming", name);
+        result.failed = true;
+        return result;
+    }
+
+    result.pixels = std::move(cooked.data);
+    result.mipOffsets = std::move(cooked.mipOffsets);
+    return result;
+}
+
+std::vector<std::shared_ptr<Image>> TextureStreamer::update() {
+    std::vector<std::shared_ptr<Image>> resident;
+
+    // 1. Retire finished batches. A zero-timeout wait (rather than just reading the
+    // counter) gives the host-side dependency on the transfer writes.
+    while (!m_inFlight.empty()) {
+        Batch& batch = m_inFlight.front();
+        VkSemaphoreWaitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_timeline;
+        waitInfo.pValues = &batch.timelineValue;
+        if (vkWaitSemaphores(m_context->getDevice(), &waitInfo, 0) != VK_SUCCESS) {
+            break;
+        }
+        resident.insert(resident.end(), batch.images.begin(), batch.images.end());
+        m_graphicsWaitValue = batch.timelineValue;
+        m_freeCommandBuffers.push_back(std::move(batch.cmd));
+        m_inFlight.pop_front();
+    }
+
+    // 2. Pick up what the workers finished, as much as fits the staging budget
+    std::vector<Decoded> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        VkDeviceSize bytes = 0;
+        auto it = m_decoded.begin();
+        for (; it != m_decoded.end(); ++it) {
+            if (!batch.empty() && bytes + it->pixels.size() > BATCH_BUDGET) {
+                break;
+            }
+            bytes += it->pixels.size();
+            batch.push_back(std::move(*it));
+        }
+        m_decoded.erase(m_decoded.begin(), it);
+    }
+
+    batch.erase(std::remove_if(batch.begin(), batch.end(), [](const Decoded& d) { return d.failed; }), batch.end());
+    if (!batch.empty()) {
+        submitBatch(batch);
+    }
+    return resident;
+}
+
+bool TextureStreamer::takeGraphicsWait(VkSemaphoreSubmitInfo& wait) {
+    if (m_graphicsWaitValue == 0) {
+        return false;
+    }
+    wait = {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    wait.semaphore = m_timeline;
+    wait.value = m_graphicsWaitValue;
+    wait.stageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    m_graphicsWaitValue = 0;
+    return true;
+}
+
+void TextureStreamer::submitBatch(std::vector<Decoded>& decoded) {
+    VkDeviceSize stagingSize = 0;
+    std::vector<VkDeviceSize> baseOffsets;
+    for (const auto& d : decoded) {
+        stagingSize = alignUp(stagingSize, 16);
+        baseOffsets.push_back(stagingSize);
+        stagingSize += d.pixels.size();
+    }
+
+    Batch batch;
+    batch.staging = std::make_unique<Buffer>(m_context, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO,
+                                             VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    auto* staging = static_cast<uint8_t*>(batch.staging->getMappedData());
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        memcpy(staging + baseOffsets[i], decoded[i].pixels.data(), decoded[i].pixels.size());
+    }
+    batch.staging->flush();
+
+    if (!m_freeCommandBuffers.empty()) {
+        batch.cmd = std::move(m_freeCommandBuffers.back());
+        m_freeCommandBuffers.pop_back();
+    } else {
+        batch.cmd = m_commandPool->allocateBuffer();
+    }
+    VkCommandBuffer cmd = batch.cmd->getHandle();
+    batch.cmd->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+    // One barrier batch in, all the copies, one barrier batch out
+    std::vector<VkImageMemoryBarrier2> barriers;
+    barriers.reserve(decoded.size());
+    for (const auto& d : decoded) {
+        const ImageSpecs& specs = d.image->getSpecs();
+        VkImageMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+        barrier.srcAccessMask = VK_ACCESS_2_NONE;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = d.image->getHandle();
+        barrier.subresourceRange = {specs.aspectFlags, 0, specs.mipLevels, 0, specs.arrayLayers};
+        barriers.push_back(barrier);
+    }
+    VkDependencyInfo dependency{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependency.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+    dependency.pImageMemoryBarriers = barriers.data();
+    vkCmdPipelineBarrier2(cmd, &dependency);
+
+    std::vector<VkBufferImageCopy> regions;
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        const ImageSpecs& specs = decoded[i].image->getSpecs();
+        regions.clear();
+        for (uint32_t mip = 0; mip < specs.mipLevels; ++mip) {
+            VkBufferImageCopy region{};
+            region.bufferOffset = baseOffsets[i] + decoded[i].mipOffsets[mip];
+            region.imageSubresource = {specs.aspectFlags, mip, 0, 1};
+            region.imageExtent = {std::max(1u, specs.width >> mip), std::max(1u, specs.height >> mip), 1};
+            regions.push_back(region);
+        }
+        vkCmdCopyBufferToImage(cmd, batch.staging->getHandle(), decoded[i].image->getHandle(),
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+    }
+
+    // Nothing to wait on here: the graphics submit that first samples them waits on the
+    // timeline value (takeGraphicsWait), which makes these writes visible to its shaders
+    for (auto& barrier : barriers) {
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+        barrier.dstAccessMask = VK_ACCESS_2_NONE;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+    vkCmdPipelineBarrier2(cmd, &dependency);
+    batch.cmd->end();
+
+    batch.timelineValue = m_nextTimelineValue++;
+
+    VkCommandBufferSubmitInfo cmdInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
+    cmdInfo.commandBuffer = cmd;
+    VkSemaphoreSubmitInfo signalInfo{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    signalInfo.semaphore = m_timeline;
+    signalInfo.value = batch.timelineValue;
+    signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    VkSubmitInfo2 submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+    submitInfo.commandBufferInfoCount = 1;
+    submitInfo.pCommandBufferInfos = &cmdInfo;
+    submitInfo.signalSemaphoreInfoCount = 1;
+    submitInfo.pSignalSemaphoreInfos = &signalInfo;
+    if (vkQueueSubmit2(m_context->getTransferQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit texture upload batch!");
+    }
+
+    spdlog::debug("TextureStreamer: {} texture(s), {:.1f} MB in batch {}", decoded.size(),
+                  stagingSize / (1024.0 * 1024.0), batch.timelineValue);
+    for (auto& d : decoded) {
+        batch.images.push_back(std::move(d.image));
+    }
+    m_inFlight.push_back(std::move(batch));
+}
+
+} // namespace astral
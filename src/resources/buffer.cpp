@@ -17,9 +17,14 @@ Buffer::Buffer(Context* context, VkDeviceSize size, VkBufferUsageFlags usage, Vm
     allocInfo.usage = memoryUsage;
     allocInfo.flags = flags;
 
-    if (vmaCreateBuffer(m_context->getAllocator(), &bufferInfo, &allocInfo, &m_buffer, &m_allocation, nullptr) != VK_SUCCESS) {
+    VmaAllocationInfo allocationInfo = {};
+    if (vmaCreateBuffer(m_context->getAllocator(), &bufferInfo, &allocInfo, &m_buffer, &m_allocation, &allocationInfo) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create buffer!");
     }
+
+    if (flags & VMA_ALLOCATION_CREATE_MAPPED_BIT) {
+        m_persistentData = allocationInfo.pMappedData;
+    }
 }
 
 Buffer::~Buffer() {
@@ -30,6 +35,10 @@ Buffer::~Buffer() {
 }
 
 void Buffer::map(void** data) {
+    if (m_persistentData) {
+        *data = m_persistentData;
+        return;
+    }
     if (vmaMapMemory(m_context->getAllocator(), m_allocation, data) != VK_SUCCESS) {
         throw std::runtime_error("Failed to map buffer memory!");
     }
@@ -37,6 +46,7 @@ void Buffer::map(void** data) {
 }
 
 void Buffer::unmap() {
+    if (m_persistentData) return;
     vmaUnmapMemory(m_context->getAllocator(), m_allocation);
     m_mappedData = nullptr;
 }
@@ -46,10 +56,20 @@ void Buffer::upload(const void* data, VkDeviceSize size, VkDeviceSize offset) {
         throw std::runtime_error("Upload size + offset exceeds buffer size!");
     }
 
+    if (m_persistentData) {
+        memcpy(static_cast<char*>(m_persistentData) + offset, data, size);
+        flush(offset, size);
+        return;
+    }
+
     void* mapped;
     map(&mapped);
     memcpy(static_cast<char*>(mapped) + offset, data, size);
     unmap();
 }
 
+void Buffer::flush(VkDeviceSize offset, VkDeviceSize size) {
+    vmaFlushAllocation(m_context->getAllocator(), m_allocation, offset, size);
+}
+
 } // namespace astral
@@ -0,0 +1,32 @@
+#include "astral/resources/growable_buffer.hpp"
+#include "astral/renderer/descriptor_manager.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace astral {
+
+GrowableBuffer::GrowableBuffer(Context* context, VkDeviceSize initialSize, VkBufferUsageFlags usage,
+                               VmaMemoryUsage memoryUsage, VmaAllocationCreateFlags flags, uint32_t binding)
+    : m_context(context), m_usage(usage), m_memoryUsage(memoryUsage), m_flags(flags), m_binding(binding) {
+    m_buffer = std::make_unique<Buffer>(m_context, std::max<VkDeviceSize>(initialSize, 16), m_usage, m_memoryUsage, m_flags);
+    auto& descriptorManager = m_context->getDescriptorManager();
+    m_index = descriptorManager.reserveBuffer(m_binding);
+    descriptorManager.updateBuffer(m_index, m_buffer->getHandle(), 0, m_buffer->getSize(), m_binding);
+}
+
+bool GrowableBuffer::reserve(VkDeviceSize size) {
+    if (size <= m_buffer->getSize()) {
+        return false;
+    }
+
+    VkDeviceSize newSize = std::max(size, m_buffer->getSize() * 2);
+    spdlog::info("GrowableBuffer: binding {} slot {} grows {:.1f} -> {:.1f} KB", m_binding, m_index,
+                 m_buffer->getSize() / 1024.0, newSize / 1024.0);
+    // Old one goes first so peak memory stays at the new size
+    m_buffer.reset();
+    m_buffer = std::make_unique<Buffer>(m_context, newSize, m_usage, m_memoryUsage, m_flags);
+    m_context->getDescriptorManager().updateBuffer(m_index, m_buffer->getHandle(), 0, m_buffer->getSize(), m_binding);
+    return true;
+}
+
+} // namespace astral
@@ -32,6 +32,15 @@ Image::Image(Context* context, const ImageSpecs& specs)
     imageInfo.samples = specs.samples;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    // Saves the queue family ownership transfer dance for streamed textures
+    QueueFamilyIndices indices = m_context->getQueueFamilyIndices();
+    uint32_t families[] = {indices.graphicsFamily.value(), indices.transferFamily.value()};
+    if (specs.transferQueueAccess && families[0] != families[1]) {
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = 2;
+        imageInfo.pQueueFamilyIndices = families;
+    }
+
     if (specs.viewType == VK_IMAGE_VIEW_TYPE_CUBE || specs.viewType == VK_IMAGE_VIEW_TYPE_CUBE_ARRAY) {
         imageInfo.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
     }
@@ -0,0 +1,334 @@
+#include "astral/resources/texture_compression.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace astral {
+
+namespace {
+
+// Interpolation weights of 4-bit BC7 indices (out of 64)
+constexpr int BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* dst, size_t bytes) : m_dst(dst) { memset(dst, 0, bytes); }
+
+    void write(uint32_t value, uint32_t bits) {
+        for (uint32_t i = 0; i < bits; ++i, ++m_bit) {
+            if (value & (1u << i)) {
+                m_dst[m_bit >> 3] |= static_cast<uint8_t>(1u << (m_bit & 7));
+            }
+        }
+    }
+
+private:
+    uint8_t* m_dst;
+    uint32_t m_bit = 0;
+};
+
+struct Bc7Endpoints {
+    int q[2][4]; // 7-bit per channel
+    int p[2];    // Shared LSB per endpoint
+};
+
+int bc7Unquantize(int q, int p) { return (q << 1) | p; }
+
+int bc7Interpolate(int e0, int e1, int index) {
+    return ((64 - BC7_WEIGHTS4[index]) * e0 + BC7_WEIGHTS4[index] * e1 + 32) >> 6;
+}
+
+// Picks the 7-bit + p-bit encoding closest to a float RGBA endpoint
+void bc7QuantizeEndpoint(const float e[4], int q[4], int& p) {
+    float bestError = 1e30f;
+    for (int pbit = 0; pbit < 2; ++pbit) {
+        int candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            candidate[c] = std::clamp(static_cast<int>(std::lround((e[c] - pbit) * 0.5f)), 0, 127);
+            float d = bc7Unquantize(candidate[c], pbit) - e[c];
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            p = pbit;
+            std::copy(candidate, candidate + 4, q);
+        }
+    }
+}
+
+// Best index per texel for the given endpoints, returns the total squared error
+float bc7SelectIndices(const uint8_t* block, const Bc7Endpoints& ep, int indices[16]) {
+    int e0[4], e1[4];
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = bc7Unquantize(ep.q[0][c], ep.p[0]);
+        e1[c] = bc7Unquantize(ep.q[1][c], ep.p[1]);
+    }
+    int palette[16][4];
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            palette[i][c] = bc7Interpolate(e0[c], e1[c], i);
+        }
+    }
+
+    float total = 0.0f;
+    for (int t = 0; t < 16; ++t) {
+        const uint8_t* px = block + t * 4;
+        int best = 0;
+        int bestError = INT32_MAX;
+        for (int i = 0; i < 16; ++i) {
+            int error = 0;
+            for (int c = 0; c < 4; ++c) {
+                int d = palette[i][c] - px[c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                best = i;
+            }
+        }
+        indices[t] = best;
+        total += static_cast<float>(bestError);
+    }
+    return total;
+}
+
+// Least squares endpoints for fixed indices, false if the system is degenerate
+bool bc7RefineEndpoints(const uint8_t* block, const int indices[16], float e0[4], float e1[4]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (int t = 0; t < 16; ++t) {
+        float w = BC7_WEIGHTS4[indices[t]] / 64.0f;
+        float a = 1.0f - w;
+        aa += a * a;
+        ab += a * w;
+        bb += w * w;
+        for (int c = 0; c < 4; ++c) {
+            ax[c] += a * block[t * 4 + c];
+            bx[c] += w * block[t * 4 + c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f) {
+        return false;
+    }
+    float inv = 1.0f / det;
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) * inv, 0.0f, 255.0f);
+        e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) * inv, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+void bc4Palette(int e0, int e1, int palette[8]) {
+    palette[0] = e0;
+    palette[1] = e1;
+    for (int i = 2; i < 8; ++i) {
+        palette[i] = ((8 - i) * e0 + (i - 1) * e1 + 3) / 7;
+    }
+}
+
+} // namespace
+
+bool BlockCompressor::isBlockCompressed(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+size_t BlockCompressor::getImageSize(VkFormat format, uint32_t width, uint32_t height) {
+    size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+    switch (format) {
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            return blocks * 16;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            return blocks * 8;
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_R8G8B8A8_UNORM:
+            return static_cast<size_t>(width) * height * 4;
+        default:
+            throw std::runtime_error("BlockCompressor: unsupported format!");
+    }
+}
+
+void BlockCompressor::compressImage(VkFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* dst) {
+    if (!isBlockCompressed(format)) {
+        memcpy(dst, rgba, getImageSize(format, width, height));
+        return;
+    }
+
+    size_t blockBytes = format == VK_FORMAT_BC4_UNORM_BLOCK ? 8 : 16;
+    uint8_t block[64];
+    for (uint32_t by = 0; by < height; by += 4) {
+        for (uint32_t bx = 0; bx < width; bx += 4) {
+            for (uint32_t y = 0; y < 4; ++y) {
+                uint32_t sy = std::min(by + y, height - 1);
+                for (uint32_t x = 0; x < 4; ++x) {
+                    uint32_t sx = std::min(bx + x, width - 1);
+                    memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                }
+            }
+
+            switch (format) {
+                case VK_FORMAT_BC4_UNORM_BLOCK: encodeBC4(block, 0, dst); break;
+                case VK_FORMAT_BC5_UNORM_BLOCK: encodeBC5(block, dst); break;
+                default: encodeBC7(block, dst); break;
+            }
+            dst += blockBytes;
+        }
+    }
+}
+
+void BlockCompressor::encodeBC4(const uint8_t* block, int channel, uint8_t* dst) {
+    int lo = 255, hi = 0;
+    for (int t = 0; t < 16; ++t) {
+        lo = std::min<int>(lo, block[t * 4 + channel]);
+        hi = std::max<int>(hi, block[t * 4 + channel]);
+    }
+
+    BitWriter writer(dst, 8);
+    writer.write(static_cast<uint32_t>(hi), 8);
+    writer.write(static_cast<uint32_t>(lo), 8);
+    if (hi == lo) {
+        return; // All indices 0
+    }
+
+    // e0 > e1 selects the 8 value mode
+    int palette[8];
+    bc4Palette(hi, lo, palette);
+    for (int t = 0; t < 16; ++t) {
+        int value = block[t * 4 + channel];
+        int best = 0;
+        for (int i = 1; i < 8; ++i) {
+            if (std::abs(palette[i] - value) < std::abs(palette[best] - value)) {
+                best = i;
+            }
+        }
+        writer.write(static_cast<uint32_t>(best), 3);
+    }
+}
+
+void BlockCompressor::encodeBC5(const uint8_t* block, uint8_t* dst) {
+    encodeBC4(block, 0, dst);
+    encodeBC4(block, 1, dst + 8);
+}
+
+void BlockCompressor::encodeBC7(const uint8_t* block, uint8_t* dst) {
+    // Mode 6: one subset, RGBA 7.7.7.7 endpoints with a p-bit each, 4-bit indices.
+    // Endpoints start at the extent of the block along its principal axis, then get
+    // a couple of least squares passes.
+    float mean[4] = {};
+    for (int t = 0; t < 16; ++t) {
+        for (int c = 0; c < 4; ++c) {
+            mean[c] += block[t * 4 + c] / 16.0f;
+        }
+    }
+    float cov[4][4] = {};
+    for (int t = 0; t < 16; ++t) {
+        float d[4];
+        for (int c = 0; c < 4; ++c) {
+            d[c] = block[t * 4 + c] - mean[c];
+        }
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                cov[i][j] += d[i] * d[j];
+            }
+        }
+    }
+    // Power iteration, seeded with the channel of largest variance (a fixed (1,1,1,1)
+    // seed is orthogonal to the axis of e.g. red-to-green gradients)
+    int seed = 0;
+    for (int c = 1; c < 4; ++c) {
+        if (cov[c][c] > cov[seed][seed]) {
+            seed = c;
+        }
+    }
+    float axis[4] = {};
+    axis[seed] = 1.0f;
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float next[4] = {};
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                next[i] += cov[i][j] * axis[j];
+            }
+        }
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+        if (length < 1e-6f) {
+            break; // Flat block, any axis works
+        }
+        for (int c = 0; c < 4; ++c) {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float tMin = 1e30f, tMax = -1e30f;
+    for (int t = 0; t < 16; ++t) {
+        float proj = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            proj += (block[t * 4 + c] - mean[c]) * axis[c];
+        }
+        tMin = std::min(tMin, proj);
+        tMax = std::max(tMax, proj);
+    }
+    float e0[4], e1[4];
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+        e1[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+    }
+
+    Bc7Endpoints best;
+    bc7QuantizeEndpoint(e0, best.q[0], best.p[0]);
+    bc7QuantizeEndpoint(e1, best.q[1], best.p[1]);
+    int bestIndices[16];
+    float bestError = bc7SelectIndices(block, best, bestIndices);
+
+    for (int iteration = 0; iteration < 2 && bestError > 0.0f; ++iteration) {
+        if (!bc7RefineEndpoints(block, bestIndices, e0, e1)) {
+            break;
+        }
+        Bc7Endpoints candidate;
+        bc7QuantizeEndpoint(e0, candidate.q[0], candidate.p[0]);
+        bc7QuantizeEndpoint(e1, candidate.q[1], candidate.p[1]);
+        int indices[16];
+        float error = bc7SelectIndices(block, candidate, indices);
+        if (error >= bestError) {
+            break;
+        }
+        best = candidate;
+        bestError = error;
+        std::copy(indices, indices + 16, bestIndices);
+    }
+
+    // The anchor (first) index drops its top bit, so it has to be < 8
+    if (bestIndices[0] >= 8) {
+        std::swap(best.q[0], best.q[1]);
+        std::swap(best.p[0], best.p[1]);
+        for (int& index : bestIndices) {
+            index = 15 - index;
+        }
+    }
+
+    BitWriter writer(dst, 16);
+    writer.write(1u << 6, 7); // Mode 6
+    for (int c = 0; c < 4; ++c) {
+        writer.write(static_cast<uint32_t>(best.q[0][c]), 7);
+        writer.write(static_cast<uint32_t>(best.q[1][c]), 7);
+    }
+    writer.write(static_cast<uint32_t>(best.p[0]), 1);
+    writer.write(static_cast<uint32_t>(best.p[1]), 1);
+    writer.write(static_cast<uint32_t>(bestIndices[0]), 3);
+    for (int t = 1; t < 16; ++t) {
+        writer.write(static_cast<uint32_t>(bestIndices[t]), 4);
+    }
+}
+
+} // namespace astral
@@ -0,0 +1,69 @@
+#include "astral/resources/upload_ring.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace astral {
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+UploadRing::UploadRing(Context* context, VkDeviceSize frameCapacity, uint32_t frameCount, VkBufferUsageFlags usage)
+    : m_frameCount(frameCount) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->getPhysicalDevice(), &properties);
+    // Every allocation may end up behind a storage buffer descriptor
+    m_alignment = std::max<VkDeviceSize>(properties.limits.minStorageBufferOffsetAlignment, 16);
+    m_frameCapacity = alignUp(frameCapacity, m_alignment);
+
+    m_buffer = std::make_unique<Buffer>(context, m_frameCapacity * frameCount, usage,
+                                        VMA_MEMORY_USAGE_CPU_TO_GPU, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    m_mapped = static_cast<char*>(m_buffer->getMappedData());
+    if (!m_mapped) {
+        throw std::runtime_error("Failed to persistently map upload ring!");
+    }
+
+    spdlog::info("UploadRing: {} frames x {:.1f} MB", frameCount, m_frameCapacity / (1024.0 * 1024.0));
+}
+
+void UploadRing::beginFrame(uint32_t frameIndex) {
+    if (frameIndex >= m_frameCount) {
+        throw std::runtime_error("UploadRing: frame index out of range!");
+    }
+    m_frameBase = m_frameCapacity * frameIndex;
+    m_head = m_frameBase;
+}
+
+UploadAllocation UploadRing::allocate(VkDeviceSize size) {
+    VkDeviceSize offset = alignUp(m_head, m_alignment);
+    if (offset + size > m_frameBase + m_frameCapacity) {
+        throw std::runtime_error("UploadRing: frame region exhausted (" + std::to_string(size) + " bytes requested)!");
+    }
+    m_head = offset + size;
+
+    UploadAllocation allocation;
+    allocation.buffer = m_buffer->getHandle();
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.data = m_mapped + offset;
+    return allocation;
+}
+
+UploadAllocation UploadRing::upload(const void* data, VkDeviceSize size) {
+    UploadAllocation allocation = allocate(size);
+    memcpy(allocation.data, data, size);
+    flush(allocation);
+    return allocation;
+}
+
+void UploadRing::flush(const UploadAllocation& allocation) {
+    m_buffer->flush(allocation.offset, allocation.size);
+}
+
+} // namespace astral